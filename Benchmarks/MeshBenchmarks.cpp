@@ -0,0 +1,790 @@
+//
+//  MeshBenchmarks.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+// Timings of the mesh kernel on spheres of several sizes, the argument is
+// the sphere step count (about steps^2 faces). Results go to JSON with
+// --benchmark_format=json or --benchmark_out=results.json, the profiler
+// trace of the whole run with --profiler_trace=trace.json. Spheres of about
+// 1M and 5M faces need several GB each and run only with --large_meshes.
+
+#include "Mesh2.h"
+#include "MeshDelta.h"
+#include "FPParallel.h"
+#include "WavefrontObjectReader.h"
+#include "WavefrontObjectWriter.h"
+#include <benchmark/benchmark.h>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+static Mesh2 *makeSphere(unsigned int steps)
+{
+    Mesh2 *mesh = new Mesh2();
+    mesh->make(MeshType::Sphere, steps);
+    return mesh;
+}
+
+static void selectEveryNthVertex(Mesh2 *mesh, unsigned int n)
+{
+    mesh->setSelectionMode(MeshSelectionMode::Vertices);
+    for (unsigned int i = 0; i < mesh->vertexCount(); i += n)
+        mesh->setSelectedAtIndex(true, i);
+}
+
+static void setFaceCounters(benchmark::State &state, unsigned int faces)
+{
+    state.counters["faces"] = faces;
+    state.SetItemsProcessed(state.iterations() * faces);
+}
+
+// High-water mark of the whole process, compare it between builds by
+// running one benchmark alone with --benchmark_filter.
+static double peakResidentBytes()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return (double)usage.ru_maxrss;
+#else
+    return (double)usage.ru_maxrss * 1024.0;
+#endif
+}
+
+static void SphereSizes(benchmark::internal::Benchmark *benchmark)
+{
+    benchmark->Arg(32)->Arg(128)->Arg(512)->Unit(benchmark::kMillisecond);
+}
+
+// about 1M and 5M faces
+static void LargeSphereSizes(benchmark::internal::Benchmark *benchmark)
+{
+    benchmark->Arg(1000)->Arg(2237)->Unit(benchmark::kMillisecond);
+}
+
+static void BM_MakeSphere(benchmark::State &state)
+{
+    unsigned int faces = 0;
+    while (state.KeepRunning())
+    {
+        Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+        faces = mesh->triangleCount();
+        mesh->release();
+    }
+    setFaceCounters(state, faces);
+}
+BENCHMARK(BM_MakeSphere)->Apply(SphereSizes);
+
+static void BM_MakeCylinder(benchmark::State &state)
+{
+    unsigned int faces = 0;
+    while (state.KeepRunning())
+    {
+        Mesh2 *mesh = new Mesh2();
+        mesh->make(MeshType::Cylinder, (unsigned int)state.range(0));
+        faces = mesh->triangleCount();
+        mesh->release();
+    }
+    setFaceCounters(state, faces);
+}
+BENCHMARK(BM_MakeCylinder)->Arg(1024)->Arg(65536)->Unit(benchmark::kMillisecond);
+
+static void BM_MakeSmallPrimitives(benchmark::State &state)
+{
+    while (state.KeepRunning())
+    {
+        Mesh2 *plane = new Mesh2();
+        plane->make(MeshType::Plane, 0);
+        Mesh2 *cube = new Mesh2();
+        cube->make(MeshType::Cube, 0);
+        Mesh2 *icosahedron = new Mesh2();
+        icosahedron->make(MeshType::Icosahedron, 0);
+        plane->release();
+        cube->release();
+        icosahedron->release();
+    }
+}
+BENCHMARK(BM_MakeSmallPrimitives);
+
+static void BM_MakeEdges(benchmark::State &state)
+{
+    Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+    while (state.KeepRunning())
+        mesh->makeEdges();
+    setFaceCounters(state, mesh->triangleCount());
+    mesh->release();
+}
+BENCHMARK(BM_MakeEdges)->Apply(SphereSizes);
+
+static void BM_LoopSubdivision(benchmark::State &state)
+{
+    unsigned int faces = 0;
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+        faces = mesh->triangleCount();
+        state.ResumeTiming();
+
+        mesh->loopSubdivision();
+
+        state.PauseTiming();
+        mesh->release();
+        state.ResumeTiming();
+    }
+    setFaceCounters(state, faces);
+}
+BENCHMARK(BM_LoopSubdivision)->Apply(SphereSizes);
+
+// levels 1 to 4, each with 1, 2, 4... threads up to the hardware threads
+static void SubdivisionLevelsAndThreads(benchmark::internal::Benchmark *benchmark)
+{
+    unsigned int hardwareThreads = FPParallel::threadCount();
+    for (int levels = 1; levels <= 4; levels++)
+    {
+        for (unsigned int threads = 1; ; threads *= 2)
+        {
+            benchmark->Args({ levels, (int)min(threads, hardwareThreads) });
+            if (threads >= hardwareThreads)
+                break;
+        }
+    }
+    benchmark->ArgNames({ "levels", "threads" })->Unit(benchmark::kMillisecond);
+}
+
+static void BM_LoopSubdivisionLevels(benchmark::State &state, MeshType meshType, unsigned int steps)
+{
+    unsigned int levels = (unsigned int)state.range(0);
+    FPParallel::setThreadCount((unsigned int)state.range(1));
+
+    unsigned int faces = 0;
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        Mesh2 *mesh = new Mesh2();
+        mesh->make(meshType, steps);
+        state.ResumeTiming();
+
+        for (unsigned int i = 0; i < levels; i++)
+            mesh->loopSubdivision();
+
+        state.PauseTiming();
+        faces = mesh->triangleCount();
+        mesh->release();
+        state.ResumeTiming();
+    }
+
+    FPParallel::setThreadCount(0);
+    setFaceCounters(state, faces);
+}
+BENCHMARK_CAPTURE(BM_LoopSubdivisionLevels, Sphere64, MeshType::Sphere, 64U)->Apply(SubdivisionLevelsAndThreads);
+BENCHMARK_CAPTURE(BM_LoopSubdivisionLevels, Icosahedron, MeshType::Icosahedron, 0U)->Apply(SubdivisionLevelsAndThreads);
+
+static void BM_Merge(benchmark::State &state)
+{
+    Mesh2 *other = makeSphere((unsigned int)state.range(0));
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+        state.ResumeTiming();
+
+        mesh->merge(other);
+
+        state.PauseTiming();
+        mesh->release();
+        state.ResumeTiming();
+    }
+    setFaceCounters(state, other->triangleCount() * 2);
+    other->release();
+}
+BENCHMARK(BM_Merge)->Apply(SphereSizes);
+
+static void BM_FromIndexRepresentation(benchmark::State &state)
+{
+    vector<Vector3D> vertices;
+    vector<Vector3D> texCoords;
+    vector<TriQuad> triangles;
+
+    Mesh2 *sphere = makeSphere((unsigned int)state.range(0));
+    sphere->toIndexRepresentation(vertices, texCoords, triangles);
+    sphere->release();
+
+    while (state.KeepRunning())
+    {
+        Mesh2 *mesh = new Mesh2();
+        mesh->fromIndexRepresentation(vertices, texCoords, triangles);
+        mesh->release();
+    }
+    state.counters["peakRSS"] = peakResidentBytes();
+    setFaceCounters(state, (unsigned int)triangles.size());
+}
+BENCHMARK(BM_FromIndexRepresentation)->Apply(SphereSizes);
+
+// only releasing a loaded mesh, with all its nodes and edges
+static void BM_Teardown(benchmark::State &state)
+{
+    vector<Vector3D> vertices;
+    vector<Vector3D> texCoords;
+    vector<TriQuad> triangles;
+
+    Mesh2 *sphere = makeSphere((unsigned int)state.range(0));
+    sphere->toIndexRepresentation(vertices, texCoords, triangles);
+    sphere->release();
+
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        Mesh2 *mesh = new Mesh2();
+        mesh->fromIndexRepresentation(vertices, texCoords, triangles);
+        state.ResumeTiming();
+
+        mesh->release();
+    }
+    state.counters["peakRSS"] = peakResidentBytes();
+    setFaceCounters(state, (unsigned int)triangles.size());
+}
+BENCHMARK(BM_Teardown)->Apply(SphereSizes);
+
+static void BM_TransformAll(benchmark::State &state)
+{
+    Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+    Matrix4x4 matrix;
+    matrix.Translate(Vector3D(0.001f, 0.0f, 0.0f));
+    while (state.KeepRunning())
+        mesh->transformAll(matrix);
+    setFaceCounters(state, mesh->triangleCount());
+    mesh->release();
+}
+BENCHMARK(BM_TransformAll)->Apply(SphereSizes);
+
+static void BM_TransformSelected(benchmark::State &state)
+{
+    Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+    selectEveryNthVertex(mesh, 4);
+    Matrix4x4 matrix;
+    matrix.Translate(Vector3D(0.001f, 0.0f, 0.0f));
+    while (state.KeepRunning())
+        mesh->transformSelected(matrix);
+    setFaceCounters(state, mesh->triangleCount());
+    mesh->release();
+}
+BENCHMARK(BM_TransformSelected)->Apply(SphereSizes);
+
+static void BM_SoftSelection(benchmark::State &state, SoftSelectionFalloff falloff)
+{
+    Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+    selectEveryNthVertex(mesh, 50);
+
+    Mesh2::setUseSoftSelection(true);
+    Mesh2::setSoftSelectionFalloff(falloff);
+    Mesh2::setSoftSelectionRadius(0.1f);
+
+    while (state.KeepRunning())
+        mesh->computeSoftSelection();
+
+    Mesh2::setUseSoftSelection(false);
+    Mesh2::setSoftSelectionFalloff(SoftSelectionFalloff::Steps);
+    setFaceCounters(state, mesh->triangleCount());
+    mesh->release();
+}
+BENCHMARK_CAPTURE(BM_SoftSelection, Steps, SoftSelectionFalloff::Steps)->Apply(SphereSizes);
+BENCHMARK_CAPTURE(BM_SoftSelection, Geodesic, SoftSelectionFalloff::Geodesic)->Apply(SphereSizes);
+BENCHMARK_CAPTURE(BM_SoftSelection, Euclidean, SoftSelectionFalloff::Euclidean)->Apply(SphereSizes);
+
+static void BM_FillTriangleCache(benchmark::State &state)
+{
+    Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+    while (state.KeepRunning())
+    {
+        mesh->resetTriangleCache();
+        mesh->fillTriangleCache();
+    }
+    setFaceCounters(state, mesh->triangleCount());
+    mesh->release();
+}
+BENCHMARK(BM_FillTriangleCache)->Apply(SphereSizes);
+
+// Rays from a sphere of radius 3 around the unit sphere mesh, each aimed
+// at a different point inside it, so the hits spread over the whole mesh.
+static void makeRays(unsigned int count, vector<Vector3D> &origins, vector<Vector3D> &directions)
+{
+    origins.resize(count);
+    directions.resize(count);
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        float z = 1.0f - 2.0f * (i + 0.5f) / count;
+        float r = sqrtf(1.0f - z * z);
+        float angle = 2.39996323f * i;
+        origins[i] = Vector3D(r * cosf(angle), r * sinf(angle), z) * 3.0f;
+
+        unsigned int j = (i * 7919U) % count;
+        z = 1.0f - 2.0f * (j + 0.5f) / count;
+        r = sqrtf(1.0f - z * z);
+        angle = 2.39996323f * j;
+        directions[i] = Vector3D(r * cosf(angle), r * sinf(angle), z) * 0.5f - origins[i];
+        directions[i].Normalize();
+    }
+}
+
+static const unsigned int kRayCount = 4096;
+
+// closest hits one ray at a time, items_per_second is rays per second
+static void BM_RayIntersect(benchmark::State &state)
+{
+    Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+    vector<Vector3D> origins, directions;
+    makeRays(kRayCount, origins, directions);
+
+    // the first query builds the BVH
+    TriangleHit hit;
+    mesh->rayIntersect(origins[0], directions[0], hit);
+
+    unsigned int hits = 0;
+    while (state.KeepRunning())
+    {
+        hits = 0;
+        for (unsigned int i = 0; i < kRayCount; i++)
+            hits += mesh->rayIntersect(origins[i], directions[i], hit) ? 1 : 0;
+    }
+
+    state.counters["hits"] = hits;
+    state.counters["faces"] = mesh->triangleCount();
+    state.SetItemsProcessed(state.iterations() * kRayCount);
+    mesh->release();
+}
+BENCHMARK(BM_RayIntersect)->Apply(SphereSizes);
+
+// the same rays in one batch, like a brush footprint in texture painting
+static void BM_RaysToUV(benchmark::State &state)
+{
+    Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+    vector<Vector3D> origins, directions;
+    makeRays(kRayCount, origins, directions);
+
+    vector<TriangleNode *> triangles;
+    vector<float> us, vs;
+    mesh->raysToUV(origins, directions, triangles, us, vs);
+
+    while (state.KeepRunning())
+        mesh->raysToUV(origins, directions, triangles, us, vs);
+
+    state.counters["hits"] = (double)(triangles.size() - count(triangles.begin(), triangles.end(), (TriangleNode *)NULL));
+    state.counters["faces"] = mesh->triangleCount();
+    state.SetItemsProcessed(state.iterations() * kRayCount);
+    mesh->release();
+}
+BENCHMARK(BM_RaysToUV)->Apply(SphereSizes);
+
+// Reports the footprint of a mesh ready for drawing, bytesPerFace is
+// the number to watch across releases.
+static void BM_MemoryFootprint(benchmark::State &state)
+{
+    Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+    mesh->fillTriangleCache();
+    mesh->fillEdgeCache();
+
+    FPMemoryFootprint footprint;
+    while (state.KeepRunning())
+        footprint = mesh->memoryFootprint();
+
+    for (unsigned int i = 0; i < (unsigned int)FPMemoryCategory::Count; i++)
+    {
+        FPMemoryCategory category = (FPMemoryCategory)i;
+        if (footprint.bytes(category) > 0)
+            state.counters[FPMemoryFootprint::categoryName(category)] = (double)footprint.bytes(category);
+    }
+    state.counters["bytesPerFace"] = (double)footprint.total() / mesh->triangleCount();
+    setFaceCounters(state, mesh->triangleCount());
+    mesh->release();
+}
+BENCHMARK(BM_MemoryFootprint)->Apply(SphereSizes);
+
+static void BM_Save(benchmark::State &state, float compressionTolerance)
+{
+    Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+    float previousTolerance = Mesh2::compressionTolerance();
+    Mesh2::setCompressionTolerance(compressionTolerance);
+
+    size_t length = 0;
+    while (state.KeepRunning())
+    {
+        MemoryWriteStream stream;
+        stream.setVersion((unsigned int)ModelVersion::Latest);
+        mesh->encode(&stream);
+        length = stream.length();
+    }
+
+    Mesh2::setCompressionTolerance(previousTolerance);
+    state.counters["bytes"] = (double)length;
+    state.SetBytesProcessed(state.iterations() * length);
+    setFaceCounters(state, mesh->triangleCount());
+    mesh->release();
+}
+BENCHMARK_CAPTURE(BM_Save, Plain, -1.0f)->Apply(SphereSizes);
+BENCHMARK_CAPTURE(BM_Save, Compressed, 0.0f)->Apply(SphereSizes);
+
+static void BM_Load(benchmark::State &state, float compressionTolerance)
+{
+    Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+    float previousTolerance = Mesh2::compressionTolerance();
+    Mesh2::setCompressionTolerance(compressionTolerance);
+
+    MemoryWriteStream written;
+    written.setVersion((unsigned int)ModelVersion::Latest);
+    mesh->encode(&written);
+    Mesh2::setCompressionTolerance(previousTolerance);
+
+    // released before loading, so only one mesh is alive at a time
+    unsigned int faces = mesh->triangleCount();
+    mesh->release();
+
+    while (state.KeepRunning())
+    {
+        MemoryReadStream stream(written.bytes(), written.length());
+        stream.setVersion((unsigned int)ModelVersion::Latest);
+        Mesh2 *loaded = new Mesh2(&stream);
+        loaded->release();
+    }
+
+    state.SetBytesProcessed(state.iterations() * written.length());
+    setFaceCounters(state, faces);
+}
+BENCHMARK_CAPTURE(BM_Load, Plain, -1.0f)->Apply(SphereSizes);
+BENCHMARK_CAPTURE(BM_Load, Compressed, 0.0f)->Apply(SphereSizes);
+
+static const unsigned int kUndoSteps = 1000;
+
+// Every tenth step extrudes one face, the steps after it move that face,
+// like a user modeling with extrude and drag.
+static void recordUndoSteps(Mesh2 *mesh, UndoMemory *memory, vector<MeshDelta *> &deltas)
+{
+    Matrix4x4 matrix;
+    matrix.Translate(Vector3D(0.0f, 0.01f, 0.0f));
+
+    for (unsigned int i = 0; i < kUndoSteps; i++)
+    {
+        bool extrude = i % 10 == 0;
+        MeshDelta *delta = new MeshDelta(mesh, 0, !extrude, memory);
+
+        if (extrude)
+        {
+            mesh->setSelectionMode(MeshSelectionMode::Triangles);
+            mesh->setSelection(vector<bool>(mesh->selectedCount(), false));
+            mesh->setSelectedAtIndex(true, (i * 37) % mesh->triangleCount());
+            mesh->extrudeSelectedTriangles();
+        }
+        else
+        {
+            mesh->transformSelected(matrix);
+        }
+
+        delta->finish(mesh);
+        deltas.push_back(delta);
+    }
+}
+
+// Undoes and redoes kUndoSteps recorded mesh deltas, recording is not
+// timed. undoBytes is what the recorded deltas hold.
+static void BM_UndoSteps(benchmark::State &state)
+{
+    size_t undoBytes = 0;
+    unsigned int faces = 0;
+
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+        UndoMemory *memory = new UndoMemory();
+        vector<MeshDelta *> deltas;
+        unsigned int vertexCount = mesh->vertexCount();
+        faces = mesh->triangleCount();
+        recordUndoSteps(mesh, memory, deltas);
+        undoBytes = memory->meshDeltas();
+        state.ResumeTiming();
+
+        for (unsigned int i = (unsigned int)deltas.size(); i-- > 0;)
+            deltas[i]->swap(mesh);
+
+        if (mesh->vertexCount() != vertexCount)
+            state.SkipWithError("undo did not restore the mesh");
+
+        for (unsigned int i = 0; i < deltas.size(); i++)
+            deltas[i]->swap(mesh);
+
+        state.PauseTiming();
+        for (unsigned int i = 0; i < deltas.size(); i++)
+            delete deltas[i];
+        memory->release();
+        mesh->release();
+        state.ResumeTiming();
+    }
+
+    state.counters["undoBytes"] = (double)undoBytes;
+    state.counters["faces"] = faces;
+    state.SetItemsProcessed(state.iterations() * kUndoSteps * 2);
+}
+BENCHMARK(BM_UndoSteps)->Arg(32)->Arg(128)->Unit(benchmark::kMillisecond);
+
+// The exporter MyDocument used before WavefrontObjectWriter, without the
+// final copies through NSString and NSData.
+static string exportWavefrontObjectWithStringStream(Mesh2 *original, const Matrix4x4 &transform)
+{
+    stringstream ssfile;
+    ssfile << "# Exported from MeshMaker" << endl;
+
+    vector<Vector3D> vertices;
+    vector<Vector3D> texCoords;
+    vector<TriQuad> triangles;
+
+    Mesh2 *mesh = original->copy();
+    mesh->transformAll(transform);
+    mesh->flipAllTriangles();
+    mesh->toIndexRepresentation(vertices, texCoords, triangles);
+
+    ssfile << "g Item_0" << endl;
+    ssfile << "# Number of vertices = " << vertices.size() << endl;
+    for (unsigned int i = 0; i < vertices.size(); i++)
+    {
+        Vector3D v = vertices[i];
+        v.z = -v.z;
+        swap(v.y, v.z);
+        ssfile << "v " << v.x << " " << v.y << " " << v.z << endl;
+    }
+
+    ssfile << "# Number of texture coordinates = " << texCoords.size() << endl;
+    for (unsigned int i = 0; i < texCoords.size(); i++)
+        ssfile << "vt " << texCoords[i].x << " " << texCoords[i].y << " " << endl;
+
+    ssfile << "# Number of triangles and quads = " << triangles.size() << endl;
+    for (unsigned int i = 0; i < triangles.size(); i++)
+    {
+        ssfile << "f ";
+        const TriQuad &triQuad = triangles[i];
+        unsigned int count = triQuad.isQuad ? 4 : 3;
+        for (unsigned int j = 0; j < count; j++)
+        {
+            ssfile << triQuad.vertexIndices[j] + 1 << "/";
+            ssfile << triQuad.texCoordIndices[j] + 1 << " ";
+        }
+        ssfile << endl;
+    }
+
+    mesh->release();
+    return ssfile.str();
+}
+
+static Matrix4x4 exportTransform()
+{
+    Matrix4x4 transform;
+    transform.Translate(Vector3D(1.5f, -2.25f, 0.125f));
+    return transform;
+}
+
+static void BM_ExportObjStringStream(benchmark::State &state)
+{
+    Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+    Matrix4x4 transform = exportTransform();
+
+    size_t length = 0;
+    while (state.KeepRunning())
+        length = exportWavefrontObjectWithStringStream(mesh, transform).size();
+
+    state.SetBytesProcessed(state.iterations() * length);
+    setFaceCounters(state, mesh->triangleCount());
+    mesh->release();
+}
+BENCHMARK(BM_ExportObjStringStream)->Apply(SphereSizes);
+
+static void BM_ExportObjWriter(benchmark::State &state)
+{
+    Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+    Matrix4x4 transform = exportTransform();
+
+    size_t length = 0;
+    while (state.KeepRunning())
+    {
+        WavefrontObjectWriter writer;
+        writer.setComment("Exported from MeshMaker");
+        writer.addGroup("Item_0", mesh, transform);
+
+        MemoryWriteStream stream;
+        writer.write(&stream);
+        length = stream.length();
+    }
+
+    state.SetBytesProcessed(state.iterations() * length);
+    setFaceCounters(state, mesh->triangleCount());
+    mesh->release();
+}
+BENCHMARK(BM_ExportObjWriter)->Apply(SphereSizes);
+
+// streamed to a file descriptor, /dev/null leaves out the disk
+static void BM_ExportObjWriterToFile(benchmark::State &state)
+{
+    Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+    Matrix4x4 transform = exportTransform();
+    int fd = open("/dev/null", O_WRONLY);
+
+    MemoryWriteStream stream;
+    WavefrontObjectWriter measure;
+    measure.addGroup("Item_0", mesh, transform);
+    measure.write(&stream);
+
+    while (state.KeepRunning())
+    {
+        WavefrontObjectWriter writer;
+        writer.addGroup("Item_0", mesh, transform);
+        if (!writer.write(fd))
+            state.SkipWithError("write failed");
+    }
+
+    close(fd);
+    state.SetBytesProcessed(state.iterations() * stream.length());
+    setFaceCounters(state, mesh->triangleCount());
+    mesh->release();
+}
+BENCHMARK(BM_ExportObjWriterToFile)->Apply(SphereSizes);
+
+// parsing only, bytes_per_second is the import rate
+static void BM_ImportObj(benchmark::State &state)
+{
+    Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+    MemoryWriteStream stream;
+    WavefrontObjectWriter writer;
+    writer.addGroup("Item_0", mesh, exportTransform());
+    writer.write(&stream);
+    unsigned int faces = mesh->triangleCount();
+    mesh->release();
+
+    while (state.KeepRunning())
+    {
+        WavefrontObjectReader reader;
+        reader.read((const char *)stream.bytes(), stream.length());
+    }
+
+    state.SetBytesProcessed(state.iterations() * stream.length());
+    setFaceCounters(state, faces);
+}
+BENCHMARK(BM_ImportObj)->Apply(SphereSizes);
+
+// Mapped from a file and built into meshes like an opened document. The
+// file stays in the page cache, so the disk is left out.
+static void BM_ImportObjFileToMesh(benchmark::State &state)
+{
+    Mesh2 *mesh = makeSphere((unsigned int)state.range(0));
+    char path[] = "/tmp/MeshBenchmarksXXXXXX";
+    int fd = mkstemp(path);
+    WavefrontObjectWriter writer;
+    writer.addGroup("Item_0", mesh, exportTransform());
+    if (fd < 0 || !writer.write(fd))
+        state.SkipWithError("cannot write temporary file");
+    off_t length = fd < 0 ? 0 : lseek(fd, 0, SEEK_END);
+    unsigned int faces = mesh->triangleCount();
+    mesh->release();
+
+    while (state.KeepRunning())
+    {
+        WavefrontObjectReader reader;
+        if (!reader.readFile(path))
+        {
+            state.SkipWithError("cannot read temporary file");
+            break;
+        }
+
+        for (unsigned int i = 0; i < reader.groupCount(); i++)
+        {
+            vector<Vector3D> vertices;
+            vector<Vector3D> texCoords;
+            vector<TriQuad> triangles;
+            reader.groupIndexRepresentation(i, vertices, texCoords, triangles);
+
+            Mesh2 *loaded = new Mesh2();
+            loaded->fromIndexRepresentation(vertices, texCoords, triangles);
+            loaded->release();
+        }
+    }
+
+    if (fd >= 0)
+    {
+        close(fd);
+        unlink(path);
+    }
+    state.SetBytesProcessed(state.iterations() * length);
+    setFaceCounters(state, faces);
+}
+BENCHMARK(BM_ImportObjFileToMesh)->Apply(SphereSizes);
+
+struct CompressionToleranceBenchmark
+{
+    void (*function)(benchmark::State &, float);
+    float compressionTolerance;
+
+    void operator()(benchmark::State &state) const { function(state, compressionTolerance); }
+};
+
+// Triangle cache rebuild, save and load of about 1M and 5M faces, each
+// mesh alone needs about 2.8 KB per face.
+static void registerLargeMeshBenchmarks()
+{
+    CompressionToleranceBenchmark savePlain = { BM_Save, -1.0f };
+    CompressionToleranceBenchmark saveCompressed = { BM_Save, 0.0f };
+    CompressionToleranceBenchmark loadPlain = { BM_Load, -1.0f };
+    CompressionToleranceBenchmark loadCompressed = { BM_Load, 0.0f };
+
+    benchmark::RegisterBenchmark("BM_FillTriangleCache", BM_FillTriangleCache)->Apply(LargeSphereSizes);
+    benchmark::RegisterBenchmark("BM_Save/Plain", savePlain)->Apply(LargeSphereSizes);
+    benchmark::RegisterBenchmark("BM_Save/Compressed", saveCompressed)->Apply(LargeSphereSizes);
+    benchmark::RegisterBenchmark("BM_Load/Plain", loadPlain)->Apply(LargeSphereSizes);
+    benchmark::RegisterBenchmark("BM_Load/Compressed", loadCompressed)->Apply(LargeSphereSizes);
+}
+
+int main(int argc, char **argv)
+{
+    const char *tracePath = NULL;
+    const char *traceFlag = "--profiler_trace=";
+    bool largeMeshes = false;
+
+    for (int i = 1; i < argc;)
+    {
+        if (strncmp(argv[i], traceFlag, strlen(traceFlag)) == 0)
+            tracePath = argv[i] + strlen(traceFlag);
+        else if (strcmp(argv[i], "--large_meshes") == 0)
+            largeMeshes = true;
+        else
+        {
+            i++;
+            continue;
+        }
+
+        for (int j = i; j < argc - 1; j++)
+            argv[j] = argv[j + 1];
+        argc--;
+    }
+
+    if (largeMeshes)
+        registerLargeMeshBenchmarks();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+
+    FPProfiler::clear();
+    benchmark::RunSpecifiedBenchmarks();
+
+    if (tracePath != NULL && !FPProfiler::writeChromeTrace(tracePath))
+    {
+        fprintf(stderr, "Cannot write profiler trace to %s\n", tracePath);
+        return 1;
+    }
+    return 0;
+}
@@ -12,7 +12,8 @@
 
 - (void)applicationWillFinishLaunching:(NSNotification *)notification
 {
-    [[NSUserDefaults standardUserDefaults] registerDefaults:@{ @"WebKitDeveloperExtras" : @YES }];
+    [[NSUserDefaults standardUserDefaults] registerDefaults:@{ @"WebKitDeveloperExtras" : @YES,
+                                                               @"UndoMemoryBudget" : @256 }];
 }
 
 - (IBAction)showHelp:(id)sender
@@ -25,6 +25,13 @@ enum class MeshSelectionMode
 	Edges,
 };
 
+enum class SoftSelectionFalloff
+{
+    Steps = 0,
+    Geodesic = 1,
+    Euclidean = 2,
+};
+
 enum class ManipulatorType
 {
 	Default = 0,
@@ -101,8 +108,9 @@ enum class ModelVersion : unsigned int
     TriQuads = 3U,
     CrossPlatform = 4U,
     TextureNames = 5U,
+    BulkArrays = 6U,
 
-    Latest = TextureNames
+    Latest = BulkArrays
 };
 
 enum class VertexWindowMode
@@ -8,6 +8,10 @@
 
 #pragma once
 
+#include <vector>
+#include <algorithm>
+using namespace std;
+
 template <class T>
 class FPArrayCache
 {
@@ -16,6 +20,8 @@ private:
     unsigned int _count;
     unsigned int _capacity;
     bool _isValid;
+    bool _allDirty;
+    vector<pair<unsigned int, unsigned int> > _dirtyRanges;
     
 public:
     FPArrayCache()
@@ -24,6 +30,7 @@ public:
         _capacity = 0;
         _array = NULL;
         _isValid = false;
+        _allDirty = false;
     }
     
     ~FPArrayCache() 
@@ -35,9 +42,72 @@ public:
     operator T *() { return _array; }
                   
     unsigned int count() const { return _count; }
+    size_t memorySize() const { return _capacity * sizeof(T) + _dirtyRanges.capacity() * sizeof(_dirtyRanges[0]); }
     bool isValid() const { return _isValid; }
     void setValid(bool valid) { _isValid = valid; }
 
+    // Changes waiting for upload, kept as [begin, end) ranges in the order they were marked.
+    bool isDirty() const { return _allDirty || !_dirtyRanges.empty(); }
+    bool isAllDirty() const { return _allDirty; }
+    
+    void markAllDirty()
+    {
+        _allDirty = true;
+        _dirtyRanges.clear();
+    }
+    
+    void markDirty(unsigned int index)
+    {
+        if (_allDirty)
+            return;
+        
+        if (!_dirtyRanges.empty())
+        {
+            pair<unsigned int, unsigned int> &last = _dirtyRanges.back();
+            if (index + 1 >= last.first && index <= last.second)
+            {
+                last.first = min(last.first, index);
+                last.second = max(last.second, index + 1);
+                return;
+            }
+        }
+        
+        _dirtyRanges.push_back(make_pair(index, index + 1));
+    }
+    
+    // Sorts the dirty ranges and joins those closer than gap elements.
+    // Returns the number of dirty elements after joining.
+    unsigned int coalesceDirtyRanges(unsigned int gap)
+    {
+        if (_dirtyRanges.empty())
+            return 0;
+        
+        sort(_dirtyRanges.begin(), _dirtyRanges.end());
+        
+        unsigned int last = 0;
+        for (unsigned int i = 1; i < _dirtyRanges.size(); i++)
+        {
+            if (_dirtyRanges[i].first <= _dirtyRanges[last].second + gap)
+                _dirtyRanges[last].second = max(_dirtyRanges[last].second, _dirtyRanges[i].second);
+            else
+                _dirtyRanges[++last] = _dirtyRanges[i];
+        }
+        _dirtyRanges.resize(last + 1);
+        
+        unsigned int dirtyCount = 0;
+        for (unsigned int i = 0; i < _dirtyRanges.size(); i++)
+            dirtyCount += _dirtyRanges[i].second - _dirtyRanges[i].first;
+        return dirtyCount;
+    }
+    
+    const vector<pair<unsigned int, unsigned int> > &dirtyRanges() const { return _dirtyRanges; }
+    
+    void clearDirty()
+    {
+        _allDirty = false;
+        _dirtyRanges.clear();
+    }
+
     void clear()
     {
         _count = 0;
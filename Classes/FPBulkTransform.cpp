@@ -0,0 +1,104 @@
+//
+//  FPBulkTransform.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "FPBulkTransform.h"
+#include "FPParallel.h"
+#include <algorithm>
+using namespace std;
+
+struct ContiguousPositions
+{
+    Vector3D *positions;
+
+    Vector3D &operator[](unsigned int index) const { return positions[index]; }
+};
+
+struct ScatteredPositions
+{
+    Vector3D *const *positions;
+
+    Vector3D &operator[](unsigned int index) const { return *positions[index]; }
+};
+
+template <class TPositions>
+struct TransformRange
+{
+    const float *m;
+    TPositions positions;
+    const float *weights;
+
+    TransformRange(const Matrix4x4 &matrix, TPositions positions, const float *weights) :
+        m(matrix.m), positions(positions), weights(weights) { }
+
+    void operator()(unsigned int begin, unsigned int end)
+    {
+        const unsigned int kBatchSize = FPBulkTransform::kBatchSize;
+        float x[kBatchSize], y[kBatchSize], z[kBatchSize];
+        float tx[kBatchSize], ty[kBatchSize], tz[kBatchSize];
+
+        for (unsigned int start = begin; start < end; start += kBatchSize)
+        {
+            unsigned int count = min(end - start, kBatchSize);
+
+            // the tail batch repeats its last position
+            for (unsigned int k = 0; k < kBatchSize; k++)
+            {
+                const Vector3D &v = positions[start + min(k, count - 1)];
+                x[k] = v.x;
+                y[k] = v.y;
+                z[k] = v.z;
+            }
+
+            for (unsigned int k = 0; k < kBatchSize; k++)
+            {
+                tx[k] = x[k] * m[0] + y[k] * m[4] + z[k] * m[8] + m[12];
+                ty[k] = x[k] * m[1] + y[k] * m[5] + z[k] * m[9] + m[13];
+                tz[k] = x[k] * m[2] + y[k] * m[6] + z[k] * m[10] + m[14];
+            }
+
+            if (weights != NULL)
+            {
+                const float *w = weights + start;
+                for (unsigned int k = 0; k < count; k++)
+                {
+                    tx[k] = x[k] * (1.0f - w[k]) + tx[k] * w[k];
+                    ty[k] = y[k] * (1.0f - w[k]) + ty[k] * w[k];
+                    tz[k] = z[k] * (1.0f - w[k]) + tz[k] * w[k];
+                }
+            }
+
+            for (unsigned int k = 0; k < count; k++)
+            {
+                Vector3D &v = positions[start + k];
+                v.x = tx[k];
+                v.y = ty[k];
+                v.z = tz[k];
+            }
+        }
+    }
+};
+
+void FPBulkTransform::transform(const Matrix4x4 &matrix, Vector3D *positions, unsigned int count)
+{
+    ContiguousPositions contiguous = { positions };
+    TransformRange<ContiguousPositions> range(matrix, contiguous, NULL);
+    FPParallel::forRange(count, range);
+}
+
+void FPBulkTransform::transform(const Matrix4x4 &matrix, Vector3D *const *positions, unsigned int count)
+{
+    ScatteredPositions scattered = { positions };
+    TransformRange<ScatteredPositions> range(matrix, scattered, NULL);
+    FPParallel::forRange(count, range);
+}
+
+void FPBulkTransform::transform(const Matrix4x4 &matrix, Vector3D *const *positions, const float *weights, unsigned int count)
+{
+    ScatteredPositions scattered = { positions };
+    TransformRange<ScatteredPositions> range(matrix, scattered, weights);
+    FPParallel::forRange(count, range);
+}
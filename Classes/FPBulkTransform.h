@@ -0,0 +1,28 @@
+//
+//  FPBulkTransform.h
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#pragma once
+
+#include "MathDeclaration.h"
+
+// Applies one affine matrix to many positions, same result as
+// Matrix4x4::Transform. Positions are loaded in batches of eight into
+// separate x, y and z lanes which the compiler vectorizes, large counts
+// are split over FPParallel workers.
+class FPBulkTransform
+{
+public:
+    static const unsigned int kBatchSize = 8;
+
+    static void transform(const Matrix4x4 &matrix, Vector3D *positions, unsigned int count);
+
+    // positions scattered in memory, like vertex list nodes
+    static void transform(const Matrix4x4 &matrix, Vector3D *const *positions, unsigned int count);
+
+    // each position moves by its weight towards the transformed one, like Vector3D::Lerp
+    static void transform(const Matrix4x4 &matrix, Vector3D *const *positions, const float *weights, unsigned int count);
+};
@@ -0,0 +1,124 @@
+//
+//  FPEdgeMap.h
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+// Open addressing hash map from an unordered pair of vertex nodes to the edge
+// connecting them. Keys are stored as (min, max) so both directions match.
+template <class TVertex, class TEdge>
+class FPEdgeMap
+{
+private:
+    struct Slot
+    {
+        const TVertex *first;
+        const TVertex *second;
+        TEdge *edge;
+    };
+
+    vector<Slot> _slots;
+    size_t _mask;
+    size_t _count;
+
+    static size_t hash(const TVertex *first, const TVertex *second)
+    {
+        size_t h = (size_t)first * 0x9E3779B1U;
+        h ^= (size_t)second + 0x7F4A7C15U + (h << 6) + (h >> 2);
+        return h ^ (h >> 15);
+    }
+
+    void rehash(size_t capacity)
+    {
+        vector<Slot> oldSlots;
+        oldSlots.swap(_slots);
+
+        Slot empty = { NULL, NULL, NULL };
+        _slots.assign(capacity, empty);
+        _mask = capacity - 1;
+        _count = 0;
+
+        for (size_t i = 0; i < oldSlots.size(); i++)
+        {
+            if (oldSlots[i].edge != NULL)
+                add(oldSlots[i].first, oldSlots[i].second, oldSlots[i].edge);
+        }
+    }
+
+    void add(const TVertex *first, const TVertex *second, TEdge *edge)
+    {
+        size_t i = hash(first, second) & _mask;
+        while (_slots[i].edge != NULL)
+            i = (i + 1) & _mask;
+
+        _slots[i].first = first;
+        _slots[i].second = second;
+        _slots[i].edge = edge;
+        _count++;
+    }
+
+    FPEdgeMap(const FPEdgeMap &other);
+    FPEdgeMap &operator=(const FPEdgeMap &other);
+
+public:
+    FPEdgeMap() : _mask(0), _count(0) { }
+
+    size_t count() const { return _count; }
+    size_t memorySize() const { return _slots.capacity() * sizeof(Slot); }
+
+    // keeps the slot array, so rebuilding a map of similar size does not allocate
+    void clear()
+    {
+        if (_count == 0)
+            return;
+
+        Slot empty = { NULL, NULL, NULL };
+        fill(_slots.begin(), _slots.end(), empty);
+        _count = 0;
+    }
+
+    void reserve(size_t count)
+    {
+        size_t capacity = 16;
+        while (capacity < count * 2)
+            capacity *= 2;
+
+        if (capacity > _slots.size())
+            rehash(capacity);
+    }
+
+    TEdge *find(const TVertex *v1, const TVertex *v2) const
+    {
+        if (_count == 0)
+            return NULL;
+
+        const TVertex *first = v1 < v2 ? v1 : v2;
+        const TVertex *second = v1 < v2 ? v2 : v1;
+
+        size_t i = hash(first, second) & _mask;
+        while (_slots[i].edge != NULL)
+        {
+            if (_slots[i].first == first && _slots[i].second == second)
+                return _slots[i].edge;
+            i = (i + 1) & _mask;
+        }
+
+        return NULL;
+    }
+
+    void insert(const TVertex *v1, const TVertex *v2, TEdge *edge)
+    {
+        if ((_count + 1) * 2 > _slots.size())
+            rehash(_slots.empty() ? 16 : _slots.size() * 2);
+
+        add(v1 < v2 ? v1 : v2, v1 < v2 ? v2 : v1, edge);
+    }
+};
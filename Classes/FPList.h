@@ -8,6 +8,9 @@
 
 #pragma once
 
+#include "FPNodeAllocator.h"
+#include <new>
+
 template <class TNode, class TData>
 class FPList
 {
@@ -15,25 +18,55 @@ private:
     TNode *_begin;
     TNode *_end;
     unsigned int _count;
-public:
-    FPList()
+    FPNodeAllocator *_allocator;
+    
+    FPList(const FPList &other);
+    FPList &operator=(const FPList &other);
+    
+    TNode *createNode()
+    {
+        if (_allocator)
+            return new (_allocator->allocate(sizeof(TNode))) TNode(_allocator);
+        return new TNode();
+    }
+    
+    void destroyNode(TNode *node)
+    {
+        if (_allocator)
+        {
+            node->~TNode();
+            _allocator->deallocate(node, sizeof(TNode));
+        }
+        else
+        {
+            delete node;
+        }
+    }
+    
+    void createSentinels()
     {
-        _begin = new TNode();
-        _end = new TNode();
+        _begin = createNode();
+        _end = createNode();
         
         _begin->_next = _end;
         _end->_previous = _begin;
         _count = 0U;
     }
+public:
+    FPList(FPNodeAllocator *allocator = NULL)
+    {
+        _allocator = allocator;
+        createSentinels();
+    }
     
     virtual ~FPList()
     {
         if (_begin && _end)
         {
             removeAll();
-            delete _begin;
+            destroyNode(_begin);
             _begin = NULL;
-            delete _end;
+            destroyNode(_end);
             _end = NULL;        
         }
     }
@@ -43,12 +76,13 @@ public:
         if (_begin && _end)
         {
             removeAll();
-            delete _begin;
+            destroyNode(_begin);
             _begin = NULL;
-            delete _end;
+            destroyNode(_end);
             _end = NULL;        
         }
         
+        _allocator = other._allocator;
         _begin = other._begin;
         _end = other._end;
         _count = other._count;
@@ -58,6 +92,15 @@ public:
         other._count = 0U;
     }
     
+    // Forgets all nodes without running their destructors. Valid only after
+    // the allocator owning them released its slabs, e.g. in Mesh2 teardown.
+    void abandonAll()
+    {
+        createSentinels();
+    }
+    
+    FPNodeAllocator *allocator() const { return _allocator; }
+    
     TNode *begin() const { return _begin->_next; }
     TNode *end() const { return _end; } 
     
@@ -88,13 +131,25 @@ public:
         next->_previous = previous;
         previous->_next = next;
         
-        delete node;
+        destroyNode(node);
         
         node = previous;
         
         _count--;
     }
     
+    // relinks a node of this list in front of the end
+    void moveToEnd(TNode *node)
+    {
+        node->_next->_previous = node->_previous;
+        node->_previous->_next = node->_next;
+        
+        node->_previous = _end->_previous;
+        node->_next = _end;
+        _end->_previous->_next = node;
+        _end->_previous = node;
+    }
+    
     void removeAll()
     {
         TNode *current = _begin->_next;
@@ -102,7 +157,7 @@ public:
         while (current != _end)
         {
             current = current->_next;
-            delete current->_previous;
+            destroyNode(current->_previous);
         }
         
         _begin->_next = _end;
@@ -113,7 +168,7 @@ public:
     
     TNode *add(const TData &data)
     {
-        TNode *newEnd = new TNode();
+        TNode *newEnd = createNode();
         TNode *oldEnd = _end;
         oldEnd->setData(data);
         oldEnd->_next = newEnd;
@@ -124,5 +179,23 @@ public:
          
         return oldEnd;
     }   
+    
+    // links a new node in front of next, which can be the end
+    TNode *insert(TNode *next, const TData &data)
+    {
+        if (next == _end)
+            return add(data);
+        
+        TNode *node = createNode();
+        node->setData(data);
+        node->_previous = next->_previous;
+        node->_next = next;
+        next->_previous->_next = node;
+        next->_previous = node;
+        
+        _count++;
+        
+        return node;
+    }
 };
 
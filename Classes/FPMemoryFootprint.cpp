@@ -0,0 +1,72 @@
+//
+//  FPMemoryFootprint.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "FPMemoryFootprint.h"
+#include <cstdio>
+
+static const char *const kCategoryNames[] =
+{
+    "vertices",
+    "texCoords",
+    "triangles",
+    "vertexEdges",
+    "texCoordEdges",
+    "adjacency",
+    "allocatorSlack",
+    "edgeMaps",
+    "spatialIndex",
+    "selectionCaches",
+    "renderCaches",
+    "objects",
+    "undo",
+};
+
+FPMemoryFootprint::FPMemoryFootprint()
+{
+    for (unsigned int i = 0; i < (unsigned int)FPMemoryCategory::Count; i++)
+        _bytes[i] = 0;
+}
+
+void FPMemoryFootprint::add(const FPMemoryFootprint &other)
+{
+    for (unsigned int i = 0; i < (unsigned int)FPMemoryCategory::Count; i++)
+        _bytes[i] += other._bytes[i];
+}
+
+size_t FPMemoryFootprint::total() const
+{
+    size_t total = 0;
+    for (unsigned int i = 0; i < (unsigned int)FPMemoryCategory::Count; i++)
+        total += _bytes[i];
+    return total;
+}
+
+const char *FPMemoryFootprint::categoryName(FPMemoryCategory category)
+{
+    return kCategoryNames[(unsigned int)category];
+}
+
+static void appendLine(string &text, const char *name, size_t bytes)
+{
+    char line[128];
+    snprintf(line, sizeof(line), "%-16s %12.2f MB\n", name, bytes / (1024.0 * 1024.0));
+    text += line;
+}
+
+string FPMemoryFootprint::description() const
+{
+    string text;
+
+    for (unsigned int i = 0; i < (unsigned int)FPMemoryCategory::Count; i++)
+    {
+        if (_bytes[i] > 0)
+            appendLine(text, kCategoryNames[i], _bytes[i]);
+    }
+
+    appendLine(text, "total", total());
+    return text;
+}
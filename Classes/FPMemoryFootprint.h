@@ -0,0 +1,52 @@
+//
+//  FPMemoryFootprint.h
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+using namespace std;
+
+enum class FPMemoryCategory
+{
+    Vertices = 0,
+    TexCoords,
+    Triangles,
+    VertexEdges,
+    TexCoordEdges,
+    Adjacency,
+    AllocatorSlack,
+    EdgeMaps,
+    SpatialIndex,
+    SelectionCaches,
+    RenderCaches,
+    Objects,
+    Undo,
+
+    Count
+};
+
+// Heap bytes held by meshes, split by what they are used for. Containers
+// are counted by capacity, list nodes by the blocks the node allocator
+// gave them, so the parts add up to what is really allocated.
+class FPMemoryFootprint
+{
+private:
+    size_t _bytes[(unsigned int)FPMemoryCategory::Count];
+public:
+    FPMemoryFootprint();
+
+    size_t bytes(FPMemoryCategory category) const { return _bytes[(unsigned int)category]; }
+    void add(FPMemoryCategory category, size_t bytes) { _bytes[(unsigned int)category] += bytes; }
+    void add(const FPMemoryFootprint &other);
+    size_t total() const;
+
+    static const char *categoryName(FPMemoryCategory category);
+
+    // one line per category that holds anything, then the total
+    string description() const;
+};
@@ -0,0 +1,652 @@
+//
+//  FPMeshCodec.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "FPMeshCodec.h"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+enum CodecFlags
+{
+    CodecQuantized = 1,
+    CodecFlatTexCoords = 2,
+};
+
+enum StreamMethod
+{
+    StreamRaw = 0,
+    StreamRANS = 1,
+    StreamConstant = 2,
+};
+
+const unsigned char kCodecVersion = 1;
+const unsigned int kMinimumRANSLength = 64;
+const unsigned int kScaleBits = 12;
+const unsigned int kScale = 1U << kScaleBits;
+const unsigned int kRANSLow = 1U << 16;
+const float kMaximumQuantizedExtent = 1073741824.0f;
+
+template <class T>
+static inline void writeValue(vector<unsigned char> &bytes, T value)
+{
+    const unsigned char *p = (const unsigned char *)&value;
+    bytes.insert(bytes.end(), p, p + sizeof(T));
+}
+
+template <class T>
+static inline bool readValue(const unsigned char *&p, const unsigned char *end, T &value)
+{
+    if ((size_t)(end - p) < sizeof(T))
+        return false;
+    memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+static inline unsigned int zigzag(int value)
+{
+    return ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+}
+
+static inline int unzigzag(unsigned int value)
+{
+    return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+static inline void writeVarint(vector<unsigned char> &bytes, unsigned int value)
+{
+    while (value >= 0x80)
+    {
+        bytes.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back((unsigned char)value);
+}
+
+static inline bool readVarint(const unsigned char *&p, const unsigned char *end, unsigned int &value)
+{
+    if (end - p >= 5)
+    {
+        unsigned int byte = *p++;
+        unsigned int result = byte & 0x7F;
+        for (unsigned int shift = 7; byte >= 0x80 && shift < 35; shift += 7)
+        {
+            byte = *p++;
+            result |= (byte & 0x7F) << shift;
+        }
+        value = result;
+        return byte < 0x80;
+    }
+    
+    unsigned int result = 0;
+    for (unsigned int shift = 0; shift < 35; shift += 7)
+    {
+        if (p >= end)
+            return false;
+        unsigned int byte = *p++;
+        result |= (byte & 0x7F) << shift;
+        if (byte < 0x80)
+        {
+            value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline unsigned int floatBits(float value)
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static inline float bitsFloat(unsigned int bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// rANS
+
+// Scales symbol counts to frequencies summing to kScale, every used symbol keeps at least one.
+static void normalizeFrequencies(const unsigned int counts[256], unsigned int total, unsigned int frequencies[256])
+{
+    unsigned int sum = 0;
+    unsigned int largest = 0;
+
+    for (unsigned int s = 0; s < 256; s++)
+    {
+        if (counts[s] == 0)
+        {
+            frequencies[s] = 0;
+            continue;
+        }
+
+        frequencies[s] = max(1U, (unsigned int)((unsigned long long)counts[s] * kScale / total));
+        sum += frequencies[s];
+
+        if (frequencies[s] > frequencies[largest])
+            largest = s;
+    }
+
+    if (sum <= kScale)
+    {
+        frequencies[largest] += kScale - sum;
+        return;
+    }
+
+    unsigned int excess = min(sum - kScale, frequencies[largest] - 1);
+    frequencies[largest] -= excess;
+    sum -= excess;
+
+    while (sum > kScale)
+    {
+        for (unsigned int s = 0; s < 256 && sum > kScale; s++)
+        {
+            if (frequencies[s] > 1)
+            {
+                frequencies[s]--;
+                sum--;
+            }
+        }
+    }
+}
+
+static void encodeStream(const vector<unsigned char> &raw, vector<unsigned char> &output)
+{
+    unsigned int length = (unsigned int)raw.size();
+    writeValue<unsigned int>(output, length);
+
+    if (length >= kMinimumRANSLength)
+    {
+        unsigned int counts[256] = { 0 };
+        for (unsigned int i = 0; i < length; i++)
+            counts[raw[i]]++;
+        
+        if (counts[raw[0]] == length)
+        {
+            output.push_back(StreamConstant);
+            output.push_back(raw[0]);
+            return;
+        }
+
+        unsigned int frequencies[256];
+        unsigned int starts[256];
+        normalizeFrequencies(counts, length, frequencies);
+
+        unsigned char present[32] = { 0 };
+        unsigned int presentCount = 0;
+
+        for (unsigned int s = 0, start = 0; s < 256; s++)
+        {
+            starts[s] = start;
+            start += frequencies[s];
+            if (frequencies[s] > 0)
+            {
+                present[s >> 3] |= 1 << (s & 7);
+                presentCount++;
+            }
+        }
+
+        // Symbols are encoded backwards with two interleaved states, the
+        // decoder then reads the 16 bit words forwards. A state always
+        // stays in [kRANSLow, 2^32), so one word per symbol is enough.
+        vector<unsigned short> buffer(length + 8);
+        unsigned short *end = buffer.data() + buffer.size();
+        unsigned short *ptr = end;
+        unsigned int states[2] = { kRANSLow, kRANSLow };
+
+        for (unsigned int i = length; i-- > 0; )
+        {
+            unsigned int &x = states[i & 1];
+            unsigned int s = raw[i];
+            unsigned int frequency = frequencies[s];
+            unsigned int xMax = ((kRANSLow >> kScaleBits) << 16) * frequency;
+
+            if (x >= xMax)
+            {
+                *--ptr = (unsigned short)x;
+                x >>= 16;
+            }
+
+            x = ((x / frequency) << kScaleBits) + (x % frequency) + starts[s];
+        }
+
+        for (int k = 1; k >= 0; k--)
+        {
+            *--ptr = (unsigned short)(states[k] >> 16);
+            *--ptr = (unsigned short)states[k];
+        }
+
+        unsigned int dataLength = (unsigned int)((end - ptr) * sizeof(unsigned short));
+        unsigned int codedLength = 1 + sizeof(present) + presentCount * 2 + 4 + dataLength;
+
+        // small gains are not worth the slower decoding
+        if (codedLength < length - length / 8)
+        {
+            output.push_back(StreamRANS);
+            output.insert(output.end(), present, present + sizeof(present));
+            for (unsigned int s = 0; s < 256; s++)
+            {
+                if (frequencies[s] > 0)
+                    writeValue<unsigned short>(output, (unsigned short)frequencies[s]);
+            }
+            writeValue<unsigned int>(output, dataLength);
+            output.insert(output.end(), (const unsigned char *)ptr, (const unsigned char *)end);
+            return;
+        }
+    }
+
+    output.push_back(StreamRaw);
+    output.insert(output.end(), raw.begin(), raw.end());
+}
+
+static inline bool decodeSymbol(unsigned int &x, const unsigned int *slots, unsigned char *out,
+                                const unsigned char *&q, const unsigned char *qEnd)
+{
+    unsigned int slot = slots[x & (kScale - 1)];
+    *out = (unsigned char)slot;
+    x = (slot >> 20) * (x >> kScaleBits) + ((slot >> 8) & (kScale - 1));
+
+    if (x < kRANSLow)
+    {
+        if (q >= qEnd)
+            return false;
+        unsigned short word;
+        memcpy(&word, q, 2);
+        q += 2;
+        x = (x << 16) | word;
+    }
+
+    return true;
+}
+
+static bool decodeStream(const unsigned char *&p, const unsigned char *end, vector<unsigned char> &raw)
+{
+    unsigned int length;
+    unsigned char method;
+
+    if (!readValue(p, end, length) || !readValue(p, end, method))
+        return false;
+
+    if (method == StreamRaw)
+    {
+        if ((size_t)(end - p) < length)
+            return false;
+        raw.assign(p, p + length);
+        p += length;
+        return true;
+    }
+
+    if (method == StreamConstant)
+    {
+        unsigned char value;
+        if (!readValue(p, end, value))
+            return false;
+        raw.assign(length, value);
+        return true;
+    }
+
+    if (method != StreamRANS || (size_t)(end - p) < 32)
+        return false;
+
+    const unsigned char *present = p;
+    p += 32;
+
+    // each slot packs its symbol, the offset from the symbol start and the frequency
+    unsigned int slots[kScale];
+    unsigned int sum = 0;
+
+    for (unsigned int s = 0; s < 256; s++)
+    {
+        unsigned short frequency = 0;
+        if ((present[s >> 3] & (1 << (s & 7))) && !readValue(p, end, frequency))
+            return false;
+
+        if (frequency >= kScale || sum + frequency > kScale)
+            return false;
+
+        for (unsigned int offset = 0; offset < frequency; offset++)
+            slots[sum + offset] = s | (offset << 8) | ((unsigned int)frequency << 20);
+        sum += frequency;
+    }
+
+    unsigned int dataLength;
+    if (sum != kScale || !readValue(p, end, dataLength) || (size_t)(end - p) < dataLength || dataLength < 8 || dataLength % 2 != 0)
+        return false;
+
+    const unsigned char *q = p;
+    const unsigned char *qEnd = p + dataLength;
+    unsigned int states[2];
+
+    for (int k = 0; k < 2; k++, q += 4)
+    {
+        unsigned short words[2];
+        memcpy(words, q, 4);
+        states[k] = words[0] | ((unsigned int)words[1] << 16);
+    }
+
+    raw.resize(length);
+    unsigned char *out = raw.data();
+    unsigned int x0 = states[0], x1 = states[1];
+
+    unsigned int i = 0;
+    for (; i + 1 < length; i += 2)
+    {
+        if (!decodeSymbol(x0, slots, out + i, q, qEnd) || !decodeSymbol(x1, slots, out + i + 1, q, qEnd))
+            return false;
+    }
+
+    if (i < length && !decodeSymbol(x0, slots, out + i, q, qEnd))
+        return false;
+
+    p = qEnd;
+
+    // the encoder started both states at kRANSLow
+    return x0 == kRANSLow && x1 == kRANSLow;
+}
+
+// Mesh arrays
+
+static void encodeExactFloats(const vector<float> &values, unsigned int components, unsigned int stride, vector<unsigned char> &bytes)
+{
+    unsigned int previous[3] = { 0, 0, 0 };
+
+    for (unsigned int i = 0; i + stride <= values.size(); i += stride)
+    {
+        for (unsigned int c = 0; c < components; c++)
+        {
+            unsigned int bits = floatBits(values[i + c]);
+            writeVarint(bytes, zigzag((int)(bits - previous[c])));
+            previous[c] = bits;
+        }
+    }
+}
+
+static bool decodeExactFloats(const vector<unsigned char> &bytes, unsigned int count, unsigned int components, vector<float> &values)
+{
+    const unsigned char *p = bytes.data();
+    const unsigned char *end = p + bytes.size();
+    unsigned int previous[3] = { 0, 0, 0 };
+
+    if (bytes.size() < (size_t)count * components)
+        return false;
+
+    values.resize((size_t)count * 3);
+    float *out = values.data();
+
+    for (unsigned int i = 0; i < count; i++, out += 3)
+    {
+        out[2] = 0.0f;
+        for (unsigned int c = 0; c < components; c++)
+        {
+            unsigned int delta;
+            if (!readVarint(p, end, delta))
+                return false;
+            previous[c] += (unsigned int)unzigzag(delta);
+            out[c] = bitsFloat(previous[c]);
+        }
+    }
+
+    return true;
+}
+
+// Vertex indices are predicted by the next not yet used index, so meshes
+// whose vertices are listed in order of first use mostly store zeros.
+static void encodeVertexIndices(const vector<unsigned int> &indices, vector<unsigned char> &bytes)
+{
+    unsigned int next = 0;
+    for (unsigned int i = 0; i < indices.size(); i++)
+    {
+        writeVarint(bytes, zigzag((int)(next - indices[i])));
+        next = max(next, indices[i] + 1);
+    }
+}
+
+static bool decodeVertexIndices(const vector<unsigned char> &bytes, unsigned int count, vector<unsigned int> &indices)
+{
+    const unsigned char *p = bytes.data();
+    const unsigned char *end = p + bytes.size();
+    unsigned int next = 0;
+
+    if (bytes.size() < count)
+        return false;
+
+    indices.resize(count);
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        unsigned int code;
+        if (!readVarint(p, end, code))
+            return false;
+        unsigned int index = next - (unsigned int)unzigzag(code);
+        indices[i] = index;
+        next = max(next, index + 1);
+    }
+
+    return true;
+}
+
+// texture coordinate indices mostly move in step with the vertex indices
+static void encodeTexCoordIndices(const vector<unsigned int> &indices, const vector<unsigned int> &vertexIndices, vector<unsigned char> &bytes)
+{
+    unsigned int previous = 0, previousVertex = 0;
+    for (unsigned int i = 0; i < indices.size(); i++)
+    {
+        writeVarint(bytes, zigzag((int)((indices[i] - previous) - (vertexIndices[i] - previousVertex))));
+        previous = indices[i];
+        previousVertex = vertexIndices[i];
+    }
+}
+
+static bool decodeTexCoordIndices(const vector<unsigned char> &bytes, const vector<unsigned int> &vertexIndices, vector<unsigned int> &indices)
+{
+    const unsigned char *p = bytes.data();
+    const unsigned char *end = p + bytes.size();
+    unsigned int count = (unsigned int)vertexIndices.size();
+    unsigned int previous = 0, previousVertex = 0;
+
+    if (bytes.size() < count)
+        return false;
+
+    indices.resize(count);
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        unsigned int code;
+        if (!readVarint(p, end, code))
+            return false;
+        previous += (vertexIndices[i] - previousVertex) + (unsigned int)unzigzag(code);
+        previousVertex = vertexIndices[i];
+        indices[i] = previous;
+    }
+
+    return true;
+}
+
+void FPMeshCodec::encode(const vector<float> &positions, const vector<float> &texCoords, const vector<unsigned char> &faceSizes,
+                         const vector<unsigned int> &vertexIndices, const vector<unsigned int> &texCoordIndices,
+                         float tolerance, vector<unsigned char> &output)
+{
+    unsigned int vertexCount = (unsigned int)positions.size() / 3;
+    unsigned int texCoordCount = (unsigned int)texCoords.size() / 3;
+    unsigned int faceCount = (unsigned int)faceSizes.size();
+    unsigned int indexCount = (unsigned int)vertexIndices.size();
+
+    float minimum[3] = { 0.0f, 0.0f, 0.0f };
+    float step = 0.0f;
+    unsigned char flags = 0;
+
+    if (tolerance > 0.0f && vertexCount > 0)
+    {
+        float maximum[3];
+        for (unsigned int c = 0; c < 3; c++)
+            minimum[c] = maximum[c] = positions[c];
+
+        for (unsigned int i = 0; i < vertexCount * 3; i += 3)
+        {
+            for (unsigned int c = 0; c < 3; c++)
+            {
+                minimum[c] = min(minimum[c], positions[i + c]);
+                maximum[c] = max(maximum[c], positions[i + c]);
+            }
+        }
+
+        // slightly below twice the tolerance so that rounding stays inside it
+        step = tolerance * 1.99f;
+
+        float extent = max(maximum[0] - minimum[0], max(maximum[1] - minimum[1], maximum[2] - minimum[2]));
+        if (extent / step < kMaximumQuantizedExtent)
+            flags |= CodecQuantized;
+    }
+
+    bool flatTexCoords = true;
+    for (unsigned int i = 2; i < texCoords.size() && flatTexCoords; i += 3)
+        flatTexCoords = texCoords[i] == 0.0f;
+
+    if (flatTexCoords)
+        flags |= CodecFlatTexCoords;
+
+    output.push_back(kCodecVersion);
+    output.push_back(flags);
+    writeValue<unsigned int>(output, vertexCount);
+    writeValue<unsigned int>(output, texCoordCount);
+    writeValue<unsigned int>(output, faceCount);
+    writeValue<unsigned int>(output, indexCount);
+    writeValue<float>(output, step);
+    for (unsigned int c = 0; c < 3; c++)
+        writeValue<float>(output, minimum[c]);
+
+    vector<unsigned char> bytes;
+    bytes.reserve(positions.size() * 2);
+
+    if (flags & CodecQuantized)
+    {
+        unsigned int previous[3] = { 0, 0, 0 };
+
+        for (unsigned int i = 0; i < vertexCount * 3; i += 3)
+        {
+            for (unsigned int c = 0; c < 3; c++)
+            {
+                unsigned int quantized = (unsigned int)floorf((positions[i + c] - minimum[c]) / step + 0.5f);
+                writeVarint(bytes, zigzag((int)(quantized - previous[c])));
+                previous[c] = quantized;
+            }
+        }
+    }
+    else
+    {
+        encodeExactFloats(positions, 3, 3, bytes);
+    }
+    encodeStream(bytes, output);
+
+    bytes.clear();
+    encodeExactFloats(texCoords, flatTexCoords ? 2 : 3, 3, bytes);
+    encodeStream(bytes, output);
+
+    bytes.assign((faceCount + 7) / 8, 0);
+    for (unsigned int i = 0; i < faceCount; i++)
+    {
+        if (faceSizes[i] == 4)
+            bytes[i >> 3] |= 1 << (i & 7);
+    }
+    encodeStream(bytes, output);
+
+    bytes.clear();
+    encodeVertexIndices(vertexIndices, bytes);
+    encodeStream(bytes, output);
+
+    bytes.clear();
+    encodeTexCoordIndices(texCoordIndices, vertexIndices, bytes);
+    encodeStream(bytes, output);
+}
+
+bool FPMeshCodec::decode(const unsigned char *data, size_t length,
+                         vector<float> &positions, vector<float> &texCoords, vector<unsigned char> &faceSizes,
+                         vector<unsigned int> &vertexIndices, vector<unsigned int> &texCoordIndices)
+{
+    const unsigned char *p = data;
+    const unsigned char *end = data + length;
+
+    unsigned char version, flags;
+    unsigned int vertexCount, texCoordCount, faceCount, indexCount;
+    float step;
+    float minimum[3];
+
+    if (!readValue(p, end, version) || version != kCodecVersion || !readValue(p, end, flags) ||
+        !readValue(p, end, vertexCount) || !readValue(p, end, texCoordCount) ||
+        !readValue(p, end, faceCount) || !readValue(p, end, indexCount) || !readValue(p, end, step))
+        return false;
+
+    for (unsigned int c = 0; c < 3; c++)
+    {
+        if (!readValue(p, end, minimum[c]))
+            return false;
+    }
+
+    vector<unsigned char> bytes;
+
+    if (!decodeStream(p, end, bytes))
+        return false;
+
+    if (flags & CodecQuantized)
+    {
+        const unsigned char *q = bytes.data();
+        const unsigned char *qEnd = q + bytes.size();
+        unsigned int previous[3] = { 0, 0, 0 };
+
+        if (bytes.size() < (size_t)vertexCount * 3)
+            return false;
+
+        positions.resize((size_t)vertexCount * 3);
+        float *out = positions.data();
+
+        for (unsigned int i = 0; i < vertexCount * 3; i += 3)
+        {
+            for (unsigned int c = 0; c < 3; c++)
+            {
+                unsigned int delta;
+                if (!readVarint(q, qEnd, delta))
+                    return false;
+                previous[c] += (unsigned int)unzigzag(delta);
+                out[i + c] = minimum[c] + (float)previous[c] * step;
+            }
+        }
+    }
+    else if (!decodeExactFloats(bytes, vertexCount, 3, positions))
+    {
+        return false;
+    }
+
+    if (!decodeStream(p, end, bytes) || !decodeExactFloats(bytes, texCoordCount, (flags & CodecFlatTexCoords) ? 2 : 3, texCoords))
+        return false;
+
+    if (!decodeStream(p, end, bytes) || bytes.size() < (faceCount + 7) / 8)
+        return false;
+
+    faceSizes.resize(faceCount);
+    size_t faceCorners = 0;
+    for (unsigned int i = 0; i < faceCount; i++)
+    {
+        faceSizes[i] = (bytes[i >> 3] & (1 << (i & 7))) ? 4 : 3;
+        faceCorners += faceSizes[i];
+    }
+
+    // damaged face sizes would point past the indices
+    if (faceCorners != indexCount)
+        return false;
+
+    if (!decodeStream(p, end, bytes) || !decodeVertexIndices(bytes, indexCount, vertexIndices))
+        return false;
+
+    if (!decodeStream(p, end, bytes) || !decodeTexCoordIndices(bytes, vertexIndices, texCoordIndices))
+        return false;
+
+    return true;
+}
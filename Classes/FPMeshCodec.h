@@ -0,0 +1,31 @@
+//
+//  FPMeshCodec.h
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#pragma once
+
+#include <vector>
+using namespace std;
+
+// Compresses the flat arrays of Mesh2::toIndexArrays. Positions are
+// either quantized to a grid or kept exact, texture coordinates drop z
+// when it is always zero, indices are stored as differences to the
+// previous corner in variable length bytes. Every stream then goes
+// through an order-0 rANS coder, or stays raw when that does not help.
+class FPMeshCodec
+{
+public:
+    // With tolerance above zero no coordinate moves by more than tolerance
+    // (plus float rounding), zero keeps all values exact.
+    static void encode(const vector<float> &positions, const vector<float> &texCoords, const vector<unsigned char> &faceSizes,
+                       const vector<unsigned int> &vertexIndices, const vector<unsigned int> &texCoordIndices,
+                       float tolerance, vector<unsigned char> &output);
+
+    // returns false for damaged data, indices are not checked against the counts
+    static bool decode(const unsigned char *data, size_t length,
+                       vector<float> &positions, vector<float> &texCoords, vector<unsigned char> &faceSizes,
+                       vector<unsigned int> &vertexIndices, vector<unsigned int> &texCoordIndices);
+};
@@ -0,0 +1,151 @@
+//
+//  FPNodeAllocator.h
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#pragma once
+
+#include "FPProfiler.h"
+#include <cstdlib>
+#include <vector>
+using namespace std;
+
+// Slab allocator for list nodes. Blocks are carved from 64 KB slabs and
+// recycled through per-size free lists, releaseAll frees every slab at once.
+class FPNodeAllocator
+{
+private:
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    static const size_t kGranularity = 8;
+    static const size_t kPoolCount = 64;
+    static const size_t kSlabSize = 64 * 1024;
+
+    FreeBlock *_freeBlocks[kPoolCount];
+    char *_slabCurrent;
+    char *_slabEnd;
+    vector<char *> _slabs;
+    unsigned long long _unreportedCount;
+    size_t _reservedBytes;
+    size_t _usedBytes;
+
+    FPNodeAllocator(const FPNodeAllocator &other);
+    FPNodeAllocator &operator=(const FPNodeAllocator &other);
+
+    // the profiler counter is shared by all threads, it gets batches
+    void reportCount()
+    {
+        FPProfiler::addCount(FPProfileCounter::NodesAllocated, _unreportedCount);
+        _unreportedCount = 0;
+    }
+
+    char *allocateSlab(size_t size)
+    {
+        reportCount();
+
+        char *slab = (char *)malloc(size);
+        if (slab == NULL)
+            abort();
+        _slabs.push_back(slab);
+        _reservedBytes += size;
+        return slab;
+    }
+
+public:
+    FPNodeAllocator()
+    {
+        for (size_t i = 0; i < kPoolCount; i++)
+            _freeBlocks[i] = NULL;
+
+        _slabCurrent = NULL;
+        _slabEnd = NULL;
+        _unreportedCount = 0;
+        _reservedBytes = 0;
+        _usedBytes = 0;
+    }
+
+    ~FPNodeAllocator()
+    {
+        releaseAll();
+    }
+
+    void *allocate(size_t size)
+    {
+        _unreportedCount++;
+        _usedBytes += blockSize(size);
+
+        size_t pool = (size + kGranularity - 1) / kGranularity;
+
+        // oversized blocks get their own slab, they are freed only by releaseAll
+        if (pool >= kPoolCount)
+            return allocateSlab(size);
+
+        FreeBlock *block = _freeBlocks[pool];
+        if (block)
+        {
+            _freeBlocks[pool] = block->next;
+            return block;
+        }
+
+        size_t blockSize = pool * kGranularity;
+        if (_slabCurrent == NULL || _slabCurrent + blockSize > _slabEnd)
+        {
+            _slabCurrent = allocateSlab(kSlabSize);
+            _slabEnd = _slabCurrent + kSlabSize;
+        }
+
+        void *memory = _slabCurrent;
+        _slabCurrent += blockSize;
+        return memory;
+    }
+
+    void deallocate(void *memory, size_t size)
+    {
+        _usedBytes -= blockSize(size);
+
+        size_t pool = (size + kGranularity - 1) / kGranularity;
+        if (pool >= kPoolCount)
+            return;
+
+        FreeBlock *block = (FreeBlock *)memory;
+        block->next = _freeBlocks[pool];
+        _freeBlocks[pool] = block;
+    }
+
+    void releaseAll()
+    {
+        reportCount();
+
+        for (size_t i = 0; i < _slabs.size(); i++)
+            free(_slabs[i]);
+
+        _slabs.clear();
+
+        for (size_t i = 0; i < kPoolCount; i++)
+            _freeBlocks[i] = NULL;
+
+        _slabCurrent = NULL;
+        _slabEnd = NULL;
+        _reservedBytes = 0;
+        _usedBytes = 0;
+    }
+
+    // bytes taken from the allocator by a block of the given size
+    static size_t blockSize(size_t size)
+    {
+        size_t pool = (size + kGranularity - 1) / kGranularity;
+        if (pool >= kPoolCount)
+            return size;
+        return pool * kGranularity;
+    }
+
+    // Slabs and the slab list. Bytes not in used blocks are free lists,
+    // the unused end of the current slab and freed oversized blocks.
+    size_t reservedBytes() const { return _reservedBytes + _slabs.capacity() * sizeof(char *); }
+    size_t usedBytes() const { return _usedBytes; }
+};
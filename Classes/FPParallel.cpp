@@ -0,0 +1,142 @@
+//
+//  FPParallel.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "FPParallel.h"
+#include <mutex>
+#include <condition_variable>
+
+// Threads started on the first parallel range, they take chunks of the
+// current range until none is left and then sleep until the next one.
+// The calling thread takes chunks too.
+class FPWorkerPool
+{
+private:
+    mutex _mutex;
+    condition_variable _wake;
+    condition_variable _done;
+    vector<thread> _threads;
+    bool _busy;
+    bool _stopping;
+
+    // the range being run, read only while chunks are left
+    void (*_rangeFunction)(void *function, unsigned int begin, unsigned int end);
+    void *_function;
+    unsigned int _count;
+    unsigned int _chunk;
+    unsigned int _chunkCount;
+    unsigned int _nextChunk;
+    unsigned int _pendingChunks;
+
+    struct HasWork
+    {
+        const FPWorkerPool *pool;
+        HasWork(const FPWorkerPool *pool) : pool(pool) { }
+        bool operator()() const { return pool->_stopping || pool->_nextChunk < pool->_chunkCount; }
+    };
+
+    struct IsDone
+    {
+        const FPWorkerPool *pool;
+        IsDone(const FPWorkerPool *pool) : pool(pool) { }
+        bool operator()() const { return pool->_pendingChunks == 0; }
+    };
+
+    // takes chunks with the mutex locked, runs them unlocked
+    void runChunks(unique_lock<mutex> &lock)
+    {
+        while (_nextChunk < _chunkCount)
+        {
+            unsigned int begin = _nextChunk++ * _chunk;
+            unsigned int end = begin + _chunk < _count ? begin + _chunk : _count;
+
+            lock.unlock();
+            _rangeFunction(_function, begin, end);
+            lock.lock();
+
+            if (--_pendingChunks == 0)
+                _done.notify_all();
+        }
+    }
+
+    void work()
+    {
+        unique_lock<mutex> lock(_mutex);
+
+        while (!_stopping)
+        {
+            runChunks(lock);
+            _wake.wait(lock, HasWork(this));
+        }
+    }
+
+    static void startWorker(FPWorkerPool *pool)
+    {
+        pool->work();
+    }
+
+public:
+    FPWorkerPool() : _busy(false), _stopping(false), _rangeFunction(NULL), _function(NULL),
+        _count(0), _chunk(0), _chunkCount(0), _nextChunk(0), _pendingChunks(0) { }
+
+    ~FPWorkerPool()
+    {
+        {
+            lock_guard<mutex> lock(_mutex);
+            _stopping = true;
+        }
+
+        _wake.notify_all();
+
+        for (unsigned int i = 0; i < _threads.size(); i++)
+            _threads[i].join();
+    }
+
+    bool run(void (*rangeFunction)(void *, unsigned int, unsigned int), void *function,
+             unsigned int count, unsigned int chunk, unsigned int threads)
+    {
+        unique_lock<mutex> lock(_mutex);
+
+        if (_busy)
+            return false;
+
+        _busy = true;
+
+        while (_threads.size() + 1 < threads)
+            _threads.push_back(thread(startWorker, this));
+
+        _rangeFunction = rangeFunction;
+        _function = function;
+        _count = count;
+        _chunk = chunk;
+        _chunkCount = (count + chunk - 1) / chunk;
+        _nextChunk = 0;
+        _pendingChunks = _chunkCount;
+
+        _wake.notify_all();
+        runChunks(lock);
+
+        _done.wait(lock, IsDone(this));
+
+        _chunkCount = 0;
+        _nextChunk = 0;
+        _function = NULL;
+        _busy = false;
+        return true;
+    }
+};
+
+static FPWorkerPool &workerPool()
+{
+    static FPWorkerPool pool;
+    return pool;
+}
+
+bool FPParallel::runOnWorkers(RangeFunction rangeFunction, void *function, unsigned int count,
+                              unsigned int chunk, unsigned int threads)
+{
+    return workerPool().run(rangeFunction, function, count, chunk, threads);
+}
@@ -0,0 +1,98 @@
+//
+//  FPParallel.h
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#pragma once
+
+#include <functional>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// Splits an index range into contiguous chunks and runs them on worker threads.
+// The function object is called as function(begin, end) and must only write
+// to data owned by its own range. Workers are started once and wait for the
+// next range, a call made while they are busy (from another thread or from
+// inside a range) starts threads of its own.
+class FPParallel
+{
+private:
+    typedef void (*RangeFunction)(void *function, unsigned int begin, unsigned int end);
+
+    static unsigned int &requestedThreadCount()
+    {
+        static unsigned int count = 0;
+        return count;
+    }
+
+    template <class TFunction>
+    static void callRange(void *function, unsigned int begin, unsigned int end)
+    {
+        (*(TFunction *)function)(begin, end);
+    }
+
+    // returns false without running anything when the workers are busy
+    static bool runOnWorkers(RangeFunction rangeFunction, void *function, unsigned int count,
+                             unsigned int chunk, unsigned int threads);
+
+public:
+    static const unsigned int kMinimumRangeSize = 4096;
+
+    // zero means one thread per hardware thread
+    static void setThreadCount(unsigned int count) { requestedThreadCount() = count; }
+
+    static unsigned int threadCount()
+    {
+        unsigned int count = requestedThreadCount();
+        if (count == 0)
+            count = thread::hardware_concurrency();
+        return count > 0 ? count : 1;
+    }
+
+    template <class TFunction>
+    static void forRange(unsigned int count, TFunction &function)
+    {
+        forRange(count, function, kMinimumRangeSize);
+    }
+
+    // for ranges of few but expensive items, like image tiles
+    template <class TFunction>
+    static void forRange(unsigned int count, TFunction &function, unsigned int minimumRangeSize)
+    {
+        unsigned int threads = threadCount();
+        unsigned int maximumThreads = (count + minimumRangeSize - 1) / minimumRangeSize;
+        if (threads > maximumThreads)
+            threads = maximumThreads;
+
+        if (threads <= 1)
+        {
+            if (count > 0)
+                function(0, count);
+            return;
+        }
+
+        unsigned int chunk = (count + threads - 1) / threads;
+
+        if (runOnWorkers(&callRange<TFunction>, &function, count, chunk, threads))
+            return;
+
+        vector<thread> workers;
+        workers.reserve(threads - 1);
+
+        for (unsigned int i = 1; i < threads; i++)
+        {
+            unsigned int begin = i * chunk;
+            unsigned int end = begin + chunk < count ? begin + chunk : count;
+            if (begin < end)
+                workers.push_back(thread(ref(function), begin, end));
+        }
+
+        function(0, chunk < count ? chunk : count);
+
+        for (unsigned int i = 0; i < workers.size(); i++)
+            workers[i].join();
+    }
+};
@@ -0,0 +1,255 @@
+//
+//  FPProfiler.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "FPProfiler.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <cstdio>
+
+#if FP_PROFILER
+
+static const char *const kCounterNames[] =
+{
+    "nodesAllocated",
+    "vertexBufferBytes",
+    "selectionCachesRebuilt",
+};
+
+static const unsigned int kCounterCount = (unsigned int)FPProfileCounter::Count;
+static const unsigned int kSampleRingSize = FPProfiler::kRingSize / 4;
+
+struct ZoneEvent
+{
+    const char *name;
+    unsigned long long begin;
+    unsigned long long end;
+};
+
+struct CounterSample
+{
+    unsigned long long time;
+    unsigned long long values[kCounterCount];
+};
+
+// A thread that ends gives its buffer to the next new thread, so threads
+// started for every parallel loop do not add buffers.
+struct ThreadBuffer
+{
+    unsigned int tid;
+    unsigned int depth;
+    bool inUse;
+    atomic<unsigned long long> zoneCount;
+    atomic<unsigned long long> sampleCount;
+    vector<ZoneEvent> zones;
+    vector<CounterSample> samples;
+
+    ThreadBuffer(unsigned int tid) : tid(tid), depth(0), inUse(true), zoneCount(0), sampleCount(0),
+        zones(FPProfiler::kRingSize), samples(kSampleRingSize) { }
+};
+
+struct ThreadBufferRegistry
+{
+    mutex lock;
+    vector<ThreadBuffer *> buffers;
+    chrono::steady_clock::time_point epoch;
+
+    ThreadBufferRegistry() : epoch(chrono::steady_clock::now()) { }
+
+    ~ThreadBufferRegistry()
+    {
+        for (unsigned int i = 0; i < buffers.size(); i++)
+            delete buffers[i];
+    }
+};
+
+static atomic<unsigned long long> counters[kCounterCount];
+
+static ThreadBufferRegistry &registry()
+{
+    static ThreadBufferRegistry registry;
+    return registry;
+}
+
+static unsigned long long now()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - registry().epoch).count();
+}
+
+struct ThreadBufferHolder
+{
+    ThreadBuffer *buffer;
+
+    ThreadBufferHolder() : buffer(NULL) { }
+
+    ~ThreadBufferHolder()
+    {
+        if (buffer == NULL)
+            return;
+
+        lock_guard<mutex> guard(registry().lock);
+        buffer->inUse = false;
+    }
+};
+
+static thread_local ThreadBufferHolder threadHolder;
+
+static ThreadBuffer &threadBuffer()
+{
+    if (threadHolder.buffer != NULL)
+        return *threadHolder.buffer;
+
+    ThreadBufferRegistry &r = registry();
+    lock_guard<mutex> guard(r.lock);
+
+    for (unsigned int i = 0; i < r.buffers.size(); i++)
+    {
+        if (!r.buffers[i]->inUse)
+        {
+            r.buffers[i]->inUse = true;
+            threadHolder.buffer = r.buffers[i];
+            return *threadHolder.buffer;
+        }
+    }
+
+    threadHolder.buffer = new ThreadBuffer((unsigned int)r.buffers.size() + 1);
+    r.buffers.push_back(threadHolder.buffer);
+    return *threadHolder.buffer;
+}
+
+void FPProfiler::addCount(FPProfileCounter counter, unsigned long long value)
+{
+    counters[(unsigned int)counter].fetch_add(value, memory_order_relaxed);
+}
+
+unsigned long long FPProfiler::count(FPProfileCounter counter)
+{
+    return counters[(unsigned int)counter].load(memory_order_relaxed);
+}
+
+FPProfileZone::FPProfileZone(const char *name)
+{
+    _name = name;
+    threadBuffer().depth++;
+    _begin = now();
+}
+
+FPProfileZone::~FPProfileZone()
+{
+    unsigned long long end = now();
+    ThreadBuffer &buffer = threadBuffer();
+
+    unsigned long long index = buffer.zoneCount.load(memory_order_relaxed);
+    ZoneEvent &event = buffer.zones[index % FPProfiler::kRingSize];
+    event.name = _name;
+    event.begin = _begin;
+    event.end = end;
+    buffer.zoneCount.store(index + 1, memory_order_release);
+
+    if (--buffer.depth > 0)
+        return;
+
+    index = buffer.sampleCount.load(memory_order_relaxed);
+    CounterSample &sample = buffer.samples[index % kSampleRingSize];
+    sample.time = end;
+    for (unsigned int i = 0; i < kCounterCount; i++)
+        sample.values[i] = counters[i].load(memory_order_relaxed);
+    buffer.sampleCount.store(index + 1, memory_order_release);
+}
+
+void FPProfiler::clear()
+{
+    ThreadBufferRegistry &r = registry();
+    lock_guard<mutex> guard(r.lock);
+
+    for (unsigned int i = 0; i < r.buffers.size(); i++)
+    {
+        r.buffers[i]->zoneCount.store(0);
+        r.buffers[i]->sampleCount.store(0);
+    }
+
+    for (unsigned int i = 0; i < kCounterCount; i++)
+        counters[i].store(0);
+}
+
+void FPProfiler::chromeTrace(string &json)
+{
+    ThreadBufferRegistry &r = registry();
+    lock_guard<mutex> guard(r.lock);
+
+    json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+
+    for (unsigned int i = 0; i < r.buffers.size(); i++)
+    {
+        ThreadBuffer &buffer = *r.buffers[i];
+
+        char line[256];
+
+        snprintf(line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+                 first ? "" : ",\n", buffer.tid, buffer.tid);
+        json += line;
+        first = false;
+
+        unsigned long long count = buffer.zoneCount.load(memory_order_acquire);
+        unsigned long long begin = count > kRingSize ? count - kRingSize : 0;
+
+        for (unsigned long long j = begin; j < count; j++)
+        {
+            const ZoneEvent &event = buffer.zones[j % kRingSize];
+            snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"cat\":\"mesh\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                     event.name, event.begin / 1000.0, (event.end - event.begin) / 1000.0, buffer.tid);
+            json += line;
+        }
+
+        count = buffer.sampleCount.load(memory_order_acquire);
+        begin = count > kSampleRingSize ? count - kSampleRingSize : 0;
+
+        for (unsigned long long j = begin; j < count; j++)
+        {
+            const CounterSample &sample = buffer.samples[j % kSampleRingSize];
+            snprintf(line, sizeof(line), ",\n{\"name\":\"counters\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{", sample.time / 1000.0);
+            json += line;
+
+            for (unsigned int k = 0; k < kCounterCount; k++)
+            {
+                snprintf(line, sizeof(line), "%s\"%s\":%llu", k > 0 ? "," : "", kCounterNames[k], sample.values[k]);
+                json += line;
+            }
+            json += "}}";
+        }
+    }
+
+    json += "\n]}\n";
+}
+
+#else
+
+void FPProfiler::clear()
+{
+}
+
+void FPProfiler::chromeTrace(string &json)
+{
+    json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[]}\n";
+}
+
+#endif
+
+bool FPProfiler::writeChromeTrace(const char *path)
+{
+    string json;
+    chromeTrace(json);
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+        return false;
+
+    bool written = fwrite(json.data(), 1, json.size(), file) == json.size();
+    return fclose(file) == 0 && written;
+}
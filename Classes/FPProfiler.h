@@ -0,0 +1,67 @@
+//
+//  FPProfiler.h
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#pragma once
+
+#include <string>
+using namespace std;
+
+// Set FP_PROFILER to 0 to compile zones and counters out.
+#ifndef FP_PROFILER
+#define FP_PROFILER 1
+#endif
+
+enum class FPProfileCounter
+{
+    NodesAllocated = 0,
+    VertexBufferBytes,
+    SelectionCachesRebuilt,
+
+    Count
+};
+
+// Zones are written to a ring buffer of the thread that runs them, older
+// zones are overwritten when it is full. Counters are process wide and get
+// sampled into the trace whenever an outermost zone ends. The trace is
+// Chrome trace event JSON, which Perfetto and chrome://tracing open.
+class FPProfiler
+{
+public:
+    static const unsigned int kRingSize = 1U << 15;
+
+#if FP_PROFILER
+    static void addCount(FPProfileCounter counter, unsigned long long value);
+    static unsigned long long count(FPProfileCounter counter);
+#else
+    static void addCount(FPProfileCounter counter, unsigned long long value) { }
+    static unsigned long long count(FPProfileCounter counter) { return 0; }
+#endif
+
+    // Call these while no zone runs on other threads.
+    static void clear();
+    static void chromeTrace(string &json);
+    static bool writeChromeTrace(const char *path);
+};
+
+// Times the scope it lives in, name must be a string literal.
+class FPProfileZone
+{
+#if FP_PROFILER
+private:
+    const char *_name;
+    unsigned long long _begin;
+
+    FPProfileZone(const FPProfileZone &other);
+    FPProfileZone &operator=(const FPProfileZone &other);
+public:
+    explicit FPProfileZone(const char *name);
+    ~FPProfileZone();
+#else
+public:
+    explicit FPProfileZone(const char *name) { }
+#endif
+};
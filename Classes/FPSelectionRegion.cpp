@@ -0,0 +1,168 @@
+//
+//  FPSelectionRegion.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "FPSelectionRegion.h"
+#include "FPParallel.h"
+#include <algorithm>
+
+const unsigned int FPSelectionRegion::kBatchSize;
+
+struct FPSelectionRegion::ContainsPoints
+{
+    const FPSelectionRegion &region;
+    const Matrix4x4 &matrix;
+    const Vector3D *positions;
+    bool *inside;
+    float planes[6][4];
+
+    ContainsPoints(const FPSelectionRegion &region, const Matrix4x4 &matrix, const Vector3D *positions, bool *inside) :
+        region(region), matrix(matrix), positions(positions), inside(inside)
+    {
+        region.planes(matrix, planes);
+    }
+
+    void operator()(unsigned int begin, unsigned int end)
+    {
+        float x[kBatchSize], y[kBatchSize], z[kBatchSize];
+        bool result[kBatchSize];
+
+        for (unsigned int start = begin; start < end; start += kBatchSize)
+        {
+            unsigned int count = min(end - start, kBatchSize);
+
+            // the tail batch repeats its last point
+            for (unsigned int k = 0; k < kBatchSize; k++)
+            {
+                const Vector3D &position = positions[start + min(k, count - 1)];
+                x[k] = position.x;
+                y[k] = position.y;
+                z[k] = position.z;
+                result[k] = true;
+            }
+
+            for (int p = 0; p < 6; p++)
+            {
+                float a = planes[p][0], b = planes[p][1], c = planes[p][2], d = planes[p][3];
+                for (unsigned int k = 0; k < kBatchSize; k++)
+                    result[k] &= a * x[k] + b * y[k] + c * z[k] + d > 0.0f;
+            }
+
+            if (!region._polygon.empty())
+            {
+                for (unsigned int k = 0; k < count; k++)
+                {
+                    if (!result[k])
+                        continue;
+
+                    const float *m = matrix.m;
+                    float clipX = m[0] * x[k] + m[4] * y[k] + m[8] * z[k] + m[12];
+                    float clipY = m[1] * x[k] + m[5] * y[k] + m[9] * z[k] + m[13];
+                    float clipW = m[3] * x[k] + m[7] * y[k] + m[11] * z[k] + m[15];
+                    float windowX = (clipX / clipW * 0.5f + 0.5f) * (float)region._viewportWidth;
+                    float windowY = (clipY / clipW * 0.5f + 0.5f) * (float)region._viewportHeight;
+                    result[k] = region.polygonContains(windowX, windowY);
+                }
+            }
+
+            for (unsigned int k = 0; k < count; k++)
+                inside[start + k] = result[k];
+        }
+    }
+};
+
+FPSelectionRegion::FPSelectionRegion()
+{
+    Matrix4x4 identity;
+    setMatrices(identity, identity, 0, 0);
+    setRectangle(0, 0, 0, 0);
+}
+
+void FPSelectionRegion::setMatrices(const Matrix4x4 &projection, const Matrix4x4 &view, int viewportWidth, int viewportHeight)
+{
+    _viewProjection = projection.ProjectiveMultiply(view);
+    _viewportWidth = viewportWidth;
+    _viewportHeight = viewportHeight;
+}
+
+void FPSelectionRegion::setRectangle(float x, float y, float width, float height)
+{
+    _minX = x;
+    _minY = y;
+    _maxX = x + width;
+    _maxY = y + height;
+    _polygon.clear();
+}
+
+void FPSelectionRegion::setPolygon(const vector<Vector2D> &points)
+{
+    _polygon = points;
+
+    if (_polygon.size() < 3)
+    {
+        setRectangle(0, 0, 0, 0);
+        return;
+    }
+
+    _minX = _maxX = _polygon[0].x;
+    _minY = _maxY = _polygon[0].y;
+
+    for (unsigned int i = 1; i < _polygon.size(); i++)
+    {
+        _minX = min(_minX, _polygon[i].x);
+        _minY = min(_minY, _polygon[i].y);
+        _maxX = max(_maxX, _polygon[i].x);
+        _maxY = max(_maxY, _polygon[i].y);
+    }
+}
+
+// Each plane is a combination of matrix rows, a point is inside when
+// a * x + b * y + c * z + d > 0 for all of them.
+void FPSelectionRegion::planes(const Matrix4x4 &matrix, float result[6][4]) const
+{
+    float width = (float)max(_viewportWidth, 1);
+    float height = (float)max(_viewportHeight, 1);
+
+    float left = _minX / width * 2.0f - 1.0f;
+    float right = _maxX / width * 2.0f - 1.0f;
+    float bottom = _minY / height * 2.0f - 1.0f;
+    float top = _maxY / height * 2.0f - 1.0f;
+
+    for (int column = 0; column < 4; column++)
+    {
+        const float *row = matrix.m + column * 4;
+
+        result[0][column] = row[0] - left * row[3];
+        result[1][column] = right * row[3] - row[0];
+        result[2][column] = row[1] - bottom * row[3];
+        result[3][column] = top * row[3] - row[1];
+        result[4][column] = row[3] + row[2];
+        result[5][column] = row[3] - row[2];
+    }
+}
+
+bool FPSelectionRegion::polygonContains(float x, float y) const
+{
+    bool inside = false;
+
+    for (unsigned int i = 0, j = (unsigned int)_polygon.size() - 1; i < _polygon.size(); j = i++)
+    {
+        const Vector2D &a = _polygon[i];
+        const Vector2D &b = _polygon[j];
+
+        if ((a.y > y) != (b.y > y) && x < (b.x - a.x) * (y - a.y) / (b.y - a.y) + a.x)
+            inside = !inside;
+    }
+
+    return inside;
+}
+
+void FPSelectionRegion::containsPoints(const Matrix4x4 &transform, const Vector3D *positions, unsigned int count, bool *inside) const
+{
+    Matrix4x4 matrix = _viewProjection.ProjectiveMultiply(transform);
+    ContainsPoints contains(*this, matrix, positions, inside);
+    FPParallel::forRange(count, contains);
+}
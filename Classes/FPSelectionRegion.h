@@ -0,0 +1,51 @@
+//
+//  FPSelectionRegion.h
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#pragma once
+
+#include "MathDeclaration.h"
+#include <vector>
+using namespace std;
+
+// Marquee or lasso region in window pixels tested against points in space
+// without an OpenGL context. The rectangle becomes six clip space planes of
+// the combined matrix, so most points are decided by a few dot products
+// without a division, only points inside the bounds of a lasso are
+// projected to the window for the polygon test.
+class FPSelectionRegion
+{
+public:
+    static const unsigned int kBatchSize = 8;
+
+private:
+    Matrix4x4 _viewProjection;
+    int _viewportWidth, _viewportHeight;
+    float _minX, _minY, _maxX, _maxY;
+    vector<Vector2D> _polygon;
+
+    struct ContainsPoints;
+
+    void planes(const Matrix4x4 &matrix, float result[6][4]) const;
+    bool polygonContains(float x, float y) const;
+
+public:
+    FPSelectionRegion();
+
+    // matrices as loaded into GL_PROJECTION and GL_MODELVIEW
+    void setMatrices(const Matrix4x4 &projection, const Matrix4x4 &view, int viewportWidth, int viewportHeight);
+
+    // origin at bottom left like glReadPixels, the edges are not inside
+    void setRectangle(float x, float y, float width, float height);
+    // closed lasso, inside by the even-odd rule
+    void setPolygon(const vector<Vector2D> &points);
+
+    const vector<Vector2D> &polygon() const { return _polygon; }
+
+    // inside[i] is true when transform * positions[i] lies in the region
+    // between the near and far planes, batches run on worker threads
+    void containsPoints(const Matrix4x4 &transform, const Vector3D *positions, unsigned int count, bool *inside) const;
+};
@@ -13,6 +13,8 @@
 
 @property (readwrite, assign) BOOL selectThrough;
 @property (readwrite, assign) BOOL useSoftSelection;
+@property (readwrite, assign) NSInteger softSelectionFalloff;
+@property (readwrite, assign) float softSelectionRadius;
 - (void)weightsChanged;
 
 @end
@@ -23,5 +25,7 @@
 @property (readwrite, weak) id<FPSelectionWindowDelegate> delegate;
 @property (readwrite, assign) BOOL selectThrough;
 @property (readwrite, assign) BOOL useSoftSelection;
+@property (readwrite, assign) NSInteger softSelectionFalloff;
+@property (readwrite, assign) float softSelectionRadius;
 
 @end
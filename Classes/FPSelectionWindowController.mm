@@ -34,6 +34,26 @@
     self.delegate.useSoftSelection = useSoftSelection;
 }
 
+- (NSInteger)softSelectionFalloff
+{
+    return self.delegate.softSelectionFalloff;
+}
+
+- (void)setSoftSelectionFalloff:(NSInteger)softSelectionFalloff
+{
+    self.delegate.softSelectionFalloff = softSelectionFalloff;
+}
+
+- (float)softSelectionRadius
+{
+    return self.delegate.softSelectionRadius;
+}
+
+- (void)setSoftSelectionRadius:(float)softSelectionRadius
+{
+    self.delegate.softSelectionRadius = softSelectionRadius;
+}
+
 - (id)init
 {
     self = [super initWithWindowNibName:@"FPSelectionWindowController"];
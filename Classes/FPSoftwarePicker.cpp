@@ -0,0 +1,511 @@
+//
+//  FPSoftwarePicker.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "FPSoftwarePicker.h"
+#include "FPParallel.h"
+#include <cmath>
+#include <algorithm>
+
+// first pixel whose center is not left of value
+static inline int pixelMin(float value, int limit)
+{
+    value = min(max(value, -1.0f), (float)limit + 1.0f);
+    return (int)ceilf(value - 0.5f);
+}
+
+// last pixel whose center is not right of value
+static inline int pixelMax(float value, int limit)
+{
+    value = min(max(value, -1.0f), (float)limit + 1.0f);
+    return (int)floorf(value - 0.5f);
+}
+
+// signed distances to the near and far clipping planes
+static inline float clipDistance(const float v[4], int plane)
+{
+    return plane == 0 ? v[2] + v[3] : v[3] - v[2];
+}
+
+static inline void interpolateClip(const float a[4], const float b[4], float t, float result[4])
+{
+    for (int i = 0; i < 4; i++)
+        result[i] = a[i] + (b[i] - a[i]) * t;
+}
+
+struct FPSoftwarePicker::RasterizeTiles
+{
+    FPSoftwarePicker &picker;
+
+    RasterizeTiles(FPSoftwarePicker &picker) : picker(picker) { }
+
+    void operator()(unsigned int begin, unsigned int end)
+    {
+        for (unsigned int i = begin; i < end; i++)
+            picker.rasterizeTile((int)i);
+    }
+};
+
+FPSoftwarePicker::FPSoftwarePicker()
+{
+    Matrix4x4 identity;
+    begin(identity, identity, 0, 0, 0, 0, 0, 0, 0);
+}
+
+void FPSoftwarePicker::begin(const Matrix4x4 &projection, const Matrix4x4 &view, int viewportWidth, int viewportHeight,
+                             int x, int y, int width, int height, unsigned int count)
+{
+    _viewProjection = projection.ProjectiveMultiply(view);
+
+    _viewportWidth = viewportWidth;
+    _viewportHeight = viewportHeight;
+
+    _x = max(x, 0);
+    _y = max(y, 0);
+    _width = max(min(x + width, viewportWidth) - _x, 0);
+    _height = max(min(y + height, viewportHeight) - _y, 0);
+
+    _count = count;
+    _depthTest = true;
+    _pointSize = 1.0f;
+    _primitives.clear();
+
+    setModelTransform(Matrix4x4());
+}
+
+void FPSoftwarePicker::setModelTransform(const Matrix4x4 &transform)
+{
+    _modelTransform = transform;
+    _matrix = _viewProjection.ProjectiveMultiply(transform);
+}
+
+void FPSoftwarePicker::transform(const Vector3D &v, float clip[4]) const
+{
+    for (int i = 0; i < 4; i++)
+        clip[i] = _matrix.m[i] * v.x + _matrix.m[4 + i] * v.y + _matrix.m[8 + i] * v.z + _matrix.m[12 + i];
+}
+
+void FPSoftwarePicker::toWindow(const float clip[4], float &x, float &y, float &z) const
+{
+    float inverseW = 1.0f / clip[3];
+    x = (clip[0] * inverseW * 0.5f + 0.5f) * (float)_viewportWidth - (float)_x;
+    y = (clip[1] * inverseW * 0.5f + 0.5f) * (float)_viewportHeight - (float)_y;
+    z = clip[2] * inverseW * 0.5f + 0.5f;
+}
+
+bool FPSoftwarePicker::clampBounds(float minX, float minY, float maxX, float maxY, Primitive &primitive) const
+{
+    primitive.minX = max(pixelMin(minX, _width), 0);
+    primitive.minY = max(pixelMin(minY, _height), 0);
+    primitive.maxX = min(pixelMax(maxX, _width), _width - 1);
+    primitive.maxY = min(pixelMax(maxY, _height), _height - 1);
+
+    return primitive.minX <= primitive.maxX && primitive.minY <= primitive.maxY;
+}
+
+void FPSoftwarePicker::addPoint(const Vector3D &position, unsigned int id)
+{
+    float clip[4];
+    transform(position, clip);
+
+    // points are clipped by their center
+    if (clip[3] <= 0.0f || fabsf(clip[0]) > clip[3] || fabsf(clip[1]) > clip[3] || fabsf(clip[2]) > clip[3])
+        return;
+
+    Primitive primitive;
+    primitive.type = PrimitivePoint;
+    primitive.id = id;
+    toWindow(clip, primitive.x[0], primitive.y[0], primitive.z[0]);
+
+    // square of pixel centers in [x - size / 2, x + size / 2)
+    int size = max((int)(_pointSize + 0.5f), 1);
+    float half = (float)size * 0.5f;
+
+    primitive.minX = max(pixelMin(primitive.x[0] - half, _width), 0);
+    primitive.minY = max(pixelMin(primitive.y[0] - half, _height), 0);
+    primitive.maxX = min(pixelMin(primitive.x[0] - half, _width) + size - 1, _width - 1);
+    primitive.maxY = min(pixelMin(primitive.y[0] - half, _height) + size - 1, _height - 1);
+
+    if (primitive.minX <= primitive.maxX && primitive.minY <= primitive.maxY)
+        _primitives.push_back(primitive);
+}
+
+void FPSoftwarePicker::addLine(const Vector3D &a, const Vector3D &b, unsigned int id)
+{
+    float clip[2][4];
+    transform(a, clip[0]);
+    transform(b, clip[1]);
+
+    for (int plane = 0; plane < 2; plane++)
+    {
+        float d0 = clipDistance(clip[0], plane);
+        float d1 = clipDistance(clip[1], plane);
+
+        if (d0 < 0.0f && d1 < 0.0f)
+            return;
+
+        if (d0 < 0.0f)
+            interpolateClip(clip[0], clip[1], d0 / (d0 - d1), clip[0]);
+        else if (d1 < 0.0f)
+            interpolateClip(clip[1], clip[0], d1 / (d1 - d0), clip[1]);
+    }
+
+    Primitive primitive;
+    primitive.type = PrimitiveLine;
+    primitive.id = id;
+
+    for (int i = 0; i < 2; i++)
+        toWindow(clip[i], primitive.x[i], primitive.y[i], primitive.z[i]);
+
+    // one pixel wide, rasterizeTile decides which pixels of the box are on the line
+    float minX = min(primitive.x[0], primitive.x[1]) - 0.5f;
+    float minY = min(primitive.y[0], primitive.y[1]) - 0.5f;
+    float maxX = max(primitive.x[0], primitive.x[1]) + 0.5f;
+    float maxY = max(primitive.y[0], primitive.y[1]) + 0.5f;
+
+    if (clampBounds(minX, minY, maxX, maxY, primitive))
+        _primitives.push_back(primitive);
+}
+
+void FPSoftwarePicker::addClippedTriangle(const float a[4], const float b[4], const float c[4], unsigned int id, bool offset)
+{
+    Primitive primitive;
+    primitive.type = PrimitiveTriangle;
+    primitive.id = id;
+
+    toWindow(a, primitive.x[0], primitive.y[0], primitive.z[0]);
+    toWindow(b, primitive.x[1], primitive.y[1], primitive.z[1]);
+    toWindow(c, primitive.x[2], primitive.y[2], primitive.z[2]);
+
+    float *x = primitive.x, *y = primitive.y, *z = primitive.z;
+
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area == 0.0f || area != area)
+        return;
+
+    // counter clockwise, so the inside is where all edge functions are positive
+    if (area < 0.0f)
+    {
+        swap(x[1], x[2]);
+        swap(y[1], y[2]);
+        swap(z[1], z[2]);
+        area = -area;
+    }
+
+    primitive.dzdx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+    primitive.dzdy = ((x[1] - x[0]) * (z[2] - z[0]) - (x[2] - x[0]) * (z[1] - z[0])) / area;
+
+    if (offset)
+    {
+        // factor 1 times the depth slope plus one unit of a 24 bit depth buffer
+        float bias = max(fabsf(primitive.dzdx), fabsf(primitive.dzdy)) + 1.0f / 16777216.0f;
+        for (int i = 0; i < 3; i++)
+            z[i] += bias;
+    }
+
+    float minX = min(x[0], min(x[1], x[2]));
+    float minY = min(y[0], min(y[1], y[2]));
+    float maxX = max(x[0], max(x[1], x[2]));
+    float maxY = max(y[0], max(y[1], y[2]));
+
+    if (clampBounds(minX, minY, maxX, maxY, primitive))
+        _primitives.push_back(primitive);
+}
+
+void FPSoftwarePicker::addTriangle(const Vector3D &a, const Vector3D &b, const Vector3D &c, unsigned int id, bool offset)
+{
+    // near and far plane clipping can add two vertices
+    float polygon[2][5][4];
+    int count = 3;
+
+    transform(a, polygon[0][0]);
+    transform(b, polygon[0][1]);
+    transform(c, polygon[0][2]);
+
+    int current = 0;
+
+    for (int plane = 0; plane < 2; plane++)
+    {
+        float (*input)[4] = polygon[current];
+        float (*output)[4] = polygon[1 - current];
+        int outputCount = 0;
+
+        for (int i = 0; i < count; i++)
+        {
+            const float *v0 = input[i];
+            const float *v1 = input[(i + 1) % count];
+            float d0 = clipDistance(v0, plane);
+            float d1 = clipDistance(v1, plane);
+
+            if (d0 >= 0.0f)
+            {
+                for (int j = 0; j < 4; j++)
+                    output[outputCount][j] = v0[j];
+                outputCount++;
+            }
+
+            if ((d0 >= 0.0f) != (d1 >= 0.0f))
+                interpolateClip(v0, v1, d0 / (d0 - d1), output[outputCount++]);
+        }
+
+        count = outputCount;
+        current = 1 - current;
+
+        if (count < 3)
+            return;
+    }
+
+    for (int i = 1; i + 1 < count; i++)
+        addClippedTriangle(polygon[current][0], polygon[current][i], polygon[current][i + 1], id, offset);
+}
+
+void FPSoftwarePicker::addTriangle(const Vector3D &a, const Vector3D &b, const Vector3D &c, unsigned int id)
+{
+    addTriangle(a, b, c, id, false);
+}
+
+void FPSoftwarePicker::addOccluder(const Vector3D &a, const Vector3D &b, const Vector3D &c)
+{
+    addTriangle(a, b, c, 0, true);
+}
+
+void FPSoftwarePicker::binPrimitives()
+{
+    _tilesX = (_width + kTileSize - 1) / kTileSize;
+    _tilesY = (_height + kTileSize - 1) / kTileSize;
+
+    unsigned int tileCount = (unsigned int)(_tilesX * _tilesY);
+
+    _tileStarts.assign(tileCount + 1, 0);
+
+    for (unsigned int i = 0; i < _primitives.size(); i++)
+    {
+        const Primitive &primitive = _primitives[i];
+        for (int ty = primitive.minY / kTileSize; ty <= primitive.maxY / kTileSize; ty++)
+        {
+            for (int tx = primitive.minX / kTileSize; tx <= primitive.maxX / kTileSize; tx++)
+                _tileStarts[ty * _tilesX + tx + 1]++;
+        }
+    }
+
+    for (unsigned int i = 0; i < tileCount; i++)
+        _tileStarts[i + 1] += _tileStarts[i];
+
+    _tilePrimitives.resize(_tileStarts[tileCount]);
+
+    vector<unsigned int> cursors(_tileStarts.begin(), _tileStarts.end() - 1);
+
+    // submission order is kept inside every tile, equal depths resolve like GL_LESS
+    for (unsigned int i = 0; i < _primitives.size(); i++)
+    {
+        const Primitive &primitive = _primitives[i];
+        for (int ty = primitive.minY / kTileSize; ty <= primitive.maxY / kTileSize; ty++)
+        {
+            for (int tx = primitive.minX / kTileSize; tx <= primitive.maxX / kTileSize; tx++)
+                _tilePrimitives[cursors[ty * _tilesX + tx]++] = i;
+        }
+    }
+}
+
+void FPSoftwarePicker::rasterizeTile(int tile)
+{
+    int tileMinX = (tile % _tilesX) * kTileSize;
+    int tileMinY = (tile / _tilesX) * kTileSize;
+    int tileMaxX = min(tileMinX + kTileSize, _width) - 1;
+    int tileMaxY = min(tileMinY + kTileSize, _height) - 1;
+
+    float *depth = &_depth[0];
+    unsigned int *ids = &_ids[0];
+    vector<unsigned int> &hits = _tileHits[tile];
+
+    for (int py = tileMinY; py <= tileMaxY; py++)
+    {
+        for (int px = tileMinX; px <= tileMaxX; px++)
+        {
+            depth[py * _width + px] = 1.0f;
+            ids[py * _width + px] = 0;
+        }
+    }
+
+    for (unsigned int i = _tileStarts[tile]; i < _tileStarts[tile + 1]; i++)
+    {
+        const Primitive &primitive = _primitives[_tilePrimitives[i]];
+
+        int minX = max(primitive.minX, tileMinX);
+        int minY = max(primitive.minY, tileMinY);
+        int maxX = min(primitive.maxX, tileMaxX);
+        int maxY = min(primitive.maxY, tileMaxY);
+
+        if (minX > maxX || minY > maxY)
+            continue;
+
+        bool covered = false;
+
+        switch (primitive.type)
+        {
+            case PrimitivePoint:
+            {
+                float z = primitive.z[0];
+                for (int py = minY; py <= maxY; py++)
+                {
+                    for (int px = minX; px <= maxX; px++)
+                    {
+                        unsigned int index = py * _width + px;
+                        if (z < depth[index])
+                        {
+                            depth[index] = z;
+                            ids[index] = primitive.id;
+                        }
+                    }
+                }
+                covered = true;
+            } break;
+            case PrimitiveLine:
+            {
+                float dx = primitive.x[1] - primitive.x[0];
+                float dy = primitive.y[1] - primitive.y[0];
+                float dz = primitive.z[1] - primitive.z[0];
+
+                // x major lines step over pixel columns, y major over rows
+                bool xMajor = fabsf(dx) >= fabsf(dy);
+                float major = xMajor ? dx : dy;
+                float start = xMajor ? primitive.x[0] : primitive.y[0];
+                float minorStart = xMajor ? primitive.y[0] : primitive.x[0];
+                float minorDelta = xMajor ? dy : dx;
+                int first = xMajor ? minX : minY;
+                int last = xMajor ? maxX : maxY;
+
+                // a line collapsed to a point covers the pixel under it
+                if (major == 0.0f)
+                    first = last = (int)floorf(start);
+
+                for (int step = first; step <= last; step++)
+                {
+                    float t = major != 0.0f ? ((float)step + 0.5f - start) / major : 0.0f;
+                    if (t < 0.0f || t > 1.0f)
+                        continue;
+
+                    int minor = (int)floorf(minorStart + t * minorDelta);
+                    int px = xMajor ? step : minor;
+                    int py = xMajor ? minor : step;
+
+                    if (px < minX || px > maxX || py < minY || py > maxY)
+                        continue;
+
+                    unsigned int index = py * _width + px;
+                    float z = primitive.z[0] + t * dz;
+                    covered = true;
+
+                    if (z < depth[index])
+                    {
+                        depth[index] = z;
+                        ids[index] = primitive.id;
+                    }
+                }
+            } break;
+            case PrimitiveTriangle:
+            {
+                const float *x = primitive.x, *y = primitive.y;
+
+                // edge k from vertex k to k + 1 is a * px + b at the current row
+                float a[3], b[3];
+
+                for (int py = minY; py <= maxY; py++)
+                {
+                    float cy = (float)py + 0.5f;
+                    int spanMin = minX;
+                    int spanMax = maxX;
+
+                    for (int k = 0; k < 3; k++)
+                    {
+                        int next = k == 2 ? 0 : k + 1;
+                        float ex = x[next] - x[k];
+                        float ey = y[next] - y[k];
+                        a[k] = -ey;
+                        b[k] = ex * (cy - y[k]) + ey * x[k];
+
+                        // narrow the span, one pixel of slack for rounding
+                        if (a[k] > 0.0f)
+                            spanMin = max(spanMin, pixelMin(-b[k] / a[k], _width) - 1);
+                        else if (a[k] < 0.0f)
+                            spanMax = min(spanMax, pixelMax(-b[k] / a[k], _width) + 1);
+                        else if (b[k] < 0.0f)
+                            spanMax = spanMin - 1;
+                    }
+
+                    float rowDepth = primitive.z[0] + primitive.dzdy * (cy - y[0]);
+                    unsigned int rowIndex = py * _width;
+
+                    for (int px = spanMin; px <= spanMax; px++)
+                    {
+                        float cx = (float)px + 0.5f;
+                        if (a[0] * cx + b[0] < 0.0f || a[1] * cx + b[1] < 0.0f || a[2] * cx + b[2] < 0.0f)
+                            continue;
+
+                        float z = rowDepth + primitive.dzdx * (cx - x[0]);
+                        covered = true;
+
+                        if (z < depth[rowIndex + px])
+                        {
+                            depth[rowIndex + px] = z;
+                            ids[rowIndex + px] = primitive.id;
+                        }
+                    }
+                }
+            } break;
+        }
+
+        if (covered && !_depthTest && primitive.id > 0)
+            hits.push_back(primitive.id);
+    }
+}
+
+void FPSoftwarePicker::end(vector<bool> &hits)
+{
+    hits.assign(_count, false);
+
+    if (_width <= 0 || _height <= 0 || _primitives.empty())
+        return;
+
+    binPrimitives();
+
+    unsigned int pixelCount = (unsigned int)(_width * _height);
+    if (_depth.size() < pixelCount)
+    {
+        _depth.resize(pixelCount);
+        _ids.resize(pixelCount);
+    }
+
+    unsigned int tileCount = (unsigned int)(_tilesX * _tilesY);
+    _tileHits.resize(tileCount);
+    for (unsigned int i = 0; i < tileCount; i++)
+        _tileHits[i].clear();
+
+    RasterizeTiles rasterize(*this);
+    FPParallel::forRange(tileCount, rasterize, 1);
+
+    if (_depthTest)
+    {
+        for (unsigned int i = 0; i < pixelCount; i++)
+        {
+            unsigned int id = _ids[i];
+            if (id > 0 && id - 1 < _count)
+                hits[id - 1] = true;
+        }
+    }
+    else
+    {
+        for (unsigned int i = 0; i < tileCount; i++)
+        {
+            for (unsigned int j = 0; j < _tileHits[i].size(); j++)
+            {
+                unsigned int id = _tileHits[i][j];
+                if (id - 1 < _count)
+                    hits[id - 1] = true;
+            }
+        }
+    }
+}
@@ -0,0 +1,97 @@
+//
+//  FPSoftwarePicker.h
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#pragma once
+
+#include "MathDeclaration.h"
+#include <vector>
+using namespace std;
+
+// CPU replacement of the color index selection buffer. Primitives are
+// transformed and clipped the same way OpenGL does it, binned into tiles
+// of the pick rectangle and rasterized tile by tile on worker threads.
+// Only the pick rectangle is rasterized, so the cost follows its area and
+// the primitives inside it. Ids start at one, zero is an occluder.
+class FPSoftwarePicker
+{
+public:
+    static const int kTileSize = 32;
+
+    enum PrimitiveType
+    {
+        PrimitivePoint,
+        PrimitiveLine,
+        PrimitiveTriangle
+    };
+
+    struct Primitive
+    {
+        // pick rectangle pixels, z in depth range
+        float x[3], y[3], z[3];
+        // triangle depth plane
+        float dzdx, dzdy;
+        int minX, minY, maxX, maxY;
+        unsigned int id;
+        PrimitiveType type;
+    };
+
+private:
+    Matrix4x4 _viewProjection;
+    Matrix4x4 _matrix;
+    Matrix4x4 _modelTransform;
+    int _viewportWidth, _viewportHeight;
+    int _x, _y, _width, _height;
+    unsigned int _count;
+    bool _depthTest;
+    float _pointSize;
+
+    vector<Primitive> _primitives;
+    vector<unsigned int> _tileStarts;
+    vector<unsigned int> _tilePrimitives;
+    vector<float> _depth;
+    vector<unsigned int> _ids;
+    vector<vector<unsigned int> > _tileHits;
+    int _tilesX, _tilesY;
+
+    void transform(const Vector3D &v, float clip[4]) const;
+    void toWindow(const float clip[4], float &x, float &y, float &z) const;
+    bool clampBounds(float minX, float minY, float maxX, float maxY, Primitive &primitive) const;
+    void addClippedTriangle(const float a[4], const float b[4], const float c[4], unsigned int id, bool offset);
+    void addTriangle(const Vector3D &a, const Vector3D &b, const Vector3D &c, unsigned int id, bool offset);
+    void binPrimitives();
+    void rasterizeTile(int tile);
+
+    struct RasterizeTiles;
+
+    FPSoftwarePicker(const FPSoftwarePicker &other);
+    FPSoftwarePicker &operator=(const FPSoftwarePicker &other);
+
+public:
+    FPSoftwarePicker();
+
+    // Matrices as loaded into GL_PROJECTION and GL_MODELVIEW, the rectangle
+    // is in window pixels with origin at bottom left like glReadPixels.
+    void begin(const Matrix4x4 &projection, const Matrix4x4 &view, int viewportWidth, int viewportHeight,
+               int x, int y, int width, int height, unsigned int count);
+
+    const Matrix4x4 &modelTransform() const { return _modelTransform; }
+    void setModelTransform(const Matrix4x4 &transform);
+
+    // without depth test every primitive covering a pixel of the rectangle is hit
+    bool depthTest() const { return _depthTest; }
+    void setDepthTest(bool value) { _depthTest = value; }
+    void setPointSize(float value) { _pointSize = value; }
+
+    void addPoint(const Vector3D &position, unsigned int id);
+    void addLine(const Vector3D &a, const Vector3D &b, unsigned int id);
+    void addTriangle(const Vector3D &a, const Vector3D &b, const Vector3D &c, unsigned int id);
+    // Hides primitives behind it, pushed back like glPolygonOffset(1, 1) so points and lines on it stay visible.
+    void addOccluder(const Vector3D &a, const Vector3D &b, const Vector3D &c);
+
+    // hits[i] is true when a pixel of the rectangle shows id i + 1
+    void end(vector<bool> &hits);
+};
@@ -0,0 +1,317 @@
+//
+//  FPSpatialGrid.h
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+// Uniform grid over vertex node positions, cells are hashed into a table
+// sized to the vertex count. Queries visit shells of cells around the query
+// cell and stop as soon as no farther cell can hold a closer vertex.
+// Positions are copied on build, so the owner must invalidate the grid
+// whenever vertices move or get removed.
+template <class TVertex>
+class FPSpatialGrid
+{
+private:
+    struct Entry
+    {
+        Vector3D position;
+        int x, y, z;
+        TVertex *vertex;
+    };
+
+    struct Candidate
+    {
+        float distance;
+        TVertex *vertex;
+    };
+
+    vector<unsigned int> _cellStarts;
+    vector<Entry> _entries;
+    vector<Entry> _inserted;
+    Vector3D _origin;
+    float _cellSize;
+    unsigned int _mask;
+    bool _valid;
+
+    int cellCoordinate(float value, float origin) const
+    {
+        return (int)floorf((value - origin) / _cellSize);
+    }
+
+    void makeEntry(TVertex *vertex, Entry &entry) const
+    {
+        entry.position = vertex->data().position;
+        entry.x = cellCoordinate(entry.position.x, _origin.x);
+        entry.y = cellCoordinate(entry.position.y, _origin.y);
+        entry.z = cellCoordinate(entry.position.z, _origin.z);
+        entry.vertex = vertex;
+    }
+
+    unsigned int hash(int x, int y, int z) const
+    {
+        unsigned int h = (unsigned int)x * 73856093U ^ (unsigned int)y * 19349663U ^ (unsigned int)z * 83492791U;
+        return h & _mask;
+    }
+
+    static bool isSkipped(const TVertex *vertex, const vector<TVertex *> &skip)
+    {
+        return find(skip.begin(), skip.end(), vertex) != skip.end();
+    }
+
+    // keeps nearest sorted by distance and at most count long
+    static void addCandidate(const Entry &entry, const Vector3D &position, unsigned int count,
+                             const vector<TVertex *> &skip, vector<Candidate> &nearest)
+    {
+        float distance = entry.position.SqDistance(position);
+
+        if (nearest.size() == count && distance >= nearest.back().distance)
+            return;
+
+        if (isSkipped(entry.vertex, skip))
+            return;
+
+        Candidate candidate = { distance, entry.vertex };
+
+        if (nearest.size() < count)
+            nearest.push_back(candidate);
+        else
+            nearest.back() = candidate;
+
+        for (size_t i = nearest.size() - 1; i > 0 && nearest[i - 1].distance > nearest[i].distance; i--)
+            swap(nearest[i - 1], nearest[i]);
+    }
+
+    void visitCell(int x, int y, int z, const Vector3D &position, unsigned int count,
+                   const vector<TVertex *> &skip, vector<Candidate> &nearest) const
+    {
+        unsigned int cell = hash(x, y, z);
+
+        for (unsigned int i = _cellStarts[cell]; i < _cellStarts[cell + 1]; i++)
+        {
+            const Entry &entry = _entries[i];
+            if (entry.x == x && entry.y == y && entry.z == z)
+                addCandidate(entry, position, count, skip, nearest);
+        }
+    }
+
+    FPSpatialGrid(const FPSpatialGrid &other);
+    FPSpatialGrid &operator=(const FPSpatialGrid &other);
+
+public:
+    FPSpatialGrid() : _cellSize(1.0f), _mask(0), _valid(false) { }
+
+    bool isValid() const { return _valid; }
+
+    size_t memorySize() const
+    {
+        return _cellStarts.capacity() * sizeof(unsigned int) + (_entries.capacity() + _inserted.capacity()) * sizeof(Entry);
+    }
+
+    void invalidate()
+    {
+        _valid = false;
+        _entries.clear();
+        _inserted.clear();
+    }
+
+    void build(TVertex *begin, TVertex *end)
+    {
+        vector<TVertex *> vertices;
+        for (TVertex *node = begin; node != end; node = node->next())
+            vertices.push_back(node);
+        build(vertices, 0.0f);
+    }
+
+    // cells are never smaller than minimumCellSize, radius queries then visit few cells
+    void build(const vector<TVertex *> &vertices, float minimumCellSize)
+    {
+        invalidate();
+
+        unsigned int count = (unsigned int)vertices.size();
+        Vector3D minimum, maximum;
+
+        for (unsigned int i = 0; i < count; i++)
+        {
+            const Vector3D &p = vertices[i]->data().position;
+            if (i == 0)
+            {
+                minimum = maximum = p;
+            }
+            else
+            {
+                minimum = Vector3D(min(minimum.x, p.x), min(minimum.y, p.y), min(minimum.z, p.z));
+                maximum = Vector3D(max(maximum.x, p.x), max(maximum.y, p.y), max(maximum.z, p.z));
+            }
+        }
+
+        // about two vertices per occupied cell, flat and thin meshes use fewer dimensions
+        float extents[3] = { maximum.x - minimum.x, maximum.y - minimum.y, maximum.z - minimum.z };
+        sort(extents, extents + 3);
+
+        float perVertex = 2.0f / (float)max(count, 1U);
+        _cellSize = cbrtf(extents[0] * extents[1] * extents[2] * perVertex);
+        if (!(_cellSize > 0.0f) || _cellSize > extents[0])
+            _cellSize = sqrtf(extents[1] * extents[2] * perVertex);
+        if (!(_cellSize > 0.0f) || _cellSize > extents[1])
+            _cellSize = extents[2] * perVertex;
+        if (_cellSize < minimumCellSize)
+            _cellSize = minimumCellSize;
+        if (!(_cellSize > 0.0f))
+            _cellSize = 1.0f;
+
+        _origin = minimum;
+
+        unsigned int tableSize = 16;
+        while (tableSize < count)
+            tableSize *= 2;
+        _mask = tableSize - 1;
+
+        _entries.resize(count);
+        _cellStarts.assign(tableSize + 1, 0);
+
+        vector<Entry> entries(count);
+
+        for (unsigned int i = 0; i < count; i++)
+        {
+            makeEntry(vertices[i], entries[i]);
+            _cellStarts[hash(entries[i].x, entries[i].y, entries[i].z) + 1]++;
+        }
+
+        for (unsigned int i = 0; i < tableSize; i++)
+            _cellStarts[i + 1] += _cellStarts[i];
+
+        vector<unsigned int> cursors(_cellStarts.begin(), _cellStarts.end() - 1);
+
+        for (unsigned int i = 0; i < count; i++)
+            _entries[cursors[hash(entries[i].x, entries[i].y, entries[i].z)]++] = entries[i];
+
+        _valid = true;
+    }
+
+    // vertices added after the build are scanned linearly until the next build
+    void insert(TVertex *vertex)
+    {
+        if (!_valid)
+            return;
+
+        if (_inserted.size() > _entries.size() / 8 + 64)
+        {
+            invalidate();
+            return;
+        }
+
+        Entry entry;
+        makeEntry(vertex, entry);
+        _inserted.push_back(entry);
+    }
+
+    // Fills nearest with up to count vertices sorted by distance, vertices in skip are ignored.
+    void findNearest(const Vector3D &position, unsigned int count, const vector<TVertex *> &skip, vector<TVertex *> &nearest) const
+    {
+        vector<Candidate> candidates;
+
+        if (count == 0)
+            return;
+
+        for (unsigned int i = 0; i < _inserted.size(); i++)
+            addCandidate(_inserted[i], position, count, skip, candidates);
+
+        int x = cellCoordinate(position.x, _origin.x);
+        int y = cellCoordinate(position.y, _origin.y);
+        int z = cellCoordinate(position.z, _origin.z);
+
+        unsigned int visitedCells = 0;
+
+        for (int r = 0; ; r++)
+        {
+            // farther shells are at least r cells away
+            if (candidates.size() == count && r > 0)
+            {
+                float shellDistance = (float)(r - 1) * _cellSize;
+                if (shellDistance * shellDistance >= candidates.back().distance)
+                    break;
+            }
+
+            // the query is far from the vertices or most of them are skipped
+            if (visitedCells > _entries.size())
+            {
+                candidates.clear();
+                for (unsigned int i = 0; i < _inserted.size(); i++)
+                    addCandidate(_inserted[i], position, count, skip, candidates);
+                for (unsigned int i = 0; i < _entries.size(); i++)
+                    addCandidate(_entries[i], position, count, skip, candidates);
+                break;
+            }
+
+            for (int dx = -r; dx <= r; dx++)
+            {
+                for (int dy = -r; dy <= r; dy++)
+                {
+                    bool onShell = dx == -r || dx == r || dy == -r || dy == r;
+                    int step = onShell ? 1 : 2 * r;
+
+                    for (int dz = -r; dz <= r; dz += max(step, 1))
+                    {
+                        visitCell(x + dx, y + dy, z + dz, position, count, skip, candidates);
+                        visitedCells++;
+                    }
+                }
+            }
+        }
+
+        for (unsigned int i = 0; i < candidates.size(); i++)
+            nearest.push_back(candidates[i].vertex);
+    }
+
+    // Nearest vertex no farther than maxDistance or NULL, distance is set when found.
+    TVertex *findNearestWithin(const Vector3D &position, float maxDistance, float &distance) const
+    {
+        vector<Candidate> candidates;
+        vector<TVertex *> skip;
+        float sqMaxDistance = maxDistance * maxDistance;
+
+        for (unsigned int i = 0; i < _inserted.size(); i++)
+            addCandidate(_inserted[i], position, 1, skip, candidates);
+
+        int x0 = cellCoordinate(position.x - maxDistance, _origin.x);
+        int y0 = cellCoordinate(position.y - maxDistance, _origin.y);
+        int z0 = cellCoordinate(position.z - maxDistance, _origin.z);
+        int x1 = cellCoordinate(position.x + maxDistance, _origin.x);
+        int y1 = cellCoordinate(position.y + maxDistance, _origin.y);
+        int z1 = cellCoordinate(position.z + maxDistance, _origin.z);
+
+        float cellCount = (float)(x1 - x0 + 1) * (float)(y1 - y0 + 1) * (float)(z1 - z0 + 1);
+
+        if (cellCount > (float)_entries.size())
+        {
+            for (unsigned int i = 0; i < _entries.size(); i++)
+                addCandidate(_entries[i], position, 1, skip, candidates);
+        }
+        else
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                for (int y = y0; y <= y1; y++)
+                {
+                    for (int z = z0; z <= z1; z++)
+                        visitCell(x, y, z, position, 1, skip, candidates);
+                }
+            }
+        }
+
+        if (candidates.empty() || candidates[0].distance > sqMaxDistance)
+            return NULL;
+
+        distance = sqrtf(candidates[0].distance);
+        return candidates[0].vertex;
+    }
+};
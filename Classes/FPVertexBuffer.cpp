@@ -0,0 +1,12 @@
+//
+//  FPVertexBuffer.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "FPVertexBuffer.h"
+
+unsigned long long FPVertexBufferStats::_totalBytes = 0;
+unsigned long long FPVertexBufferStats::_frameBytes = 0;
+unsigned long long FPVertexBufferStats::_lastFrameBytes = 0;
@@ -0,0 +1,110 @@
+//
+//  FPVertexBuffer.h
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#pragma once
+
+#include "OpenGLDrawing.h"
+#include "FPArrayCache.h"
+#include "FPProfiler.h"
+
+// Bytes sent to vertex buffers, a frame is one OpenGLSceneViewCore::draw.
+class FPVertexBufferStats
+{
+private:
+    static unsigned long long _totalBytes;
+    static unsigned long long _frameBytes;
+    static unsigned long long _lastFrameBytes;
+public:
+    static void addBytes(unsigned long long bytes)
+    {
+        _totalBytes += bytes;
+        _frameBytes += bytes;
+        FPProfiler::addCount(FPProfileCounter::VertexBufferBytes, bytes);
+    }
+    static void beginFrame() { _lastFrameBytes = _frameBytes; _frameBytes = 0; }
+    static unsigned long long totalBytes() { return _totalBytes; }
+    static unsigned long long frameBytes() { return _frameBytes; }
+    static unsigned long long lastFrameBytes() { return _lastFrameBytes; }
+};
+
+// Buffer object (GL_ARRAY_BUFFER unless told otherwise) mirroring an
+// FPArrayCache. Only the ranges marked dirty in the cache are sent, ranges
+// closer than kCoalesceGap elements go in one glBufferSubData. The storage
+// is reallocated only when the count changes or most of the array is dirty.
+template <class T>
+class FPVertexBuffer
+{
+private:
+    GLenum _target;
+    unsigned int _id;
+    unsigned int _count;
+    
+    FPVertexBuffer(const FPVertexBuffer &other);
+    FPVertexBuffer &operator=(const FPVertexBuffer &other);
+public:
+    static const unsigned int kCoalesceGap = 32;
+    
+    FPVertexBuffer(GLenum target = GL_ARRAY_BUFFER) : _target(target), _id(0U), _count(0U) { }
+    ~FPVertexBuffer() { destroy(); }
+    
+    unsigned int id() const { return _id; }
+    
+    void destroy()
+    {
+        if (_id != 0U)
+            glDeleteBuffers(1, &_id);
+        _id = 0U;
+        _count = 0U;
+    }
+    
+    void update(FPArrayCache<T> &cache);
+    
+    void bind() { glBindBuffer(_target, _id); }
+    void unbind() { glBindBuffer(_target, 0); }
+};
+
+template <class T>
+void FPVertexBuffer<T>::update(FPArrayCache<T> &cache)
+{
+    if (_id == 0U)
+    {
+        glGenBuffers(1, &_id);
+        cache.markAllDirty();
+    }
+    
+    if (!cache.isDirty())
+        return;
+    
+    unsigned int count = cache.count();
+    T *array = cache;
+    
+    glBindBuffer(_target, _id);
+    
+    if (count != _count || cache.isAllDirty() || cache.coalesceDirtyRanges(kCoalesceGap) > count / 2)
+    {
+        glBufferData(_target, count * sizeof(T), array, GL_DYNAMIC_DRAW);
+        FPVertexBufferStats::addBytes((unsigned long long)count * sizeof(T));
+        _count = count;
+    }
+    else
+    {
+        const vector<pair<unsigned int, unsigned int> > &ranges = cache.dirtyRanges();
+        for (unsigned int i = 0; i < ranges.size(); i++)
+        {
+            unsigned int begin = ranges[i].first;
+            unsigned int end = min(ranges[i].second, count);
+            if (begin >= end)
+                continue;
+            
+            glBufferSubData(_target, begin * sizeof(T), (end - begin) * sizeof(T), array + begin);
+            FPVertexBufferStats::addBytes((unsigned long long)(end - begin) * sizeof(T));
+        }
+    }
+    
+    glBindBuffer(_target, 0);
+    cache.clearDirty();
+}
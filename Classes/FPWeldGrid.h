@@ -0,0 +1,141 @@
+//
+//  FPWeldGrid.h
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#pragma once
+
+#include <cmath>
+#include <climits>
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+// Incremental weld of positions closer than a distance. Positions are
+// quantized to cells of the weld distance and chained in a hash table,
+// so find() only visits the 27 cells around the query. Among all positions
+// within the distance find() returns the first inserted one, which makes
+// the result independent of the table layout.
+class FPWeldGrid
+{
+private:
+    struct Entry
+    {
+        Vector3D position;
+        int x, y, z;
+        unsigned int next;
+    };
+
+    vector<unsigned int> _buckets;
+    vector<Entry> _entries;
+    float _squaredDistance;
+    float _inverseCellSize;
+    unsigned int _mask;
+
+    int cellCoordinate(float value) const
+    {
+        double cell = floor((double)value * _inverseCellSize);
+        return (int)max(min(cell, (double)(INT_MAX - 1)), (double)(INT_MIN + 1));
+    }
+
+    unsigned int hash(int x, int y, int z) const
+    {
+        unsigned int h = (unsigned int)x * 73856093U ^ (unsigned int)y * 19349663U ^ (unsigned int)z * 83492791U;
+        return h & _mask;
+    }
+
+    void rehash(unsigned int size)
+    {
+        _buckets.assign(size, UINT_MAX);
+        _mask = size - 1;
+
+        for (unsigned int i = 0; i < _entries.size(); i++)
+        {
+            Entry &entry = _entries[i];
+            unsigned int bucket = hash(entry.x, entry.y, entry.z);
+            entry.next = _buckets[bucket];
+            _buckets[bucket] = i;
+        }
+    }
+
+    FPWeldGrid(const FPWeldGrid &other);
+    FPWeldGrid &operator=(const FPWeldGrid &other);
+
+public:
+    FPWeldGrid(float distance, unsigned int expectedCount = 0)
+    {
+        _squaredDistance = distance * distance;
+        _inverseCellSize = distance > 0.0f ? 1.0f / distance : 0.0f;
+
+        unsigned int size = 16;
+        while (size < expectedCount)
+            size *= 2;
+
+        _entries.reserve(expectedCount);
+        rehash(size);
+    }
+
+    unsigned int count() const { return (unsigned int)_entries.size(); }
+
+    // Returns insertion index of the first position closer than the distance, or UINT_MAX.
+    unsigned int find(const Vector3D &position) const
+    {
+        unsigned int found = UINT_MAX;
+
+        if (_inverseCellSize == 0.0f)
+            return found;
+
+        int x = cellCoordinate(position.x);
+        int y = cellCoordinate(position.y);
+        int z = cellCoordinate(position.z);
+
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                for (int dz = -1; dz <= 1; dz++)
+                {
+                    for (unsigned int i = _buckets[hash(x + dx, y + dy, z + dz)]; i != UINT_MAX; i = _entries[i].next)
+                    {
+                        const Entry &entry = _entries[i];
+                        if (entry.x == x + dx && entry.y == y + dy && entry.z == z + dz &&
+                            entry.position.SqDistance(position) < _squaredDistance)
+                        {
+                            found = min(found, i);
+                        }
+                    }
+                }
+            }
+        }
+
+        return found;
+    }
+
+    // Returns insertion index of the new position.
+    unsigned int insert(const Vector3D &position)
+    {
+        Entry entry;
+        entry.position = position;
+        entry.x = cellCoordinate(position.x);
+        entry.y = cellCoordinate(position.y);
+        entry.z = cellCoordinate(position.z);
+        entry.next = UINT_MAX;
+        _entries.push_back(entry);
+
+        if (_entries.size() > _buckets.size())
+        {
+            rehash((unsigned int)_buckets.size() * 2);
+        }
+        else
+        {
+            unsigned int index = (unsigned int)_entries.size() - 1;
+            unsigned int bucket = hash(entry.x, entry.y, entry.z);
+            _entries[index].next = _buckets[bucket];
+            _buckets[bucket] = index;
+        }
+
+        return (unsigned int)_entries.size() - 1;
+    }
+};
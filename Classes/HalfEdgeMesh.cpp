@@ -0,0 +1,1200 @@
+//
+//  HalfEdgeMesh.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "HalfEdgeMesh.h"
+#include <algorithm>
+
+const unsigned int HalfEdgeMesh::InvalidIndex;
+
+HalfEdgeMesh::HalfEdgeMesh()
+{
+
+}
+
+HalfEdgeMesh::~HalfEdgeMesh()
+{
+
+}
+
+unsigned int HalfEdgeMesh::addVertex(const Vector3D &position)
+{
+    if (!_freeVertices.empty())
+    {
+        unsigned int vertex = _freeVertices.back();
+        _freeVertices.pop_back();
+        _positions[vertex] = position;
+        _vertexFlags[vertex] = 0;
+        _selectionWeights[vertex] = 0.0f;
+        return vertex;
+    }
+
+    _positions.push_back(position);
+    _vertexFlags.push_back(0);
+    _selectionWeights.push_back(0.0f);
+    return vertexCapacity() - 1;
+}
+
+unsigned int HalfEdgeMesh::addTexCoord(const Vector3D &position)
+{
+    if (!_freeTexCoords.empty())
+    {
+        unsigned int texCoord = _freeTexCoords.back();
+        _freeTexCoords.pop_back();
+        _texCoords[texCoord] = position;
+        _texCoordFlags[texCoord] = 0;
+        return texCoord;
+    }
+
+    _texCoords.push_back(position);
+    _texCoordFlags.push_back(0);
+    return texCoordCapacity() - 1;
+}
+
+unsigned int HalfEdgeMesh::addFace(const unsigned int *vertices, const unsigned int *texCoords, unsigned int size)
+{
+    unsigned int face;
+
+    if (!_freeFaces.empty())
+    {
+        face = _freeFaces.back();
+        _freeFaces.pop_back();
+    }
+    else
+    {
+        face = faceCapacity();
+        _faceSizes.push_back(0);
+        _faceFlags.push_back(0);
+        _halfEdgeVertices.resize(_halfEdgeVertices.size() + 4, InvalidIndex);
+        _halfEdgeTexCoords.resize(_halfEdgeTexCoords.size() + 4, InvalidIndex);
+        _halfEdgeTwins.resize(_halfEdgeTwins.size() + 4, InvalidIndex);
+        _halfEdgeFlags.resize(_halfEdgeFlags.size() + 4, 0);
+    }
+
+    _faceFlags[face] = 0;
+    setFace(face, vertices, texCoords, size);
+    return face;
+}
+
+// twins of the face and of its neighbours are stale until rebuildTwins
+void HalfEdgeMesh::setFace(unsigned int face, const unsigned int *vertices, const unsigned int *texCoords, unsigned int size)
+{
+    _faceSizes[face] = (unsigned char)size;
+
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        unsigned int halfEdge = face * 4 + i;
+        _halfEdgeVertices[halfEdge] = i < size ? vertices[i] : InvalidIndex;
+        _halfEdgeTexCoords[halfEdge] = i < size ? texCoords[i] : InvalidIndex;
+        _halfEdgeTwins[halfEdge] = InvalidIndex;
+        _halfEdgeFlags[halfEdge] = 0;
+    }
+}
+
+void HalfEdgeMesh::removeVertex(unsigned int vertex)
+{
+    _vertexFlags[vertex] = FlagDeleted;
+    _selectionWeights[vertex] = 0.0f;
+    _freeVertices.push_back(vertex);
+}
+
+void HalfEdgeMesh::removeTexCoord(unsigned int texCoord)
+{
+    _texCoordFlags[texCoord] = FlagDeleted;
+    _freeTexCoords.push_back(texCoord);
+}
+
+void HalfEdgeMesh::removeFace(unsigned int face)
+{
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        unsigned int halfEdge = face * 4 + i;
+        unsigned int twin = _halfEdgeTwins[halfEdge];
+        if (twin != InvalidIndex && _halfEdgeTwins[twin] == halfEdge)
+            _halfEdgeTwins[twin] = InvalidIndex;
+
+        _halfEdgeVertices[halfEdge] = InvalidIndex;
+        _halfEdgeTexCoords[halfEdge] = InvalidIndex;
+        _halfEdgeTwins[halfEdge] = InvalidIndex;
+        _halfEdgeFlags[halfEdge] = 0;
+    }
+
+    _faceSizes[face] = 0;
+    _faceFlags[face] = 0;
+    _freeFaces.push_back(face);
+}
+
+void HalfEdgeMesh::removeAll()
+{
+    _positions.clear();
+    _vertexFlags.clear();
+    _selectionWeights.clear();
+    _freeVertices.clear();
+
+    _texCoords.clear();
+    _texCoordFlags.clear();
+    _freeTexCoords.clear();
+
+    _faceSizes.clear();
+    _faceFlags.clear();
+    _freeFaces.clear();
+
+    _halfEdgeVertices.clear();
+    _halfEdgeTexCoords.clear();
+    _halfEdgeTwins.clear();
+    _halfEdgeFlags.clear();
+}
+
+void HalfEdgeMesh::setVertexSelected(unsigned int vertex, bool selected)
+{
+    if (selected)
+        _vertexFlags[vertex] |= FlagSelected;
+    else
+        _vertexFlags[vertex] &= ~FlagSelected;
+}
+
+void HalfEdgeMesh::setTexCoordSelected(unsigned int texCoord, bool selected)
+{
+    if (selected)
+        _texCoordFlags[texCoord] |= FlagSelected;
+    else
+        _texCoordFlags[texCoord] &= ~FlagSelected;
+}
+
+void HalfEdgeMesh::setFaceSelected(unsigned int face, bool selected)
+{
+    if (selected)
+        _faceFlags[face] |= FlagSelected;
+    else
+        _faceFlags[face] &= ~FlagSelected;
+}
+
+void HalfEdgeMesh::setEdgeSelected(unsigned int halfEdge, bool selected)
+{
+    unsigned int twin = _halfEdgeTwins[halfEdge];
+
+    if (selected)
+    {
+        _halfEdgeFlags[halfEdge] |= FlagSelected;
+        if (twin != InvalidIndex)
+            _halfEdgeFlags[twin] |= FlagSelected;
+    }
+    else
+    {
+        _halfEdgeFlags[halfEdge] &= ~FlagSelected;
+        if (twin != InvalidIndex)
+            _halfEdgeFlags[twin] &= ~FlagSelected;
+    }
+}
+
+// Buckets half-edges by their smaller vertex index, then sorts each (short)
+// bucket by the larger one, so half-edges of the same edge end up adjacent.
+void HalfEdgeMesh::groupHalfEdges(vector<unsigned int> &offsets, vector<unsigned int> &halfEdges) const
+{
+    unsigned int vertexCount = vertexCapacity();
+    unsigned int faceCount = faceCapacity();
+
+    offsets.assign(vertexCount + 1, 0);
+
+    for (unsigned int face = 0; face < faceCount; face++)
+    {
+        for (unsigned int i = 0, size = _faceSizes[face]; i < size; i++)
+        {
+            unsigned int halfEdge = face * 4 + i;
+            offsets[min(origin(halfEdge), destination(halfEdge)) + 1]++;
+        }
+    }
+
+    for (unsigned int i = 0; i < vertexCount; i++)
+        offsets[i + 1] += offsets[i];
+
+    halfEdges.resize(offsets[vertexCount]);
+    vector<unsigned int> cursors(offsets.begin(), offsets.end() - 1);
+
+    for (unsigned int face = 0; face < faceCount; face++)
+    {
+        for (unsigned int i = 0, size = _faceSizes[face]; i < size; i++)
+        {
+            unsigned int halfEdge = face * 4 + i;
+            halfEdges[cursors[min(origin(halfEdge), destination(halfEdge))]++] = halfEdge;
+        }
+    }
+
+    for (unsigned int vertex = 0; vertex < vertexCount; vertex++)
+    {
+        for (unsigned int i = offsets[vertex] + 1; i < offsets[vertex + 1]; i++)
+        {
+            unsigned int halfEdge = halfEdges[i];
+            unsigned int key = max(origin(halfEdge), destination(halfEdge));
+            unsigned int j = i;
+
+            for (; j > offsets[vertex]; j--)
+            {
+                unsigned int other = halfEdges[j - 1];
+                if (max(origin(other), destination(other)) <= key)
+                    break;
+                halfEdges[j] = other;
+            }
+
+            halfEdges[j] = halfEdge;
+        }
+    }
+}
+
+void HalfEdgeMesh::rebuildTwins()
+{
+    _halfEdgeTwins.assign(halfEdgeCapacity(), InvalidIndex);
+
+    vector<unsigned int> offsets;
+    vector<unsigned int> halfEdges;
+    groupHalfEdges(offsets, halfEdges);
+
+    for (unsigned int i = 0, count = (unsigned int)halfEdges.size(); i < count; )
+    {
+        unsigned int first = halfEdges[i];
+        unsigned int firstMin = min(origin(first), destination(first));
+        unsigned int firstMax = max(origin(first), destination(first));
+        unsigned int j = i + 1;
+
+        while (j < count &&
+               min(origin(halfEdges[j]), destination(halfEdges[j])) == firstMin &&
+               max(origin(halfEdges[j]), destination(halfEdges[j])) == firstMax)
+        {
+            j++;
+        }
+
+        // non-manifold edges pair only the first two faces
+        if (j - i >= 2 && firstMin != firstMax)
+        {
+            unsigned int second = halfEdges[i + 1];
+            _halfEdgeTwins[first] = second;
+            _halfEdgeTwins[second] = first;
+        }
+
+        i = j;
+    }
+}
+
+void HalfEdgeMesh::buildVertexNeighbours(vector<unsigned int> &offsets, vector<unsigned int> &neighbours) const
+{
+    unsigned int vertexCount = vertexCapacity();
+
+    vector<unsigned int> edgeOffsets;
+    vector<unsigned int> halfEdges;
+    groupHalfEdges(edgeOffsets, halfEdges);
+
+    vector<unsigned int> edges;
+
+    for (unsigned int i = 0, count = (unsigned int)halfEdges.size(); i < count; i++)
+    {
+        unsigned int halfEdge = halfEdges[i];
+        unsigned int v0 = min(origin(halfEdge), destination(halfEdge));
+        unsigned int v1 = max(origin(halfEdge), destination(halfEdge));
+
+        if (v0 == v1)
+            continue;
+
+        if (!edges.empty() && edges[edges.size() - 2] == v0 && edges[edges.size() - 1] == v1)
+            continue;
+
+        edges.push_back(v0);
+        edges.push_back(v1);
+    }
+
+    offsets.assign(vertexCount + 1, 0);
+
+    for (unsigned int i = 0; i < edges.size(); i++)
+        offsets[edges[i] + 1]++;
+
+    for (unsigned int i = 0; i < vertexCount; i++)
+        offsets[i + 1] += offsets[i];
+
+    neighbours.resize(offsets[vertexCount]);
+    vector<unsigned int> cursors(offsets.begin(), offsets.end() - 1);
+
+    for (unsigned int i = 0; i < edges.size(); i += 2)
+    {
+        neighbours[cursors[edges[i]]++] = edges[i + 1];
+        neighbours[cursors[edges[i + 1]]++] = edges[i];
+    }
+}
+
+unsigned int HalfEdgeMesh::edgeCount() const
+{
+    vector<unsigned int> offsets;
+    vector<unsigned int> neighbours;
+    buildVertexNeighbours(offsets, neighbours);
+    return (unsigned int)neighbours.size() / 2;
+}
+
+void HalfEdgeMesh::fromIndexRepresentation(const vector<Vector3D> &vertices, const vector<Vector3D> &texCoords, const vector<TriQuad> &triangles)
+{
+    removeAll();
+
+    _positions = vertices;
+    _vertexFlags.assign(vertices.size(), 0);
+    _selectionWeights.assign(vertices.size(), 0.0f);
+
+    _texCoords = texCoords;
+    _texCoordFlags.assign(texCoords.size(), 0);
+
+    _faceSizes.reserve(triangles.size());
+    _faceFlags.reserve(triangles.size());
+    _halfEdgeVertices.reserve(triangles.size() * 4);
+    _halfEdgeTexCoords.reserve(triangles.size() * 4);
+    _halfEdgeTwins.reserve(triangles.size() * 4);
+    _halfEdgeFlags.reserve(triangles.size() * 4);
+
+    for (unsigned int i = 0; i < triangles.size(); i++)
+    {
+        const TriQuad &triQuad = triangles[i];
+        addFace(triQuad.vertexIndices, triQuad.texCoordIndices, triQuad.isQuad ? 4 : 3);
+    }
+
+    rebuildTwins();
+}
+
+// Deleted slots are skipped, live elements keep their relative order.
+void HalfEdgeMesh::toIndexRepresentation(vector<Vector3D> &vertices, vector<Vector3D> &texCoords, vector<TriQuad> &triangles) const
+{
+    vertices.clear();
+    texCoords.clear();
+    triangles.clear();
+
+    vector<unsigned int> vertexIndices(vertexCapacity(), InvalidIndex);
+    vector<unsigned int> texCoordIndices(texCoordCapacity(), InvalidIndex);
+
+    vertices.reserve(vertexCount());
+    texCoords.reserve(texCoordCount());
+    triangles.reserve(faceCount());
+
+    for (unsigned int i = 0; i < vertexCapacity(); i++)
+    {
+        if (isVertexDeleted(i))
+            continue;
+
+        vertexIndices[i] = (unsigned int)vertices.size();
+        vertices.push_back(_positions[i]);
+    }
+
+    for (unsigned int i = 0; i < texCoordCapacity(); i++)
+    {
+        if (isTexCoordDeleted(i))
+            continue;
+
+        texCoordIndices[i] = (unsigned int)texCoords.size();
+        texCoords.push_back(_texCoords[i]);
+    }
+
+    for (unsigned int face = 0; face < faceCapacity(); face++)
+    {
+        if (isFaceDeleted(face))
+            continue;
+
+        TriQuad triQuad;
+        triQuad.isQuad = _faceSizes[face] == 4;
+
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            if (i < _faceSizes[face])
+            {
+                triQuad.vertexIndices[i] = vertexIndices[faceVertex(face, i)];
+                triQuad.texCoordIndices[i] = texCoordIndices[faceTexCoord(face, i)];
+            }
+            else
+            {
+                triQuad.vertexIndices[i] = 0;
+                triQuad.texCoordIndices[i] = 0;
+            }
+        }
+
+        triangles.push_back(triQuad);
+    }
+}
+
+void HalfEdgeMesh::merge(const HalfEdgeMesh &other)
+{
+    vector<unsigned int> vertexIndices(other.vertexCapacity(), InvalidIndex);
+    vector<unsigned int> texCoordIndices(other.texCoordCapacity(), InvalidIndex);
+
+    for (unsigned int i = 0; i < other.vertexCapacity(); i++)
+    {
+        if (!other.isVertexDeleted(i))
+            vertexIndices[i] = addVertex(other._positions[i]);
+    }
+
+    for (unsigned int i = 0; i < other.texCoordCapacity(); i++)
+    {
+        if (!other.isTexCoordDeleted(i))
+            texCoordIndices[i] = addTexCoord(other._texCoords[i]);
+    }
+
+    for (unsigned int face = 0; face < other.faceCapacity(); face++)
+    {
+        unsigned int size = other.faceSize(face);
+        if (size == 0)
+            continue;
+
+        unsigned int vertices[4], texCoords[4];
+        for (unsigned int i = 0; i < size; i++)
+        {
+            vertices[i] = vertexIndices[other.faceVertex(face, i)];
+            texCoords[i] = texCoordIndices[other.faceTexCoord(face, i)];
+        }
+
+        addFace(vertices, texCoords, size);
+    }
+
+    rebuildTwins();
+}
+
+void HalfEdgeMesh::removeUnusedVertices()
+{
+    vector<bool> used(vertexCapacity(), false);
+
+    for (unsigned int i = 0; i < halfEdgeCapacity(); i++)
+    {
+        if (_halfEdgeVertices[i] != InvalidIndex)
+            used[_halfEdgeVertices[i]] = true;
+    }
+
+    for (unsigned int i = 0; i < vertexCapacity(); i++)
+    {
+        if (!used[i] && !isVertexDeleted(i))
+            removeVertex(i);
+    }
+}
+
+void HalfEdgeMesh::removeUnusedTexCoords()
+{
+    vector<bool> used(texCoordCapacity(), false);
+
+    for (unsigned int i = 0; i < halfEdgeCapacity(); i++)
+    {
+        if (_halfEdgeTexCoords[i] != InvalidIndex)
+            used[_halfEdgeTexCoords[i]] = true;
+    }
+
+    for (unsigned int i = 0; i < texCoordCapacity(); i++)
+    {
+        if (!used[i] && !isTexCoordDeleted(i))
+            removeTexCoord(i);
+    }
+}
+
+// Drops repeated consecutive corners, a quad can collapse to a triangle,
+// anything smaller is removed. Returns true when the face was removed.
+bool HalfEdgeMesh::collapseDegeneratedFace(unsigned int face)
+{
+    unsigned int size = _faceSizes[face];
+    unsigned int vertices[4], texCoords[4];
+    unsigned int count = 0;
+
+    for (unsigned int i = 0; i < size; i++)
+    {
+        unsigned int vertex = faceVertex(face, i);
+        if (count > 0 && vertices[count - 1] == vertex)
+            continue;
+
+        vertices[count] = vertex;
+        texCoords[count] = faceTexCoord(face, i);
+        count++;
+    }
+
+    if (count > 1 && vertices[count - 1] == vertices[0])
+        count--;
+
+    if (count < 3 || (count == 4 && (vertices[0] == vertices[2] || vertices[1] == vertices[3])))
+    {
+        removeFace(face);
+        return true;
+    }
+
+    if (count < size)
+        setFace(face, vertices, texCoords, count);
+
+    return false;
+}
+
+void HalfEdgeMesh::mergeSelectedVertices()
+{
+    Vector3D center;
+    unsigned int selectedCount = 0;
+
+    for (unsigned int i = 0; i < vertexCapacity(); i++)
+    {
+        if (!isVertexDeleted(i) && isVertexSelected(i))
+        {
+            center += _positions[i];
+            selectedCount++;
+        }
+    }
+
+    if (selectedCount < 2)
+        return;
+
+    center /= (float)selectedCount;
+
+    unsigned int mergedVertex = addVertex(center);
+
+    for (unsigned int i = 0; i < halfEdgeCapacity(); i++)
+    {
+        unsigned int vertex = _halfEdgeVertices[i];
+        if (vertex != InvalidIndex && vertex != mergedVertex && isVertexSelected(vertex))
+            _halfEdgeVertices[i] = mergedVertex;
+    }
+
+    for (unsigned int face = 0; face < faceCapacity(); face++)
+    {
+        if (!isFaceDeleted(face))
+            collapseDegeneratedFace(face);
+    }
+
+    removeUnusedVertices();
+    removeUnusedTexCoords();
+    rebuildTwins();
+}
+
+void HalfEdgeMesh::removeSelectedFaces()
+{
+    for (unsigned int face = 0; face < faceCapacity(); face++)
+    {
+        if (!isFaceDeleted(face) && isFaceSelected(face))
+            removeFace(face);
+    }
+
+    removeUnusedVertices();
+    removeUnusedTexCoords();
+    rebuildTwins();
+}
+
+void HalfEdgeMesh::splitSelectedFaces()
+{
+    unsigned int faceCount = faceCapacity();
+
+    // midpoints are shared with the twin, texture midpoints only across seamless edges
+    vector<unsigned int> vertexMidpoints(halfEdgeCapacity(), InvalidIndex);
+    vector<unsigned int> texCoordMidpoints(halfEdgeCapacity(), InvalidIndex);
+
+    unsigned int v[9], t[9];
+
+    for (unsigned int face = 0; face < faceCount; face++)
+    {
+        unsigned int size = _faceSizes[face];
+        if (size == 0 || !isFaceSelected(face))
+            continue;
+
+        for (unsigned int i = 0; i < size; i++)
+        {
+            unsigned int halfEdge = face * 4 + i;
+            unsigned int nextHalfEdge = next(halfEdge);
+            unsigned int twin = _halfEdgeTwins[halfEdge];
+
+            if (vertexMidpoints[halfEdge] == InvalidIndex)
+            {
+                unsigned int midpoint = addVertex((_positions[origin(halfEdge)] + _positions[origin(nextHalfEdge)]) / 2.0f);
+                vertexMidpoints[halfEdge] = midpoint;
+                if (twin != InvalidIndex)
+                    vertexMidpoints[twin] = midpoint;
+            }
+
+            if (texCoordMidpoints[halfEdge] == InvalidIndex)
+            {
+                unsigned int t0 = _halfEdgeTexCoords[halfEdge];
+                unsigned int t1 = _halfEdgeTexCoords[nextHalfEdge];
+                unsigned int midpoint = addTexCoord((_texCoords[t0] + _texCoords[t1]) / 2.0f);
+                texCoordMidpoints[halfEdge] = midpoint;
+                if (twin != InvalidIndex && _halfEdgeTexCoords[twin] == t1 && _halfEdgeTexCoords[next(twin)] == t0)
+                    texCoordMidpoints[twin] = midpoint;
+            }
+
+            v[i] = origin(halfEdge);
+            t[i] = _halfEdgeTexCoords[halfEdge];
+            v[i + size] = vertexMidpoints[halfEdge];
+            t[i + size] = texCoordMidpoints[halfEdge];
+        }
+
+        if (size == 4)
+        {
+            /*
+                3----(6)----2
+                |     |     |
+               (7)---[8]---(5)
+                |     |     |
+                0----(4)----1
+            */
+
+            v[8] = addVertex((_positions[v[7]] + _positions[v[5]]) / 2.0f);
+            t[8] = addTexCoord((_texCoords[t[7]] + _texCoords[t[5]]) / 2.0f);
+
+            static const unsigned int quads[4][4] = { { 0, 4, 8, 7 }, { 4, 1, 5, 8 }, { 8, 5, 2, 6 }, { 7, 8, 6, 3 } };
+
+            for (unsigned int i = 0; i < 4; i++)
+            {
+                unsigned int vertices[4], texCoords[4];
+                for (unsigned int j = 0; j < 4; j++)
+                {
+                    vertices[j] = v[quads[i][j]];
+                    texCoords[j] = t[quads[i][j]];
+                }
+
+                if (i == 0)
+                    setFace(face, vertices, texCoords, 4);
+                else
+                    addFace(vertices, texCoords, 4);
+            }
+        }
+        else
+        {
+            /*
+                   2
+                  /\
+               *5/__\*4
+                /\  /\
+               /__\/__\
+               0  *3   1
+            */
+
+            static const unsigned int triangles[4][3] = { { 0, 3, 5 }, { 3, 1, 4 }, { 5, 4, 2 }, { 3, 4, 5 } };
+
+            for (unsigned int i = 0; i < 4; i++)
+            {
+                unsigned int vertices[3], texCoords[3];
+                for (unsigned int j = 0; j < 3; j++)
+                {
+                    vertices[j] = v[triangles[i][j]];
+                    texCoords[j] = t[triangles[i][j]];
+                }
+
+                if (i == 0)
+                    setFace(face, vertices, texCoords, 3);
+                else
+                    addFace(vertices, texCoords, 3);
+            }
+        }
+
+        setFaceSelected(face, false);
+    }
+
+    rebuildTwins();
+}
+
+void HalfEdgeMesh::extrudeSelectedFaces()
+{
+    unsigned int faceCount = faceCapacity();
+    vector<unsigned int> duplicates(vertexCapacity(), InvalidIndex);
+
+    for (unsigned int face = 0; face < faceCount; face++)
+    {
+        unsigned int size = _faceSizes[face];
+        if (size == 0 || !isFaceSelected(face))
+            continue;
+
+        for (unsigned int i = 0; i < size; i++)
+        {
+            unsigned int halfEdge = face * 4 + i;
+            unsigned int twin = _halfEdgeTwins[halfEdge];
+
+            if (twin != InvalidIndex && isFaceSelected(twin / 4))
+                continue;
+
+            unsigned int original0 = origin(halfEdge);
+            unsigned int original1 = destination(halfEdge);
+
+            if (duplicates[original0] == InvalidIndex)
+                duplicates[original0] = addVertex(_positions[original0]);
+            if (duplicates[original1] == InvalidIndex)
+                duplicates[original1] = addVertex(_positions[original1]);
+
+            unsigned int vertices[4] = { original0, original1, duplicates[original1], duplicates[original0] };
+            unsigned int texCoords[4];
+            for (unsigned int j = 0; j < 4; j++)
+                texCoords[j] = addTexCoord(_positions[vertices[j]]);
+
+            addFace(vertices, texCoords, 4);
+        }
+    }
+
+    for (unsigned int face = 0; face < faceCount; face++)
+    {
+        if (_faceSizes[face] == 0 || !isFaceSelected(face))
+            continue;
+
+        for (unsigned int i = 0; i < _faceSizes[face]; i++)
+        {
+            unsigned int &vertex = _halfEdgeVertices[face * 4 + i];
+            if (vertex < duplicates.size() && duplicates[vertex] != InvalidIndex)
+                vertex = duplicates[vertex];
+        }
+    }
+
+    rebuildTwins();
+}
+
+void HalfEdgeMesh::detachSelectedVertices()
+{
+    unsigned int vertexCount = vertexCapacity();
+
+    for (unsigned int i = 0; i < halfEdgeCapacity(); i++)
+    {
+        unsigned int vertex = _halfEdgeVertices[i];
+        if (vertex != InvalidIndex && vertex < vertexCount && isVertexSelected(vertex))
+            _halfEdgeVertices[i] = addVertex(_positions[vertex]);
+    }
+
+    for (unsigned int i = 0; i < vertexCount; i++)
+    {
+        if (!isVertexDeleted(i) && isVertexSelected(i))
+            removeVertex(i);
+    }
+
+    rebuildTwins();
+}
+
+void HalfEdgeMesh::detachSelectedFaces()
+{
+    vector<unsigned int> duplicates(vertexCapacity(), InvalidIndex);
+
+    for (unsigned int face = 0; face < faceCapacity(); face++)
+    {
+        if (_faceSizes[face] == 0 || !isFaceSelected(face))
+            continue;
+
+        for (unsigned int i = 0; i < _faceSizes[face]; i++)
+        {
+            unsigned int halfEdge = face * 4 + i;
+            unsigned int vertex = _halfEdgeVertices[halfEdge];
+
+            if (duplicates[vertex] == InvalidIndex)
+                duplicates[vertex] = addVertex(_positions[vertex]);
+
+            _halfEdgeVertices[halfEdge] = duplicates[vertex];
+        }
+    }
+
+    removeUnusedVertices();
+    rebuildTwins();
+}
+
+void HalfEdgeMesh::flipSelectedFaces()
+{
+    for (unsigned int face = 0; face < faceCapacity(); face++)
+    {
+        if (_faceSizes[face] == 0 || !isFaceSelected(face))
+            continue;
+
+        unsigned int first = face * 4;
+        unsigned int last = first + 2;
+
+        swap(_halfEdgeVertices[first], _halfEdgeVertices[last]);
+        swap(_halfEdgeTexCoords[first], _halfEdgeTexCoords[last]);
+    }
+
+    rebuildTwins();
+}
+
+// Only edges shared by two triangles can be turned.
+void HalfEdgeMesh::turnSelectedEdges()
+{
+    vector<bool> turned(faceCapacity(), false);
+
+    for (unsigned int halfEdge = 0; halfEdge < halfEdgeCapacity(); halfEdge++)
+    {
+        unsigned int twin = _halfEdgeTwins[halfEdge];
+
+        if (twin == InvalidIndex || twin < halfEdge || !isEdgeSelected(halfEdge))
+            continue;
+
+        unsigned int face0 = halfEdge / 4;
+        unsigned int face1 = twin / 4;
+
+        if (face0 == face1 || _faceSizes[face0] != 3 || _faceSizes[face1] != 3)
+            continue;
+
+        // twins around an already turned pair are stale until rebuildTwins
+        if (turned[face0] || turned[face1])
+            continue;
+
+        // a -> d -> b -> c is the boundary of both triangles, the new edge goes from c to d
+        unsigned int h0 = halfEdge, h1 = twin;
+        unsigned int quadHalfEdges[4] = { next(h1), previous(h1), next(h0), previous(h0) };
+        unsigned int vertices[4], texCoords[4];
+
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            vertices[i] = _halfEdgeVertices[quadHalfEdges[i]];
+            texCoords[i] = _halfEdgeTexCoords[quadHalfEdges[i]];
+        }
+
+        if (vertices[1] == vertices[3])
+            continue;
+
+        unsigned int v0[3] = { vertices[0], vertices[1], vertices[3] };
+        unsigned int t0[3] = { texCoords[0], texCoords[1], texCoords[3] };
+        unsigned int v1[3] = { vertices[1], vertices[2], vertices[3] };
+        unsigned int t1[3] = { texCoords[1], texCoords[2], texCoords[3] };
+
+        setFace(face0, v0, t0, 3);
+        setFace(face1, v1, t1, 3);
+
+        _halfEdgeFlags[face0 * 4 + 1] |= FlagSelected;
+        _halfEdgeFlags[face1 * 4 + 2] |= FlagSelected;
+
+        turned[face0] = true;
+        turned[face1] = true;
+    }
+
+    rebuildTwins();
+}
+
+void HalfEdgeMesh::triangulate()
+{
+    unsigned int faceCount = faceCapacity();
+
+    for (unsigned int face = 0; face < faceCount; face++)
+    {
+        if (_faceSizes[face] != 4)
+            continue;
+
+        unsigned int vertices[4], texCoords[4];
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            vertices[i] = faceVertex(face, i);
+            texCoords[i] = faceTexCoord(face, i);
+        }
+
+        unsigned int v0[3] = { vertices[0], vertices[1], vertices[2] };
+        unsigned int t0[3] = { texCoords[0], texCoords[1], texCoords[2] };
+        unsigned int v1[3] = { vertices[0], vertices[2], vertices[3] };
+        unsigned int t1[3] = { texCoords[0], texCoords[2], texCoords[3] };
+
+        bool selected = isFaceSelected(face);
+
+        setFace(face, v0, t0, 3);
+        unsigned int secondFace = addFace(v1, t1, 3);
+        setFaceSelected(secondFace, selected);
+    }
+
+    rebuildTwins();
+}
+
+void HalfEdgeMesh::loopSubdivision()
+{
+    triangulate();
+
+    unsigned int vertexCount = vertexCapacity();
+    unsigned int faceCount = faceCapacity();
+
+    vector<unsigned int> offsets;
+    vector<unsigned int> neighbours;
+    buildVertexNeighbours(offsets, neighbours);
+
+    vector<unsigned int> vertexMidpoints(halfEdgeCapacity(), InvalidIndex);
+    vector<unsigned int> texCoordMidpoints(halfEdgeCapacity(), InvalidIndex);
+
+    for (unsigned int face = 0; face < faceCount; face++)
+    {
+        if (_faceSizes[face] == 0)
+            continue;
+
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            unsigned int halfEdge = face * 4 + i;
+            unsigned int twin = _halfEdgeTwins[halfEdge];
+            unsigned int v0 = origin(halfEdge);
+            unsigned int v1 = destination(halfEdge);
+
+            if (vertexMidpoints[halfEdge] == InvalidIndex)
+            {
+                Vector3D edgeVertex;
+
+                if (twin == InvalidIndex)
+                {
+                    edgeVertex = (_positions[v0] + _positions[v1]) / 2.0f;
+                }
+                else
+                {
+                    const Vector3D &v2 = _positions[origin(previous(halfEdge))];
+                    const Vector3D &v3 = _positions[origin(previous(twin))];
+
+                    edgeVertex = 3.0f * (_positions[v0] + _positions[v1]) / 8.0f + 1.0f * (v2 + v3) / 8.0f;
+                }
+
+                unsigned int midpoint = addVertex(edgeVertex);
+                vertexMidpoints[halfEdge] = midpoint;
+                if (twin != InvalidIndex)
+                    vertexMidpoints[twin] = midpoint;
+            }
+
+            if (texCoordMidpoints[halfEdge] == InvalidIndex)
+            {
+                unsigned int t0 = _halfEdgeTexCoords[halfEdge];
+                unsigned int t1 = _halfEdgeTexCoords[next(halfEdge)];
+                unsigned int midpoint = addTexCoord((_texCoords[t0] + _texCoords[t1]) / 2.0f);
+                texCoordMidpoints[halfEdge] = midpoint;
+                if (twin != InvalidIndex && _halfEdgeTexCoords[twin] == t1 && _halfEdgeTexCoords[next(twin)] == t0)
+                    texCoordMidpoints[twin] = midpoint;
+            }
+        }
+    }
+
+    vector<Vector3D> repositioned(vertexCount);
+
+    for (unsigned int vertex = 0; vertex < vertexCount; vertex++)
+    {
+        unsigned int begin = offsets[vertex];
+        unsigned int end = offsets[vertex + 1];
+
+        // isolated vertices stay where they are
+        if (begin == end)
+        {
+            repositioned[vertex] = _positions[vertex];
+            continue;
+        }
+
+        float n = (float)(end - begin);
+        float beta = 3.0f + 2.0f * cosf(FLOAT_PI * 2.0f / n);
+        beta = 5.0f / 8.0f - (beta * beta) / 64.0f;
+
+        Vector3D finalPosition = (1.0f - beta) * _positions[vertex];
+        float bon = beta / n;
+
+        for (unsigned int i = begin; i < end; i++)
+            finalPosition += _positions[neighbours[i]] * bon;
+
+        repositioned[vertex] = finalPosition;
+    }
+
+    copy(repositioned.begin(), repositioned.end(), _positions.begin());
+
+    // new faces can reuse free slots, so the original ones are collected first
+    vector<unsigned int> faces;
+    faces.reserve(this->faceCount());
+
+    for (unsigned int face = 0; face < faceCount; face++)
+    {
+        if (_faceSizes[face] != 0)
+            faces.push_back(face);
+    }
+
+    unsigned int v[6], t[6];
+    static const unsigned int triangles[4][3] = { { 0, 3, 5 }, { 3, 1, 4 }, { 5, 4, 2 }, { 3, 4, 5 } };
+
+    for (unsigned int f = 0; f < faces.size(); f++)
+    {
+        unsigned int face = faces[f];
+
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            unsigned int halfEdge = face * 4 + i;
+            v[i] = _halfEdgeVertices[halfEdge];
+            t[i] = _halfEdgeTexCoords[halfEdge];
+            v[i + 3] = vertexMidpoints[halfEdge];
+            t[i + 3] = texCoordMidpoints[halfEdge];
+        }
+
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            unsigned int vertices[3], texCoords[3];
+            for (unsigned int j = 0; j < 3; j++)
+            {
+                vertices[j] = v[triangles[i][j]];
+                texCoords[j] = t[triangles[i][j]];
+            }
+
+            if (i == 0)
+                setFace(face, vertices, texCoords, 3);
+            else
+                addFace(vertices, texCoords, 3);
+        }
+
+        setFaceSelected(face, false);
+    }
+
+    rebuildTwins();
+}
+
+void HalfEdgeMesh::computeSoftSelection(MeshSelectionMode selectionMode, const vector<float> &weights)
+{
+    fill(_selectionWeights.begin(), _selectionWeights.end(), 0.0f);
+
+    if (weights.empty())
+        return;
+
+    switch (selectionMode)
+    {
+        case MeshSelectionMode::Vertices:
+            softSelectFromVertices(weights);
+            break;
+        case MeshSelectionMode::Triangles:
+            softSelectFromFaces(weights);
+            break;
+        case MeshSelectionMode::Edges:
+            softSelectFromEdges(weights);
+            break;
+    }
+}
+
+// All selected elements are seeded at once, every vertex is visited once per
+// breadth-first step instead of once per selected source.
+void HalfEdgeMesh::softSelectFromVertices(const vector<float> &weights)
+{
+    vector<unsigned int> offsets;
+    vector<unsigned int> neighbours;
+    buildVertexNeighbours(offsets, neighbours);
+
+    vector<bool> visited(vertexCapacity(), false);
+    vector<unsigned int> currentStep;
+    vector<unsigned int> nextStep;
+
+    for (unsigned int i = 0; i < vertexCapacity(); i++)
+    {
+        if (!isVertexDeleted(i) && isVertexSelected(i))
+        {
+            _selectionWeights[i] = weights[0];
+            visited[i] = true;
+            currentStep.push_back(i);
+        }
+    }
+
+    for (unsigned int w = 1; w < weights.size() && !currentStep.empty(); w++)
+    {
+        nextStep.clear();
+
+        for (unsigned int i = 0; i < currentStep.size(); i++)
+        {
+            unsigned int vertex = currentStep[i];
+            for (unsigned int j = offsets[vertex]; j < offsets[vertex + 1]; j++)
+            {
+                unsigned int neighbour = neighbours[j];
+                if (visited[neighbour])
+                    continue;
+
+                visited[neighbour] = true;
+                _selectionWeights[neighbour] = weights[w];
+                nextStep.push_back(neighbour);
+            }
+        }
+
+        currentStep.swap(nextStep);
+    }
+}
+
+void HalfEdgeMesh::softSelectFromFaces(const vector<float> &weights)
+{
+    vector<float> faceWeights(faceCapacity(), 0.0f);
+    vector<bool> visited(faceCapacity(), false);
+    vector<unsigned int> currentStep;
+    vector<unsigned int> nextStep;
+
+    for (unsigned int face = 0; face < faceCapacity(); face++)
+    {
+        if (!isFaceDeleted(face) && isFaceSelected(face))
+        {
+            faceWeights[face] = weights[0];
+            visited[face] = true;
+            currentStep.push_back(face);
+        }
+    }
+
+    for (unsigned int w = 1; w < weights.size() && !currentStep.empty(); w++)
+    {
+        nextStep.clear();
+
+        for (unsigned int i = 0; i < currentStep.size(); i++)
+        {
+            unsigned int face = currentStep[i];
+            for (unsigned int j = 0; j < _faceSizes[face]; j++)
+            {
+                unsigned int twin = _halfEdgeTwins[face * 4 + j];
+                if (twin == InvalidIndex || visited[twin / 4])
+                    continue;
+
+                visited[twin / 4] = true;
+                faceWeights[twin / 4] = weights[w];
+                nextStep.push_back(twin / 4);
+            }
+        }
+
+        currentStep.swap(nextStep);
+    }
+
+    for (unsigned int face = 0; face < faceCapacity(); face++)
+    {
+        for (unsigned int i = 0; i < _faceSizes[face]; i++)
+        {
+            unsigned int vertex = faceVertex(face, i);
+            if (_selectionWeights[vertex] < faceWeights[face])
+                _selectionWeights[vertex] = faceWeights[face];
+        }
+    }
+}
+
+// Edge weights spread along quad loops, the edge across the quad continues the loop.
+void HalfEdgeMesh::softSelectFromEdges(const vector<float> &weights)
+{
+    vector<float> edgeWeights(halfEdgeCapacity(), 0.0f);
+    vector<bool> visited(halfEdgeCapacity(), false);
+    vector<unsigned int> currentStep;
+    vector<unsigned int> nextStep;
+
+    for (unsigned int halfEdge = 0; halfEdge < halfEdgeCapacity(); halfEdge++)
+    {
+        if (_halfEdgeVertices[halfEdge] != InvalidIndex && isEdgeSelected(halfEdge))
+        {
+            edgeWeights[halfEdge] = weights[0];
+            visited[halfEdge] = true;
+            currentStep.push_back(halfEdge);
+        }
+    }
+
+    for (unsigned int w = 1; w < weights.size() && !currentStep.empty(); w++)
+    {
+        nextStep.clear();
+
+        for (unsigned int i = 0; i < currentStep.size(); i++)
+        {
+            unsigned int halfEdge = currentStep[i];
+            unsigned int twin = _halfEdgeTwins[halfEdge];
+            unsigned int sides[2] = { halfEdge, twin };
+
+            for (unsigned int j = 0; j < 2; j++)
+            {
+                if (sides[j] == InvalidIndex || _faceSizes[sides[j] / 4] != 4)
+                    continue;
+
+                unsigned int opposite = next(next(sides[j]));
+                if (visited[opposite])
+                    continue;
+
+                unsigned int oppositeTwin = _halfEdgeTwins[opposite];
+                visited[opposite] = true;
+                edgeWeights[opposite] = weights[w];
+                if (oppositeTwin != InvalidIndex)
+                {
+                    visited[oppositeTwin] = true;
+                    edgeWeights[oppositeTwin] = weights[w];
+                }
+                nextStep.push_back(opposite);
+            }
+        }
+
+        currentStep.swap(nextStep);
+    }
+
+    for (unsigned int halfEdge = 0; halfEdge < halfEdgeCapacity(); halfEdge++)
+    {
+        if (_halfEdgeVertices[halfEdge] == InvalidIndex)
+            continue;
+
+        unsigned int vertices[2] = { origin(halfEdge), destination(halfEdge) };
+        for (unsigned int i = 0; i < 2; i++)
+        {
+            if (_selectionWeights[vertices[i]] < edgeWeights[halfEdge])
+                _selectionWeights[vertices[i]] = edgeWeights[halfEdge];
+        }
+    }
+}
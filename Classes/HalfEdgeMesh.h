@@ -0,0 +1,135 @@
+//
+//  HalfEdgeMesh.h
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#pragma once
+
+#include "MeshForwardDeclaration.h"
+#include <climits>
+
+// Index based alternative to the Mesh2 topology. Vertices, texture coordinates
+// and faces live in parallel arrays addressed by 32-bit indices, deleted slots
+// are recycled through free lists. Every face owns a block of four half-edges
+// (the last one is unused by triangles), so the face, next and previous links
+// are implicit and only the twin has to be stored.
+class HalfEdgeMesh
+{
+public:
+    static const unsigned int InvalidIndex = UINT_MAX;
+
+    enum Flags
+    {
+        FlagSelected = 1,
+        FlagDeleted = 2,
+    };
+
+private:
+    vector<Vector3D> _positions;
+    vector<unsigned char> _vertexFlags;
+    vector<float> _selectionWeights;
+    vector<unsigned int> _freeVertices;
+
+    vector<Vector3D> _texCoords;
+    vector<unsigned char> _texCoordFlags;
+    vector<unsigned int> _freeTexCoords;
+
+    vector<unsigned char> _faceSizes;
+    vector<unsigned char> _faceFlags;
+    vector<unsigned int> _freeFaces;
+
+    vector<unsigned int> _halfEdgeVertices;
+    vector<unsigned int> _halfEdgeTexCoords;
+    vector<unsigned int> _halfEdgeTwins;
+    vector<unsigned char> _halfEdgeFlags;
+
+    void groupHalfEdges(vector<unsigned int> &offsets, vector<unsigned int> &halfEdges) const;
+    void buildVertexNeighbours(vector<unsigned int> &offsets, vector<unsigned int> &neighbours) const;
+    void removeUnusedVertices();
+    void removeUnusedTexCoords();
+    bool collapseDegeneratedFace(unsigned int face);
+    void setFace(unsigned int face, const unsigned int *vertices, const unsigned int *texCoords, unsigned int size);
+    void softSelectFromVertices(const vector<float> &weights);
+    void softSelectFromFaces(const vector<float> &weights);
+    void softSelectFromEdges(const vector<float> &weights);
+
+public:
+    HalfEdgeMesh();
+    ~HalfEdgeMesh();
+
+    unsigned int vertexCapacity() const { return (unsigned int)_positions.size(); }
+    unsigned int texCoordCapacity() const { return (unsigned int)_texCoords.size(); }
+    unsigned int faceCapacity() const { return (unsigned int)_faceSizes.size(); }
+    unsigned int halfEdgeCapacity() const { return (unsigned int)_halfEdgeVertices.size(); }
+
+    unsigned int vertexCount() const { return vertexCapacity() - (unsigned int)_freeVertices.size(); }
+    unsigned int texCoordCount() const { return texCoordCapacity() - (unsigned int)_freeTexCoords.size(); }
+    unsigned int faceCount() const { return faceCapacity() - (unsigned int)_freeFaces.size(); }
+    unsigned int edgeCount() const;
+
+    bool isVertexDeleted(unsigned int vertex) const { return (_vertexFlags[vertex] & FlagDeleted) != 0; }
+    bool isTexCoordDeleted(unsigned int texCoord) const { return (_texCoordFlags[texCoord] & FlagDeleted) != 0; }
+    bool isFaceDeleted(unsigned int face) const { return _faceSizes[face] == 0; }
+
+    const Vector3D &position(unsigned int vertex) const { return _positions[vertex]; }
+    void setPosition(unsigned int vertex, const Vector3D &position) { _positions[vertex] = position; }
+    const Vector3D &texCoord(unsigned int texCoord) const { return _texCoords[texCoord]; }
+    void setTexCoord(unsigned int texCoord, const Vector3D &position) { _texCoords[texCoord] = position; }
+    float selectionWeight(unsigned int vertex) const { return _selectionWeights[vertex]; }
+
+    bool isVertexSelected(unsigned int vertex) const { return (_vertexFlags[vertex] & FlagSelected) != 0; }
+    bool isTexCoordSelected(unsigned int texCoord) const { return (_texCoordFlags[texCoord] & FlagSelected) != 0; }
+    bool isFaceSelected(unsigned int face) const { return (_faceFlags[face] & FlagSelected) != 0; }
+    bool isEdgeSelected(unsigned int halfEdge) const { return (_halfEdgeFlags[halfEdge] & FlagSelected) != 0; }
+    void setVertexSelected(unsigned int vertex, bool selected);
+    void setTexCoordSelected(unsigned int texCoord, bool selected);
+    void setFaceSelected(unsigned int face, bool selected);
+    void setEdgeSelected(unsigned int halfEdge, bool selected);
+
+    unsigned int faceSize(unsigned int face) const { return _faceSizes[face]; }
+    unsigned int faceHalfEdge(unsigned int face, unsigned int index) const { return face * 4 + index; }
+    unsigned int faceVertex(unsigned int face, unsigned int index) const { return _halfEdgeVertices[face * 4 + index]; }
+    unsigned int faceTexCoord(unsigned int face, unsigned int index) const { return _halfEdgeTexCoords[face * 4 + index]; }
+
+    unsigned int face(unsigned int halfEdge) const { return halfEdge / 4; }
+    unsigned int next(unsigned int halfEdge) const
+    {
+        unsigned int index = (halfEdge & 3U) + 1;
+        return (halfEdge & ~3U) | (index < _faceSizes[halfEdge / 4] ? index : 0U);
+    }
+    unsigned int previous(unsigned int halfEdge) const
+    {
+        unsigned int index = halfEdge & 3U;
+        return (halfEdge & ~3U) | (index > 0 ? index - 1 : _faceSizes[halfEdge / 4] - 1U);
+    }
+    unsigned int twin(unsigned int halfEdge) const { return _halfEdgeTwins[halfEdge]; }
+    unsigned int origin(unsigned int halfEdge) const { return _halfEdgeVertices[halfEdge]; }
+    unsigned int destination(unsigned int halfEdge) const { return _halfEdgeVertices[next(halfEdge)]; }
+
+    unsigned int addVertex(const Vector3D &position);
+    unsigned int addTexCoord(const Vector3D &position);
+    unsigned int addFace(const unsigned int *vertices, const unsigned int *texCoords, unsigned int size);
+    void removeVertex(unsigned int vertex);
+    void removeTexCoord(unsigned int texCoord);
+    void removeFace(unsigned int face);
+    void removeAll();
+    void rebuildTwins();
+
+    void fromIndexRepresentation(const vector<Vector3D> &vertices, const vector<Vector3D> &texCoords, const vector<TriQuad> &triangles);
+    void toIndexRepresentation(vector<Vector3D> &vertices, vector<Vector3D> &texCoords, vector<TriQuad> &triangles) const;
+
+    void merge(const HalfEdgeMesh &other);
+    void mergeSelectedVertices();
+    void removeSelectedFaces();
+    void splitSelectedFaces();
+    void extrudeSelectedFaces();
+    void detachSelectedVertices();
+    void detachSelectedFaces();
+    void flipSelectedFaces();
+    void turnSelectedEdges();
+    void triangulate();
+    void loopSubdivision();
+    void computeSoftSelection(MeshSelectionMode selectionMode, const vector<float> &weights);
+};
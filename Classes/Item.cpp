@@ -8,11 +8,12 @@
 
 #include "OpenGLDrawing.h"
 #include "Item.h"
+#include "TextureCollection.h"
 
 Item::Item(Mesh2 *aMesh)
 {
     scale = Vector3D(1, 1, 1);
-    mesh = aMesh;
+    _mesh = aMesh;
     selected = false;
     visible = true;
     _viewMode = ViewMode::SolidFlat;
@@ -20,7 +21,7 @@ Item::Item(Mesh2 *aMesh)
 
 Item::~Item()
 {
-    delete mesh;
+    _mesh->release();
 }
 
 Item::Item(MemoryReadStream *stream, TextureCollection &textures)
@@ -52,7 +53,17 @@ Item::Item(MemoryReadStream *stream, TextureCollection &textures)
     
     visible = true;
     
-    mesh = new Mesh2(stream, textures);
+    Texture *texture = NULL;
+    
+    if (stream->version() >= (unsigned int)ModelVersion::TextureNames)
+    {
+        unsigned int textureIndex = stream->read<unsigned int>();
+        if (textureIndex < textures.count())
+            texture = textures.textureAtIndex(textureIndex);
+    }
+    
+    _mesh = new Mesh2(stream);
+    _mesh->setTexture(texture);
 }
 
 void Item::encode(MemoryWriteStream *stream, TextureCollection &textures)
@@ -72,7 +83,14 @@ void Item::encode(MemoryWriteStream *stream, TextureCollection &textures)
     
     stream->write<bool>(selected);
 
-    mesh->encode(stream, textures);
+    Texture *texture = _mesh->texture();
+    
+    if (texture == NULL)
+        stream->write<unsigned int>(UINT_MAX);
+    else
+        stream->write<unsigned int>(textures.indexOfTexture(texture));
+    
+    _mesh->encode(stream);
 }
 
 Matrix4x4 Item::transform()
@@ -82,6 +100,17 @@ Matrix4x4 Item::transform()
     return m;
 }
 
+Mesh2 *Item::mesh()
+{
+    if (_mesh->isShared())
+    {
+        Mesh2 *copy = _mesh->copy();
+        _mesh->release();
+        _mesh = copy;
+    }
+    return _mesh;
+}
+
 void Item::drawForSelection(bool forSelection)
 {
     if (visible)
@@ -92,19 +121,19 @@ void Item::drawForSelection(bool forSelection)
 		glMultMatrixf(rotationMatrix);
         if (forSelection)
         {
-            mesh->draw(ViewMode::SolidFlat, scale, selected, forSelection);
+            _mesh->draw(ViewMode::SolidFlat, scale, selected, forSelection);
         }
         else
         {
             if (_viewMode == ViewMode::MixedWireSolid)
             {
                 glDisable(GL_DEPTH_TEST);
-                mesh->draw(_viewMode, scale, selected, forSelection);
+                _mesh->draw(_viewMode, scale, selected, forSelection);
                 glEnable(GL_DEPTH_TEST);
             }
             else
             {
-                mesh->draw(_viewMode, scale, selected, forSelection);
+                _mesh->draw(_viewMode, scale, selected, forSelection);
             }
         }
 		glPopMatrix();
@@ -128,33 +157,49 @@ void Item::scaleByOffset(Vector3D offset)
 
 Item *Item::duplicate()
 {
-    Item *newItem = new Item(new Mesh2());
+    _mesh->retain();
+    Item *newItem = new Item(_mesh);
     
     newItem->position = position;
     newItem->rotation = rotation;
     newItem->scale = scale;
-    
-    newItem->mesh->merge(mesh);
-    newItem->mesh->setColor(mesh->color());
-    newItem->mesh->setTexture(mesh->texture());
     newItem->selected = selected;
 	
 	return newItem;
 }
 
+void Item::addMemoryFootprint(FPMemoryFootprint &footprint, vector<const Mesh2 *> &countedMeshes) const
+{
+    footprint.add(FPMemoryCategory::Objects, sizeof(Item));
+    
+    if (find(countedMeshes.begin(), countedMeshes.end(), _mesh) != countedMeshes.end())
+        return;
+    
+    countedMeshes.push_back(_mesh);
+    footprint.add(_mesh->memoryFootprint());
+}
+
+FPMemoryFootprint Item::memoryFootprint() const
+{
+    FPMemoryFootprint footprint;
+    vector<const Mesh2 *> countedMeshes;
+    addMemoryFootprint(footprint, countedMeshes);
+    return footprint;
+}
+
 void Item::setPositionToGeometricCenter()
 {
     Vector3D center = Vector3D();
     
-    for (VertexNode *node = mesh->vertices().begin(), *end = mesh->vertices().end(); node != end; node = node->next())
+    for (VertexNode *node = _mesh->vertices().begin(), *end = _mesh->vertices().end(); node != end; node = node->next())
         center += node->data().position;
     
-	if (mesh->vertices().count() > 0)
-		center /= (float)mesh->vertices().count();
+	if (_mesh->vertices().count() > 0)
+		center /= (float)_mesh->vertices().count();
     
     Matrix4x4 inverseTranslate;
     inverseTranslate.Translate(-center);
-    mesh->transformAll(inverseTranslate);
+    mesh()->transformAll(inverseTranslate);
     
     position = center;
 }
@@ -167,57 +212,59 @@ ViewMode Item::viewMode()
 void Item::setViewMode(ViewMode viewMode)
 {
     _viewMode = viewMode;
-    mesh->setUnwrapped(_viewMode == ViewMode::Unwrap);
+    bool unwrapped = _viewMode == ViewMode::Unwrap;
+    if (_mesh->isUnwrapped() != unwrapped)
+        mesh()->setUnwrapped(unwrapped);
 }
 
 unsigned int Item::count()
 {
-    return mesh->selectedCount();
+    return _mesh->selectedCount();
 }
 
 bool Item::isSelectedAtIndex(unsigned int index)
 {
-    return mesh->isSelectedAtIndex(index);
+    return _mesh->isSelectedAtIndex(index);
 }
 
 void Item::setSelectedAtIndex(unsigned int index, bool selected)
 {
-    mesh->setSelectedAtIndex(selected, index);
+    mesh()->setSelectedAtIndex(selected, index);
 }
 
 void Item::expandSelectionFromIndex(unsigned int index, bool invert)
 {
-    mesh->expandSelectionFromIndex(index, invert);
+    mesh()->expandSelectionFromIndex(index, invert);
 }
 
 void Item::duplicateSelected()
 {
-    mesh->duplicateSelectedTriangles();
+    mesh()->duplicateSelectedTriangles();
 }
 
 void Item::removeSelected()
 {
-    mesh->removeSelected();
+    mesh()->removeSelected();
 }
 
 void Item::hideSelected()
 {
-    mesh->hideSelected();
+    mesh()->hideSelected();
 }
 
 void Item::unhideAll()
 {
-    mesh->unhideAll();
+    mesh()->unhideAll();
 }
 
 Vector4D Item::selectionColor()
 {
-    return mesh->color();
+    return _mesh->color();
 }
 
 void Item::setSelectionColor(Vector4D color)
 {
-    mesh->setColor(color);
+    mesh()->setColor(color);
 }
 
 void Item::willSelectThrough(bool selectThrough)
@@ -227,54 +274,59 @@ void Item::willSelectThrough(bool selectThrough)
 
 void Item::didSelect()
 {
-    mesh->resetTriangleCache();
-    mesh->computeSoftSelection();
+    _mesh->resetTriangleCache();
+    _mesh->computeSoftSelection();
 }
 
 bool Item::needsCullFace()
 {
-    if (mesh->selectionMode() == MeshSelectionMode::Triangles && Mesh2::selectThrough())
+    if (_mesh->selectionMode() == MeshSelectionMode::Triangles && Mesh2::selectThrough())
         return true;
     return false;
 }
 
 void Item::getSelectionCenterRotationScale(Vector3D &center, Quaternion &rotation, Vector3D &scale)
 {
-    mesh->getSelectionCenterRotationScale(center, rotation, scale);
+    _mesh->getSelectionCenterRotationScale(center, rotation, scale);
 }
 
 void Item::transformSelectedByMatrix(Matrix4x4 &matrix)
 {
-    mesh->transformSelected(matrix);
+    mesh()->transformSelected(matrix);
 }
 
 void Item::drawAllForSelection(bool forSelection)
 {
     if (forSelection)
     {
-        mesh->drawAll(ViewMode::SolidFlat, forSelection);
+        _mesh->drawAll(ViewMode::SolidFlat, forSelection);
     }
     else
     {
         if (_viewMode == ViewMode::MixedWireSolid)
         {
             glDisable(GL_DEPTH_TEST);
-            mesh->drawAll(_viewMode, forSelection);
+            _mesh->drawAll(_viewMode, forSelection);
             glEnable(GL_DEPTH_TEST);
         }
         else
         {
-            mesh->drawAll(_viewMode, forSelection);
+            _mesh->drawAll(_viewMode, forSelection);
         }
     }
 }
 
-bool Item::useGLProject()
+void Item::pickAllForSelection(FPSoftwarePicker &picker)
+{
+    _mesh->pickAll(picker);
+}
+
+bool Item::useProjectSelect()
 {
-    return mesh->useGLProject();
+    return _mesh->useProjectSelect();
 }
 
-void Item::glProjectSelect(int x, int y, int width, int height, Matrix4x4 &matrix, OpenGLSelectionMode selectionMode)
+void Item::projectSelect(const FPSelectionRegion &region, const Matrix4x4 &matrix, OpenGLSelectionMode selectionMode)
 {
-    mesh->glProjectSelect(x, y, width, height, matrix, selectionMode);
+    mesh()->projectSelect(region, matrix, selectionMode);
 }
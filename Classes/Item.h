@@ -18,11 +18,12 @@
 
 class Item : public IOpenGLManipulatingModelMesh
 {
+private:
+    Mesh2 *_mesh;
 public:
     Vector3D position;
     Quaternion rotation;
     Vector3D scale;
-    Mesh2 *mesh;
     bool selected;
     bool visible;
     ViewMode _viewMode;
@@ -35,6 +36,11 @@ public:
     
     Matrix4x4 transform();
     
+    // Duplicates share the mesh until one of them changes it. mesh() makes
+    // a private copy first, sharedMesh() is only for reading and drawing.
+    Mesh2 *mesh();
+    Mesh2 *sharedMesh() const { return _mesh; }
+    
     void drawForSelection(bool forSelection);
     void moveByOffset(Vector3D offset);
     void rotateByOffset(Quaternion offset);
@@ -42,6 +48,11 @@ public:
     Item *duplicate();
     void setPositionToGeometricCenter();
     
+    // The mesh is skipped when it is in countedMeshes, it is shared with
+    // an item counted before.
+    void addMemoryFootprint(FPMemoryFootprint &footprint, vector<const Mesh2 *> &countedMeshes) const;
+    FPMemoryFootprint memoryFootprint() const;
+    
     // IOpenGLManipulatingModel
     
     virtual ViewMode viewMode();
@@ -66,7 +77,8 @@ public:
     virtual void getSelectionCenterRotationScale(Vector3D &center, Quaternion &rotation, Vector3D &scale);
     virtual void transformSelectedByMatrix(Matrix4x4 &matrix);
     virtual void drawAllForSelection(bool forSelection);
-    virtual bool useGLProject();
-    virtual void glProjectSelect(int x, int y, int width, int height, Matrix4x4 &matrix, OpenGLSelectionMode selectionMode);
+    virtual void pickAllForSelection(FPSoftwarePicker &picker);
+    virtual bool useProjectSelect();
+    virtual void projectSelect(const FPSelectionRegion &region, const Matrix4x4 &matrix, OpenGLSelectionMode selectionMode);
 };
 
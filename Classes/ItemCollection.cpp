@@ -36,10 +36,18 @@ RemovedItem::RemovedItem(ItemCollection &collection, unsigned int index)
 {
     _index = index;
     _item = collection.itemAtIndex(_index)->duplicate();
+    _memory = &collection.undoMemory();
+    _memory->retain();
+    _memoryIndex = _memory->addRemovedItem(this);
 }
 
 RemovedItem::~RemovedItem()
 {
+    RemovedItem *moved = _memory->removeRemovedItem(_memoryIndex);
+    if (moved)
+        moved->_memoryIndex = _memoryIndex;
+    
+    _memory->release();
     delete _item;
 }
 
@@ -53,36 +61,15 @@ void RemovedItem::insert(ItemCollection &collection)
     collection.insertItemAtIndex(_index, _item->duplicate());
 }
 
-MeshState::MeshState(ItemCollection &collection, unsigned int index)
-{
-    _index = index;
-    Mesh2 *mesh = collection.itemAtIndex(_index)->mesh;
-    mesh->toIndexRepresentation(_vertices, _texCoords, _triangles);
-    _selectionMode = mesh->selectionMode();
-    mesh->getSelection(_selection);
-}
-
-MeshState::~MeshState()
-{
-}
-
-void MeshState::apply(ItemCollection &collection)
-{
-    Item *item = collection.itemAtIndex(_index);
-    item->selected = true;
-    Mesh2 *mesh = item->mesh;
-    mesh->fromIndexRepresentation(_vertices, _texCoords, _triangles);
-    mesh->setSelectionMode(_selectionMode);
-    mesh->setSelection(_selection);
-}
-
-unsigned int MeshState::index()
+void RemovedItem::addMemoryFootprint(FPMemoryFootprint &footprint, vector<const Mesh2 *> &countedMeshes) const
 {
-    return _index;
+    footprint.add(FPMemoryCategory::Objects, sizeof(RemovedItem));
+    _item->addMemoryFootprint(footprint, countedMeshes);
 }
 
 ItemCollection::ItemCollection()
 {
+    _undoMemory = new UndoMemory();
 }
 
 ItemCollection::~ItemCollection()
@@ -91,10 +78,12 @@ ItemCollection::~ItemCollection()
         delete items[i];
     
     items.clear();
+    _undoMemory->release();
 }
 
 ItemCollection::ItemCollection(MemoryReadStream *stream, TextureCollection &textures)
 {
+    _undoMemory = new UndoMemory();
     unsigned int itemsCount = stream->read<unsigned int>();
     for (unsigned int i = 0; i < itemsCount; i++)
     {
@@ -141,30 +130,41 @@ void ItemCollection::setCurrentManipulations(IUndoState *undoState)
 	}
 }
 
-IUndoState *ItemCollection::currentMeshState()
+IUndoState *ItemCollection::beginMeshDelta(bool positionsOnly)
 {
     for (unsigned int i = 0; i < items.size(); i++)
 	{
 		Item *item = items.at(i);
 		if (item->selected)
 		{
-			MeshState *meshState = new MeshState(*this, i);
-			return new UndoState<MeshState>(meshState);
+			MeshDelta *meshDelta = new MeshDelta(item->sharedMesh(), i, positionsOnly, _undoMemory);
+			return new UndoState<MeshDelta>(meshDelta);
 		}
 	}
 	return NULL;
 }
 
-void ItemCollection::setCurrentMeshState(IUndoState *undoState)
+void ItemCollection::finishMeshDelta(IUndoState *undoState)
+{
+    if (undoState == NULL)
+        return;
+    
+    MeshDelta *meshDelta = dynamic_cast<UndoState<MeshDelta> *>(undoState)->state();
+    meshDelta->finish(itemAtIndex(meshDelta->index())->sharedMesh());
+}
+
+void ItemCollection::swapMeshDelta(IUndoState *undoState)
 {
     if (undoState == NULL)
         return;
     
-    MeshState *meshState = dynamic_cast<UndoState<MeshState> *>(undoState)->state();
+    MeshDelta *meshDelta = dynamic_cast<UndoState<MeshDelta> *>(undoState)->state();
     
     deselectAll();
 	
-    meshState->apply(*this);
+    Item *item = itemAtIndex(meshDelta->index());
+    item->selected = true;
+    meshDelta->swap(item->mesh());
 }
 
 IUndoState *ItemCollection::currentSelection()
@@ -225,31 +225,25 @@ void ItemCollection::setCurrentItems(IUndoState *undoState)
 
 IUndoState *ItemCollection::allItems()
 {
-    vector<Item *> *duplicates = new vector<Item *>();
+    vector<RemovedItem *> *removedItems = new vector<RemovedItem *>();
 	
 	for (unsigned int i = 0; i < items.size(); i++)
-	{
-		Item *duplicate = items.at(i)->duplicate();
-        duplicates->push_back(duplicate);
-	}
+        removedItems->push_back(new RemovedItem(*this, i));
 	
-	return new UndoState<vector<Item *>>(duplicates);
+	return new UndoState<vector<RemovedItem *>>(removedItems);
 }
 
 void ItemCollection::setAllItems(IUndoState *undoState)
 {
-    vector<Item *> *duplicates = dynamic_cast<UndoState<vector<Item *>> *>(undoState)->state();
+    vector<RemovedItem *> *removedItems = dynamic_cast<UndoState<vector<RemovedItem *>> *>(undoState)->state();
     
     for (unsigned int i = 0; i < items.size(); i++)
         delete items[i];
     
     items.clear();
     
-    for (unsigned int i = 0; i < duplicates->size(); i++)
-    {
-        Item *duplicate = duplicates->at(i)->duplicate();
-        items.push_back(duplicate);
-    }
+    for (unsigned int i = 0; i < removedItems->size(); i++)
+        removedItems->at(i)->insert(*this);
 }
 
 Item *ItemCollection::itemAtIndex(unsigned int index)
@@ -344,7 +338,7 @@ void ItemCollection::mergeSelectedItems()
 			itemMatrix.TranslateRotateScale(item->position, item->rotation, scale);
 			
 			Matrix4x4 finalMatrix = firstMatrix * itemMatrix;
-			Mesh2 *itemMesh = item->mesh;
+			Mesh2 *itemMesh = item->mesh();
 			
 			itemMesh->transformAll(finalMatrix);
 			
@@ -387,19 +381,52 @@ void ItemCollection::getVertexAndTriangleCount(unsigned int &vertexCount, unsign
 	triangleCount = 0;
 	for (unsigned int i = 0; i < items.size(); i++)
     {
-        Mesh2 *mesh = items[i]->mesh;
+        Mesh2 *mesh = items[i]->sharedMesh();
 		vertexCount += mesh->vertexCount();
 		triangleCount += mesh->triangleCount();
 	}
 }
 
+void ItemCollection::addMemoryFootprint(FPMemoryFootprint &footprint, vector<const Mesh2 *> &countedMeshes) const
+{
+    footprint.add(FPMemoryCategory::Objects, sizeof(ItemCollection) + items.capacity() * sizeof(Item *));
+    
+    for (unsigned int i = 0; i < items.size(); i++)
+        items[i]->addMemoryFootprint(footprint, countedMeshes);
+}
+
+FPMemoryFootprint ItemCollection::memoryFootprint() const
+{
+    FPMemoryFootprint footprint;
+    vector<const Mesh2 *> countedMeshes;
+    addMemoryFootprint(footprint, countedMeshes);
+    return footprint;
+}
+
+FPMemoryFootprint ItemCollection::undoFootprint() const
+{
+    vector<const Mesh2 *> countedMeshes;
+    for (unsigned int i = 0; i < items.size(); i++)
+        countedMeshes.push_back(items[i]->sharedMesh());
+    
+    const vector<RemovedItem *> &removed = _undoMemory->removedItems();
+    FPMemoryFootprint removedItems;
+    removedItems.add(FPMemoryCategory::Objects, removed.capacity() * sizeof(RemovedItem *));
+    for (unsigned int i = 0; i < removed.size(); i++)
+        removed[i]->addMemoryFootprint(removedItems, countedMeshes);
+    
+    FPMemoryFootprint footprint;
+    footprint.add(FPMemoryCategory::Undo, _undoMemory->meshDeltas() + removedItems.total());
+    return footprint;
+}
+
 Mesh2 *ItemCollection::currentMesh()
 {
     for (unsigned int i = 0; i < items.size(); i++)
     {
         Item *item = items[i];
 		if (item->selected)
-			return item->mesh;
+			return item->mesh();
 	}
     return NULL;
 
@@ -586,3 +613,15 @@ void ItemCollection::drawAtIndex(unsigned int index, bool forSelection)
 {
     items.at(index)->drawForSelection(forSelection);
 }
+
+void ItemCollection::pickAtIndex(unsigned int index, unsigned int id, FPSoftwarePicker &picker)
+{
+    Item *item = items.at(index);
+    if (!item->visible)
+        return;
+    
+    Matrix4x4 parentTransform = picker.modelTransform();
+    picker.setModelTransform(parentTransform * item->transform());
+    item->sharedMesh()->pickFill(picker, id);
+    picker.setModelTransform(parentTransform);
+}
@@ -12,6 +12,7 @@
 #include "OpenGLSelecting.h"
 #include "OpenGLManipulating.h"
 #include "OpenGLManipulatingController.h"
+#include "MeshDelta.h"
 
 class ItemCollection;
 
@@ -29,34 +30,23 @@ public:
     void apply(ItemCollection &collection);
 };
 
+// Copy of an item kept by an undo step.
 class RemovedItem
 {
 private:
     unsigned int _index;
     Item *_item;
+    UndoMemory *_memory;
+    unsigned int _memoryIndex;
 public:
     RemovedItem(ItemCollection &collection, unsigned int index);
     ~RemovedItem();
     
     void selectItemForRemove(ItemCollection &collection);
     void insert(ItemCollection &collection);
-};
-
-class MeshState
-{
-private:
-    unsigned int _index;
-	vector<Vector3D> _vertices;
-    vector<Vector3D> _texCoords;
-	vector<TriQuad> _triangles;
-	vector<bool> _selection;
-	MeshSelectionMode _selectionMode;
-public:
-    MeshState(ItemCollection &collection, unsigned int index);
-    ~MeshState();
     
-    unsigned int index();
-    void apply(ItemCollection &collection);
+    // the mesh is added only when not in countedMeshes
+    void addMemoryFootprint(FPMemoryFootprint &footprint, vector<const Mesh2 *> &countedMeshes) const;
 };
 
 class IUndoState
@@ -65,6 +55,21 @@ public:
     virtual ~IUndoState() { }
 };
 
+template <class T>
+inline void deleteUndoState(T *state)
+{
+    delete state;
+}
+
+// undo states own the items of their arrays
+template <class T>
+inline void deleteUndoState(vector<T *> *state)
+{
+    for (unsigned int i = 0; i < state->size(); i++)
+        delete state->at(i);
+    delete state;
+}
+
 template <class T>
 class UndoState : public IUndoState
 {
@@ -72,13 +77,14 @@ class UndoState : public IUndoState
 public:
     UndoState(T *state) : _state(state) { }
     T *state() { return _state; }
-    virtual ~UndoState() { delete _state; }
+    virtual ~UndoState() { deleteUndoState(_state); }
 };
 
 class ItemCollection : public IOpenGLManipulatingModelItem
 {
 private:
     vector<Item *> items;
+    UndoMemory *_undoMemory;
 public:
     ItemCollection();
     virtual ~ItemCollection();
@@ -88,8 +94,9 @@ public:
     
     IUndoState *currentManipulations();
     void setCurrentManipulations(IUndoState *undoState);
-    IUndoState *currentMeshState();
-    void setCurrentMeshState(IUndoState *undoState);
+    IUndoState *beginMeshDelta(bool positionsOnly);
+    void finishMeshDelta(IUndoState *undoState);
+    void swapMeshDelta(IUndoState *undoState);
     IUndoState *currentSelection();
     void setCurrentSelection(IUndoState *undoState);
     IUndoState *currentItems();
@@ -108,6 +115,15 @@ public:
     void setSelectionFromRemovedItems(IUndoState *undoState);
     void deselectAll();
     void getVertexAndTriangleCount(unsigned int &vertexCount, unsigned int &triangleCount);
+    
+    // Meshes shared by several items are counted once.
+    void addMemoryFootprint(FPMemoryFootprint &footprint, vector<const Mesh2 *> &countedMeshes) const;
+    FPMemoryFootprint memoryFootprint() const;
+    
+    // Memory held only by undo steps of this collection, that is mesh
+    // deltas and meshes of removed items not shared with its items.
+    FPMemoryFootprint undoFootprint() const;
+    UndoMemory &undoMemory() { return *_undoMemory; }
     Mesh2 *currentMesh();
     Item *firstSelectedItem();
     
@@ -142,4 +158,5 @@ public:
     virtual void rotateByOffset(unsigned int index, Quaternion offset);
     virtual void scaleByOffset(unsigned int index, Vector3D offset);
     virtual void drawAtIndex(unsigned int index, bool forSelection);
+    virtual void pickAtIndex(unsigned int index, unsigned int id, FPSoftwarePicker &picker);
 };
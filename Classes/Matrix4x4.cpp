@@ -18,11 +18,6 @@ Matrix4x4::Matrix4x4(const float * m)
 	memcpy(this->m, m, 16 * sizeof(float));
 }
 
-Matrix4x4::Matrix4x4(const Matrix4x4 & m)
-{
-	memcpy(this->m, m.m, 16 * sizeof(float));
-}
-
 Matrix4x4::Matrix4x4(const Vector3D & translate, const Quaternion & rotate, const Vector3D & scale)
 {
 	TranslateRotateScale(translate, rotate, scale);
@@ -386,6 +381,29 @@ void Matrix4x4::Perspective(float fovy, float aspect, float n, float f)
     Frustum(xmin, xmax, ymin, ymax, n, f);
 }
 
+void Matrix4x4::Ortho(float l, float r, float b, float t, float n, float f)
+{
+    m[0] = 2.0f / (r - l);
+    m[1] = 0.0;
+	m[2] = 0.0;
+    m[3] = 0.0;
+    
+    m[4] = 0.0;
+    m[5] = 2.0f / (t - b);
+    m[6] = 0.0;
+    m[7] = 0.0;
+    
+	m[8] = 0.0;
+    m[9] = 0.0;
+    m[10] = -2.0f / (f - n);
+    m[11] = 0.0;
+    
+	m[12] = -(r + l) / (r - l);
+    m[13] = -(t + b) / (t - b);
+    m[14] = -(f + n) / (f - n);
+    m[15] = 1.0f;
+}
+
 float Det2x2(float a1, float a2, float b1, float b2)
 {
 	return a1 * b2 - b1 * a2;
@@ -395,3 +413,22 @@ float Det3x3(float a1, float a2, float a3, float b1, float b2, float b3, float c
 {
 	return a1 * Det2x2(b2, b3, c2, c3) - b1 * Det2x2(a2, a3, c2, c3) + c1 * Det2x2(a2, a3, b2, b3);
 }
+
+Matrix4x4 Matrix4x4::ProjectiveMultiply(const Matrix4x4 & m) const
+{
+    Matrix4x4 result;
+    const float *a = this->m, *b = m.m;
+    
+    for (int column = 0; column < 4; column++)
+    {
+        for (int row = 0; row < 4; row++)
+        {
+            result.m[column * 4 + row] = a[row] * b[column * 4] +
+                                         a[4 + row] * b[column * 4 + 1] +
+                                         a[8 + row] * b[column * 4 + 2] +
+                                         a[12 + row] * b[column * 4 + 3];
+        }
+    }
+    
+    return result;
+}
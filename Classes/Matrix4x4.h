@@ -18,7 +18,6 @@ public:
 
 	Matrix4x4();
     Matrix4x4(const float * m);
-    Matrix4x4(const Matrix4x4 & m);
 	Matrix4x4(const Vector3D & translate, const Quaternion & rotate, const Vector3D & scale);
 
     float & operator() (int row, int col);
@@ -61,9 +60,12 @@ public:
 	Matrix4x4 Transpose() const;
     Vector3D Transform(const Vector3D &v) const;
     Vector4D Transform(const Vector4D & v) const;
+    // full product, operator * drops the last row of projection matrices
+    Matrix4x4 ProjectiveMultiply(const Matrix4x4 & m) const;
     
     void Frustum(float l, float r, float b, float t, float n, float f);
     void Perspective(float fovy, float aspect, float n, float f);
+    void Ortho(float l, float r, float b, float t, float n, float f);
 };
 
 float Det2x2(float a1, float a2, float b1, float b2);
@@ -7,10 +7,14 @@
 //
 
 #include "MemoryStream.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
 
-MemoryReadStream::MemoryReadStream(NSData *data)
+MemoryReadStream::MemoryReadStream(const void *bytes, size_t length)
 {
-    _data = data;
+    _bytes = (const unsigned char *)bytes;
+    _length = length;
     _lastReadPosition = 0;
     _version = 0;
 }
@@ -21,22 +25,78 @@ MemoryReadStream::~MemoryReadStream()
 
 void MemoryReadStream::readBytes(void *buffer, unsigned int length)
 {
-    [_data getBytes:buffer range:NSMakeRange(_lastReadPosition, length)];
+    memcpy(buffer, readSpan(length), length);
+}
+
+const void *MemoryReadStream::readSpan(unsigned int length)
+{
+    if (length > _length - _lastReadPosition)
+        throw MeshMaker::IndexOutOfRangeException();
+    
+    const void *span = _bytes + _lastReadPosition;
     _lastReadPosition += length;
+    return span;
 }
 
-MemoryWriteStream::MemoryWriteStream(NSMutableData *data)
+void MemoryReadStream::skipPadding(unsigned int alignment)
 {
-    _data = data;
+    size_t position = (_lastReadPosition + alignment - 1) / alignment * alignment;
+    
+    // past the end of truncated data the next readSpan throws
+    _lastReadPosition = position < _length ? position : _length;
+}
+
+MemoryWriteStream::MemoryWriteStream()
+{
+    _bytes = NULL;
+    _length = 0;
+    _capacity = 0;
     _version = 0;
 }
 
 MemoryWriteStream::~MemoryWriteStream()
 {
-    
+    free(_bytes);
+}
+
+unsigned char *MemoryWriteStream::detachBytes()
+{
+    unsigned char *bytes = _bytes;
+    _bytes = NULL;
+    _length = 0;
+    _capacity = 0;
+    return bytes;
 }
 
 void MemoryWriteStream::writeBytes(const void *buffer, unsigned int length)
 {
-    [_data appendBytes:buffer length:length];
+    if (_length + length > _capacity)
+    {
+        size_t capacity = _capacity < 4096 ? 4096 : _capacity;
+        while (capacity < _length + length)
+            capacity *= 2;
+        
+        unsigned char *bytes = (unsigned char *)realloc(_bytes, capacity);
+        if (bytes == NULL)
+            throw std::bad_alloc();
+        
+        _bytes = bytes;
+        _capacity = capacity;
+    }
+    
+    memcpy(_bytes + _length, buffer, length);
+    _length += length;
+}
+
+void MemoryWriteStream::writePadding(unsigned int alignment)
+{
+    const char zeros[16] = { 0 };
+    size_t padding = (_length + alignment - 1) / alignment * alignment - _length;
+    
+    while (padding > 0)
+    {
+        size_t count = padding < sizeof(zeros) ? padding : sizeof(zeros);
+        writeBytes(zeros, (unsigned int)count);
+        padding -= count;
+    }
 }
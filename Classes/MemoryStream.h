@@ -8,21 +8,27 @@
 
 #pragma once
 
-#include <Foundation/Foundation.h>
+#include "Exceptions.h"
+#include <cstddef>
 
+// Reads from bytes owned by the caller, they must outlive the stream.
 class MemoryReadStream
 {
 private:
-    __unsafe_unretained NSData *_data;
-    NSUInteger _lastReadPosition;
+    const unsigned char *_bytes;
+    size_t _length;
+    size_t _lastReadPosition;
     unsigned int _version;
 public:
-    MemoryReadStream(NSData *data);
+    MemoryReadStream(const void *bytes, size_t length);
     ~MemoryReadStream();
 
     unsigned int version() { return _version; }
     void setVersion(unsigned int value) { _version = value; }
     void readBytes(void *buffer, unsigned int length);
+    // Points into the data without copying, stays valid while the data lives.
+    const void *readSpan(unsigned int length);
+    void skipPadding(unsigned int alignment);
 
     template <class T>
     T read()
@@ -33,18 +39,31 @@ public:
     }
 };
 
+// Appends to a growing malloc buffer, detachBytes hands it over to the caller.
 class MemoryWriteStream
 {
 private:
-    __unsafe_unretained NSMutableData *_data;
+    unsigned char *_bytes;
+    size_t _length;
+    size_t _capacity;
     unsigned int _version;
+    
+    MemoryWriteStream(const MemoryWriteStream &other);
+    MemoryWriteStream &operator=(const MemoryWriteStream &other);
 public:
-    MemoryWriteStream(NSMutableData *data);
+    MemoryWriteStream();
     ~MemoryWriteStream();
+    
+    const unsigned char *bytes() const { return _bytes; }
+    size_t length() const { return _length; }
+    // the caller frees the returned bytes, the stream is empty afterwards
+    unsigned char *detachBytes();
 
     unsigned int version() { return _version; }
     void setVersion(unsigned int value) { _version = value; }
     void writeBytes(const void *buffer, unsigned int length);
+    // zero bytes up to a multiple of alignment from the start of the data
+    void writePadding(unsigned int alignment);
     
     template <class T>
     void write(const T &value)
@@ -7,12 +7,19 @@
 //
 
 #include "Mesh2.h"
-#include "TextureCollection.h"
+#include "FPBulkTransform.h"
+#include "FPMeshCodec.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
 
 bool Mesh2::_useSoftSelection = false;
 bool Mesh2::_selectThrough = false;
 float Mesh2::_minimumSelectionWeight = 0.1f;
 vector<float> *Mesh2::_selectionWeights = NULL;
+SoftSelectionFalloff Mesh2::_softSelectionFalloff = SoftSelectionFalloff::Steps;
+float Mesh2::_softSelectionRadius = 1.0f;
+float Mesh2::_compressionTolerance = -1.0f;
 
 vector<float> &Mesh2::selectionWeights()
 {
@@ -32,13 +39,26 @@ Vector4D generateRandomColor();
 Vector4D generateRandomColor()
 {
     float hue = (random() % 10) / 10.0f;
-    
-    NSColor *color = [NSColor colorWithCalibratedHue:hue
-                                          saturation:0.5f
-                                          brightness:0.6f
-                                               alpha:1.0f];
-    
-    return Vector4D(color.redComponent, color.greenComponent, color.blueComponent, color.alphaComponent);
+    float saturation = 0.5f;
+    float brightness = 0.6f;
+    
+    // same conversion as NSColor colorWithCalibratedHue
+    float sector = hue * 6.0f;
+    int i = (int)sector;
+    float f = sector - (float)i;
+    float p = brightness * (1.0f - saturation);
+    float q = brightness * (1.0f - saturation * f);
+    float t = brightness * (1.0f - saturation * (1.0f - f));
+    
+    switch (i % 6)
+    {
+        case 0: return Vector4D(brightness, t, p, 1.0f);
+        case 1: return Vector4D(q, brightness, p, 1.0f);
+        case 2: return Vector4D(p, brightness, t, 1.0f);
+        case 3: return Vector4D(p, q, brightness, 1.0f);
+        case 4: return Vector4D(t, p, brightness, 1.0f);
+        default: return Vector4D(brightness, p, q, 1.0f);
+    }
 }
 
 Triangle2 makeTriangle(VertexNode *vertices[], TexCoordNode *texCoords[],
@@ -77,63 +97,68 @@ Triangle2 makeQuad(VertexNode *vertices[], TexCoordNode *texCoords[],
     return Triangle2(triangleVertices, triangleTexCoords, true);
 }
 
-NSString *Mesh2::descriptionOfMeshType(MeshType meshType)
+const char *Mesh2::descriptionOfMeshType(MeshType meshType)
 {
     switch (meshType)
 	{
 		case MeshType::Cube:
-			return @"Cube";
+			return "Cube";
 		case MeshType::Cylinder:
-			return @"Cylinder";
+			return "Cylinder";
 		case MeshType::Sphere:
-			return @"Sphere";
+			return "Sphere";
         case MeshType::Plane:
-            return @"Plane";
+            return "Plane";
         case MeshType::Icosahedron:
-            return @"Icosahedron";
+            return "Icosahedron";
 		default:
-			return nil;
+			return NULL;
 	}
 }
 
-Mesh2::Mesh2()
+Mesh2::Mesh2() :
+    _vertices(&_allocator),
+    _triangles(&_allocator),
+    _texCoords(&_allocator),
+    _vertexEdges(&_allocator),
+    _texCoordEdges(&_allocator)
 {
     _selectionMode = MeshSelectionMode::Vertices;
     
-    _vboID = 0U;
-    _vboGenerated = false;
-    
     _isUnwrapped = false;
+    _useEdgeMaps = false;
+    _referenceCount = 1U;
+    _recording = NULL;
     
     _texture = NULL;
+    _renderBuffers = NULL;
     
     setColor(generateRandomColor());
 }
 
-Mesh2::Mesh2(MemoryReadStream *stream, TextureCollection &textures)
+Mesh2::Mesh2(MemoryReadStream *stream) :
+    _vertices(&_allocator),
+    _triangles(&_allocator),
+    _texCoords(&_allocator),
+    _vertexEdges(&_allocator),
+    _texCoordEdges(&_allocator)
 {
+    FPProfileZone zone("Mesh2::Mesh2(stream)");
+
 	_selectionMode = MeshSelectionMode::Vertices;
     
-    _vboID = 0U;
-    _vboGenerated = false;
-    
     _isUnwrapped = false;
+    _useEdgeMaps = false;
+    _referenceCount = 1U;
+    _recording = NULL;
     
     _texture = NULL;
+    _renderBuffers = NULL;
     
     setColor(generateRandomColor());
     
     const ModelVersion version = (ModelVersion)stream->version();
     
-    if (version >= ModelVersion::TextureNames)
-    {
-        unsigned int textureIndex = stream->read<unsigned int>();
-        if (textureIndex < textures.count())
-            _texture = textures.textureAtIndex(textureIndex);
-        else
-            _texture = NULL;
-    }
-    
     Vector4D color;
 
     if (version >= ModelVersion::CrossPlatform)
@@ -152,6 +177,13 @@ Mesh2::Mesh2(MemoryReadStream *stream, TextureCollection &textures)
         color = generateRandomColor();
     }
     
+    if (version >= ModelVersion::BulkArrays)
+    {
+        decodeIndexArrays(stream);
+        this->setColor(color);
+        return;
+    }
+    
     unsigned int verticesSize = stream->read<unsigned int>();
     unsigned int texCoordsSize = stream->read<unsigned int>();
     unsigned int trianglesSize = stream->read<unsigned int>();
@@ -236,17 +268,20 @@ Mesh2::Mesh2(MemoryReadStream *stream, TextureCollection &textures)
     this->setColor(color);
 }
 
-void Mesh2::encode(MemoryWriteStream *stream, TextureCollection &textures)
+void Mesh2::encode(MemoryWriteStream *stream)
 {
-    if (_texture == NULL)
-        stream->write<unsigned int>(UINT_MAX);
-    else
-        stream->write<unsigned int>(textures.indexOfTexture(_texture));
-    
+    FPProfileZone zone("Mesh2::encode");
+
     stream->write<float>(_color.x);
     stream->write<float>(_color.y);
     stream->write<float>(_color.z);
     stream->write<float>(_color.w);
+    
+    if (stream->version() >= (unsigned int)ModelVersion::BulkArrays)
+    {
+        encodeIndexArrays(stream);
+        return;
+    }
         
     vector<Vector3D> vertices;
     vector<Vector3D> texCoords;
@@ -291,6 +326,166 @@ void Mesh2::encode(MemoryWriteStream *stream, TextureCollection &textures)
     }
 }
 
+// ModelVersion::BulkArrays stores a table of sections followed by their
+// contents, each aligned so that the reader can use them in place.
+
+enum MeshSection : unsigned int
+{
+    MeshSectionPositions = 1U,
+    MeshSectionTexCoords = 2U,
+    MeshSectionFaceSizes = 3U,
+    MeshSectionVertexIndices = 4U,
+    MeshSectionTexCoordIndices = 5U,
+    MeshSectionCompressed = 6U,
+};
+
+const unsigned int kMeshSectionAlignment = 16U;
+
+struct MeshSectionEntry
+{
+    unsigned int section;
+    unsigned int count;
+    unsigned int length;
+    const void *bytes;
+};
+
+void Mesh2::encodeIndexArrays(MemoryWriteStream *stream)
+{
+    vector<float> positions;
+    vector<float> texCoords;
+    vector<unsigned char> faceSizes;
+    vector<unsigned int> vertexIndices;
+    vector<unsigned int> texCoordIndices;
+    
+    this->toIndexArrays(positions, texCoords, faceSizes, vertexIndices, texCoordIndices);
+    
+    if (_compressionTolerance >= 0.0f)
+    {
+        vector<unsigned char> compressed;
+        FPMeshCodec::encode(positions, texCoords, faceSizes, vertexIndices, texCoordIndices, _compressionTolerance, compressed);
+        
+        stream->write<unsigned int>(1U);
+        stream->write<unsigned int>(MeshSectionCompressed);
+        stream->write<unsigned int>((unsigned int)faceSizes.size());
+        stream->write<unsigned int>((unsigned int)compressed.size());
+        stream->writePadding(kMeshSectionAlignment);
+        stream->writeBytes(compressed.data(), (unsigned int)compressed.size());
+        return;
+    }
+    
+    MeshSectionEntry entries[] =
+    {
+        { MeshSectionPositions, (unsigned int)positions.size() / 3, (unsigned int)(positions.size() * sizeof(float)), positions.data() },
+        { MeshSectionTexCoords, (unsigned int)texCoords.size() / 3, (unsigned int)(texCoords.size() * sizeof(float)), texCoords.data() },
+        { MeshSectionFaceSizes, (unsigned int)faceSizes.size(), (unsigned int)faceSizes.size(), faceSizes.data() },
+        { MeshSectionVertexIndices, (unsigned int)vertexIndices.size(), (unsigned int)(vertexIndices.size() * sizeof(unsigned int)), vertexIndices.data() },
+        { MeshSectionTexCoordIndices, (unsigned int)texCoordIndices.size(), (unsigned int)(texCoordIndices.size() * sizeof(unsigned int)), texCoordIndices.data() },
+    };
+    
+    unsigned int sectionCount = sizeof(entries) / sizeof(entries[0]);
+    stream->write<unsigned int>(sectionCount);
+    
+    for (unsigned int i = 0; i < sectionCount; i++)
+    {
+        stream->write<unsigned int>(entries[i].section);
+        stream->write<unsigned int>(entries[i].count);
+        stream->write<unsigned int>(entries[i].length);
+    }
+    
+    for (unsigned int i = 0; i < sectionCount; i++)
+    {
+        stream->writePadding(kMeshSectionAlignment);
+        stream->writeBytes(entries[i].bytes, entries[i].length);
+    }
+}
+
+void Mesh2::decodeIndexArrays(MemoryReadStream *stream)
+{
+    unsigned int sectionCount = stream->read<unsigned int>();
+    
+    vector<MeshSectionEntry> entries(sectionCount);
+    
+    for (unsigned int i = 0; i < sectionCount; i++)
+    {
+        entries[i].section = stream->read<unsigned int>();
+        entries[i].count = stream->read<unsigned int>();
+        entries[i].length = stream->read<unsigned int>();
+    }
+    
+    const float *positions = NULL;
+    const float *texCoords = NULL;
+    const unsigned char *faceSizes = NULL;
+    const unsigned int *vertexIndices = NULL;
+    const unsigned int *texCoordIndices = NULL;
+    unsigned int vertexCount = 0, texCoordCount = 0, faceCount = 0, indexCount = 0, texCoordIndexCount = 0;
+    
+    vector<float> decodedPositions;
+    vector<float> decodedTexCoords;
+    vector<unsigned char> decodedFaceSizes;
+    vector<unsigned int> decodedVertexIndices;
+    vector<unsigned int> decodedTexCoordIndices;
+    
+    // unknown sections from newer versions are skipped
+    for (unsigned int i = 0; i < sectionCount; i++)
+    {
+        stream->skipPadding(kMeshSectionAlignment);
+        const MeshSectionEntry &entry = entries[i];
+        const void *bytes = stream->readSpan(entry.length);
+        
+        switch (entry.section)
+        {
+            case MeshSectionPositions:
+                positions = (const float *)bytes;
+                vertexCount = min(entry.count, entry.length / (unsigned int)(3 * sizeof(float)));
+                break;
+            case MeshSectionTexCoords:
+                texCoords = (const float *)bytes;
+                texCoordCount = min(entry.count, entry.length / (unsigned int)(3 * sizeof(float)));
+                break;
+            case MeshSectionFaceSizes:
+                faceSizes = (const unsigned char *)bytes;
+                faceCount = min(entry.count, entry.length);
+                break;
+            case MeshSectionVertexIndices:
+                vertexIndices = (const unsigned int *)bytes;
+                indexCount = min(entry.count, entry.length / (unsigned int)sizeof(unsigned int));
+                break;
+            case MeshSectionTexCoordIndices:
+                texCoordIndices = (const unsigned int *)bytes;
+                texCoordIndexCount = min(entry.count, entry.length / (unsigned int)sizeof(unsigned int));
+                break;
+            case MeshSectionCompressed:
+                if (!FPMeshCodec::decode((const unsigned char *)bytes, entry.length, decodedPositions, decodedTexCoords,
+                                         decodedFaceSizes, decodedVertexIndices, decodedTexCoordIndices))
+                {
+                    throw MeshMaker::IndexOutOfRangeException();
+                }
+                positions = decodedPositions.data();
+                vertexCount = (unsigned int)decodedPositions.size() / 3;
+                texCoords = decodedTexCoords.data();
+                texCoordCount = (unsigned int)decodedTexCoords.size() / 3;
+                faceSizes = decodedFaceSizes.data();
+                faceCount = (unsigned int)decodedFaceSizes.size();
+                vertexIndices = decodedVertexIndices.data();
+                indexCount = (unsigned int)decodedVertexIndices.size();
+                texCoordIndices = decodedTexCoordIndices.data();
+                texCoordIndexCount = (unsigned int)decodedTexCoordIndices.size();
+                break;
+            default:
+                break;
+        }
+    }
+    
+    unsigned int expectedIndexCount = 0;
+    for (unsigned int i = 0; i < faceCount; i++)
+        expectedIndexCount += faceSizes[i] == 4 ? 4 : 3;
+    
+    if (expectedIndexCount > indexCount || expectedIndexCount > texCoordIndexCount)
+        throw MeshMaker::IndexOutOfRangeException();
+    
+    this->fromIndexArrays(positions, vertexCount, texCoords, texCoordCount, faceSizes, faceCount, vertexIndices, texCoordIndices);
+}
+
 void Mesh2::setColor(Vector4D color)
 {
     _color = color;
@@ -302,7 +497,32 @@ void Mesh2::setColor(Vector4D color)
 
 Mesh2::~Mesh2()
 {
+    _recording = NULL;
     resetTriangleCache();
+    removeAllNodes();
+    delete _renderBuffers;
+}
+
+void Mesh2::removeAllNodes()
+{
+    // every node lives in _allocator, so instead of unlinking them one by one
+    // all slabs are released at once and the lists start over empty
+    
+    _cachedVertexSelection.clear();
+    _cachedTriangleSelection.clear();
+    _cachedTexCoordSelection.clear();
+    _cachedVertexEdgeSelection.clear();
+    _cachedTexCoordEdgeSelection.clear();
+    _vertexGrid.invalidate();
+    invalidateMovedSelection();
+    
+    _allocator.releaseAll();
+    
+    _vertices.abandonAll();
+    _triangles.abandonAll();
+    _texCoords.abandonAll();
+    _vertexEdges.abandonAll();
+    _texCoordEdges.abandonAll();
 }
 
 void Mesh2::resetAlgorithmData()
@@ -316,7 +536,11 @@ void Mesh2::resetAlgorithmData()
 
 void Mesh2::setSelectionMode(MeshSelectionMode value)
 {
+    FPProfileZone zone("Mesh2::setSelectionMode");
+    FPProfiler::addCount(FPProfileCounter::SelectionCachesRebuilt, 1);
+
     resetEdgeCache();
+    invalidateMovedSelection();
     
     _selectionMode = value;
     _cachedVertexSelection.clear();
@@ -400,6 +624,218 @@ void Mesh2::setSelectionMode(MeshSelectionMode value)
     }
 }
 
+template <class TNode>
+static void patchSelectionCache(vector<TNode *> &cache, vector<TNode *> &removed, TNode *firstAdded, TNode *end)
+{
+    if (!removed.empty())
+    {
+        sort(removed.begin(), removed.end());
+        
+        unsigned int count = 0;
+        for (unsigned int i = 0; i < cache.size(); i++)
+        {
+            if (!binary_search(removed.begin(), removed.end(), cache[i]))
+                cache[count++] = cache[i];
+        }
+        cache.resize(count);
+    }
+    
+    for (TNode *node = firstAdded; node != end; node = node->next())
+        cache.push_back(node);
+}
+
+void Mesh2::beginLocalEdit(LocalEdit &edit)
+{
+    if (_recording)
+    {
+        if (_recording->state == MeshRecording::State::Unchanged)
+            numberRecordedNodes();
+        _recording->inLocalEdit = true;
+    }
+    
+    edit.keepsUnusedVertices = false;
+    edit.vertexEnd = _vertices.end();
+    edit.texCoordEnd = _texCoords.end();
+    edit.triangleEnd = _triangles.end();
+    edit.vertexEdgeEnd = _vertexEdges.end();
+    edit.texCoordEdgeEnd = _texCoordEdges.end();
+}
+
+void Mesh2::touchTriangle(LocalEdit &edit, TriangleNode *node)
+{
+    recordFace(node);
+    
+    Triangle2 &triangle = node->data();
+    
+    for (unsigned int i = 0; i < triangle.count(); i++)
+    {
+        edit.touchedVertices.push_back(triangle.vertex(i));
+        edit.touchedTexCoords.push_back(triangle.texCoord(i));
+        
+        if (triangle.vertexEdge(i))
+            edit.touchedVertexEdges.push_back(triangle.vertexEdge(i));
+        if (triangle.texCoordEdge(i))
+            edit.touchedTexCoordEdges.push_back(triangle.texCoordEdge(i));
+    }
+}
+
+// Call before changing the vertices of the triangle, its edges are rebuilt in endLocalEdit.
+void Mesh2::detachTriangle(LocalEdit &edit, TriangleNode *node)
+{
+    touchTriangle(edit, node);
+    node->removeFromEdges();
+    edit.modifiedTriangles.push_back(node);
+}
+
+void Mesh2::removeTriangle(LocalEdit &edit, TriangleNode *&node)
+{
+    touchTriangle(edit, node);
+    recordRemovedFace(node);
+    edit.removedTriangles.push_back(node);
+    _triangles.remove(node);
+}
+
+// Rebuilds edges only around modified and added triangles, removes edges and
+// vertices they left unused and patches the selection caches in place.
+void Mesh2::endLocalEdit(LocalEdit &edit)
+{
+    for (unsigned int i = 0; i < edit.modifiedTriangles.size(); i++)
+        makeEdges(edit.modifiedTriangles[i]);
+    
+    for (TriangleNode *node = edit.triangleEnd, *end = _triangles.end(); node != end; node = node->next())
+        makeEdges(node);
+    
+    vector<VertexEdgeNode *> removedVertexEdges;
+    vector<TexCoordEdgeNode *> removedTexCoordEdges;
+    vector<VertexNode *> removedVertices;
+    vector<TexCoordNode *> removedTexCoords;
+    
+    removeDetachedEdges(edit.touchedVertexEdges, removedVertexEdges);
+    removeDetachedEdges(edit.touchedTexCoordEdges, removedTexCoordEdges);
+    if (!edit.keepsUnusedVertices)
+    {
+        removeUnusedVertices(edit.touchedVertices, removedVertices);
+        removeUnusedVertices(edit.touchedTexCoords, removedTexCoords);
+    }
+    
+    if (!removedVertices.empty())
+    {
+        _vertexGrid.invalidate();
+    }
+    else
+    {
+        for (VertexNode *node = edit.vertexEnd, *end = _vertices.end(); node != end; node = node->next())
+            _vertexGrid.insert(node);
+    }
+    
+    // the BVH holds triangle nodes, modified ones keep their nodes and only need new bounds
+    if (edit.triangleEnd != _triangles.end() || !edit.removedTriangles.empty())
+        _triangleBVH.invalidate();
+    else if (!edit.modifiedTriangles.empty())
+        _triangleBVH.setNeedsRefit();
+    
+    invalidateMovedSelection();
+    resetEdgeCache();
+    
+    switch (_selectionMode)
+    {
+        case MeshSelectionMode::Vertices:
+        {
+            patchSelectionCache(_cachedVertexSelection, removedVertices, edit.vertexEnd, _vertices.end());
+            patchSelectionCache(_cachedTexCoordSelection, removedTexCoords, edit.texCoordEnd, _texCoords.end());
+        } break;
+        case MeshSelectionMode::Triangles:
+        {
+            patchSelectionCache(_cachedTriangleSelection, edit.removedTriangles, edit.triangleEnd, _triangles.end());
+        } break;
+        case MeshSelectionMode::Edges:
+        {
+            if (_isUnwrapped)
+                patchSelectionCache(_cachedTexCoordEdgeSelection, removedTexCoordEdges, edit.texCoordEdgeEnd, _texCoordEdges.end());
+            else
+                patchSelectionCache(_cachedVertexEdgeSelection, removedVertexEdges, edit.vertexEdgeEnd, _vertexEdges.end());
+        } break;
+        default:
+            break;
+    }
+    
+    updateVertexSelection(edit.touchedVertices, edit.touchedTexCoords);
+    
+    if (_recording)
+        _recording->inLocalEdit = false;
+}
+
+// In triangle and edge selection modes a vertex is selected when any of its
+// triangles or edges is, this recomputes that for the given vertices.
+void Mesh2::updateVertexSelection(const vector<VertexNode *> &vertices, const vector<TexCoordNode *> &texCoords)
+{
+    invalidateMovedSelection();
+    
+    switch (_selectionMode)
+    {
+        case MeshSelectionMode::Triangles:
+        {
+            for (unsigned int i = 0; i < vertices.size(); i++)
+            {
+                VertexNode *vertexNode = vertices[i];
+                vertexNode->data().selected = false;
+                
+                for (VertexTriangleNode *node = vertexNode->_triangles.begin(), *end = vertexNode->_triangles.end(); node != end; node = node->next())
+                {
+                    if (node->data()->data().selected)
+                        vertexNode->data().selected = true;
+                }
+            }
+            
+            for (unsigned int i = 0; i < texCoords.size(); i++)
+            {
+                TexCoordNode *texCoordNode = texCoords[i];
+                texCoordNode->data().selected = false;
+                
+                for (VertexTriangleNode *node = texCoordNode->_triangles.begin(), *end = texCoordNode->_triangles.end(); node != end; node = node->next())
+                {
+                    if (node->data()->data().selected)
+                        texCoordNode->data().selected = true;
+                }
+            }
+        } break;
+        case MeshSelectionMode::Edges:
+        {
+            for (unsigned int i = 0; i < vertices.size(); i++)
+            {
+                VertexNode *vertexNode = vertices[i];
+                vertexNode->data().selected = false;
+                
+                if (_isUnwrapped)
+                    continue;
+                
+                for (Vertex2VEdgeNode *node = vertexNode->_edges.begin(), *end = vertexNode->_edges.end(); node != end; node = node->next())
+                {
+                    if (node->data()->data().selected)
+                        vertexNode->data().selected = true;
+                }
+            }
+            
+            for (unsigned int i = 0; i < texCoords.size(); i++)
+            {
+                TexCoordNode *texCoordNode = texCoords[i];
+                texCoordNode->data().selected = false;
+                
+                if (!_isUnwrapped)
+                    continue;
+                
+                for (TexCoordVEdgeNode *node = texCoordNode->_edges.begin(), *end = texCoordNode->_edges.end(); node != end; node = node->next())
+                {
+                    if (node->data()->data().selected)
+                        texCoordNode->data().selected = true;
+                }
+            }
+        } break;
+        default:
+            break;
+    }
+}
+
 unsigned int Mesh2::selectedCount() const
 {
     switch (_selectionMode)
@@ -440,6 +876,8 @@ bool Mesh2::isSelectedAtIndex(unsigned int index) const
 
 void Mesh2::setSelectedAtIndex(bool selected, unsigned int index)
 {
+    invalidateMovedSelection();
+    
     switch (_selectionMode)
     {
         case MeshSelectionMode::Vertices:
@@ -536,131 +974,307 @@ void Mesh2::getSelectionCenterRotationScale(Vector3D &center, Quaternion &rotati
 
 void Mesh2::transformAll(const Matrix4x4 &matrix)
 {
-    resetTriangleCache();
+    FPProfileZone zone("Mesh2::transformAll");
+
+    resetMovedTriangleCache();
+    
+    vector<Vector3D *> positions;
+    
+    if (_isUnwrapped)
+    {
+        positions.reserve(_texCoords.count());
+        for (TexCoordNode *node = _texCoords.begin(), *end = _texCoords.end(); node != end; node = node->next())
+            positions.push_back(&node->data().position);
+    }
+    else
+    {
+        positions.reserve(_vertices.count());
+        for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
+            positions.push_back(&node->data().position);
+    }
+    
+    FPBulkTransform::transform(matrix, positions.data(), (unsigned int)positions.size());
+    
+    setSelectionMode(_selectionMode);
+}
+
+void Mesh2::prepareMovedSelection()
+{
+    MovedSelection &moved = _movedSelection;
+    
+    if (moved.valid && moved.unwrapped == _isUnwrapped && moved.soft == _useSoftSelection &&
+        moved.minimumWeight == _minimumSelectionWeight)
+        return;
+    
+    moved.valid = true;
+    moved.unwrapped = _isUnwrapped;
+    moved.soft = _useSoftSelection;
+    moved.minimumWeight = _minimumSelectionWeight;
+    moved.positions.clear();
+    moved.weights.clear();
+    moved.affectedVertices.clear();
     
     if (_isUnwrapped)
     {
         for (TexCoordNode *node = _texCoords.begin(), *end = _texCoords.end(); node != end; node = node->next())
         {
-            Vector3D &v = node->data().position;
-            v = matrix.Transform(v);
+            if (node->data().selected)
+                moved.positions.push_back(&node->data().position);
+        }
+    }
+    else if (_useSoftSelection)
+    {
+        for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
+        {
+            if (node->selectionWeight > _minimumSelectionWeight)
+            {
+                moved.positions.push_back(&node->data().position);
+                moved.weights.push_back(node->selectionWeight);
+            }
         }
     }
     else
     {
         for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
         {
-            Vector3D &v = node->data().position;
-            v = matrix.Transform(v);
+            if (node->data().selected)
+            {
+                moved.positions.push_back(&node->data().position);
+                moved.affectedVertices.push_back(node);
+            }
         }
+        
+        moved.updatesLocally = addAffectedVertices(moved.affectedVertices);
+        
+        // neighbours shared by several moved vertices are listed once per vertex
+        vector<VertexNode *> &affected = moved.affectedVertices;
+        for (unsigned int i = 0; i < affected.size(); i++)
+            affected[i]->algorithmData.index = 0;
+        
+        unsigned int count = 0;
+        for (unsigned int i = 0; i < affected.size(); i++)
+        {
+            if (affected[i]->algorithmData.index == 0)
+            {
+                affected[i]->algorithmData.index = 1;
+                affected[count++] = affected[i];
+            }
+        }
+        affected.resize(count);
     }
-    
-    setSelectionMode(_selectionMode);
 }
 
 void Mesh2::transformSelected(const Matrix4x4 &matrix)
 {
+    FPProfileZone zone("Mesh2::transformSelected");
+
+    prepareMovedSelection();
+    
+    vector<Vector3D *> &positions = _movedSelection.positions;
+    
     if (_isUnwrapped)
     {
-        resetTriangleCache();
+        resetMovedTriangleCache();
+        FPBulkTransform::transform(matrix, positions.data(), (unsigned int)positions.size());
+    }
+    else if (_useSoftSelection)
+    {
+        resetMovedTriangleCache();
+        FPBulkTransform::transform(matrix, positions.data(), _movedSelection.weights.data(), (unsigned int)positions.size());
+    }
+    else
+    {
+        FPBulkTransform::transform(matrix, positions.data(), (unsigned int)positions.size());
         
-        for (TexCoordNode *node = _texCoords.begin(), *end = _texCoords.end(); node != end; node = node->next())
+        if (_movedSelection.updatesLocally)
+            updateAffectedTriangleAndEdgeCache(_movedSelection.affectedVertices);
+        else
+            resetMovedTriangleCache();
+    }
+}
+
+// Indices are sorted, so without a cache covering the whole list a single
+// walk finds all nodes.
+template <class TNode, class T>
+static void nodesAtIndices(FPList<TNode, T> &list, const vector<TNode *> &cache,
+                           const vector<unsigned int> &indices, vector<TNode *> &nodes)
+{
+    if (cache.size() == list.count())
+    {
+        for (unsigned int i = 0; i < indices.size(); i++)
+            nodes.push_back(cache.at(indices[i]));
+        return;
+    }
+    
+    unsigned int index = 0;
+    unsigned int i = 0;
+    
+    for (TNode *node = list.begin(), *end = list.end(); node != end && i < indices.size(); node = node->next(), index++)
+    {
+        if (index == indices[i])
+        {
+            nodes.push_back(node);
+            i++;
+        }
+    }
+}
+
+void Mesh2::getMovablePositions(vector<unsigned int> &indices, vector<Vector3D> &positions, bool &texCoords) const
+{
+    unsigned int index = 0;
+    texCoords = _isUnwrapped;
+    
+    if (_isUnwrapped)
+    {
+        for (TexCoordNode *node = _texCoords.begin(), *end = _texCoords.end(); node != end; node = node->next(), index++)
         {
             if (node->data().selected)
             {
-                Vector3D &v = node->data().position;
-                v = matrix.Transform(v);
+                indices.push_back(index);
+                positions.push_back(node->data().position);
             }
         }
     }
     else
+    {
+        for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next(), index++)
+        {
+            bool movable = _useSoftSelection ? node->selectionWeight > _minimumSelectionWeight : node->data().selected;
+            if (movable)
+            {
+                indices.push_back(index);
+                positions.push_back(node->data().position);
+            }
+        }
+    }
+}
+
+void Mesh2::getPositions(const vector<unsigned int> &indices, vector<Vector3D> &positions, bool texCoords)
+{
+    if (texCoords)
+    {
+        vector<TexCoordNode *> nodes;
+        nodesAtIndices(_texCoords, _cachedTexCoordSelection, indices, nodes);
+        for (unsigned int i = 0; i < nodes.size(); i++)
+            positions.push_back(nodes[i]->data().position);
+    }
+    else
+    {
+        vector<VertexNode *> nodes;
+        nodesAtIndices(_vertices, _cachedVertexSelection, indices, nodes);
+        for (unsigned int i = 0; i < nodes.size(); i++)
+            positions.push_back(nodes[i]->data().position);
+    }
+}
+
+void Mesh2::swapPositions(const vector<unsigned int> &indices, vector<Vector3D> &positions, bool texCoords)
+{
+    if (indices.empty())
+        return;
+    
+    if (texCoords)
+    {
+        vector<TexCoordNode *> nodes;
+        nodesAtIndices(_texCoords, _cachedTexCoordSelection, indices, nodes);
+        for (unsigned int i = 0; i < nodes.size(); i++)
+            swap(nodes[i]->data().position, positions[i]);
+        
+        resetMovedTriangleCache();
+    }
+    else
     {
         vector<VertexNode *> affectedVertices;
+        nodesAtIndices(_vertices, _cachedVertexSelection, indices, affectedVertices);
+        for (unsigned int i = 0; i < affectedVertices.size(); i++)
+            swap(affectedVertices[i]->data().position, positions[i]);
         
-        if (_useSoftSelection)
+        updateTriangleAndEdgeCache(affectedVertices);
+    }
+}
+
+void Mesh2::swapSelection(const vector<unsigned int> &indices, vector<bool> &selection)
+{
+    if (indices.empty())
+        return;
+    
+    vector<unsigned int> selected;
+    vector<unsigned int> deselected;
+    
+    for (unsigned int i = 0; i < indices.size(); i++)
+    {
+        bool value = selection[i];
+        selection[i] = isSelectedAtIndex(indices[i]);
+        
+        if (value)
+            selected.push_back(indices[i]);
+        else
+            deselected.push_back(indices[i]);
+    }
+    
+    for (unsigned int i = 0; i < deselected.size(); i++)
+        setSelectedAtIndex(false, deselected[i]);
+    
+    for (unsigned int i = 0; i < selected.size(); i++)
+        setSelectedAtIndex(true, selected[i]);
+    
+    // deselected triangles and edges cleared vertices they share with selected ones
+    vector<VertexNode *> touchedVertices;
+    vector<TexCoordNode *> touchedTexCoords;
+    
+    for (unsigned int i = 0; i < deselected.size(); i++)
+    {
+        if (_selectionMode == MeshSelectionMode::Triangles)
         {
-            resetTriangleCache();
-            
-            for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
+            const Triangle2 &triangle = _cachedTriangleSelection.at(deselected[i])->data();
+            for (unsigned int j = 0; j < triangle.count(); j++)
             {
-                if (node->selectionWeight > _minimumSelectionWeight)
-                {
-                    Vector3D &v = node->data().position;
-                    v = v.Lerp(matrix.Transform(v), node->selectionWeight);
-                }
+                touchedVertices.push_back(triangle.vertex(j));
+                touchedTexCoords.push_back(triangle.texCoord(j));
             }
         }
-        else
+        else if (_selectionMode == MeshSelectionMode::Edges)
         {
-            for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
+            for (unsigned int j = 0; j < 2; j++)
             {
-                if (node->data().selected)
-                {
-                    Vector3D &v = node->data().position;
-                    v = matrix.Transform(v);
-                    affectedVertices.push_back(node);
-                }
+                if (_isUnwrapped)
+                    touchedTexCoords.push_back(_cachedTexCoordEdgeSelection.at(deselected[i])->data().texCoord(j));
+                else
+                    touchedVertices.push_back(_cachedVertexEdgeSelection.at(deselected[i])->data().vertex(j));
             }
         }
-        
-        updateTriangleAndEdgeCache(affectedVertices);
     }
+    
+    updateVertexSelection(touchedVertices, touchedTexCoords);
+    
+    _cachedTriangleVertices.setValid(false);
+    resetEdgeCache();
+    computeSoftSelection();
 }
 
 void Mesh2::fastMergeSelectedVertices()
 {
-    Vector3D center = Vector3D();
-    
-    SimpleList<VertexNode *> selectedNodes;
+    vector<VertexNode *> selectedNodes;
     
     for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
     {
         if (node->data().selected)
-        {
-            selectedNodes.add(node);
-            center += node->data().position;
-        }
+            selectedNodes.push_back(node);
     }
     
-    if (selectedNodes.count() < 2)
-        return;
-    
-    center /= (float)selectedNodes.count();
-    
-    VertexNode *centerNode = _vertices.add(center);
-    
-    for (SimpleNode<VertexNode *> *node = selectedNodes.begin(), *end = selectedNodes.end(); node != end; node = node->next())
-    {
-        node->data()->replaceVertex(centerNode);        
-    }    
+    mergeVertices<Vertex2>(selectedNodes);
 }
 
 void Mesh2::fastMergeSelectedTexCoords()
 {
-    Vector3D center = Vector3D();
-    
-    SimpleList<TexCoordNode *> selectedNodes;
+    vector<TexCoordNode *> selectedNodes;
     
     for (TexCoordNode *node = _texCoords.begin(), *end = _texCoords.end(); node != end; node = node->next())
     {
         if (node->data().selected)
-        {
-            selectedNodes.add(node);
-            center += node->data().position;
-        }
+            selectedNodes.push_back(node);
     }
     
-    if (selectedNodes.count() < 2)
-        return;
-    
-    center /= (float)selectedNodes.count();
-    
-    TexCoordNode *centerNode = _texCoords.add(center);
-    
-    for (SimpleNode<TexCoordNode *> *node = selectedNodes.begin(), *end = selectedNodes.end(); node != end; node = node->next())
-    {
-        node->data()->replaceVertex(centerNode);
-    }
+    mergeVertices<TexCoord>(selectedNodes);
 }
 
 void Mesh2::removeDegeneratedTriangles()
@@ -712,6 +1326,24 @@ void Mesh2::mergeSelectedVertices()
     setSelectionMode(_selectionMode);
 }
 
+void Mesh2::weldSelectedVertices(float distance)
+{
+    resetTriangleCache();
+    
+    if (_isUnwrapped)
+        fastWeldSelectedVertices<TexCoord>(distance);
+    else
+        fastWeldSelectedVertices<Vertex2>(distance);
+    
+    removeDegeneratedTriangles();
+    removeNonUsedVertices();
+    removeNonUsedTexCoords();
+    
+    makeEdges();
+    
+    setSelectionMode(_selectionMode);
+}
+
 void Mesh2::removeSelectedVertices()
 {
     resetTriangleCache();
@@ -733,20 +1365,17 @@ void Mesh2::removeSelectedVertices()
 
 void Mesh2::removeSelectedTriangles()
 {
+    LocalEdit edit;
+    beginLocalEdit(edit);
     resetTriangleCache();
     
     for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
     {
         if (node->data().selected)
-            _triangles.remove(node);
+            removeTriangle(edit, node);
     }
     
-    removeNonUsedVertices();
-    removeNonUsedTexCoords();
-    
-    makeEdges();
-    
-    setSelectionMode(_selectionMode);
+    endLocalEdit(edit);
 }
 
 void Mesh2::removeSelectedEdges()
@@ -819,6 +1448,18 @@ void Mesh2::mergeSelected()
 	}
 }
 
+void Mesh2::weldSelected(float distance)
+{
+    switch (_selectionMode)
+    {
+        case MeshSelectionMode::Vertices:
+            weldSelectedVertices(distance);
+            break;
+        default:
+            break;
+    }
+}
+
 void Mesh2::triangulate()
 {
     resetTriangleCache();
@@ -887,154 +1528,6 @@ void Mesh2::triangulateSelectedQuads()
     setSelectionMode(_selectionMode);
 }
 
-void Mesh2::halfEdges()
-{
-    for (VertexEdgeNode *node = _vertexEdges.begin(), *end = _vertexEdges.end(); node != end; node = node->next())
-    {
-        Vector3D v1 = node->data().vertex(0)->data().position;
-        Vector3D v2 = node->data().vertex(1)->data().position;
-        
-        Vector3D edgeVertex;
-        
-        // boundary
-        if (node->data().triangle(0) == NULL || node->data().triangle(1) == NULL)
-        {
-            edgeVertex = (v1 + v2) / 2.0f;
-        }
-        else
-        {
-            Triangle2 &t0 = node->data().triangle(0)->data();
-            Triangle2 &t1 = node->data().triangle(1)->data();
-            
-            VertexNode *vn0 = t0.vertexNotInEdge(&node->data());
-            VertexNode *vn1 = t1.vertexNotInEdge(&node->data());
-            
-            // degenerated triangles
-            if (vn0 == NULL || vn1 == NULL)
-            {
-                edgeVertex = (v1 + v2) / 2.0f;
-            }
-            else
-            {
-                Vector3D v3 = vn0->data().position;
-                Vector3D v4 = vn1->data().position;
-                
-                edgeVertex = 3.0f * (v1 + v2) / 8.0f + 1.0f * (v3 + v4) / 8.0f;
-            }
-        }
-        
-        node->data().half = _vertices.add(edgeVertex);
-    }
-    
-    for (TexCoordEdgeNode *node = _texCoordEdges.begin(), *end = _texCoordEdges.end(); node != end; node = node->next())
-    {
-        Vector3D t1 = node->data().texCoord(0)->data().position;
-        Vector3D t2 = node->data().texCoord(1)->data().position;
-        
-        Vector3D edgeTexCoord = (t1 + t2) / 2.0f;
-        
-        node->data().half = _texCoords.add(edgeTexCoord);
-    }
-}
-
-void Mesh2::repositionVertices(unsigned int vertexCount)
-{
-    resetAlgorithmData();
-    
-    vector<Vector3D> tempVertices;
-    
-    unsigned int index = 0;
-    
-    for (VertexNode *node = _vertices.begin(); index < vertexCount; node = node->next())
-    {
-        node->algorithmData.index = index;
-        index++;
-        
-        float beta, n;
-        
-        n = (float)node->_edges.count();
-        beta = 3.0f + 2.0f * cosf(FLOAT_PI * 2.0f / n);
-        beta = 5.0f / 8.0f - (beta * beta) / 64.0f;
-        
-        Vector3D finalPosition = (1.0f - beta) * node->data().position;
-        
-        float bon = beta / n;
-        
-        for (Vertex2VEdgeNode *vertexEdgeNode = node->_edges.begin(), *endVertexEdgeNode = node->_edges.end(); vertexEdgeNode != endVertexEdgeNode; vertexEdgeNode = vertexEdgeNode->next())
-        {
-            VertexEdge &edge = vertexEdgeNode->data()->data();
-            VertexNode *oppositeVertex = edge.opposite(node);
-            
-            finalPosition += oppositeVertex->data().position * bon;
-        }
-        
-        tempVertices.push_back(finalPosition);
-    }
-    
-    index = 0;
-    
-    for (VertexNode *node = _vertices.begin(); index < vertexCount; node = node->next())
-    {
-        node->data().position = tempVertices[(unsigned int)node->algorithmData.index];
-        index++;
-    }
-}
-
-void Mesh2::makeSubdividedTriangles()
-{
-    VertexNode *vertices[6];
-    TexCoordNode *texCoords[6];
-    FPList<TriangleNode, Triangle2> subdivided;
-    
-    for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
-    {
-        for (unsigned int i = 0; i < 3; i++)
-        {
-            vertices[i] = node->data().vertex(i);
-            vertices[i + 3] = node->data().vertexEdge(i)->data().half;
-            
-            texCoords[i] = node->data().texCoord(i);
-            texCoords[i + 3] = node->data().texCoordEdge(i)->data().half;
-        }
-        
-        /*
-               2
-              /\
-             /  \
-          *5/____\*4
-           /\    /\
-          /  \  /  \
-         /____\/____\
-         0    *3     1
-         
-         */
-        
-        subdivided.add(makeTriangle(vertices, texCoords, 0, 3, 5));
-        subdivided.add(makeTriangle(vertices, texCoords, 3, 1, 4));
-        subdivided.add(makeTriangle(vertices, texCoords, 5, 4, 2));
-        subdivided.add(makeTriangle(vertices, texCoords, 3, 4, 5));
-    }
-    
-    _triangles.moveFrom(subdivided);
-}
-
-void Mesh2::loopSubdivision()
-{
-    triangulate();
-    
-    resetTriangleCache();
-    
-    unsigned int vertexCount = _vertices.count();
-    
-    halfEdges();
-    repositionVertices(vertexCount);
-    makeSubdividedTriangles();
-    
-    makeEdges();
-    
-    setSelectionMode(_selectionMode);
-}
-
 void Mesh2::detachSelectedVertices()
 {
     resetTriangleCache();
@@ -1156,7 +1649,7 @@ void Mesh2::splitSelectedTriangles()
     VertexNode *v[9];
     TexCoordNode *t[9];
     
-    FPList<TriangleNode, Triangle2> subdivided;
+    FPList<TriangleNode, Triangle2> subdivided(&_allocator);
     
     for (VertexEdgeNode *node = _vertexEdges.begin(), *end = _vertexEdges.end(); node != end; node = node->next())
     {
@@ -1442,17 +1935,39 @@ void Mesh2::flipSelectedTriangles()
 
 void Mesh2::turnSelectedEdges()
 {
+    LocalEdit edit;
+    beginLocalEdit(edit);
     resetTriangleCache();
     
     for (VertexEdgeNode *node = _vertexEdges.begin(), *end = _vertexEdges.end(); node != end; node = node->next())
     {
-        if (node->data().selected)
-            node->data().turn();
+        VertexEdge &edge = node->data();
+        TriangleNode *t0 = edge.triangle(0);
+        TriangleNode *t1 = edge.triangle(1);
+        
+        // edges of triangles turned earlier in this pass are detached and skipped
+        if (!edge.selected || t0 == NULL || t1 == NULL || t0->data().isQuad() || t1->data().isQuad())
+            continue;
+        
+        // a recording keeps the corners from before the turn
+        recordFace(t0);
+        recordFace(t1);
+        
+        // the turned edge keeps its node, it only moves to the other two vertices
+        for (unsigned int i = 0; i < 2; i++)
+        {
+            edit.touchedVertices.push_back(edge.vertex(i));
+            edge.vertex(i)->removeEdge(node);
+        }
+        
+        edge.turn();
+        node->addToVertices();
+        
+        detachTriangle(edit, t0);
+        detachTriangle(edit, t1);
     }
     
-    makeEdges();
-    
-    setSelectionMode(_selectionMode);
+    endLocalEdit(edit);
 }
 
 void Mesh2::flipSelected()
@@ -1597,8 +2112,95 @@ void Mesh2::extrudeSelectedTriangles()
     setSelectionMode(_selectionMode);
 }
 
+// Rebuilt edges follow the faces, the source can have them in another
+// order and direction after local edits. Edge selection and visibility
+// go by index.
+template <class T>
+static void orderEdgesLike(const FPList<VEdgeNode<T>, VEdge<T> > &source, FPList<VEdgeNode<T>, VEdge<T> > &edges,
+                           const FPList<VNode<T>, T> &vertices)
+{
+    vector<VNode<T> *> nodes;
+    nodes.reserve(vertices.count());
+    for (VNode<T> *node = vertices.begin(), *end = vertices.end(); node != end; node = node->next())
+        nodes.push_back(node);
+    
+    for (VEdgeNode<T> *node = source.begin(), *end = source.end(); node != end; node = node->next())
+    {
+        VEdge<T> &edge = node->data();
+        VNode<T> *first = nodes[edge.vertex(0)->algorithmData.index];
+        VNode<T> *second = nodes[edge.vertex(1)->algorithmData.index];
+        VEdgeNode<T> *copied = first->sharedEdge(second);
+        if (copied == NULL)
+            continue;
+        
+        copied->data().setVertex(0, first);
+        copied->data().setVertex(1, second);
+        edges.moveToEnd(copied);
+    }
+}
+
+template <class TNode, class T>
+static void copyRecordedIndices(const FPList<TNode, T> &source, const FPList<TNode, T> &copied)
+{
+    for (TNode *node = source.begin(), *end = source.end(), *copy = copied.begin(); node != end; node = node->next(), copy = copy->next())
+        copy->recordedIndex = node->recordedIndex;
+}
+
+Mesh2 *Mesh2::copy() const
+{
+    FPProfileZone zone("Mesh2::copy");
+
+    vector<float> positions;
+    vector<float> texCoords;
+    vector<unsigned char> faceSizes;
+    vector<unsigned int> vertexIndices;
+    vector<unsigned int> texCoordIndices;
+    vector<bool> selection;
+    MeshVisibility visibility;
+    
+    this->toIndexArrays(positions, texCoords, faceSizes, vertexIndices, texCoordIndices);
+    this->getSelection(selection);
+    this->getVisibility(visibility);
+    
+    Mesh2 *mesh = new Mesh2();
+    mesh->_isUnwrapped = _isUnwrapped;
+    mesh->_selectionMode = _selectionMode;
+    mesh->fromIndexArrays(positions.data(), (unsigned int)positions.size() / 3,
+                          texCoords.data(), (unsigned int)texCoords.size() / 3,
+                          faceSizes.data(), (unsigned int)faceSizes.size(),
+                          vertexIndices.data(), texCoordIndices.data());
+    
+    // toIndexArrays numbered the nodes of this mesh
+    orderEdgesLike(_vertexEdges, mesh->_vertexEdges, mesh->_vertices);
+    orderEdgesLike(_texCoordEdges, mesh->_texCoordEdges, mesh->_texCoords);
+    mesh->setSelectionMode(_selectionMode);
+    
+    mesh->setVisibility(visibility);
+    mesh->setSelection(selection);
+    mesh->setColor(_color);
+    mesh->setTexture(_texture);
+    
+    // the copy is changed instead of this mesh
+    if (_recording)
+    {
+        if (_recording->state == MeshRecording::State::Local)
+        {
+            copyRecordedIndices(_vertices, mesh->_vertices);
+            copyRecordedIndices(_texCoords, mesh->_texCoords);
+            copyRecordedIndices(_triangles, mesh->_triangles);
+        }
+        
+        mesh->_recording = _recording;
+        _recording = NULL;
+    }
+    
+    return mesh;
+}
+
 void Mesh2::merge(Mesh2 *mesh)
 {
+    FPProfileZone zone("Mesh2::merge");
+
     vector<Vector3D> thisVertices;
     vector<Vector3D> thisTexCoords;
     vector<TriQuad> thisTriangles;
@@ -1644,78 +2246,115 @@ void Mesh2::merge(Mesh2 *mesh)
     this->fromIndexRepresentation(mergedVertices, mergedTexCoords, mergedTriangles);     
 }
 
-void Mesh2::computeSoftSelection()
+void Mesh2::hideSelected()
 {
-    if (!_useSoftSelection)
-        return;
-    
-    for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
-        node->selectionWeight = 0.0f;
-    
-    for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
-        node->selectionWeight = 0.0f;
-    
-    for (VertexEdgeNode *node = _vertexEdges.begin(), *end = _vertexEdges.end(); node != end; node = node->next())
-        node->selectionWeight = 0.0f;
+    resetTriangleCache();
     
     switch (_selectionMode)
     {
-        case MeshSelectionMode::Vertices:
-            computeSoftSelectionVertices();
-            break;
         case MeshSelectionMode::Triangles:
-            computeSoftSelectionTriangles();
+            
+            for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
+            {
+                if (!node->data().visible)
+                    node->data().selected = true;
+            }            
+            
+            for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
+            {
+                Triangle2 &tri = node->data();
+                
+                if (tri.selected)
+                {
+                    tri.visible = false;
+                    
+                    for (unsigned int i = 0; i < tri.count(); i++)
+                    {
+                        if (!tri.vertexEdge(i)->data().isNotShared())
+                            tri.vertexEdge(i)->data().visible = false;
+                        
+                        if (!tri.texCoordEdge(i)->data().isNotShared())
+                            tri.texCoordEdge(i)->data().visible = false;
+                    }
+                    
+                    tri.selected = false;
+                }
+            }
+            
             break;
         case MeshSelectionMode::Edges:
-            computeSoftSelectionEdges();
+            if (_isUnwrapped)
+            {
+                for (TexCoordEdgeNode *node = _texCoordEdges.begin(), *end = _texCoordEdges.end(); node != end; node = node->next())
+                {
+                    if (node->data().selected)
+                    {
+                        node->data().visible = false;
+                        node->data().selected = false;
+                    }
+                }
+            }
+            else
+            {
+                for (VertexEdgeNode *node = _vertexEdges.begin(), *end = _vertexEdges.end(); node != end; node = node->next())
+                {
+                    if (node->data().selected)
+                    {
+                        node->data().visible = false;
+                        node->data().selected = false;
+                    }
+                }
+            }
+            break;
+        case MeshSelectionMode::Vertices:
+            if (_isUnwrapped)
+            {
+                for (TexCoordNode *node = _texCoords.begin(), *end = _texCoords.end(); node != end; node = node->next())
+                {
+                    if (node->data().selected)
+                    {
+                        node->data().visible = false;
+                        node->data().selected = false;
+                    }
+                } 
+            }
+            else
+            {
+                for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
+                {
+                    if (node->data().selected)
+                    {
+                        node->data().visible = false;
+                        node->data().selected = false;
+                    }
+                } 
+            }
+            break;            
+        default:
             break;
     }
+    
+    setSelectionMode(_selectionMode);
 }
 
-void Mesh2::computeSoftSelectionVertices()
-{
-    for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
-    {
-        if (node->data().selected)
-            node->softSelect(*_selectionWeights);
-    }
-}
-
-void Mesh2::computeSoftSelectionTriangles()
+void Mesh2::unhideAll()
 {
-    for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
-    {
-        if (node->data().selected)
-            node->softSelect(*_selectionWeights);
-    }
+    resetTriangleCache();
     
     for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
-    {
-        unsigned int count = node->data().count();
-        for (unsigned int i = 0; i < count; i++)
-        {
-            VertexNode *vertexNode = node->data().vertex(i);
-            if (vertexNode->selectionWeight < node->selectionWeight)
-                vertexNode->selectionWeight = node->selectionWeight;
-        }
-    }
-}
+        node->data().visible = true;
 
-void Mesh2::computeSoftSelectionEdges()
-{
-    for (VertexEdgeNode *node = _vertexEdges.begin(), *end = _vertexEdges.end(); node != end; node = node->next())
-    {
-        if (node->data().selected)
-            node->softSelect(*_selectionWeights);
-    }
+    for (TexCoordEdgeNode *node = _texCoordEdges.begin(), *end = _texCoordEdges.end(); node != end; node = node->next())
+        node->data().visible = true;
     
     for (VertexEdgeNode *node = _vertexEdges.begin(), *end = _vertexEdges.end(); node != end; node = node->next())
-    {
-        for (unsigned int i = 0; i < 2; i++)
-        {
-            VertexNode *vertexNode = node->data().vertex(i);
-            if (vertexNode->selectionWeight < node->selectionWeight)
-                vertexNode->selectionWeight = node->selectionWeight;
-        }
-    }
+        node->data().visible = true;
+    
+    for (TexCoordNode *node = _texCoords.begin(), *end = _texCoords.end(); node != end; node = node->next())
+        node->data().visible = true;
+    
+    for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
+        node->data().visible = true;
+    
+    setSelectionMode(_selectionMode);
 }
@@ -7,326 +7,27 @@
 //
 
 #include "Mesh2.h"
+#include "OpenGLDrawing.h"
 #include "Texture.h"
+#include "ShaderProgram.h"
+#include "FPVertexBuffer.h"
 
-void Mesh2::resetTriangleCache()
+// Buffer objects mirroring the render caches, made on the first draw.
+class GLMeshRenderBuffers : public MeshRenderBuffers
 {
-    _cachedTriangleVertices.setValid(false);
-    resetEdgeCache();
-}
-
-void Mesh2::resetEdgeCache()
-{
-    _cachedEdgeVertices.setValid(false);
-    _cachedEdgeTexCoords.setValid(false);
-}
-
-void Mesh2::fillTriangleCache()
-{
-    if (_cachedTriangleVertices.isValid())
-        return;
-    
-    _cachedTriangleVertices.resize(_triangles.count() * 6);
-    
-    for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
-    {
-        Triangle2 &currentTriangle = node->data();
-        currentTriangle.normalsAreValid = false;
-        currentTriangle.computeNormalsIfNeeded();
-    }
-    
-    for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
-    {
-        node->resetCacheIndices();
-        node->computeNormal();
-    }
-    
-    for (TexCoordNode *node = _texCoords.begin(), *end = _texCoords.end(); node != end; node = node->next())
-    {
-        node->computeNormal();
-    }
-
-    float weightedComponents[] = { 0.0f, 0.0f, 0.0f };
-    const float selectedComponents[] = { 0.7f, 0.0f, 0.0f };
-    const unsigned int *twoTriIndices = Triangle2::twoTriIndices;
-    unsigned int i = 0;
-    
-    for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
-    {
-        Triangle2 &currentTriangle = node->data();
-
-        if (!currentTriangle.visible)
-            continue;
-        
-        const float *c;
-        if (_useSoftSelection)
-        {
-            if (node->selectionWeight > _minimumSelectionWeight)
-            {
-                weightedComponents[0] = 1.0f;
-                weightedComponents[1] = 1.0f - node->selectionWeight;
-                c = weightedComponents;
-            }
-            else
-            {
-                c = _colorComponents;
-            }
-        }
-        else
-        {
-            if (currentTriangle.selected)
-                c = selectedComponents;
-            else
-                c = _colorComponents;
-        }
-        
-        Vector3D fn = _isUnwrapped ? currentTriangle.texCoordNormal : currentTriangle.vertexNormal;
-        
-        unsigned int vertexCount = currentTriangle.isQuad() ? 6 : 3;
-        
-        for (unsigned int j = 0; j < vertexCount; j++)
-        {
-            unsigned int twoTriIndex = twoTriIndices[j];
-            VertexNode *vertex = currentTriangle.vertex(twoTriIndex);
-            TexCoordNode *texCoord = currentTriangle.texCoord(twoTriIndex);
-
-            const Vector3D &v = vertex->data().position;
-            const Vector3D &t = texCoord->data().position;
-            
-            const Vector3D &sn = _isUnwrapped ? texCoord->algorithmData.normal : vertex->algorithmData.normal;;
-            
-            GLTriangleVertex &cachedVertex = _cachedTriangleVertices[i];
-            vertex->setCacheIndexForTriangleNode(node, i, j < 3 ? 0 : 1);
-            
-            for (unsigned int k = 0; k < 3; k++)
-            {
-                cachedVertex.position.coords[k] = v[k];
-                cachedVertex.texCoord.coords[k] = t[k];
-                cachedVertex.flatNormal.coords[k] = fn[k];
-                cachedVertex.smoothNormal.coords[k] = sn[k];
-                cachedVertex.color.coords[k] = c[k];
-            }
-            
-            i++;
-        }
-    }
-    
-    _cachedTriangleVertices.resize(i);
-    _cachedTriangleVertices.setValid(true);
-
-    if (!_vboGenerated)
-    {
-        glGenBuffers(1, &_vboID);
-        _vboGenerated = true;
-    }
-
-    glBindBuffer(GL_ARRAY_BUFFER, _vboID);
-    glBufferData(GL_ARRAY_BUFFER, _cachedTriangleVertices.count() * sizeof(GLTriangleVertex), _cachedTriangleVertices, GL_DYNAMIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-}
-
-void Mesh2::fillEdgeCache()
-{
-    if (_cachedEdgeVertices.isValid() && _cachedEdgeTexCoords.isValid())
-        return;
-    
-    _cachedEdgeVertices.resize(_vertexEdges.count() * 2);
-    _cachedEdgeTexCoords.resize(_texCoordEdges.count() * 2);
-    
-    Vector3D selectedColor(0.8f, 0.0f, 0.0f);
-    Vector3D normalColor(_colorComponents[0] - 0.2f, _colorComponents[1] - 0.2f, _colorComponents[2] - 0.2f);
-    
-    unsigned int i = 0;
-    
-    for (VertexEdgeNode *node = _vertexEdges.begin(), *end = _vertexEdges.end(); node != end; node = node->next())
-    {
-        if (!node->data().visible)
-            continue;
-        
-        if (_useSoftSelection)
-        {
-            if (node->selectionWeight > _minimumSelectionWeight)
-            {
-                Vector3D softSelectedColor = Vector3D(1.0f, 1.0f - node->selectionWeight, 0.0f);
-                
-                for (unsigned int k = 0; k < 3; k++)
-                {
-                    _cachedEdgeVertices[i].color.coords[k] = softSelectedColor[k];
-                    _cachedEdgeVertices[i + 1].color.coords[k] = softSelectedColor[k];
-                }
-            }
-            else
-            {
-                for (unsigned int k = 0; k < 3; k++)
-                {
-                    _cachedEdgeVertices[i].color.coords[k] = normalColor[k];
-                    _cachedEdgeVertices[i + 1].color.coords[k] = normalColor[k];
-                }
-            }
-        }
-        else
-        {
-            if (node->data().selected)
-            {
-                for (unsigned int k = 0; k < 3; k++)
-                {
-                    _cachedEdgeVertices[i].color.coords[k] = selectedColor[k];
-                    _cachedEdgeVertices[i + 1].color.coords[k] = selectedColor[k];
-                }
-            }
-            else
-            {
-                for (unsigned int k = 0; k < 3; k++)
-                {
-                    _cachedEdgeVertices[i].color.coords[k] = normalColor[k];
-                    _cachedEdgeVertices[i + 1].color.coords[k] = normalColor[k];
-                }
-            }
-        }
-        
-        VertexNode *v0 = node->data().vertex(0);
-        VertexNode *v1 = node->data().vertex(1);
-        
-        v0->setCacheIndexForEdgeNode(node, i);
-        v1->setCacheIndexForEdgeNode(node, i + 1);
-        
-        for (unsigned int k = 0; k < 3; k++)
-        {
-            _cachedEdgeVertices[i].position.coords[k] = v0->data().position[k];
-            _cachedEdgeVertices[i + 1].position.coords[k] = v1->data().position[k];
-        }
-        
-        i += 2;
-    }
+public:
+    FPVertexBuffer<GLTriangleVertex> triangles;
+    FPVertexBuffer<unsigned int> indices;
+    FPVertexBuffer<GLEdgeVertex> edges;
     
-    _cachedEdgeVertices.resize(i); // resize doesn't delete [] internal array, if not needed
-    _cachedEdgeVertices.setValid(true);
-    
-    i = 0;
-    
-    for (TexCoordEdgeNode *node = _texCoordEdges.begin(), *end = _texCoordEdges.end(); node != end; node = node->next())
-    {
-        if (!node->data().visible)
-            continue;
-        
-        if (node->data().selected)
-        {
-            for (unsigned int k = 0; k < 3; k++)
-            {
-                _cachedEdgeTexCoords[i].color.coords[k] = selectedColor[k];
-                _cachedEdgeTexCoords[i + 1].color.coords[k] = selectedColor[k];
-            }
-        }
-        else
-        {
-            for (unsigned int k = 0; k < 3; k++)
-            {
-                _cachedEdgeTexCoords[i].color.coords[k] = normalColor[k];
-                _cachedEdgeTexCoords[i + 1].color.coords[k] = normalColor[k];
-            }
-        }
-        
-        for (unsigned int k = 0; k < 3; k++)
-        {
-            _cachedEdgeTexCoords[i].position.coords[k] = node->data().texCoord(0)->data().position[k];
-            _cachedEdgeTexCoords[i + 1].position.coords[k] = node->data().texCoord(1)->data().position[k];
-        }
-        
-        i += 2;
-    }
-    
-    _cachedEdgeTexCoords.resize(i); // resize doesn't delete [] internal array, if not needed
-    _cachedEdgeTexCoords.setValid(true);
-}
-
-void Mesh2::updateVertexInTriangleCache(VertexNode *vertexNode, VertexTriangleNode *triangleNode, unsigned int cacheIndexPosition)
-{
-    int cacheIndex = triangleNode->cacheIndices[cacheIndexPosition];
-    if (cacheIndex < 0)
-        return;
-    
-    const Vector3D &v = vertexNode->data().position;
-	const Vector3D &sn = vertexNode->algorithmData.normal;
-    const Vector3D &fn = triangleNode->data()->data().vertexNormal;
-    
-    GLTriangleVertex &cachedVertex = _cachedTriangleVertices[cacheIndex];
-    
-    for (unsigned int k = 0; k < 3; k++)
-    {
-        cachedVertex.position.coords[k] = v[k];
-        cachedVertex.smoothNormal.coords[k] = sn[k];
-        cachedVertex.flatNormal.coords[k] = fn[k];
-    }
-}
+    GLMeshRenderBuffers() : indices(GL_ELEMENT_ARRAY_BUFFER) { }
+};
 
-void Mesh2::updateVertexInEdgeCache(VertexNode *vertexNode, Vertex2VEdgeNode *edgeNode)
+static GLMeshRenderBuffers &glBuffers(MeshRenderBuffers *&buffers)
 {
-    int cacheIndex = edgeNode->cacheIndex;
-    if (cacheIndex < 0)
-        return;
-    
-    const Vector3D &v = vertexNode->data().position;
-    
-    GLEdgeVertex &cachedVertex = _cachedEdgeVertices[cacheIndex];
-    
-    for (unsigned int k = 0; k < 3; k++)
-    {
-        cachedVertex.position.coords[k] = v[k];
-    }
-}
-
-void Mesh2::updateTriangleAndEdgeCache(vector<VertexNode *> &affectedVertices)
-{
-    unsigned int count = static_cast<unsigned int>(affectedVertices.size());
-    
-    if (count > vertexCount() / 3)
-    {
-        resetTriangleCache();
-        return;
-    }
-    
-    for (unsigned int i = 0; i < count; i++)
-    {
-        VertexNode *vertexNode = affectedVertices[i];
-        vertexNode->addAffectedVertices(affectedVertices);
-    }
-    
-    count = static_cast<unsigned int>(affectedVertices.size());
-    
-    for (unsigned int i = 0; i < count; i++)
-    {
-        VertexNode *vertexNode = affectedVertices[i];
-        vertexNode->updateTriangleNormals();
-    }
-    
-    for (unsigned int i = 0; i < count; i++)
-    {
-        VertexNode *vertexNode = affectedVertices[i];
-        vertexNode->computeNormal();
-        
-        for (VertexTriangleNode
-             *triangleNode = vertexNode->_triangles.begin(),
-             *triangleEnd = vertexNode->_triangles.end();
-             triangleNode != triangleEnd;
-             triangleNode = triangleNode->next())
-        {
-            updateVertexInTriangleCache(vertexNode, triangleNode, 0);
-            if (triangleNode->data()->data().isQuad())
-                updateVertexInTriangleCache(vertexNode, triangleNode, 1);
-        }
-        
-        for (Vertex2VEdgeNode
-             *edgeNode = vertexNode->_edges.begin(),
-             *edgeEnd = vertexNode->_edges.end();
-             edgeNode != edgeEnd;
-             edgeNode = edgeNode->next())
-        {
-            updateVertexInEdgeCache(vertexNode, edgeNode);
-        }
-    }
-    glBindBuffer(GL_ARRAY_BUFFER, _vboID);
-    glBufferData(GL_ARRAY_BUFFER, _cachedTriangleVertices.count() * sizeof(GLTriangleVertex), _cachedTriangleVertices, GL_DYNAMIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (buffers == NULL)
+        buffers = new GLMeshRenderBuffers();
+    return *static_cast<GLMeshRenderBuffers *>(buffers);
 }
 
 void Mesh2::drawFill(FillMode fillMode, ViewMode viewMode)
@@ -342,7 +43,11 @@ void Mesh2::drawFill(FillMode fillMode, ViewMode viewMode)
         glBindTexture(GL_TEXTURE_2D, _texture->textureID());
     }
     
-    glBindBuffer(GL_ARRAY_BUFFER, _vboID);
+    GLMeshRenderBuffers &buffers = glBuffers(_renderBuffers);
+    buffers.triangles.update(_cachedTriangleVertices);
+    buffers.indices.update(_cachedTriangleIndices);
+    buffers.triangles.bind();
+    buffers.indices.bind();
     
     glEnableClientState(GL_VERTEX_ARRAY);
 	glEnableClientState(GL_NORMAL_ARRAY);
@@ -350,29 +55,32 @@ void Mesh2::drawFill(FillMode fillMode, ViewMode viewMode)
     if (fillMode.textured && _texture != NULL)
         glEnableClientState(GL_TEXTURE_COORD_ARRAY);
     
-    if (fillMode.colored)
-    {
-        glEnableClientState(GL_COLOR_ARRAY);
-        glColorPointer(3, GL_FLOAT, sizeof(GLTriangleVertex), (void *)offsetof(GLTriangleVertex, color));
-    }
-    
-    if (viewMode == ViewMode::SolidSmooth)
-        glNormalPointer(GL_FLOAT, sizeof(GLTriangleVertex), (void *)offsetof(GLTriangleVertex, smoothNormal));
-    else
-        glNormalPointer(GL_FLOAT, sizeof(GLTriangleVertex), (void *)offsetof(GLTriangleVertex, flatNormal));
+    // flat normals are computed by the shader, see the flatNormals uniform
+    glNormalPointer(GL_SHORT, sizeof(GLTriangleVertex), (void *)offsetof(GLTriangleVertex, smoothNormal));
     
     if (fillMode.textured && _texture != NULL)
         glTexCoordPointer(2, GL_FLOAT, sizeof(GLTriangleVertex), (void *)offsetof(GLTriangleVertex, texCoord));
     
     if (viewMode == ViewMode::Unwrap)
-        glVertexPointer(3, GL_FLOAT, sizeof(GLTriangleVertex), (void *)offsetof(GLTriangleVertex, texCoord));
+        glVertexPointer(2, GL_FLOAT, sizeof(GLTriangleVertex), (void *)offsetof(GLTriangleVertex, texCoord));
     else
         glVertexPointer(3, GL_FLOAT, sizeof(GLTriangleVertex), (void *)offsetof(GLTriangleVertex, position));
     
-    glDrawArrays(GL_TRIANGLES, 0, (int)_cachedTriangleVertices.count());
-    
     if (fillMode.colored)
-        glDisableClientState(GL_COLOR_ARRAY);
+    {
+        glPushAttrib(GL_CURRENT_BIT);
+        for (unsigned int i = 0; i < _cachedColorRanges.size(); i++)
+        {
+            const GLColorRange &range = _cachedColorRanges[i];
+            glColor3fv(range.color);
+            glDrawElements(GL_TRIANGLES, (int)range.count, GL_UNSIGNED_INT, (void *)(range.start * sizeof(unsigned int)));
+        }
+        glPopAttrib();
+    }
+    else
+    {
+        glDrawElements(GL_TRIANGLES, (int)_cachedTriangleIndices.count(), GL_UNSIGNED_INT, (void *)0);
+    }
     
     if (fillMode.textured && _texture != NULL)
         glDisableClientState(GL_TEXTURE_COORD_ARRAY);
@@ -380,7 +88,8 @@ void Mesh2::drawFill(FillMode fillMode, ViewMode viewMode)
     glDisableClientState(GL_NORMAL_ARRAY);
     glDisableClientState(GL_VERTEX_ARRAY);
     
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    buffers.indices.unbind();
+    buffers.triangles.unbind();
     
     if (fillMode.textured && _texture != NULL)
     {
@@ -440,6 +149,9 @@ void Mesh2::draw(ViewMode viewMode, const Vector3D &scale, bool selected, bool f
             glUniform1i(textureLocation, 0);
         }
         shader->useProgram();
+        
+        GLint flatNormalsLocation = glGetUniformLocation(shader->program, "flatNormals");
+        glUniform1i(flatNormalsLocation, viewMode == ViewMode::SolidSmooth ? 0 : 1);
 
         if (_selectionMode != MeshSelectionMode::Triangles)
         {
@@ -730,52 +442,6 @@ void Mesh2::drawAllVertices(ViewMode viewMode, bool forSelection)
     }
 }
 
-void Mesh2::glProjectSelect(int x, int y, int width, int height, const Matrix4x4 &transform, OpenGLSelectionMode selectionMode)
-{
-    int viewport[4];
-    double modelview[16];
-    double projection[16];
-    double winX, winY, winZ;
-    double posX, posY, posZ;
-	
-    glGetDoublev(GL_MODELVIEW_MATRIX, modelview);
-    glGetDoublev(GL_PROJECTION_MATRIX, projection);
-    glGetIntegerv(GL_VIEWPORT, viewport);
-    
-    for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
-    {
-        if (!node->data().visible)
-            continue;
-
-        Vector3D position = transform.Transform(node->data().position);
-
-        posX = position.x;
-        posY = position.y;
-        posZ = position.z;
-        
-        gluProject(posX, posY, posZ, modelview, projection, viewport, &winX, &winY, &winZ);
-        
-        if (winX > x && winX < x + width &&
-            winY > y && winY < y + height)
-        {
-            switch (selectionMode) 
-            {
-                case OpenGLSelectionMode::Add:
-                    node->data().selected = true;
-                    break;
-                case OpenGLSelectionMode::Subtract:
-                    node->data().selected = false;
-                    break;
-                case OpenGLSelectionMode::Invert:
-                    node->data().selected = !node->data().selected;
-                    break;
-                default:
-                    break;
-            }
-        }
-    }
-}
-
 void Mesh2::drawAllTriangles(ViewMode viewMode, bool forSelection)
 {
     for (unsigned int i = 0; i < _triangles.count(); i++)
@@ -853,10 +519,14 @@ void Mesh2::drawAllEdges(ViewMode viewMode, bool forSelection)
         }
         else
         {
-            float *vertexPtr = (float *)&_cachedEdgeVertices[0].position;
-            glVertexPointer(3, GL_FLOAT, sizeof(GLEdgeVertex), vertexPtr);
+            // the color indices stay in client memory, they were set before binding
+            GLMeshRenderBuffers &buffers = glBuffers(_renderBuffers);
+            buffers.edges.update(_cachedEdgeVertices);
+            buffers.edges.bind();
+            glVertexPointer(3, GL_FLOAT, sizeof(GLEdgeVertex), (void *)offsetof(GLEdgeVertex, position));
             
             glDrawArrays(GL_LINES, 0, (int)_cachedEdgeVertices.count());
+            buffers.edges.unbind();
         }
         
         glDisableClientState(GL_COLOR_ARRAY);
@@ -879,13 +549,14 @@ void Mesh2::drawAllEdges(ViewMode viewMode, bool forSelection)
         }
         else
         {
-            float *colorPtr = (float *)&_cachedEdgeVertices[0].color;
-            glColorPointer(3, GL_FLOAT, sizeof(GLEdgeVertex), colorPtr);
-            
-            float *vertexPtr = (float *)&_cachedEdgeVertices[0].position;
-            glVertexPointer(3, GL_FLOAT, sizeof(GLEdgeVertex), vertexPtr);
+            GLMeshRenderBuffers &buffers = glBuffers(_renderBuffers);
+            buffers.edges.update(_cachedEdgeVertices);
+            buffers.edges.bind();
+            glColorPointer(3, GL_FLOAT, sizeof(GLEdgeVertex), (void *)offsetof(GLEdgeVertex, color));
+            glVertexPointer(3, GL_FLOAT, sizeof(GLEdgeVertex), (void *)offsetof(GLEdgeVertex, position));
             
             glDrawArrays(GL_LINES, 0, (int)_cachedEdgeVertices.count());
+            buffers.edges.unbind();
         }
         
         glDisableClientState(GL_COLOR_ARRAY);
@@ -908,163 +579,3 @@ void Mesh2::drawAll(ViewMode viewMode, bool forSelection)
             break;
     }
 }
-
-void Mesh2::uvToPixels(float &u, float &v)
-{
-//    u *= (float)_texture.width;
-//    v *= (float)_texture.height;
-//    
-//    v = (float)_texture.height - v;
-}
-
-TriangleNode *Mesh2::rayToUV(const Vector3D &origin, const Vector3D &direction, float &u, float &v)
-{
-    Vector3D intersect = Vector3D();
-    TriangleNode *nearest = NULL;
-    u = 0.0f;
-    v = 0.0f;
-    
-    float lastSqDistance = 0.0f;
-    float tempSqDistance = 0.0f;
-    
-    for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
-    {
-        float tempU = 0.0f;
-        float tempV = 0.0f;
-        Vector3D tempIntersect;
-        
-        if (node->data().rayIntersect(origin, direction, tempU, tempV, tempIntersect))
-        {
-            tempSqDistance = tempIntersect.SqDistance(origin);
-            if (nearest == NULL || lastSqDistance > tempSqDistance)
-            {
-                nearest = node;
-                u = tempU;
-                v = tempV;
-                intersect = tempIntersect;
-                lastSqDistance = tempSqDistance;
-            }            
-        }
-    }
-
-    if (nearest)
-    {
-        nearest->data().convertBarycentricToUVs(u, v);
-        uvToPixels(u, v);
-    }
-    return nearest;
-}
-
-void Mesh2::hideSelected()
-{
-    resetTriangleCache();
-    
-    switch (_selectionMode)
-    {
-        case MeshSelectionMode::Triangles:
-            
-            for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
-            {
-                if (!node->data().visible)
-                    node->data().selected = true;
-            }            
-            
-            for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
-            {
-                Triangle2 &tri = node->data();
-                
-                if (tri.selected)
-                {
-                    tri.visible = false;
-                    
-                    for (unsigned int i = 0; i < tri.count(); i++)
-                    {
-                        if (!tri.vertexEdge(i)->data().isNotShared())
-                            tri.vertexEdge(i)->data().visible = false;
-                        
-                        if (!tri.texCoordEdge(i)->data().isNotShared())
-                            tri.texCoordEdge(i)->data().visible = false;
-                    }
-                    
-                    tri.selected = false;
-                }
-            }
-            
-            break;
-        case MeshSelectionMode::Edges:
-            if (_isUnwrapped)
-            {
-                for (TexCoordEdgeNode *node = _texCoordEdges.begin(), *end = _texCoordEdges.end(); node != end; node = node->next())
-                {
-                    if (node->data().selected)
-                    {
-                        node->data().visible = false;
-                        node->data().selected = false;
-                    }
-                }
-            }
-            else
-            {
-                for (VertexEdgeNode *node = _vertexEdges.begin(), *end = _vertexEdges.end(); node != end; node = node->next())
-                {
-                    if (node->data().selected)
-                    {
-                        node->data().visible = false;
-                        node->data().selected = false;
-                    }
-                }
-            }
-            break;
-        case MeshSelectionMode::Vertices:
-            if (_isUnwrapped)
-            {
-                for (TexCoordNode *node = _texCoords.begin(), *end = _texCoords.end(); node != end; node = node->next())
-                {
-                    if (node->data().selected)
-                    {
-                        node->data().visible = false;
-                        node->data().selected = false;
-                    }
-                } 
-            }
-            else
-            {
-                for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
-                {
-                    if (node->data().selected)
-                    {
-                        node->data().visible = false;
-                        node->data().selected = false;
-                    }
-                } 
-            }
-            break;            
-        default:
-            break;
-    }
-    
-    setSelectionMode(_selectionMode);
-}
-
-void Mesh2::unhideAll()
-{
-    resetTriangleCache();
-    
-    for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
-        node->data().visible = true;
-
-    for (TexCoordEdgeNode *node = _texCoordEdges.begin(), *end = _texCoordEdges.end(); node != end; node = node->next())
-        node->data().visible = true;
-    
-    for (VertexEdgeNode *node = _vertexEdges.begin(), *end = _vertexEdges.end(); node != end; node = node->next())
-        node->data().visible = true;
-    
-    for (TexCoordNode *node = _texCoords.begin(), *end = _texCoords.end(); node != end; node = node->next())
-        node->data().visible = true;
-    
-    for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
-        node->data().visible = true;
-    
-    setSelectionMode(_selectionMode);
-}
-
@@ -8,11 +8,15 @@
 
 #pragma once
 
-#include "OpenGLDrawing.h"
-#include "ShaderProgram.h"
+#include "MathDeclaration.h"
 #include "MeshHelpers.h"
-#include "Camera.h"
 #include "MemoryStream.h"
+#include "TriangleBVH.h"
+#include "FPSoftwarePicker.h"
+#include "FPSelectionRegion.h"
+#include "FPProfiler.h"
+#include "FPMemoryFootprint.h"
+#include <algorithm>
 
 enum GLVertexAttribID
 {
@@ -31,13 +35,22 @@ struct Point2D
     float coords[2];
 };
 
+// One vertex per distinct vertex and texture coordinate pair, shared by
+// the triangles through _cachedTriangleIndices. Flat normals come from the
+// shader and colors from GLColorRange.
 struct GLTriangleVertex
 {
     Point3D position;
-    Point3D flatNormal;
-    Point3D smoothNormal;
-    Point3D color;
-    Point3D texCoord;
+    Point2D texCoord;
+    short smoothNormal[4]; // normalized by GL, the fourth one pads to 8 bytes
+};
+
+// indices drawn with one color
+struct GLColorRange
+{
+    float color[3];
+    unsigned int start;
+    unsigned int count;
 };
 
 struct GLEdgeVertex
@@ -58,12 +71,21 @@ struct FillMode
     bool textured;
 };
 
+// GPU copies of the render caches. The drawing code makes them on the
+// first draw, the mesh only deletes them, so it builds without OpenGL.
+class MeshRenderBuffers
+{
+public:
+    virtual ~MeshRenderBuffers() { }
+};
+
 class Texture;
-class TextureCollection;
 
 class Mesh2
 {
 private:
+    FPNodeAllocator _allocator;
+    
     FPList<VertexNode, Vertex2> _vertices;
 	FPList<TriangleNode, Triangle2> _triangles;
     FPList<TexCoordNode, TexCoord> _texCoords;
@@ -71,6 +93,12 @@ private:
     FPList<VertexEdgeNode, VertexEdge> _vertexEdges;
     FPList<TexCoordEdgeNode, TexCoordEdge> _texCoordEdges;
     
+    FPEdgeMap<VertexNode, VertexEdgeNode> _vertexEdgeMap;
+    FPEdgeMap<TexCoordNode, TexCoordEdgeNode> _texCoordEdgeMap;
+    bool _useEdgeMaps;
+    mutable FPSpatialGrid<VertexNode> _vertexGrid;
+    TriangleBVH _triangleBVH;
+    
     MeshSelectionMode _selectionMode;
 	
     vector<VertexNode *> _cachedVertexSelection;
@@ -79,7 +107,29 @@ private:
     vector<VertexEdgeNode *> _cachedVertexEdgeSelection;
     vector<TexCoordEdgeNode *> _cachedTexCoordEdgeSelection;
     
+    // What transformSelected moves, gathered once per selection so that
+    // dragging does not walk the whole lists on every event. It is rebuilt
+    // when the selection, the soft selection or the nodes change.
+    struct MovedSelection
+    {
+        bool valid;
+        bool unwrapped;
+        bool soft;
+        bool updatesLocally;
+        float minimumWeight;
+        vector<Vector3D *> positions;
+        vector<float> weights;
+        vector<VertexNode *> affectedVertices;
+        
+        MovedSelection() : valid(false), unwrapped(false), soft(false), updatesLocally(false), minimumWeight(0.0f) { }
+    };
+    
+    MovedSelection _movedSelection;
+    
 	FPArrayCache<GLTriangleVertex> _cachedTriangleVertices;
+    FPArrayCache<unsigned int> _cachedTriangleIndices;
+    vector<unsigned int> _cachedCornerIndices; // four per triangle at TriangleNode::cacheIndex
+    vector<GLColorRange> _cachedColorRanges;
     FPArrayCache<GLEdgeVertex> _cachedEdgeVertices;
     FPArrayCache<GLEdgeTexCoord> _cachedEdgeTexCoords;
     
@@ -87,22 +137,72 @@ private:
     static bool _selectThrough;
     static float _minimumSelectionWeight;
     static vector<float> *_selectionWeights;
+    static SoftSelectionFalloff _softSelectionFalloff;
+    static float _softSelectionRadius;
+    static float _compressionTolerance;
     
     bool _isUnwrapped;
+    unsigned int _referenceCount;
+    // a copy made to change a shared mesh takes the recording over
+    mutable MeshRecording *_recording;
     
-    unsigned int _vboID;
-    bool _vboGenerated;
+    MeshRenderBuffers *_renderBuffers;
 
     float _colorComponents[4];
     Vector4D _color;
     Texture *_texture;
 private:
+    // List ends captured before a local edit, everything from them to the
+    // current ends was added by the edit. Touched nodes are checked afterwards,
+    // unused vertices are removed unless the edit keeps them.
+    struct LocalEdit
+    {
+        bool keepsUnusedVertices;
+        VertexNode *vertexEnd;
+        TexCoordNode *texCoordEnd;
+        TriangleNode *triangleEnd;
+        VertexEdgeNode *vertexEdgeEnd;
+        TexCoordEdgeNode *texCoordEdgeEnd;
+        
+        vector<TriangleNode *> modifiedTriangles;
+        vector<TriangleNode *> removedTriangles;
+        vector<VertexNode *> touchedVertices;
+        vector<TexCoordNode *> touchedTexCoords;
+        vector<VertexEdgeNode *> touchedVertexEdges;
+        vector<TexCoordEdgeNode *> touchedTexCoordEdges;
+    };
+    
+    void removeAllNodes();
+    void beginLocalEdit(LocalEdit &edit);
+    void touchTriangle(LocalEdit &edit, TriangleNode *node);
+    void detachTriangle(LocalEdit &edit, TriangleNode *node);
+    void removeTriangle(LocalEdit &edit, TriangleNode *&node);
+    void endLocalEdit(LocalEdit &edit);
+    void numberRecordedNodes();
+    void recordSnapshot();
+    void recordFace(TriangleNode *node);
+    void recordRemovedFace(TriangleNode *node);
+    void recordMovedVertex(VertexNode *node);
+    void recordRemovedVertex(VertexNode *node);
+    void recordRemovedVertex(TexCoordNode *node);
+    void updateVertexSelection(const vector<VertexNode *> &vertices, const vector<TexCoordNode *> &texCoords);
+    void invalidateMovedSelection() { _movedSelection.valid = false; }
+    void prepareMovedSelection();
     void fastMergeSelectedVertices();
     void fastMergeSelectedTexCoords();
-    void halfEdges();
-    void repositionVertices(unsigned int vertexCount);
-    void makeSubdividedTriangles();
+    bool isSelectedForSubdivision(const Triangle2 &triangle, float minimumEdgeLength) const;
+    void splitSubdivisionEdge(LocalEdit &edit, VertexEdgeNode *edge, vector<TriangleNode *> &pending);
+    TexCoordNode *subdivisionTexCoord(LocalEdit &edit, const Triangle2 &triangle, unsigned int index);
+    void addChildTriangle(const Triangle2 &parent, VertexNode *vertices[], TexCoordNode *texCoords[],
+                          unsigned int index0, unsigned int index1, unsigned int index2);
+    void addSubdividedTriangles(const Triangle2 &parent, VertexNode *vertices[], TexCoordNode *texCoords[]);
     void uvToPixels(float &u, float &v);
+    void hitToPixels(const TriangleHit &hit, float &u, float &v);
+    void pickTriangle(FPSoftwarePicker &picker, const Triangle2 &triangle, unsigned int id);
+    void prepareTriangleBVH();
+    void resetMovedTriangleCache();
+    void encodeIndexArrays(MemoryWriteStream *stream);
+    void decodeIndexArrays(MemoryReadStream *stream);
     
     template <class T>
     FPList<VEdgeNode<T>, VEdge<T> > &edges();
@@ -110,17 +210,40 @@ private:
     template <class T>
     FPList<VNode<T>, T> &vertices();    
     
+    template <class T>
+    FPEdgeMap<VNode<T>, VEdgeNode<T> > &edgeMap();
+    
     template <class T>
     VEdgeNode<T> *findOrCreateEdge(VNode<T> *v1, VNode<T> *v2, TriangleNode * triangle);
     
     template <class T>
     VNode<T> *duplicateVertex(VNode<T> *original);    
+    
+    template <class T>
+    void removeDetachedEdges(vector<VEdgeNode<T> *> &touched, vector<VEdgeNode<T> *> &removed);
+    
+    template <class T>
+    void removeUnusedVertices(vector<VNode<T> *> &touched, vector<VNode<T> *> &removed);
+    
+    template <class T>
+    VNode<T> *mergeVertices(const vector<VNode<T> *> &nodes);
+    
+    template <class T>
+    void fastWeldSelectedVertices(float distance);
 public:
     Mesh2();
-    Mesh2(MemoryReadStream *stream, TextureCollection &textures);
+    // Item reads and writes the texture index in front of the mesh
+    Mesh2(MemoryReadStream *stream);
     ~Mesh2();
     
-    void encode(MemoryWriteStream *stream, TextureCollection &textures);
+    // Duplicated items and undo states share one mesh, the last release
+    // deletes it. Shared meshes are copied before they are changed.
+    void retain() { _referenceCount++; }
+    void release() { if (--_referenceCount == 0) delete this; }
+    bool isShared() const { return _referenceCount > 1; }
+    Mesh2 *copy() const;
+    
+    void encode(MemoryWriteStream *stream);
     
     Vector4D color() { return _color; }
     void setColor(Vector4D color);
@@ -132,6 +255,9 @@ public:
     unsigned int triangleCount() { return _triangles.count(); }
     unsigned int vertexEdgeCount() { return _vertexEdges.count(); }
     
+    // walks the vertices for their adjacency lists, GPU buffers are not included
+    FPMemoryFootprint memoryFootprint() const;
+    
     MeshSelectionMode selectionMode() const { return _selectionMode; };
     void setSelectionMode(MeshSelectionMode value);
     
@@ -150,8 +276,18 @@ public:
     static void setSelectThrough(bool value) { _selectThrough = value; }
     
     static vector<float> &selectionWeights();
+    
+    // distance falloffs spread the weights over the radius, steps use one weight per edge
+    static SoftSelectionFalloff softSelectionFalloff() { return _softSelectionFalloff; }
+    static void setSoftSelectionFalloff(SoftSelectionFalloff value) { _softSelectionFalloff = value; }
+    static float softSelectionRadius() { return _softSelectionRadius; }
+    static void setSoftSelectionRadius(float value) { _softSelectionRadius = value; }
+    
+    // below zero saves plain arrays, zero compresses losslessly
+    static float compressionTolerance() { return _compressionTolerance; }
+    static void setCompressionTolerance(float value) { _compressionTolerance = value; }
 
-    static NSString *descriptionOfMeshType(MeshType meshType);
+    static const char *descriptionOfMeshType(MeshType meshType);
     
     bool isUnwrapped() { return _isUnwrapped; }
     void setUnwrapped(bool value) { _isUnwrapped = value; }
@@ -163,6 +299,7 @@ public:
     void removeNonUsedVertices();
     void removeNonUsedTexCoords();
     void mergeSelectedVertices();
+    void weldSelectedVertices(float distance);
     void removeSelectedVertices();
     void removeSelectedTriangles();
     void removeSelectedEdges();
@@ -175,6 +312,7 @@ public:
     
     void removeSelected();
     void mergeSelected();
+    void weldSelected(float distance);
     void splitSelected();
     void detachSelected();
     void duplicateSelectedTriangles();
@@ -186,11 +324,14 @@ public:
     void triangulate();
     void triangulateSelectedQuads();
     void loopSubdivision();
+    void loopSubdivisionSelected(float minimumEdgeLength = 0.0f);
     
     void merge(Mesh2 *mesh);
     
     void computeSoftSelection();
     void computeSoftSelectionVertices();
+    void computeSoftSelectionGeodesic();
+    void computeSoftSelectionEuclidean();
     void computeSoftSelectionEdges();
     void computeSoftSelectionTriangles();
     
@@ -202,9 +343,12 @@ public:
     void resetEdgeCache();
     void fillEdgeCache();
     
-    void updateVertexInTriangleCache(VertexNode *vertexNode, VertexTriangleNode *triangleNode, unsigned int cacheIndexPosition);
+    void colorOfGroup(unsigned int group, float color[3]) const;
+    void updateVertexInTriangleCache(VertexNode *vertexNode, VertexTriangleNode *triangleNode);
     void updateVertexInEdgeCache(VertexNode *vertexNode, Vertex2VEdgeNode *edgeNode);
     void updateTriangleAndEdgeCache(vector<VertexNode *> &affectedVertices);
+    bool addAffectedVertices(vector<VertexNode *> &affectedVertices);
+    void updateAffectedTriangleAndEdgeCache(const vector<VertexNode *> &affectedVertices);
     
     void drawFill(FillMode fillMode, ViewMode viewMode);
     void draw(ViewMode viewMode, const Vector3D &scale, bool selected, bool forSelection);
@@ -215,9 +359,11 @@ public:
     void drawAllVertices(ViewMode viewMode, bool forSelection);
     void drawAllTriangles(ViewMode viewMode, bool forSelection);
     void drawAllEdges(ViewMode viewMode, bool forSelection);
+    void pickAll(FPSoftwarePicker &picker);
+    void pickFill(FPSoftwarePicker &picker, unsigned int id);
     
-    bool useGLProject() { return _selectThrough && _selectionMode == MeshSelectionMode::Vertices; }
-    void glProjectSelect(int x, int y, int width, int height, const Matrix4x4 &transform, OpenGLSelectionMode selectionMode);
+    bool useProjectSelect() { return _selectThrough && _selectionMode == MeshSelectionMode::Vertices; }
+    void projectSelect(const FPSelectionRegion &region, const Matrix4x4 &transform, OpenGLSelectionMode selectionMode);
     
     void hideSelected();
     void unhideAll();
@@ -225,6 +371,9 @@ public:
     // texturing
     
     TriangleNode *rayToUV(const Vector3D &origin, const Vector3D &direction, float &u, float &v);
+    void raysToUV(const vector<Vector3D> &origins, const vector<Vector3D> &directions, vector<TriangleNode *> &triangles, vector<float> &us, vector<float> &vs);
+    bool rayIntersect(const Vector3D &origin, const Vector3D &direction, TriangleHit &hit);
+    bool rayIntersectsAny(const Vector3D &origin, const Vector3D &direction, float maxDistance);
 
     // make
     
@@ -234,6 +383,7 @@ public:
     void triangleVertexNodesNearPosition(const Vector3D &position, const Vector3D &eyeVector, vector<VertexNode *> &vertices);
     TriangleNode *triangleConnectVerticesNearPosition(const Vector3D &position, const Vector3D &eyeVector);
     VertexNode *findNearestVertex(const Vector3D &position, const vector<VertexNode *> &skipVertices) const;
+    void findNearestVertices(const Vector3D &position, unsigned int count, const vector<VertexNode *> &skipVertices, vector<VertexNode *> &nearest) const;
 
     TriangleNode *addTriangle(VertexNode *v0, VertexNode *v1, VertexNode *v2);
     TriangleNode *addQuad(VertexNode *v0, VertexNode *v1, VertexNode *v2, VertexNode *v3);
@@ -260,9 +410,35 @@ public:
     
     void fromIndexRepresentation(const vector<Vector3D> &vertices, const vector<Vector3D> &texCoords, const vector<TriQuad> &triangles);
     void toIndexRepresentation(vector<Vector3D> &vertices, vector<Vector3D> &texCoords, vector<TriQuad> &triangles) const;
+    
+    // Flat arrays with three floats per position, faceSizes is 3 or 4 and
+    // the index arrays hold that many entries for each face.
+    void fromIndexArrays(const float *positions, unsigned int vertexCount,
+                         const float *texCoords, unsigned int texCoordCount,
+                         const unsigned char *faceSizes, unsigned int faceCount,
+                         const unsigned int *vertexIndices, const unsigned int *texCoordIndices);
+    void toIndexArrays(vector<float> &positions, vector<float> &texCoords, vector<unsigned char> &faceSizes,
+                       vector<unsigned int> &vertexIndices, vector<unsigned int> &texCoordIndices) const;
+    void takeSnapshot(MeshSnapshot &snapshot) const;
+    // Puts the patch into the mesh in one local edit and leaves what it
+    // replaced in the patch.
+    void swapPatch(MeshPatch &patch);
+    // Records changes into recording until endRecording. Local edits keep
+    // only what they touch, other changes make it take a snapshot first.
+    void beginRecording(MeshRecording *recording);
+    void endRecording(MeshRecording *recording);
   
     void setSelection(const vector<bool> &selection);
     void getSelection(vector<bool> &selection) const;
+    void setVisibility(const MeshVisibility &visibility);
+    void getVisibility(MeshVisibility &visibility) const;
+    
+    // Positions of vertices (or texture coordinates) by their sorted list
+    // indices, movable ones are those transformSelected would change.
+    void getMovablePositions(vector<unsigned int> &indices, vector<Vector3D> &positions, bool &texCoords) const;
+    void getPositions(const vector<unsigned int> &indices, vector<Vector3D> &positions, bool texCoords);
+    void swapPositions(const vector<unsigned int> &indices, vector<Vector3D> &positions, bool texCoords);
+    void swapSelection(const vector<unsigned int> &indices, vector<bool> &selection);
     
     void fillMeshFromSelectedTriangles(Mesh2 &mesh);
 };
@@ -279,19 +455,32 @@ inline FPList<VertexNode, Vertex2> &Mesh2::vertices() { return this->_vertices;
 template <>
 inline FPList<TexCoordNode, TexCoord> &Mesh2::vertices() { return this->_texCoords; }
 
+template <>
+inline FPEdgeMap<VertexNode, VertexEdgeNode> &Mesh2::edgeMap() { return this->_vertexEdgeMap; }
+
+template <>
+inline FPEdgeMap<TexCoordNode, TexCoordEdgeNode> &Mesh2::edgeMap() { return this->_texCoordEdgeMap; }
+
 template <class T>
 inline VEdgeNode<T> *Mesh2::findOrCreateEdge(VNode<T> *v1, VNode<T> *v2, TriangleNode * triangle)
 {
-    VEdgeNode<T> *sharedEdge = v1->sharedEdge(v2);
+    VEdgeNode<T> *sharedEdge = _useEdgeMaps ? edgeMap<T>().find(v1, v2) : v1->sharedEdge(v2);
     if (sharedEdge)
     {
-        sharedEdge->data().setTriangle(1, triangle);
+        // a local edit can leave the first slot empty
+        if (sharedEdge->data().triangle(0) == NULL)
+            sharedEdge->data().setTriangle(0, triangle);
+        else
+            sharedEdge->data().setTriangle(1, triangle);
         return sharedEdge;
     }
     
     VNode<T> *vertices[2] = { v1, v2 };
     VEdgeNode<T> *node = edges<T>().add(vertices);
     
+    if (_useEdgeMaps)
+        edgeMap<T>().insert(v1, v2, node);
+    
     node->data().setTriangle(0, triangle);
     return node;
 }
@@ -304,3 +493,98 @@ inline VNode<T> *Mesh2::duplicateVertex(VNode<T> *original)
     
     return original->algorithmData.duplicatePair;
 }
+
+template <class T>
+inline void Mesh2::removeDetachedEdges(vector<VEdgeNode<T> *> &touched, vector<VEdgeNode<T> *> &removed)
+{
+    sort(touched.begin(), touched.end());
+    touched.erase(unique(touched.begin(), touched.end()), touched.end());
+    
+    for (unsigned int i = 0; i < touched.size(); i++)
+    {
+        VEdgeNode<T> *node = touched[i];
+        if (node->data().triangle(0) == NULL && node->data().triangle(1) == NULL)
+        {
+            removed.push_back(node);
+            edges<T>().remove(node);
+        }
+    }
+}
+
+// Removes touched vertices left without triangles, touched keeps only the live ones.
+template <class T>
+inline void Mesh2::removeUnusedVertices(vector<VNode<T> *> &touched, vector<VNode<T> *> &removed)
+{
+    sort(touched.begin(), touched.end());
+    touched.erase(unique(touched.begin(), touched.end()), touched.end());
+    
+    unsigned int count = 0;
+    
+    for (unsigned int i = 0; i < touched.size(); i++)
+    {
+        VNode<T> *node = touched[i];
+        if (node->isUsed())
+        {
+            touched[count++] = node;
+        }
+        else
+        {
+            recordRemovedVertex(node);
+            removed.push_back(node);
+            vertices<T>().remove(node);
+        }
+    }
+    
+    touched.resize(count);
+}
+
+// Replaces nodes with a single node at their center.
+template <class T>
+inline VNode<T> *Mesh2::mergeVertices(const vector<VNode<T> *> &nodes)
+{
+    if (nodes.size() < 2)
+        return NULL;
+    
+    Vector3D center = Vector3D();
+    
+    for (unsigned int i = 0; i < nodes.size(); i++)
+        center += nodes[i]->data().position;
+    
+    center /= (float)nodes.size();
+    
+    VNode<T> *centerNode = vertices<T>().add(center);
+    
+    for (unsigned int i = 0; i < nodes.size(); i++)
+        nodes[i]->replaceVertex(centerNode);
+    
+    return centerNode;
+}
+
+// Groups selected nodes around the first node of every group closer than distance,
+// each group is then merged like in fastMergeSelectedVertices.
+template <class T>
+inline void Mesh2::fastWeldSelectedVertices(float distance)
+{
+    FPWeldGrid weldGrid(distance);
+    vector<vector<VNode<T> *> > groups;
+    
+    for (VNode<T> *node = vertices<T>().begin(), *end = vertices<T>().end(); node != end; node = node->next())
+    {
+        if (!node->data().selected)
+            continue;
+        
+        unsigned int found = weldGrid.find(node->data().position);
+        if (found == UINT_MAX)
+        {
+            weldGrid.insert(node->data().position);
+            groups.push_back(vector<VNode<T> *>(1, node));
+        }
+        else
+        {
+            groups[found].push_back(node);
+        }
+    }
+    
+    for (unsigned int i = 0; i < groups.size(); i++)
+        mergeVertices<T>(groups[i]);
+}
@@ -11,19 +11,26 @@
 
 VertexNode *Mesh2::addVertex(const Vector3D &position)
 {
-    return _vertices.add(position);
+    // endLocalEdit puts the new vertex into the grid and the selection cache
+    LocalEdit edit;
+    beginLocalEdit(edit);
+    
+    VertexNode *node = _vertices.add(position);
+    
+    endLocalEdit(edit);
+    
+    return node;
 }
 
 void Mesh2::quadVertexNodesNearPosition(const Vector3D &position, const Vector3D &eyeVector, vector<VertexNode *> &vertices)
 {
     Vector3D center = Vector3D();
     
+    vector<VertexNode *> skipVertices;
+    findNearestVertices(position, 4, skipVertices, vertices);
+    
     for (unsigned int i = 0; i < 4; i++)
-    {
-        VertexNode *nearestVertex = findNearestVertex(position, vertices);
-        vertices.push_back(nearestVertex);
-        center += nearestVertex->data().position;
-    }
+        center += vertices[i]->data().position;
     
     center /= 4.0f;
     
@@ -67,21 +74,23 @@ TriangleNode *Mesh2::quadConnectVerticesNearPosition(const Vector3D &position, c
     vector<VertexNode *> vertices;
     quadVertexNodesNearPosition(position, eyeVector, vertices);
     
+    LocalEdit edit;
+    beginLocalEdit(edit);
+    
     TriangleNode *quad = addQuad(vertices[0], vertices[1], vertices[2], vertices[3]);
     
-    makeEdges();
-    setSelectionMode(_selectionMode);
+    endLocalEdit(edit);
+    
+    // vertices did not move, so the vertex grid stays valid
+    _cachedTriangleVertices.setValid(false);
     
     return quad;
 }
 
 void Mesh2::triangleVertexNodesNearPosition(const Vector3D &position, const Vector3D &eyeVector, vector<VertexNode *> &vertices)
 {
-    for (unsigned int i = 0; i < 3; i++)
-    {
-        VertexNode *nearestVertex = findNearestVertex(position, vertices);
-        vertices.push_back(nearestVertex);
-    }
+    vector<VertexNode *> skipVertices;
+    findNearestVertices(position, 3, skipVertices, vertices);
     
     Vector3D u, v;
     u = vertices[0]->data().position - vertices[1]->data().position;
@@ -97,33 +106,36 @@ TriangleNode *Mesh2::triangleConnectVerticesNearPosition(const Vector3D &positio
     vector<VertexNode *> vertices;
     triangleVertexNodesNearPosition(position, eyeVector, vertices);
     
+    LocalEdit edit;
+    beginLocalEdit(edit);
+    
     TriangleNode *triangle = addTriangle(vertices[0], vertices[1], vertices[2]);
     
-    makeEdges();
-    setSelectionMode(_selectionMode);
+    endLocalEdit(edit);
+    
+    _cachedTriangleVertices.setValid(false);
     
     return triangle;
 }
 
 VertexNode *Mesh2::findNearestVertex(const Vector3D &position, const vector<VertexNode *> &skipVertices) const
 {
-    VertexNode *nearest = NULL;
+    vector<VertexNode *> nearest;
+    findNearestVertices(position, 1, skipVertices, nearest);
     
-    for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
-    {
-        if (find(skipVertices.begin(), skipVertices.end(), node) != skipVertices.end())
-        {
-            continue;
-        }
-        
-        if (nearest == NULL ||
-            node->data().position.Distance(position) < nearest->data().position.Distance(position))
-        {
-            nearest = node;
-        }
-    }
+    if (nearest.empty())
+        return NULL;
+    
+    return nearest[0];
+}
+
+// The grid is built on the first query after vertices were moved or removed.
+void Mesh2::findNearestVertices(const Vector3D &position, unsigned int count, const vector<VertexNode *> &skipVertices, vector<VertexNode *> &nearest) const
+{
+    if (!_vertexGrid.isValid())
+        _vertexGrid.build(_vertices.begin(), _vertices.end());
     
-    return nearest;
+    _vertexGrid.findNearest(position, count, skipVertices, nearest);
 }
 
 TriangleNode *Mesh2::addTriangle(VertexNode *v0, VertexNode *v1, VertexNode *v2)
@@ -158,6 +170,7 @@ void Mesh2::removeTriQuad(TriangleNode *&triQuad)
 
 void Mesh2::makeTexCoords()
 {
+    invalidateMovedSelection();
     _texCoords.removeAll();
     
     for (VertexNode *vertex = _vertices.begin(), *end = _vertices.end(); vertex != end; vertex = vertex->next())
@@ -202,6 +215,8 @@ void Mesh2::makeEdges(TriangleNode *node)
 
 void Mesh2::makeEdges()
 {
+    FPProfileZone zone("Mesh2::makeEdges");
+
     _vertexEdges.removeAll();
     _texCoordEdges.removeAll();
     
@@ -215,16 +230,25 @@ void Mesh2::makeEdges()
         node->removeEdges();
     }
     
+    // edges are looked up by their vertex pair only during the full rebuild,
+    // local updates keep using the short per vertex edge lists
+    _vertexEdgeMap.clear();
+    _texCoordEdgeMap.clear();
+    _vertexEdgeMap.reserve(_triangles.count() * 2);
+    _texCoordEdgeMap.reserve(_triangles.count() * 2);
+    _useEdgeMaps = true;
+    
     for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
     {
         makeEdges(node);
     }
+    
+    _useEdgeMaps = false;
 }
 
 void Mesh2::makePlane()
 {
-    _vertices.removeAll();
-    _triangles.removeAll();
+    removeAllNodes();
     
     VertexNode *v0 = _vertices.add(Vector3D(-1, -1, 0));
 	VertexNode *v1 = _vertices.add(Vector3D(-1,  1, 0));
@@ -241,9 +265,7 @@ void Mesh2::makePlane()
 
 void Mesh2::makeCube()
 {
-    _vertices.removeAll();
-	_triangles.removeAll();
-    _texCoords.removeAll();
+    removeAllNodes();
     
 	// back vertices
 	VertexNode *v0 = _vertices.add(Vector3D(-1, -1, -1));
@@ -283,8 +305,7 @@ void Mesh2::makeCube()
 
 void Mesh2::makeCylinder(unsigned int steps)
 {
-    _vertices.removeAll();
-    _triangles.removeAll();
+    removeAllNodes();
     
     VertexNode *node0 = _vertices.add(Vector3D(0, -1, 0)); // 0
     VertexNode *node1 = _vertices.add(Vector3D(0,  1, 0)); // 1
@@ -327,8 +348,7 @@ void Mesh2::makeCylinder(unsigned int steps)
 
 void Mesh2::makeSphere(unsigned int steps)
 {
-    _vertices.removeAll();
-    _triangles.removeAll();
+    removeAllNodes();
     
     unsigned int max = steps;
     
@@ -480,41 +500,44 @@ void Mesh2::makeIcosahedron()
 void Mesh2::fromVertices(const vector<Vector3D> &vertices)
 {
     resetTriangleCache();
-    _vertices.removeAll();
-    _texCoords.removeAll();
-    _triangles.removeAll();
+    removeAllNodes();
     
     vector<VertexNode *> tempVertices;
     vector<VertexNode *> uniqueVertices;
     
     unsigned int verticesSize = static_cast<unsigned int>(vertices.size());
     
+    FPWeldGrid weldGrid(sqrtf(FLOAT_EPS), verticesSize / 4);
+    tempVertices.reserve(verticesSize);
+    
     for (unsigned int i = 0; i < verticesSize; i++)
     {
-        bool found = false;
+        unsigned int found = weldGrid.find(vertices[i]);
         
-        for (unsigned int j = 0; j < uniqueVertices.size(); j++)
+        // welding inside one triangle would make it degenerated
+        if (found != UINT_MAX)
         {
-            if (uniqueVertices[j]->data().position.SqDistance(vertices[i]) < FLOAT_EPS)
+            for (unsigned int j = i - i % 3; j < i; j++)
             {
-                VertexNode *last = tempVertices.size() > 0 ? tempVertices[tempVertices.size() - 1] : NULL;
-                VertexNode *lastPrevious = tempVertices.size() > 1 ? tempVertices[tempVertices.size() - 2] : NULL;
-                
-                if (last == uniqueVertices[j] || lastPrevious == uniqueVertices[j])
+                if (tempVertices[j] == uniqueVertices[found])
+                {
+                    found = UINT_MAX;
                     break;
-                
-                tempVertices.push_back(uniqueVertices[j]);
-                found = true;
-                break;
-            }            
+                }
+            }
         }
         
-        if (!found)
+        if (found != UINT_MAX)
+        {
+            tempVertices.push_back(uniqueVertices[found]);
+        }
+        else
         {
             VertexNode *newVertex = _vertices.add(vertices[i]);
+            weldGrid.insert(vertices[i]);
             uniqueVertices.push_back(newVertex);
             tempVertices.push_back(newVertex);
-        }        
+        }
     }
     
     VertexNode *triangleVertices[3];
@@ -548,10 +571,10 @@ void Mesh2::toVertices(vector<Vector3D> &vertices)
 
 void Mesh2::fromIndexRepresentation(const vector<Vector3D> &vertices, const vector<Vector3D> &texCoords, const vector<TriQuad> &triangles)
 {
+    FPProfileZone zone("Mesh2::fromIndexRepresentation");
+
     resetTriangleCache();
-    _vertices.removeAll();
-    _texCoords.removeAll();
-    _triangles.removeAll();
+    removeAllNodes();
     
     vector<VertexNode *> tempVertices;
     vector<TexCoordNode *> tempTexCoords;
@@ -632,6 +655,736 @@ void Mesh2::toIndexRepresentation(vector<Vector3D> &vertices, vector<Vector3D> &
     }
 }
 
+void Mesh2::fromIndexArrays(const float *positions, unsigned int vertexCount,
+                            const float *texCoords, unsigned int texCoordCount,
+                            const unsigned char *faceSizes, unsigned int faceCount,
+                            const unsigned int *vertexIndices, const unsigned int *texCoordIndices)
+{
+    FPProfileZone zone("Mesh2::fromIndexArrays");
+
+    resetTriangleCache();
+    removeAllNodes();
+    
+    vector<VertexNode *> tempVertices;
+    vector<TexCoordNode *> tempTexCoords;
+    tempVertices.reserve(vertexCount);
+    tempTexCoords.reserve(texCoordCount);
+    
+    for (unsigned int i = 0; i < vertexCount; i++)
+    {
+        const float *p = positions + i * 3;
+        tempVertices.push_back(_vertices.add(Vector3D(p[0], p[1], p[2])));
+    }
+    
+    for (unsigned int i = 0; i < texCoordCount; i++)
+    {
+        const float *p = texCoords + i * 3;
+        tempTexCoords.push_back(_texCoords.add(Vector3D(p[0], p[1], p[2])));
+    }
+    
+    VertexNode *triangleVertices[4];
+    TexCoordNode *triangleTexCoords[4];
+    
+    for (unsigned int i = 0; i < faceCount; i++)
+    {
+        bool isQuad = faceSizes[i] == 4;
+        unsigned int count = isQuad ? 4 : 3;
+        
+        for (unsigned int j = 0; j < count; j++)
+        {
+            triangleVertices[j] = tempVertices.at(vertexIndices[j]);
+            triangleTexCoords[j] = tempTexCoords.at(texCoordIndices[j]);
+        }
+        
+        _triangles.add(Triangle2(triangleVertices, triangleTexCoords, isQuad));
+        
+        vertexIndices += count;
+        texCoordIndices += count;
+    }
+    
+    makeEdges();
+    
+    setSelectionMode(_selectionMode);
+}
+
+void Mesh2::toIndexArrays(vector<float> &positions, vector<float> &texCoords, vector<unsigned char> &faceSizes,
+                          vector<unsigned int> &vertexIndices, vector<unsigned int> &texCoordIndices) const
+{
+    FPProfileZone zone("Mesh2::toIndexArrays");
+
+    positions.reserve(positions.size() + _vertices.count() * 3);
+    texCoords.reserve(texCoords.size() + _texCoords.count() * 3);
+    faceSizes.reserve(faceSizes.size() + _triangles.count());
+    
+    unsigned int index = 0;
+    
+    for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
+    {
+        node->algorithmData.index = index;
+        index++;
+        
+        const Vector3D &v = node->data().position;
+        positions.push_back(v.x);
+        positions.push_back(v.y);
+        positions.push_back(v.z);
+    }
+    
+    index = 0;
+    
+    for (TexCoordNode *node = _texCoords.begin(), *end = _texCoords.end(); node != end; node = node->next())
+    {
+        node->algorithmData.index = index;
+        index++;
+        
+        const Vector3D &v = node->data().position;
+        texCoords.push_back(v.x);
+        texCoords.push_back(v.y);
+        texCoords.push_back(v.z);
+    }
+    
+    for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
+    {
+        const Triangle2 &triangle = node->data();
+        faceSizes.push_back((unsigned char)triangle.count());
+        for (unsigned int j = 0; j < triangle.count(); j++)
+        {
+            vertexIndices.push_back(triangle.vertex(j)->algorithmData.index);
+            texCoordIndices.push_back(triangle.texCoord(j)->algorithmData.index);
+        }
+    }
+}
+
+static unsigned char patchFlags(bool selected, bool visible)
+{
+    return (selected ? MeshPatch::kSelected : 0) | (visible ? 0 : MeshPatch::kHidden);
+}
+
+template <class T>
+static void setPatchFlags(T &data, unsigned char flags)
+{
+    data.selected = (flags & MeshPatch::kSelected) != 0;
+    data.visible = (flags & MeshPatch::kHidden) == 0;
+}
+
+// only edges that are selected or hidden are kept
+template <class T>
+static void addEdgeFlags(MeshPatchVertices &patch, const VEdge<T> &edge, unsigned int first, unsigned int second)
+{
+    unsigned char flags = patchFlags(edge.selected, edge.visible);
+    if (flags == 0 || first == UINT_MAX || second == UINT_MAX)
+        return;
+    
+    Edge patchEdge;
+    patchEdge.vertexIndices[0] = first;
+    patchEdge.vertexIndices[1] = second;
+    patch.edges.push_back(patchEdge);
+    patch.edgeFlags.push_back(flags);
+}
+
+template <class T>
+static void setEdgeFlags(const MeshPatchVertices &patch, const vector<VNode<T> *> &nodes)
+{
+    for (unsigned int i = 0; i < patch.edges.size(); i++)
+    {
+        const unsigned int *indices = patch.edges[i].vertexIndices;
+        VEdgeNode<T> *edge = nodes.at(indices[0])->sharedEdge(nodes.at(indices[1]));
+        if (edge)
+            setPatchFlags(edge->data(), patch.edgeFlags[i]);
+    }
+}
+
+// walks from the nearer end, the end for an index past the last node
+template <class TNode, class T>
+static TNode *nodeAtIndex(const FPList<TNode, T> &list, unsigned int index)
+{
+    if (index >= list.count())
+        return list.end();
+    
+    TNode *node;
+    if (index < list.count() / 2)
+    {
+        node = list.begin();
+        for (unsigned int i = 0; i < index; i++)
+            node = node->next();
+    }
+    else
+    {
+        node = list.last();
+        for (unsigned int i = list.count() - 1; i > index; i--)
+            node = node->previous();
+    }
+    return node;
+}
+
+template <class TNode, class T>
+static void listNodes(const FPList<TNode, T> &list, vector<TNode *> &nodes)
+{
+    nodes.reserve(list.count());
+    
+    unsigned int index = 0;
+    for (TNode *node = list.begin(), *end = list.end(); node != end; node = node->next(), index++)
+    {
+        node->algorithmData.index = index;
+        nodes.push_back(node);
+    }
+}
+
+template <class T>
+static VNode<T> *insertPatchNode(FPList<VNode<T>, T> &list, VNode<T> *next, const MeshPatchVertices &patch, unsigned int i)
+{
+    T data(patch.positions.at(i));
+    setPatchFlags(data, patch.flags.at(i));
+    return list.insert(next, data);
+}
+
+// Moves kept nodes, sets removed ones aside to be deleted once no edge uses
+// them and links added ones at their indices. Nodes are numbered as in the
+// patched list afterwards, returns whether any was linked before a kept one.
+template <class T>
+static bool swapPatchVertices(FPList<VNode<T>, T> &list, MeshPatchVertices &patch, MeshPatchVertices &replaced,
+                              vector<VNode<T> *> &nodes, vector<VNode<T> *> &removed)
+{
+    vector<VNode<T> *> moved;
+    for (unsigned int i = 0; i < patch.moved.size(); i++)
+    {
+        VNode<T> *node = nodes.at(patch.moved[i]);
+        swap(node->data().position, patch.movedPositions.at(i));
+        moved.push_back(node);
+    }
+    
+    for (unsigned int i = 0; i < patch.removed.size(); i++)
+    {
+        VNode<T> *node = nodes.at(patch.removed[i]);
+        const T &data = node->data();
+        replaced.added.push_back(patch.removed[i]);
+        replaced.positions.push_back(data.position);
+        replaced.flags.push_back(patchFlags(data.selected, data.visible));
+        removed.push_back(node);
+    }
+    
+    // nodes in front of the first removed or added one keep their indices
+    unsigned int first = (unsigned int)nodes.size();
+    if (!patch.removed.empty())
+        first = min(first, patch.removed[0]);
+    if (!patch.added.empty())
+        first = min(first, patch.added[0]);
+    
+    vector<VNode<T> *> patched(nodes.begin(), nodes.begin() + first);
+    patched.reserve(nodes.size() - patch.removed.size() + patch.added.size());
+    
+    unsigned int r = 0;
+    unsigned int a = 0;
+    for (unsigned int i = first; i < nodes.size(); i++)
+    {
+        if (r < patch.removed.size() && patch.removed[r] == i)
+        {
+            r++;
+            continue;
+        }
+        
+        for (; a < patch.added.size() && patch.added[a] == patched.size(); a++)
+            patched.push_back(insertPatchNode(list, nodes[i], patch, a));
+        patched.push_back(nodes[i]);
+    }
+    
+    bool inserted = a > 0;
+    for (; a < patch.added.size(); a++)
+    {
+        if (patch.added[a] != patched.size())
+            throw MeshMaker::IndexOutOfRangeException();
+        patched.push_back(insertPatchNode(list, list.end(), patch, a));
+    }
+    
+    nodes.swap(patched);
+    for (unsigned int i = first; i < nodes.size(); i++)
+        nodes[i]->algorithmData.index = i;
+    
+    replaced.removed = patch.added;
+    for (unsigned int i = 0; i < moved.size(); i++)
+        replaced.moved.push_back(moved[i]->algorithmData.index);
+    replaced.movedPositions.swap(patch.movedPositions);
+    return inserted;
+}
+
+void Mesh2::swapPatch(MeshPatch &patch)
+{
+    FPProfileZone zone("Mesh2::swapPatch");
+    
+    // removed vertices go only after endLocalEdit removed their edges
+    LocalEdit edit;
+    beginLocalEdit(edit);
+    edit.keepsUnusedVertices = true;
+    resetTriangleCache();
+    
+    // the walks only number the nodes, nothing is rebuilt outside the patch
+    MeshPatch replaced;
+    vector<VertexNode *> vertices;
+    vector<TexCoordNode *> texCoords;
+    listNodes(_vertices, vertices);
+    listNodes(_texCoords, texCoords);
+    
+    // faces in front of the first removed or added one stay as they are
+    unsigned int first = _triangles.count();
+    if (!patch.removedFaces.empty())
+        first = min(first, patch.removedFaces[0]);
+    if (!patch.addedFaces.empty())
+        first = min(first, patch.addedFaces[0]);
+    TriangleNode *firstNode = nodeAtIndex(_triangles, first);
+    
+    vector<TriangleNode *> faces;
+    unsigned int index = first;
+    unsigned int i = 0;
+    for (TriangleNode *node = firstNode, *end = _triangles.end(); node != end && i < patch.removedFaces.size(); node = node->next(), index++)
+    {
+        if (patch.removedFaces[i] != index)
+            continue;
+        
+        const Triangle2 &triangle = node->data();
+        faces.push_back(node);
+        replaced.addedFaces.push_back(index);
+        replaced.faceSizes.push_back((unsigned char)triangle.count());
+        replaced.faceFlags.push_back(patchFlags(triangle.selected, triangle.visible));
+        
+        for (unsigned int j = 0; j < triangle.count(); j++)
+        {
+            replaced.vertexIndices.push_back(triangle.vertex(j)->algorithmData.index);
+            replaced.texCoordIndices.push_back(triangle.texCoord(j)->algorithmData.index);
+            
+            if (triangle.vertexEdge(j))
+            {
+                const VertexEdge &edge = triangle.vertexEdge(j)->data();
+                addEdgeFlags(replaced.vertices, edge, edge.vertex(0)->algorithmData.index, edge.vertex(1)->algorithmData.index);
+            }
+            if (triangle.texCoordEdge(j))
+            {
+                const TexCoordEdge &edge = triangle.texCoordEdge(j)->data();
+                addEdgeFlags(replaced.texCoords, edge, edge.vertex(0)->algorithmData.index, edge.vertex(1)->algorithmData.index);
+            }
+        }
+        
+        i++;
+    }
+    
+    if (i < patch.removedFaces.size())
+        throw MeshMaker::IndexOutOfRangeException();
+    
+    vector<VertexNode *> removedVertices;
+    vector<TexCoordNode *> removedTexCoords;
+    bool inserted = swapPatchVertices(_vertices, patch.vertices, replaced.vertices, vertices, removedVertices);
+    inserted = swapPatchVertices(_texCoords, patch.texCoords, replaced.texCoords, texCoords, removedTexCoords) || inserted;
+    
+    // A removed face whose slot gets an added one keeps its node, like an edit
+    // in place. Others are removed, added faces in front of kept ones are linked there.
+    VertexNode *triangleVertices[4];
+    TexCoordNode *triangleTexCoords[4];
+    unsigned int corner = 0;
+    unsigned int r = 0;
+    unsigned int a = 0;
+    unsigned int patched = first;
+    
+    for (TriangleNode *node = firstNode, *end = _triangles.end(); node != end && (r < faces.size() || a < patch.addedFaces.size());)
+    {
+        bool removed = r < faces.size() && node == faces[r];
+        bool added = a < patch.addedFaces.size() && patch.addedFaces[a] == patched;
+        
+        if (!removed && !added)
+        {
+            node = node->next();
+            patched++;
+            continue;
+        }
+        
+        if (removed && !added)
+        {
+            TriangleNode *next = node->next();
+            removeTriangle(edit, node);
+            node = next;
+            r++;
+            continue;
+        }
+        
+        unsigned int count = patch.faceSizes.at(a);
+        for (unsigned int j = 0; j < count; j++, corner++)
+        {
+            triangleVertices[j] = vertices.at(patch.vertexIndices.at(corner));
+            triangleTexCoords[j] = texCoords.at(patch.texCoordIndices.at(corner));
+        }
+        
+        Triangle2 triangle(triangleVertices, triangleTexCoords, count == 4);
+        setPatchFlags(triangle, patch.faceFlags.at(a));
+        
+        if (removed)
+        {
+            detachTriangle(edit, node);
+            node->removeFromVertices();
+            node->removeFromTexCoords();
+            node->setData(triangle);
+            node = node->next();
+            r++;
+        }
+        else
+        {
+            edit.modifiedTriangles.push_back(_triangles.insert(node, triangle));
+            inserted = true;
+        }
+        
+        a++;
+        patched++;
+    }
+    
+    // endLocalEdit makes edges of faces from the old end on
+    for (; a < patch.addedFaces.size(); a++, patched++)
+    {
+        if (patch.addedFaces[a] != patched)
+            throw MeshMaker::IndexOutOfRangeException();
+        
+        unsigned int count = patch.faceSizes.at(a);
+        for (unsigned int j = 0; j < count; j++, corner++)
+        {
+            triangleVertices[j] = vertices.at(patch.vertexIndices.at(corner));
+            triangleTexCoords[j] = texCoords.at(patch.texCoordIndices.at(corner));
+        }
+        
+        Triangle2 triangle(triangleVertices, triangleTexCoords, count == 4);
+        setPatchFlags(triangle, patch.faceFlags.at(a));
+        _triangles.add(triangle);
+    }
+    
+    endLocalEdit(edit);
+    
+    for (i = 0; i < removedVertices.size(); i++)
+        _vertices.remove(removedVertices[i]);
+    for (i = 0; i < removedTexCoords.size(); i++)
+        _texCoords.remove(removedTexCoords[i]);
+    
+    setEdgeFlags(patch.vertices, vertices);
+    setEdgeFlags(patch.texCoords, texCoords);
+    replaced.removedFaces = patch.addedFaces;
+    
+    // the caches keep list order, nodes linked in between or removed here are not in them
+    if (inserted || !removedVertices.empty() || !removedTexCoords.empty())
+        _vertexGrid.invalidate();
+    if (inserted)
+        _triangleBVH.invalidate();
+    if (inserted || (_selectionMode == MeshSelectionMode::Vertices && (!removedVertices.empty() || !removedTexCoords.empty())))
+        setSelectionMode(_selectionMode);
+    
+    patch = replaced;
+}
+
+void Mesh2::takeSnapshot(MeshSnapshot &snapshot) const
+{
+    toIndexArrays(snapshot.positions, snapshot.texCoords, snapshot.faceSizes, snapshot.vertexIndices, snapshot.texCoordIndices);
+    getSelection(snapshot.selection);
+    getVisibility(snapshot.visibility);
+    snapshot.selectionMode = _selectionMode;
+}
+
+void Mesh2::beginRecording(MeshRecording *recording)
+{
+    _recording = recording;
+}
+
+template <class TNode, class T>
+static void numberRecordedNodes(const FPList<TNode, T> &list)
+{
+    unsigned int index = 0;
+    for (TNode *node = list.begin(), *end = list.end(); node != end; node = node->next(), index++)
+        node->recordedIndex = index;
+}
+
+// The first local edit numbers the nodes, it and later ones record by these numbers.
+void Mesh2::numberRecordedNodes()
+{
+    MeshRecording &recording = *_recording;
+    recording.state = MeshRecording::State::Local;
+    recording.vertexCount = _vertices.count();
+    recording.texCoordCount = _texCoords.count();
+    recording.faceCount = _triangles.count();
+    recording.touchedFaces.assign(recording.faceCount, false);
+    recording.movedVertices.assign(recording.vertexCount, false);
+    
+    ::numberRecordedNodes(_vertices);
+    ::numberRecordedNodes(_texCoords);
+    ::numberRecordedNodes(_triangles);
+}
+
+// Called before a face changes, nodes added since recording began are left out.
+void Mesh2::recordFace(TriangleNode *node)
+{
+    if (_recording == NULL || _recording->state != MeshRecording::State::Local)
+        return;
+    
+    unsigned int index = node->recordedIndex;
+    if (index == UINT_MAX || _recording->touchedFaces[index])
+        return;
+    
+    _recording->touchedFaces[index] = true;
+    
+    MeshPatch &patch = _recording->patch;
+    const Triangle2 &triangle = node->data();
+    patch.addedFaces.push_back(index);
+    patch.faceSizes.push_back((unsigned char)triangle.count());
+    patch.faceFlags.push_back(patchFlags(triangle.selected, triangle.visible));
+    
+    for (unsigned int j = 0; j < triangle.count(); j++)
+    {
+        patch.vertexIndices.push_back(triangle.vertex(j)->recordedIndex);
+        patch.texCoordIndices.push_back(triangle.texCoord(j)->recordedIndex);
+        
+        if (triangle.vertexEdge(j))
+        {
+            const VertexEdge &edge = triangle.vertexEdge(j)->data();
+            addEdgeFlags(patch.vertices, edge, edge.vertex(0)->recordedIndex, edge.vertex(1)->recordedIndex);
+        }
+        if (triangle.texCoordEdge(j))
+        {
+            const TexCoordEdge &edge = triangle.texCoordEdge(j)->data();
+            addEdgeFlags(patch.texCoords, edge, edge.vertex(0)->recordedIndex, edge.vertex(1)->recordedIndex);
+        }
+    }
+}
+
+void Mesh2::recordRemovedFace(TriangleNode *node)
+{
+    if (_recording && _recording->state == MeshRecording::State::Local && node->recordedIndex != UINT_MAX)
+        _recording->removedFaces.push_back(node->recordedIndex);
+}
+
+void Mesh2::recordMovedVertex(VertexNode *node)
+{
+    if (_recording == NULL || _recording->state != MeshRecording::State::Local)
+        return;
+    
+    unsigned int index = node->recordedIndex;
+    if (index == UINT_MAX || _recording->movedVertices[index])
+        return;
+    
+    _recording->movedVertices[index] = true;
+    _recording->patch.vertices.moved.push_back(index);
+    _recording->patch.vertices.movedPositions.push_back(node->data().position);
+}
+
+template <class T>
+static void recordRemoved(MeshRecording *recording, MeshPatchVertices &patch, VNode<T> *node)
+{
+    if (recording == NULL || recording->state != MeshRecording::State::Local || node->recordedIndex == UINT_MAX)
+        return;
+    
+    const T &data = node->data();
+    patch.added.push_back(node->recordedIndex);
+    patch.positions.push_back(data.position);
+    patch.flags.push_back(patchFlags(data.selected, data.visible));
+}
+
+void Mesh2::recordRemovedVertex(VertexNode *node)
+{
+    if (_recording)
+        recordRemoved(_recording, _recording->patch.vertices, node);
+}
+
+void Mesh2::recordRemovedVertex(TexCoordNode *node)
+{
+    if (_recording)
+        recordRemoved(_recording, _recording->patch.texCoords, node);
+}
+
+struct IndexOrder
+{
+    const vector<unsigned int> &keys;
+    
+    IndexOrder(const vector<unsigned int> &keys) : keys(keys) { }
+    bool operator()(unsigned int a, unsigned int b) const { return keys[a] < keys[b]; }
+};
+
+struct EdgeOrder
+{
+    const vector<Edge> &edges;
+    
+    EdgeOrder(const vector<Edge> &edges) : edges(edges) { }
+    
+    pair<unsigned int, unsigned int> key(unsigned int i) const
+    {
+        const unsigned int *indices = edges[i].vertexIndices;
+        return make_pair(min(indices[0], indices[1]), max(indices[0], indices[1]));
+    }
+    
+    bool operator()(unsigned int a, unsigned int b) const { return key(a) < key(b); }
+};
+
+static void sortedOrder(const vector<unsigned int> &keys, vector<unsigned int> &order)
+{
+    order.resize(keys.size());
+    for (unsigned int i = 0; i < order.size(); i++)
+        order[i] = i;
+    sort(order.begin(), order.end(), IndexOrder(keys));
+}
+
+template <class T>
+static void reorder(vector<T> &values, const vector<unsigned int> &order)
+{
+    vector<T> ordered;
+    ordered.reserve(order.size());
+    for (unsigned int i = 0; i < order.size(); i++)
+        ordered.push_back(values[order[i]]);
+    values.swap(ordered);
+}
+
+// nodes added since recording began are after the kept ones
+static void addRecordedTail(vector<unsigned int> &indices, unsigned int recordedCount, size_t removedCount, unsigned int count)
+{
+    for (unsigned int i = recordedCount - (unsigned int)removedCount; i < count; i++)
+        indices.push_back(i);
+}
+
+// Removed vertices were recorded in the order they went, moved ones keep
+// their numbers from when recording began until they are renumbered here.
+static void finishRecordedVertices(MeshPatchVertices &patch, unsigned int recordedCount, unsigned int count)
+{
+    vector<unsigned int> order;
+    sortedOrder(patch.added, order);
+    reorder(patch.added, order);
+    reorder(patch.positions, order);
+    reorder(patch.flags, order);
+    
+    vector<unsigned int> moved;
+    vector<Vector3D> movedPositions;
+    
+    for (unsigned int i = 0; i < patch.moved.size(); i++)
+    {
+        unsigned int index = patch.moved[i];
+        vector<unsigned int>::iterator it = lower_bound(patch.added.begin(), patch.added.end(), index);
+        
+        // a vertex moved and then removed comes back where it was
+        if (it != patch.added.end() && *it == index)
+        {
+            patch.positions[it - patch.added.begin()] = patch.movedPositions[i];
+        }
+        else
+        {
+            moved.push_back(index - (unsigned int)(it - patch.added.begin()));
+            movedPositions.push_back(patch.movedPositions[i]);
+        }
+    }
+    
+    patch.moved.swap(moved);
+    patch.movedPositions.swap(movedPositions);
+    
+    patch.removed.clear();
+    addRecordedTail(patch.removed, recordedCount, patch.added.size(), count);
+    
+    // an edge keeps the flags from the first face that recorded it
+    order.resize(patch.edges.size());
+    for (unsigned int i = 0; i < order.size(); i++)
+        order[i] = i;
+    
+    EdgeOrder edgeOrder(patch.edges);
+    stable_sort(order.begin(), order.end(), edgeOrder);
+    
+    unsigned int unique = 0;
+    for (unsigned int i = 0; i < order.size(); i++)
+    {
+        if (unique == 0 || edgeOrder(order[unique - 1], order[i]))
+            order[unique++] = order[i];
+    }
+    order.resize(unique);
+    
+    reorder(patch.edges, order);
+    reorder(patch.edgeFlags, order);
+}
+
+// Turns what local edits recorded into the patch back to the state when recording began.
+static void finishRecordedPatch(MeshRecording &recording, unsigned int vertexCount, unsigned int texCoordCount, unsigned int faceCount)
+{
+    MeshPatch &patch = recording.patch;
+    
+    finishRecordedVertices(patch.vertices, recording.vertexCount, vertexCount);
+    finishRecordedVertices(patch.texCoords, recording.texCoordCount, texCoordCount);
+    
+    vector<unsigned int> corners;
+    corners.reserve(patch.faceSizes.size());
+    unsigned int corner = 0;
+    for (unsigned int i = 0; i < patch.faceSizes.size(); i++)
+    {
+        corners.push_back(corner);
+        corner += patch.faceSizes[i];
+    }
+    
+    vector<unsigned int> order;
+    sortedOrder(patch.addedFaces, order);
+    
+    vector<unsigned int> vertexIndices;
+    vector<unsigned int> texCoordIndices;
+    vertexIndices.reserve(patch.vertexIndices.size());
+    texCoordIndices.reserve(patch.texCoordIndices.size());
+    
+    for (unsigned int i = 0; i < order.size(); i++)
+    {
+        unsigned int first = corners[order[i]];
+        unsigned int last = first + patch.faceSizes[order[i]];
+        vertexIndices.insert(vertexIndices.end(), patch.vertexIndices.begin() + first, patch.vertexIndices.begin() + last);
+        texCoordIndices.insert(texCoordIndices.end(), patch.texCoordIndices.begin() + first, patch.texCoordIndices.begin() + last);
+    }
+    
+    patch.vertexIndices.swap(vertexIndices);
+    patch.texCoordIndices.swap(texCoordIndices);
+    reorder(patch.addedFaces, order);
+    reorder(patch.faceSizes, order);
+    reorder(patch.faceFlags, order);
+    
+    // faces changed in place are taken out at their current index
+    vector<unsigned int> &removed = recording.removedFaces;
+    sort(removed.begin(), removed.end());
+    
+    patch.removedFaces.clear();
+    for (unsigned int i = 0; i < patch.addedFaces.size(); i++)
+    {
+        unsigned int index = patch.addedFaces[i];
+        vector<unsigned int>::iterator it = lower_bound(removed.begin(), removed.end(), index);
+        if (it == removed.end() || *it != index)
+            patch.removedFaces.push_back(index - (unsigned int)(it - removed.begin()));
+    }
+    
+    addRecordedTail(patch.removedFaces, recording.faceCount, removed.size(), faceCount);
+}
+
+// A change outside local edits after some local ones puts the mesh back
+// for the snapshot, the recording is off meanwhile.
+void Mesh2::recordSnapshot()
+{
+    MeshRecording *recording = _recording;
+    _recording = NULL;
+    
+    if (recording->state == MeshRecording::State::Local)
+    {
+        finishRecordedPatch(*recording, _vertices.count(), _texCoords.count(), _triangles.count());
+        swapPatch(recording->patch);
+        takeSnapshot(recording->snapshot);
+        swapPatch(recording->patch);
+        
+        recording->patch = MeshPatch();
+        vector<bool>().swap(recording->touchedFaces);
+        vector<bool>().swap(recording->movedVertices);
+        vector<unsigned int>().swap(recording->removedFaces);
+    }
+    else
+    {
+        takeSnapshot(recording->snapshot);
+    }
+    
+    recording->state = MeshRecording::State::Snapshot;
+    _recording = recording;
+}
+
+void Mesh2::endRecording(MeshRecording *recording)
+{
+    if (_recording == recording)
+        _recording = NULL;
+    
+    if (recording->state == MeshRecording::State::Local)
+        finishRecordedPatch(*recording, _vertices.count(), _texCoords.count(), _triangles.count());
+}
+
 void Mesh2::setSelection(const vector<bool> &selection)
 {
     for (unsigned int i = 0; i < selection.size(); i++)
@@ -654,9 +1407,115 @@ void Mesh2::getSelection(vector<bool> &selection) const
         selection.push_back(isSelectedAtIndex(i));
 }
 
+template <class TNode, class T>
+static void numberNodes(const FPList<TNode, T> &list)
+{
+    unsigned int index = 0;
+    for (TNode *node = list.begin(), *end = list.end(); node != end; node = node->next(), index++)
+        node->algorithmData.index = index;
+}
+
+template <class TNode, class T>
+static void getHiddenIndices(const FPList<TNode, T> &list, vector<unsigned int> &hidden)
+{
+    hidden.clear();
+    unsigned int index = 0;
+    for (TNode *node = list.begin(), *end = list.end(); node != end; node = node->next(), index++)
+    {
+        if (!node->data().visible)
+            hidden.push_back(index);
+    }
+}
+
+template <class TNode, class T>
+static void setHiddenIndices(const FPList<TNode, T> &list, const vector<unsigned int> &hidden)
+{
+    unsigned int index = 0;
+    unsigned int i = 0;
+    for (TNode *node = list.begin(), *end = list.end(); node != end && i < hidden.size(); node = node->next(), index++)
+    {
+        if (index == hidden[i])
+        {
+            node->data().visible = false;
+            i++;
+        }
+    }
+}
+
+// nodes at both ends must be numbered
+template <class TNode, class T>
+static void getHiddenEdges(const FPList<TNode, T> &list, vector<Edge> &hidden)
+{
+    hidden.clear();
+    for (TNode *node = list.begin(), *end = list.end(); node != end; node = node->next())
+    {
+        const T &edge = node->data();
+        if (!edge.visible)
+        {
+            Edge hiddenEdge;
+            for (unsigned int i = 0; i < 2; i++)
+                hiddenEdge.vertexIndices[i] = edge.vertex(i)->algorithmData.index;
+            hidden.push_back(hiddenEdge);
+        }
+    }
+}
+
+template <class TNode, class T>
+static void setHiddenEdges(const FPList<TNode, T> &list, const vector<Edge> &hidden)
+{
+    if (hidden.empty())
+        return;
+    
+    vector<pair<unsigned int, unsigned int> > keys;
+    for (unsigned int i = 0; i < hidden.size(); i++)
+    {
+        const unsigned int *indices = hidden[i].vertexIndices;
+        keys.push_back(make_pair(min(indices[0], indices[1]), max(indices[0], indices[1])));
+    }
+    sort(keys.begin(), keys.end());
+    
+    for (TNode *node = list.begin(), *end = list.end(); node != end; node = node->next())
+    {
+        T &edge = node->data();
+        unsigned int first = edge.vertex(0)->algorithmData.index;
+        unsigned int second = edge.vertex(1)->algorithmData.index;
+        
+        if (binary_search(keys.begin(), keys.end(), make_pair(min(first, second), max(first, second))))
+            edge.visible = false;
+    }
+}
+
+void Mesh2::setVisibility(const MeshVisibility &visibility)
+{
+    resetTriangleCache();
+    
+    numberNodes(_vertices);
+    numberNodes(_texCoords);
+    
+    setHiddenIndices(_vertices, visibility.hiddenVertices);
+    setHiddenIndices(_texCoords, visibility.hiddenTexCoords);
+    setHiddenIndices(_triangles, visibility.hiddenTriangles);
+    setHiddenEdges(_vertexEdges, visibility.hiddenVertexEdges);
+    setHiddenEdges(_texCoordEdges, visibility.hiddenTexCoordEdges);
+}
+
+void Mesh2::getVisibility(MeshVisibility &visibility) const
+{
+    numberNodes(_vertices);
+    numberNodes(_texCoords);
+    
+    getHiddenIndices(_vertices, visibility.hiddenVertices);
+    getHiddenIndices(_texCoords, visibility.hiddenTexCoords);
+    getHiddenIndices(_triangles, visibility.hiddenTriangles);
+    getHiddenEdges(_vertexEdges, visibility.hiddenVertexEdges);
+    getHiddenEdges(_texCoordEdges, visibility.hiddenTexCoordEdges);
+}
+
 
 void Mesh2::make(MeshType meshType, unsigned int steps)
 {
+    FPProfileZone zone("Mesh2::make");
+
 	switch (meshType) 
 	{
         case MeshType::Plane:
@@ -681,9 +1540,7 @@ void Mesh2::make(MeshType meshType, unsigned int steps)
 
 void Mesh2::fillMeshFromSelectedTriangles(Mesh2 &mesh)
 {
-    mesh._vertices.removeAll();
-    mesh._texCoords.removeAll();
-    mesh._triangles.removeAll();
+    mesh.removeAllNodes();
 
     resetAlgorithmData();
     
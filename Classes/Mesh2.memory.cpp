@@ -0,0 +1,62 @@
+//
+//  Mesh2.memory.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "Mesh2.h"
+
+// every list owns two sentinel nodes
+template <class TNode, class TData>
+static size_t listBytes(const FPList<TNode, TData> &list)
+{
+    return (list.count() + 2U) * FPNodeAllocator::blockSize(sizeof(TNode));
+}
+
+template <class T>
+static size_t vectorBytes(const vector<T> &array)
+{
+    return array.capacity() * sizeof(T);
+}
+
+template <class T>
+static size_t adjacencyBytes(const FPList<VNode<T>, T> &vertices)
+{
+    // sentinels of the vertex list have empty adjacency lists too
+    size_t bytes = 4U * (FPNodeAllocator::blockSize(sizeof(VertexTriangleNode)) + FPNodeAllocator::blockSize(sizeof(VertexVEdgeNode<T>)));
+    for (VNode<T> *node = vertices.begin(), *end = vertices.end(); node != end; node = node->next())
+        bytes += listBytes(node->_triangles) + listBytes(node->_edges);
+    return bytes;
+}
+
+FPMemoryFootprint Mesh2::memoryFootprint() const
+{
+    FPMemoryFootprint footprint;
+
+    footprint.add(FPMemoryCategory::Vertices, listBytes(_vertices));
+    footprint.add(FPMemoryCategory::TexCoords, listBytes(_texCoords));
+    footprint.add(FPMemoryCategory::Triangles, listBytes(_triangles));
+    footprint.add(FPMemoryCategory::VertexEdges, listBytes(_vertexEdges));
+    footprint.add(FPMemoryCategory::TexCoordEdges, listBytes(_texCoordEdges));
+    footprint.add(FPMemoryCategory::Adjacency, adjacencyBytes(_vertices) + adjacencyBytes(_texCoords));
+    footprint.add(FPMemoryCategory::AllocatorSlack, _allocator.reservedBytes() - _allocator.usedBytes());
+
+    footprint.add(FPMemoryCategory::EdgeMaps, _vertexEdgeMap.memorySize() + _texCoordEdgeMap.memorySize());
+    footprint.add(FPMemoryCategory::SpatialIndex, _vertexGrid.memorySize() + _triangleBVH.memorySize());
+
+    footprint.add(FPMemoryCategory::SelectionCaches,
+                  vectorBytes(_cachedVertexSelection) + vectorBytes(_cachedTriangleSelection) +
+                  vectorBytes(_cachedTexCoordSelection) + vectorBytes(_cachedVertexEdgeSelection) +
+                  vectorBytes(_cachedTexCoordEdgeSelection) + vectorBytes(_movedSelection.positions) +
+                  vectorBytes(_movedSelection.weights) + vectorBytes(_movedSelection.affectedVertices));
+
+    footprint.add(FPMemoryCategory::RenderCaches,
+                  _cachedTriangleVertices.memorySize() + _cachedTriangleIndices.memorySize() +
+                  vectorBytes(_cachedCornerIndices) + vectorBytes(_cachedColorRanges) +
+                  _cachedEdgeVertices.memorySize() + _cachedEdgeTexCoords.memorySize());
+
+    footprint.add(FPMemoryCategory::Objects, sizeof(Mesh2));
+
+    return footprint;
+}
@@ -0,0 +1,249 @@
+//
+//  Mesh2.picking.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "Mesh2.h"
+
+void Mesh2::projectSelect(const FPSelectionRegion &region, const Matrix4x4 &transform, OpenGLSelectionMode selectionMode)
+{
+    FPProfileZone zone("Mesh2::projectSelect");
+
+    invalidateMovedSelection();
+
+    vector<VertexNode *> nodes;
+    vector<Vector3D> positions;
+    nodes.reserve(_vertices.count());
+    positions.reserve(_vertices.count());
+    
+    for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
+    {
+        if (!node->data().visible)
+            continue;
+        
+        nodes.push_back(node);
+        positions.push_back(node->data().position);
+    }
+    
+    if (nodes.empty())
+        return;
+    
+    bool *inside = new bool[nodes.size()];
+    region.containsPoints(transform, &positions[0], (unsigned int)positions.size(), inside);
+    
+    for (unsigned int i = 0; i < nodes.size(); i++)
+    {
+        if (!inside[i])
+            continue;
+        
+        VertexNode *node = nodes[i];
+        
+        switch (selectionMode) 
+        {
+            case OpenGLSelectionMode::Add:
+                node->data().selected = true;
+                break;
+            case OpenGLSelectionMode::Subtract:
+                node->data().selected = false;
+                break;
+            case OpenGLSelectionMode::Invert:
+                node->data().selected = !node->data().selected;
+                break;
+            default:
+                break;
+        }
+    }
+    
+    delete [] inside;
+}
+
+void Mesh2::pickTriangle(FPSoftwarePicker &picker, const Triangle2 &triangle, unsigned int id)
+{
+    Vector3D v[4];
+    
+    for (unsigned int i = 0; i < triangle.count(); i++)
+        v[i] = _isUnwrapped ? triangle.texCoord(i)->data().position : triangle.vertex(i)->data().position;
+    
+    const unsigned int *twoTriIndices = Triangle2::twoTriIndices;
+    unsigned int count = triangle.isQuad() ? 6 : 3;
+    
+    for (unsigned int i = 0; i < count; i += 3)
+    {
+        const Vector3D &a = v[twoTriIndices[i]];
+        const Vector3D &b = v[twoTriIndices[i + 1]];
+        const Vector3D &c = v[twoTriIndices[i + 2]];
+        
+        if (id == 0)
+            picker.addOccluder(a, b, c);
+        else
+            picker.addTriangle(a, b, c, id);
+    }
+}
+
+// same geometry as drawFill, id zero makes an occluder
+void Mesh2::pickFill(FPSoftwarePicker &picker, unsigned int id)
+{
+    for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
+    {
+        if (node->data().visible)
+            pickTriangle(picker, node->data(), id);
+    }
+}
+
+// same ids as drawAll with forSelection
+void Mesh2::pickAll(FPSoftwarePicker &picker)
+{
+    FPProfileZone zone("Mesh2::pickAll");
+
+    picker.setDepthTest(!_selectThrough);
+    
+    unsigned int colorIndex = 0;
+    
+    switch (_selectionMode)
+    {
+        case MeshSelectionMode::Vertices:
+        {
+            if (!_selectThrough && !_isUnwrapped)
+                pickFill(picker, 0);
+            
+            picker.setPointSize(4.0f);
+            
+            if (_isUnwrapped)
+            {
+                for (TexCoordNode *node = _texCoords.begin(), *end = _texCoords.end(); node != end; node = node->next())
+                {
+                    colorIndex++;
+                    if (node->data().visible)
+                        picker.addPoint(node->data().position, colorIndex);
+                }
+            }
+            else
+            {
+                for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
+                {
+                    colorIndex++;
+                    if (node->data().visible)
+                        picker.addPoint(node->data().position, colorIndex);
+                }
+            }
+        } break;
+        case MeshSelectionMode::Triangles:
+        {
+            for (unsigned int i = 0; i < _cachedTriangleSelection.size(); i++)
+            {
+                const Triangle2 &triangle = _cachedTriangleSelection[i]->data();
+                if (triangle.visible)
+                    pickTriangle(picker, triangle, i + 1);
+            }
+        } break;
+        case MeshSelectionMode::Edges:
+        {
+            if (!_selectThrough && !_isUnwrapped)
+                pickFill(picker, 0);
+            
+            if (_isUnwrapped)
+            {
+                for (TexCoordEdgeNode *node = _texCoordEdges.begin(), *end = _texCoordEdges.end(); node != end; node = node->next())
+                {
+                    colorIndex++;
+                    const TexCoordEdge &edge = node->data();
+                    if (edge.visible)
+                        picker.addLine(edge.texCoord(0)->data().position, edge.texCoord(1)->data().position, colorIndex);
+                }
+            }
+            else
+            {
+                for (VertexEdgeNode *node = _vertexEdges.begin(), *end = _vertexEdges.end(); node != end; node = node->next())
+                {
+                    colorIndex++;
+                    const VertexEdge &edge = node->data();
+                    if (edge.visible)
+                        picker.addLine(edge.vertex(0)->data().position, edge.vertex(1)->data().position, colorIndex);
+                }
+            }
+        } break;
+    }
+}
+
+void Mesh2::uvToPixels(float &u, float &v)
+{
+//    u *= (float)_texture.width;
+//    v *= (float)_texture.height;
+//    
+//    v = (float)_texture.height - v;
+}
+
+void Mesh2::prepareTriangleBVH()
+{
+    FPProfileZone zone("Mesh2::prepareTriangleBVH");
+
+    if (!_triangleBVH.isValid())
+        _triangleBVH.build(_triangles.begin(), _triangles.end());
+    else if (_triangleBVH.needsRefit())
+        _triangleBVH.refit();
+}
+
+void Mesh2::hitToPixels(const TriangleHit &hit, float &u, float &v)
+{
+    const Triangle2 &triangle = hit.triangle->data();
+    
+    Vector3D t0 = triangle.texCoord(Triangle2::twoTriIndices[hit.part * 3])->data().position;
+    Vector3D t1 = triangle.texCoord(Triangle2::twoTriIndices[hit.part * 3 + 1])->data().position;
+    Vector3D t2 = triangle.texCoord(Triangle2::twoTriIndices[hit.part * 3 + 2])->data().position;
+    
+    Vector3D final = t0 + (t1 - t0) * hit.u + (t2 - t0) * hit.v;
+    
+    u = final.x;
+    v = final.y;
+    uvToPixels(u, v);
+}
+
+bool Mesh2::rayIntersect(const Vector3D &origin, const Vector3D &direction, TriangleHit &hit)
+{
+    prepareTriangleBVH();
+    return _triangleBVH.closestHit(origin, direction, hit);
+}
+
+bool Mesh2::rayIntersectsAny(const Vector3D &origin, const Vector3D &direction, float maxDistance)
+{
+    prepareTriangleBVH();
+    return _triangleBVH.anyHit(origin, direction, maxDistance);
+}
+
+TriangleNode *Mesh2::rayToUV(const Vector3D &origin, const Vector3D &direction, float &u, float &v)
+{
+    u = 0.0f;
+    v = 0.0f;
+    
+    TriangleHit hit;
+    if (!rayIntersect(origin, direction, hit))
+        return NULL;
+    
+    hitToPixels(hit, u, v);
+    return hit.triangle;
+}
+
+// Casts a whole brush footprint at once, missed rays get a NULL triangle.
+void Mesh2::raysToUV(const vector<Vector3D> &origins, const vector<Vector3D> &directions, vector<TriangleNode *> &triangles, vector<float> &us, vector<float> &vs)
+{
+    prepareTriangleBVH();
+    
+    vector<TriangleHit> hits;
+    _triangleBVH.closestHits(origins, directions, hits);
+    
+    triangles.resize(hits.size());
+    us.resize(hits.size());
+    vs.resize(hits.size());
+    
+    for (unsigned int i = 0; i < hits.size(); i++)
+    {
+        triangles[i] = hits[i].triangle;
+        us[i] = 0.0f;
+        vs[i] = 0.0f;
+        
+        if (hits[i].triangle)
+            hitToPixels(hits[i], us[i], vs[i]);
+    }
+}
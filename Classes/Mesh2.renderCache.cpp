@@ -0,0 +1,586 @@
+//
+//  Mesh2.renderCache.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "Mesh2.h"
+#include "FPParallel.h"
+
+void Mesh2::resetTriangleCache()
+{
+    FPProfileZone zone("Mesh2::resetTriangleCache");
+
+    // edits outside local edits start here, a recording keeps the whole mesh before them
+    if (_recording && !_recording->inLocalEdit && _recording->state != MeshRecording::State::Snapshot)
+        recordSnapshot();
+
+    _cachedTriangleVertices.setValid(false);
+    _vertexGrid.invalidate();
+    _triangleBVH.invalidate();
+    invalidateMovedSelection();
+    resetEdgeCache();
+}
+
+// Vertices moved but the triangles stayed the same, so the BVH is only refitted.
+void Mesh2::resetMovedTriangleCache()
+{
+    _cachedTriangleVertices.setValid(false);
+    _vertexGrid.invalidate();
+    _triangleBVH.setNeedsRefit();
+    resetEdgeCache();
+}
+
+void Mesh2::resetEdgeCache()
+{
+    _cachedEdgeVertices.setValid(false);
+    _cachedEdgeTexCoords.setValid(false);
+}
+
+static const unsigned int kSoftSelectionLevels = 64;
+
+static inline short packNormalComponent(float value)
+{
+    return (short)(max(-1.0f, min(1.0f, value)) * 32767.0f);
+}
+
+// 0 is the mesh color, then selected or soft selected colors
+static inline unsigned int colorGroup(TriangleNode *node, bool useSoftSelection, float minimumSelectionWeight)
+{
+    if (useSoftSelection)
+    {
+        if (node->selectionWeight > minimumSelectionWeight)
+            return 1 + (unsigned int)(min(node->selectionWeight, 1.0f) * (kSoftSelectionLevels - 1) + 0.5f);
+        return 0;
+    }
+    
+    return node->data().selected ? 1 : 0;
+}
+
+void Mesh2::colorOfGroup(unsigned int group, float color[3]) const
+{
+    if (group == 0)
+    {
+        for (unsigned int k = 0; k < 3; k++)
+            color[k] = _colorComponents[k];
+    }
+    else if (_useSoftSelection)
+    {
+        color[0] = 1.0f;
+        color[1] = 1.0f - (float)(group - 1) / (kSoftSelectionLevels - 1);
+        color[2] = 0.0f;
+    }
+    else
+    {
+        color[0] = 0.7f;
+        color[1] = 0.0f;
+        color[2] = 0.0f;
+    }
+}
+
+struct ComputeFaceNormals
+{
+    const vector<TriangleNode *> &faces;
+    vector<unsigned char> &groups;
+    bool useSoftSelection;
+    float minimumSelectionWeight;
+    
+    ComputeFaceNormals(const vector<TriangleNode *> &faces, vector<unsigned char> &groups, bool useSoftSelection, float minimumSelectionWeight) :
+        faces(faces), groups(groups), useSoftSelection(useSoftSelection), minimumSelectionWeight(minimumSelectionWeight) { }
+    
+    void operator()(unsigned int begin, unsigned int end)
+    {
+        for (unsigned int face = begin; face < end; face++)
+        {
+            Triangle2 &triangle = faces[face]->data();
+            triangle.normalsAreValid = false;
+            triangle.computeNormalsIfNeeded();
+            groups[face] = (unsigned char)colorGroup(faces[face], useSoftSelection, minimumSelectionWeight);
+        }
+    }
+};
+
+struct ComputeTexCoordNormals
+{
+    const vector<TexCoordNode *> &nodes;
+    
+    ComputeTexCoordNormals(const vector<TexCoordNode *> &nodes) : nodes(nodes) { }
+    
+    void operator()(unsigned int begin, unsigned int end)
+    {
+        for (unsigned int i = begin; i < end; i++)
+            nodes[i]->computeNormal();
+    }
+};
+
+static const unsigned int kFirstCorner = 0x80000000U;
+
+// Every distinct texture coordinate around a vertex in visible triangles
+// becomes one cache vertex. For each corner this stores the vertex and the
+// rank of its texture coordinate, the corner that found it first is marked.
+// The vertex normal is computed here too, while its triangles are in cache.
+struct RankVertexCorners
+{
+    const vector<VertexNode *> &vertices;
+    vector<unsigned int> &vertexStarts;
+    vector<unsigned int> &cornerRanks;
+    vector<unsigned int> &cornerVertices;
+    
+    RankVertexCorners(const vector<VertexNode *> &vertices, vector<unsigned int> &vertexStarts,
+                      vector<unsigned int> &cornerRanks, vector<unsigned int> &cornerVertices) :
+        vertices(vertices), vertexStarts(vertexStarts), cornerRanks(cornerRanks), cornerVertices(cornerVertices) { }
+    
+    void operator()(unsigned int begin, unsigned int end)
+    {
+        vector<TexCoordNode *> texCoords;
+        
+        for (unsigned int i = begin; i < end; i++)
+        {
+            VertexNode *vertex = vertices[i];
+            vertex->computeNormal();
+            texCoords.clear();
+            
+            for (VertexTriangleNode *node = vertex->_triangles.begin(), *nodeEnd = vertex->_triangles.end(); node != nodeEnd; node = node->next())
+            {
+                TriangleNode *triangleNode = node->data();
+                const Triangle2 &triangle = triangleNode->data();
+                if (!triangle.visible)
+                    continue;
+                
+                // a degenerate triangle is in the list once for every corner with the vertex
+                unsigned int corner = 0;
+                while (triangle.vertex(corner) != vertex || cornerVertices[triangleNode->cacheIndex * 4 + corner] == i)
+                    corner++;
+                
+                TexCoordNode *texCoord = triangle.texCoord(corner);
+                
+                unsigned int rank = 0;
+                while (rank < texCoords.size() && texCoords[rank] != texCoord)
+                    rank++;
+                
+                unsigned int slot = triangleNode->cacheIndex * 4 + corner;
+                
+                if (rank == texCoords.size())
+                {
+                    texCoords.push_back(texCoord);
+                    cornerRanks[slot] = rank | kFirstCorner;
+                }
+                else
+                {
+                    cornerRanks[slot] = rank;
+                }
+                cornerVertices[slot] = i;
+            }
+            
+            vertexStarts[i] = (unsigned int)texCoords.size();
+        }
+    }
+};
+
+// Turns corner ranks into cache indices in place, fills each cache vertex
+// from its first corner and writes the triangle indices of every face.
+struct EmitTriangleCorners
+{
+    const vector<TriangleNode *> &faces;
+    const vector<unsigned int> &faceStarts;
+    const vector<unsigned int> &vertexStarts;
+    const vector<unsigned int> &cornerVertices;
+    vector<unsigned int> &cornerIndices;
+    GLTriangleVertex *cachedVertices;
+    unsigned int *indices;
+    bool isUnwrapped;
+    
+    EmitTriangleCorners(const vector<TriangleNode *> &faces, const vector<unsigned int> &faceStarts,
+                        const vector<unsigned int> &vertexStarts, const vector<unsigned int> &cornerVertices,
+                        vector<unsigned int> &cornerIndices, GLTriangleVertex *cachedVertices, unsigned int *indices, bool isUnwrapped) :
+        faces(faces), faceStarts(faceStarts), vertexStarts(vertexStarts), cornerVertices(cornerVertices),
+        cornerIndices(cornerIndices), cachedVertices(cachedVertices), indices(indices), isUnwrapped(isUnwrapped) { }
+    
+    void operator()(unsigned int begin, unsigned int end)
+    {
+        const unsigned int *twoTriIndices = Triangle2::twoTriIndices;
+        
+        for (unsigned int face = begin; face < end; face++)
+        {
+            const Triangle2 &triangle = faces[face]->data();
+            if (!triangle.visible)
+                continue;
+            
+            unsigned int *corners = &cornerIndices[face * 4];
+            
+            for (unsigned int j = 0; j < triangle.count(); j++)
+            {
+                unsigned int rank = corners[j];
+                unsigned int cacheIndex = vertexStarts[cornerVertices[face * 4 + j]] + (rank & ~kFirstCorner);
+                
+                if (rank & kFirstCorner)
+                    fillVertex(cachedVertices[cacheIndex], triangle.vertex(j), triangle.texCoord(j));
+                
+                corners[j] = cacheIndex;
+            }
+            
+            unsigned int *output = indices + faceStarts[face];
+            unsigned int count = triangle.isQuad() ? 6 : 3;
+            
+            for (unsigned int j = 0; j < count; j++)
+                output[j] = corners[twoTriIndices[j]];
+        }
+    }
+    
+    void fillVertex(GLTriangleVertex &cachedVertex, VertexNode *vertex, TexCoordNode *texCoord)
+    {
+        const Vector3D &v = vertex->data().position;
+        const Vector3D &t = texCoord->data().position;
+        const Vector3D &sn = isUnwrapped ? texCoord->algorithmData.normal : vertex->algorithmData.normal;
+        
+        for (unsigned int k = 0; k < 3; k++)
+        {
+            cachedVertex.position.coords[k] = v[k];
+            cachedVertex.smoothNormal[k] = packNormalComponent(sn[k]);
+        }
+        cachedVertex.smoothNormal[3] = 0;
+        cachedVertex.texCoord.coords[0] = t.x;
+        cachedVertex.texCoord.coords[1] = t.y;
+    }
+};
+
+// Normals, cache vertices and indices are computed in parallel passes over
+// flat arrays of the nodes. Output slices come from exclusive prefix sums
+// of the per vertex and per face counts, so every thread writes its own part.
+void Mesh2::fillTriangleCache()
+{
+    FPProfileZone zone("Mesh2::fillTriangleCache");
+
+    if (_cachedTriangleVertices.isValid())
+        return;
+    
+    vector<TriangleNode *> faces;
+    faces.reserve(_triangles.count());
+    for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
+    {
+        node->cacheIndex = (unsigned int)faces.size();
+        faces.push_back(node);
+    }
+    
+    vector<VertexNode *> vertices;
+    vertices.reserve(_vertices.count());
+    for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
+        vertices.push_back(node);
+    
+    unsigned int faceCount = (unsigned int)faces.size();
+    unsigned int vertexCount = (unsigned int)vertices.size();
+    
+    vector<unsigned char> groups(faceCount);
+    ComputeFaceNormals faceNormals(faces, groups, _useSoftSelection, _minimumSelectionWeight);
+    FPParallel::forRange(faceCount, faceNormals);
+    
+    // texture coordinate normals are only drawn in the unwrapped view
+    if (_isUnwrapped)
+    {
+        vector<TexCoordNode *> texCoords;
+        texCoords.reserve(_texCoords.count());
+        for (TexCoordNode *node = _texCoords.begin(), *end = _texCoords.end(); node != end; node = node->next())
+            texCoords.push_back(node);
+        
+        ComputeTexCoordNormals texCoordNormals(texCoords);
+        FPParallel::forRange((unsigned int)texCoords.size(), texCoordNormals);
+    }
+    
+    vector<unsigned int> vertexStarts(vertexCount + 1, 0);
+    vector<unsigned int> cornerVertices(faceCount * 4, UINT_MAX);
+    _cachedCornerIndices.resize(faceCount * 4);
+    
+    RankVertexCorners rankCorners(vertices, vertexStarts, _cachedCornerIndices, cornerVertices);
+    FPParallel::forRange(vertexCount, rankCorners);
+    
+    unsigned int cachedVertexCount = 0;
+    for (unsigned int i = 0; i <= vertexCount; i++)
+    {
+        unsigned int count = vertexStarts[i];
+        vertexStarts[i] = cachedVertexCount;
+        cachedVertexCount += count;
+    }
+    
+    // indices are grouped by color, so every group is one draw call
+    unsigned int groupCount = _useSoftSelection ? kSoftSelectionLevels + 1 : 2;
+    vector<unsigned int> groupStarts(groupCount + 1, 0);
+    
+    for (unsigned int face = 0; face < faceCount; face++)
+    {
+        const Triangle2 &triangle = faces[face]->data();
+        if (triangle.visible)
+            groupStarts[groups[face] + 1] += triangle.isQuad() ? 6 : 3;
+    }
+    
+    for (unsigned int group = 0; group < groupCount; group++)
+        groupStarts[group + 1] += groupStarts[group];
+    
+    unsigned int indexCount = groupStarts[groupCount];
+    
+    _cachedColorRanges.clear();
+    for (unsigned int group = 0; group < groupCount; group++)
+    {
+        if (groupStarts[group + 1] == groupStarts[group])
+            continue;
+        
+        GLColorRange range;
+        colorOfGroup(group, range.color);
+        range.start = groupStarts[group];
+        range.count = groupStarts[group + 1] - groupStarts[group];
+        _cachedColorRanges.push_back(range);
+    }
+    
+    vector<unsigned int> faceStarts(faceCount);
+    for (unsigned int face = 0; face < faceCount; face++)
+    {
+        const Triangle2 &triangle = faces[face]->data();
+        unsigned int &start = groupStarts[groups[face]];
+        faceStarts[face] = start;
+        if (triangle.visible)
+            start += triangle.isQuad() ? 6 : 3;
+    }
+    
+    _cachedTriangleVertices.resize(cachedVertexCount);
+    _cachedTriangleIndices.resize(indexCount);
+    
+    EmitTriangleCorners emitCorners(faces, faceStarts, vertexStarts, cornerVertices, _cachedCornerIndices,
+                                    _cachedTriangleVertices, _cachedTriangleIndices, _isUnwrapped);
+    FPParallel::forRange(faceCount, emitCorners);
+    
+    _cachedTriangleVertices.setValid(true);
+    _cachedTriangleVertices.markAllDirty();
+    _cachedTriangleIndices.setValid(true);
+    _cachedTriangleIndices.markAllDirty();
+}
+
+void Mesh2::fillEdgeCache()
+{
+    FPProfileZone zone("Mesh2::fillEdgeCache");
+
+    if (_cachedEdgeVertices.isValid() && _cachedEdgeTexCoords.isValid())
+        return;
+    
+    _cachedEdgeVertices.resize(_vertexEdges.count() * 2);
+    _cachedEdgeTexCoords.resize(_texCoordEdges.count() * 2);
+    
+    Vector3D selectedColor(0.8f, 0.0f, 0.0f);
+    Vector3D normalColor(_colorComponents[0] - 0.2f, _colorComponents[1] - 0.2f, _colorComponents[2] - 0.2f);
+    
+    unsigned int i = 0;
+    
+    for (VertexEdgeNode *node = _vertexEdges.begin(), *end = _vertexEdges.end(); node != end; node = node->next())
+    {
+        if (!node->data().visible)
+            continue;
+        
+        if (_useSoftSelection)
+        {
+            if (node->selectionWeight > _minimumSelectionWeight)
+            {
+                Vector3D softSelectedColor = Vector3D(1.0f, 1.0f - node->selectionWeight, 0.0f);
+                
+                for (unsigned int k = 0; k < 3; k++)
+                {
+                    _cachedEdgeVertices[i].color.coords[k] = softSelectedColor[k];
+                    _cachedEdgeVertices[i + 1].color.coords[k] = softSelectedColor[k];
+                }
+            }
+            else
+            {
+                for (unsigned int k = 0; k < 3; k++)
+                {
+                    _cachedEdgeVertices[i].color.coords[k] = normalColor[k];
+                    _cachedEdgeVertices[i + 1].color.coords[k] = normalColor[k];
+                }
+            }
+        }
+        else
+        {
+            if (node->data().selected)
+            {
+                for (unsigned int k = 0; k < 3; k++)
+                {
+                    _cachedEdgeVertices[i].color.coords[k] = selectedColor[k];
+                    _cachedEdgeVertices[i + 1].color.coords[k] = selectedColor[k];
+                }
+            }
+            else
+            {
+                for (unsigned int k = 0; k < 3; k++)
+                {
+                    _cachedEdgeVertices[i].color.coords[k] = normalColor[k];
+                    _cachedEdgeVertices[i + 1].color.coords[k] = normalColor[k];
+                }
+            }
+        }
+        
+        VertexNode *v0 = node->data().vertex(0);
+        VertexNode *v1 = node->data().vertex(1);
+        
+        v0->setCacheIndexForEdgeNode(node, i);
+        v1->setCacheIndexForEdgeNode(node, i + 1);
+        
+        for (unsigned int k = 0; k < 3; k++)
+        {
+            _cachedEdgeVertices[i].position.coords[k] = v0->data().position[k];
+            _cachedEdgeVertices[i + 1].position.coords[k] = v1->data().position[k];
+        }
+        
+        i += 2;
+    }
+    
+    _cachedEdgeVertices.resize(i); // resize doesn't delete [] internal array, if not needed
+    _cachedEdgeVertices.setValid(true);
+    _cachedEdgeVertices.markAllDirty();
+    
+    i = 0;
+    
+    for (TexCoordEdgeNode *node = _texCoordEdges.begin(), *end = _texCoordEdges.end(); node != end; node = node->next())
+    {
+        if (!node->data().visible)
+            continue;
+        
+        if (node->data().selected)
+        {
+            for (unsigned int k = 0; k < 3; k++)
+            {
+                _cachedEdgeTexCoords[i].color.coords[k] = selectedColor[k];
+                _cachedEdgeTexCoords[i + 1].color.coords[k] = selectedColor[k];
+            }
+        }
+        else
+        {
+            for (unsigned int k = 0; k < 3; k++)
+            {
+                _cachedEdgeTexCoords[i].color.coords[k] = normalColor[k];
+                _cachedEdgeTexCoords[i + 1].color.coords[k] = normalColor[k];
+            }
+        }
+        
+        for (unsigned int k = 0; k < 3; k++)
+        {
+            _cachedEdgeTexCoords[i].position.coords[k] = node->data().texCoord(0)->data().position[k];
+            _cachedEdgeTexCoords[i + 1].position.coords[k] = node->data().texCoord(1)->data().position[k];
+        }
+        
+        i += 2;
+    }
+    
+    _cachedEdgeTexCoords.resize(i); // resize doesn't delete [] internal array, if not needed
+    _cachedEdgeTexCoords.setValid(true);
+}
+
+void Mesh2::updateVertexInTriangleCache(VertexNode *vertexNode, VertexTriangleNode *triangleNode)
+{
+    if (!_cachedTriangleVertices.isValid())
+        return;
+    
+    const Triangle2 &triangle = triangleNode->data()->data();
+    if (!triangle.visible)
+        return;
+    
+    const Vector3D &v = vertexNode->data().position;
+	const Vector3D &sn = vertexNode->algorithmData.normal;
+    
+    // every corner with the vertex, a degenerate triangle can have more of them
+    for (unsigned int corner = 0; corner < triangle.count(); corner++)
+    {
+        if (triangle.vertex(corner) != vertexNode)
+            continue;
+        
+        unsigned int cacheIndex = _cachedCornerIndices[triangleNode->data()->cacheIndex * 4 + corner];
+        
+        GLTriangleVertex &cachedVertex = _cachedTriangleVertices[cacheIndex];
+        _cachedTriangleVertices.markDirty(cacheIndex);
+        
+        for (unsigned int k = 0; k < 3; k++)
+        {
+            cachedVertex.position.coords[k] = v[k];
+            cachedVertex.smoothNormal[k] = packNormalComponent(sn[k]);
+        }
+    }
+}
+
+void Mesh2::updateVertexInEdgeCache(VertexNode *vertexNode, Vertex2VEdgeNode *edgeNode)
+{
+    int cacheIndex = edgeNode->cacheIndex;
+    if (cacheIndex < 0)
+        return;
+    
+    const Vector3D &v = vertexNode->data().position;
+    
+    GLEdgeVertex &cachedVertex = _cachedEdgeVertices[cacheIndex];
+    _cachedEdgeVertices.markDirty(cacheIndex);
+    
+    for (unsigned int k = 0; k < 3; k++)
+    {
+        cachedVertex.position.coords[k] = v[k];
+    }
+}
+
+// Adds the unmoved neighbours of the moved vertices, returns false when
+// so many vertices move that refilling the whole cache is cheaper.
+bool Mesh2::addAffectedVertices(vector<VertexNode *> &affectedVertices)
+{
+    unsigned int count = static_cast<unsigned int>(affectedVertices.size());
+    
+    if (count > vertexCount() / 3)
+        return false;
+    
+    for (unsigned int i = 0; i < count; i++)
+    {
+        VertexNode *vertexNode = affectedVertices[i];
+        vertexNode->addAffectedVertices(affectedVertices);
+    }
+    
+    return true;
+}
+
+void Mesh2::updateTriangleAndEdgeCache(vector<VertexNode *> &affectedVertices)
+{
+    if (addAffectedVertices(affectedVertices))
+        updateAffectedTriangleAndEdgeCache(affectedVertices);
+    else
+        resetMovedTriangleCache();
+}
+
+void Mesh2::updateAffectedTriangleAndEdgeCache(const vector<VertexNode *> &affectedVertices)
+{
+    FPProfileZone zone("Mesh2::updateTriangleAndEdgeCache");
+
+    unsigned int count = static_cast<unsigned int>(affectedVertices.size());
+    
+    _vertexGrid.invalidate();
+    _triangleBVH.setNeedsRefit();
+    
+    for (unsigned int i = 0; i < count; i++)
+    {
+        VertexNode *vertexNode = affectedVertices[i];
+        vertexNode->updateTriangleNormals();
+    }
+    
+    for (unsigned int i = 0; i < count; i++)
+    {
+        VertexNode *vertexNode = affectedVertices[i];
+        vertexNode->computeNormal();
+        
+        for (VertexTriangleNode
+             *triangleNode = vertexNode->_triangles.begin(),
+             *triangleEnd = vertexNode->_triangles.end();
+             triangleNode != triangleEnd;
+             triangleNode = triangleNode->next())
+        {
+            updateVertexInTriangleCache(vertexNode, triangleNode);
+        }
+        
+        for (Vertex2VEdgeNode
+             *edgeNode = vertexNode->_edges.begin(),
+             *edgeEnd = vertexNode->_edges.end();
+             edgeNode != edgeEnd;
+             edgeNode = edgeNode->next())
+        {
+            updateVertexInEdgeCache(vertexNode, edgeNode);
+        }
+    }
+}
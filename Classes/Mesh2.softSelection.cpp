@@ -0,0 +1,277 @@
+//
+//  Mesh2.softSelection.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "Mesh2.h"
+#include <queue>
+#include <cfloat>
+
+// All selected nodes start one breadth first search together, so every
+// node is reached once at its shortest step count and gets that weight.
+// During the search a negative selectionWeight marks unreached nodes.
+
+struct VertexNeighbours
+{
+    void operator()(VertexNode *node, vector<VertexNode *> &next) const
+    {
+        for (Vertex2VEdgeNode *edgeNode = node->_edges.begin(), *end = node->_edges.end(); edgeNode != end; edgeNode = edgeNode->next())
+            next.push_back(edgeNode->data()->data().opposite(node));
+    }
+};
+
+struct TriangleNeighbours
+{
+    void operator()(TriangleNode *node, vector<TriangleNode *> &next) const
+    {
+        Triangle2 &triangle = node->data();
+        for (unsigned int i = 0; i < triangle.count(); i++)
+        {
+            TriangleNode *opposite = triangle.vertexEdge(i)->data().opposite(node);
+            if (opposite != NULL)
+                next.push_back(opposite);
+        }
+    }
+};
+
+// edges continue along quad loops
+struct EdgeNeighbours
+{
+    void operator()(VertexEdgeNode *node, vector<VertexEdgeNode *> &next) const
+    {
+        VertexEdge &edge = node->data();
+        for (unsigned int i = 0; i < 2; i++)
+        {
+            TriangleNode *quad = edge.triangle(i);
+            if (quad != NULL && quad->data().isQuad())
+            {
+                VertexEdgeNode *edgeNode = quad->data().nextEdgeInQuadLoop(edge);
+                if (edgeNode != NULL)
+                    next.push_back(edgeNode);
+            }
+        }
+    }
+};
+
+template <class TNode, class TNeighbours>
+static void softSelectSteps(TNode *begin, TNode *end, const TNeighbours &neighbours, const vector<float> &weights)
+{
+    vector<TNode *> current;
+    vector<TNode *> next;
+    vector<TNode *> candidates;
+
+    for (TNode *node = begin; node != end; node = node->next())
+    {
+        if (node->data().selected)
+        {
+            node->selectionWeight = weights[0];
+            current.push_back(node);
+        }
+        else
+        {
+            node->selectionWeight = -1.0f;
+        }
+    }
+
+    for (unsigned int step = 1; step < weights.size() && !current.empty(); step++)
+    {
+        next.clear();
+
+        for (unsigned int i = 0; i < current.size(); i++)
+        {
+            candidates.clear();
+            neighbours(current[i], candidates);
+
+            for (unsigned int j = 0; j < candidates.size(); j++)
+            {
+                if (candidates[j]->selectionWeight < 0.0f)
+                {
+                    candidates[j]->selectionWeight = weights[step];
+                    next.push_back(candidates[j]);
+                }
+            }
+        }
+
+        current.swap(next);
+    }
+
+    for (TNode *node = begin; node != end; node = node->next())
+    {
+        if (node->selectionWeight < 0.0f)
+            node->selectionWeight = 0.0f;
+    }
+}
+
+// The weight table is spread evenly over the radius and interpolated.
+static float weightAtDistance(const vector<float> &weights, float distance, float radius)
+{
+    if (distance <= 0.0f)
+        return weights[0];
+    if (distance >= radius || weights.size() < 2)
+        return 0.0f;
+
+    float position = distance / radius * (float)(weights.size() - 1);
+    unsigned int i = (unsigned int)position;
+    float t = position - (float)i;
+    return weights[i] * (1.0f - t) + weights[i + 1] * t;
+}
+
+void Mesh2::computeSoftSelection()
+{
+    FPProfileZone zone("Mesh2::computeSoftSelection");
+
+    invalidateMovedSelection();
+
+    if (!_useSoftSelection)
+        return;
+
+    for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
+        node->selectionWeight = 0.0f;
+
+    for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
+        node->selectionWeight = 0.0f;
+
+    for (VertexEdgeNode *node = _vertexEdges.begin(), *end = _vertexEdges.end(); node != end; node = node->next())
+        node->selectionWeight = 0.0f;
+
+    switch (_selectionMode)
+    {
+        case MeshSelectionMode::Vertices:
+            if (_softSelectionFalloff == SoftSelectionFalloff::Geodesic)
+                computeSoftSelectionGeodesic();
+            else if (_softSelectionFalloff == SoftSelectionFalloff::Euclidean)
+                computeSoftSelectionEuclidean();
+            else
+                computeSoftSelectionVertices();
+            break;
+        case MeshSelectionMode::Triangles:
+            computeSoftSelectionTriangles();
+            break;
+        case MeshSelectionMode::Edges:
+            computeSoftSelectionEdges();
+            break;
+    }
+}
+
+void Mesh2::computeSoftSelectionVertices()
+{
+    VertexNeighbours neighbours;
+    softSelectSteps(_vertices.begin(), _vertices.end(), neighbours, selectionWeights());
+}
+
+// Dijkstra from all selected vertices along edge lengths, selectionWeight
+// holds the distance until the search is done.
+void Mesh2::computeSoftSelectionGeodesic()
+{
+    typedef pair<float, VertexNode *> QueueItem;
+    priority_queue<QueueItem, vector<QueueItem>, greater<QueueItem> > queue;
+
+    const vector<float> &weights = selectionWeights();
+    float radius = _softSelectionRadius;
+
+    for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
+    {
+        if (node->data().selected)
+        {
+            node->selectionWeight = 0.0f;
+            queue.push(QueueItem(0.0f, node));
+        }
+        else
+        {
+            node->selectionWeight = FLT_MAX;
+        }
+    }
+
+    while (!queue.empty())
+    {
+        QueueItem item = queue.top();
+        queue.pop();
+
+        VertexNode *node = item.second;
+        if (item.first > node->selectionWeight)
+            continue;
+
+        for (Vertex2VEdgeNode *edgeNode = node->_edges.begin(), *end = node->_edges.end(); edgeNode != end; edgeNode = edgeNode->next())
+        {
+            VertexNode *opposite = edgeNode->data()->data().opposite(node);
+            float distance = item.first + node->data().position.Distance(opposite->data().position);
+
+            if (distance < radius && distance < opposite->selectionWeight)
+            {
+                opposite->selectionWeight = distance;
+                queue.push(QueueItem(distance, opposite));
+            }
+        }
+    }
+
+    for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
+        node->selectionWeight = weightAtDistance(weights, node->selectionWeight, radius);
+}
+
+void Mesh2::computeSoftSelectionEuclidean()
+{
+    const vector<float> &weights = selectionWeights();
+    float radius = _softSelectionRadius;
+
+    vector<VertexNode *> selected;
+
+    for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
+    {
+        if (node->data().selected)
+        {
+            node->selectionWeight = weights[0];
+            selected.push_back(node);
+        }
+    }
+
+    if (selected.empty())
+        return;
+
+    FPSpatialGrid<VertexNode> grid;
+    grid.build(selected, radius);
+
+    for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
+    {
+        if (node->data().selected)
+            continue;
+
+        float distance = 0.0f;
+        if (grid.findNearestWithin(node->data().position, radius, distance) != NULL)
+            node->selectionWeight = weightAtDistance(weights, distance, radius);
+    }
+}
+
+void Mesh2::computeSoftSelectionTriangles()
+{
+    TriangleNeighbours neighbours;
+    softSelectSteps(_triangles.begin(), _triangles.end(), neighbours, selectionWeights());
+
+    for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
+    {
+        unsigned int count = node->data().count();
+        for (unsigned int i = 0; i < count; i++)
+        {
+            VertexNode *vertexNode = node->data().vertex(i);
+            if (vertexNode->selectionWeight < node->selectionWeight)
+                vertexNode->selectionWeight = node->selectionWeight;
+        }
+    }
+}
+
+void Mesh2::computeSoftSelectionEdges()
+{
+    EdgeNeighbours neighbours;
+    softSelectSteps(_vertexEdges.begin(), _vertexEdges.end(), neighbours, selectionWeights());
+
+    for (VertexEdgeNode *node = _vertexEdges.begin(), *end = _vertexEdges.end(); node != end; node = node->next())
+    {
+        for (unsigned int i = 0; i < 2; i++)
+        {
+            VertexNode *vertexNode = node->data().vertex(i);
+            if (vertexNode->selectionWeight < node->selectionWeight)
+                vertexNode->selectionWeight = node->selectionWeight;
+        }
+    }
+}
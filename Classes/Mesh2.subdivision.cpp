@@ -0,0 +1,874 @@
+//
+//  Mesh2.subdivision.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "Mesh2.h"
+#include "FPParallel.h"
+
+// Loop subdivision runs on flat index arrays. Every step writes only to
+// the range of vertices, edges or triangles it was given, so each step can
+// run in parallel. Nodes are created and linked serially at the end.
+
+static inline unsigned int nextCorner(unsigned int corner)
+{
+    return corner % 3 == 2 ? corner - 2 : corner + 1;
+}
+
+static inline unsigned int previousCorner(unsigned int corner)
+{
+    return corner % 3 == 0 ? corner + 2 : corner - 1;
+}
+
+struct SubdivisionEdges
+{
+    // edge going from corner c to the next corner of its triangle
+    vector<unsigned int> cornerEdges;
+    // first and last corner sharing the edge, the last one is UINT_MAX on boundaries
+    vector<unsigned int> edgeCorners;
+
+    unsigned int count() const { return (unsigned int)edgeCorners.size() / 2; }
+};
+
+struct SortEdgeBuckets
+{
+    const vector<unsigned int> &indices;
+    const vector<unsigned int> &offsets;
+    vector<unsigned int> &corners;
+    vector<unsigned int> &cornerEdges;
+    vector<unsigned int> &lastCorners;
+
+    SortEdgeBuckets(const vector<unsigned int> &indices, const vector<unsigned int> &offsets, vector<unsigned int> &corners,
+                    vector<unsigned int> &cornerEdges, vector<unsigned int> &lastCorners) :
+        indices(indices), offsets(offsets), corners(corners), cornerEdges(cornerEdges), lastCorners(lastCorners) { }
+
+    unsigned int key(unsigned int corner) const
+    {
+        return max(indices[corner], indices[nextCorner(corner)]);
+    }
+
+    void operator()(unsigned int begin, unsigned int end)
+    {
+        for (unsigned int bucket = begin; bucket < end; bucket++)
+        {
+            unsigned int first = offsets[bucket];
+            unsigned int last = offsets[bucket + 1];
+
+            // stable, buckets hold only the few edges around one vertex
+            for (unsigned int i = first + 1; i < last; i++)
+            {
+                unsigned int corner = corners[i];
+                unsigned int cornerKey = key(corner);
+                unsigned int j = i;
+
+                for (; j > first && key(corners[j - 1]) > cornerKey; j--)
+                    corners[j] = corners[j - 1];
+
+                corners[j] = corner;
+            }
+
+            // corners of one edge point to the first of them until edges get their ids
+            for (unsigned int i = first; i < last; )
+            {
+                unsigned int firstCorner = corners[i];
+                unsigned int firstKey = key(firstCorner);
+                unsigned int j = i + 1;
+
+                while (j < last && key(corners[j]) == firstKey)
+                    j++;
+
+                for (unsigned int k = i; k < j; k++)
+                    cornerEdges[corners[k]] = firstCorner;
+
+                lastCorners[firstCorner] = j - i > 1 ? corners[j - 1] : UINT_MAX;
+                i = j;
+            }
+        }
+    }
+};
+
+struct AssignEdgeIds
+{
+    vector<unsigned int> &cornerEdges;
+    const vector<unsigned int> &edgeIds;
+
+    AssignEdgeIds(vector<unsigned int> &cornerEdges, const vector<unsigned int> &edgeIds) :
+        cornerEdges(cornerEdges), edgeIds(edgeIds) { }
+
+    void operator()(unsigned int begin, unsigned int end)
+    {
+        for (unsigned int corner = begin; corner < end; corner++)
+            cornerEdges[corner] = edgeIds[cornerEdges[corner]];
+    }
+};
+
+// Edges are numbered in the order makeEdges would create them.
+static void buildSubdivisionEdges(const vector<unsigned int> &indices, unsigned int indexCount, SubdivisionEdges &edges)
+{
+    unsigned int cornerCount = (unsigned int)indices.size();
+
+    vector<unsigned int> offsets(indexCount + 1, 0);
+
+    for (unsigned int corner = 0; corner < cornerCount; corner++)
+        offsets[min(indices[corner], indices[nextCorner(corner)]) + 1]++;
+
+    for (unsigned int i = 0; i < indexCount; i++)
+        offsets[i + 1] += offsets[i];
+
+    vector<unsigned int> corners(cornerCount);
+    vector<unsigned int> cursors(offsets.begin(), offsets.end() - 1);
+
+    for (unsigned int corner = 0; corner < cornerCount; corner++)
+        corners[cursors[min(indices[corner], indices[nextCorner(corner)])]++] = corner;
+
+    edges.cornerEdges.resize(cornerCount);
+    vector<unsigned int> lastCorners(cornerCount);
+
+    SortEdgeBuckets sortBuckets(indices, offsets, corners, edges.cornerEdges, lastCorners);
+    FPParallel::forRange(indexCount, sortBuckets);
+
+    vector<unsigned int> &edgeIds = corners;
+    edges.edgeCorners.clear();
+
+    for (unsigned int corner = 0; corner < cornerCount; corner++)
+    {
+        if (edges.cornerEdges[corner] == corner)
+        {
+            edgeIds[corner] = edges.count();
+            edges.edgeCorners.push_back(corner);
+            edges.edgeCorners.push_back(lastCorners[corner]);
+        }
+    }
+
+    AssignEdgeIds assignIds(edges.cornerEdges, edgeIds);
+    FPParallel::forRange(cornerCount, assignIds);
+}
+
+struct ComputeEdgeVertices
+{
+    const vector<unsigned int> &indices;
+    const SubdivisionEdges &edges;
+    vector<Vector3D> &positions;
+    unsigned int vertexCount;
+
+    ComputeEdgeVertices(const vector<unsigned int> &indices, const SubdivisionEdges &edges, vector<Vector3D> &positions, unsigned int vertexCount) :
+        indices(indices), edges(edges), positions(positions), vertexCount(vertexCount) { }
+
+    void operator()(unsigned int begin, unsigned int end)
+    {
+        for (unsigned int edge = begin; edge < end; edge++)
+        {
+            unsigned int c0 = edges.edgeCorners[edge * 2];
+            unsigned int c1 = edges.edgeCorners[edge * 2 + 1];
+
+            unsigned int i1 = indices[c0];
+            unsigned int i2 = indices[nextCorner(c0)];
+
+            Vector3D v1 = positions[i1];
+            Vector3D v2 = positions[i2];
+
+            Vector3D edgeVertex;
+
+            // boundary
+            if (c1 == UINT_MAX)
+            {
+                edgeVertex = (v1 + v2) / 2.0f;
+            }
+            else
+            {
+                unsigned int i3 = indices[previousCorner(c0)];
+                unsigned int i4 = indices[previousCorner(c1)];
+
+                // degenerated triangles
+                if (i3 == i1 || i3 == i2 || i4 == i1 || i4 == i2)
+                {
+                    edgeVertex = (v1 + v2) / 2.0f;
+                }
+                else
+                {
+                    Vector3D v3 = positions[i3];
+                    Vector3D v4 = positions[i4];
+
+                    edgeVertex = 3.0f * (v1 + v2) / 8.0f + 1.0f * (v3 + v4) / 8.0f;
+                }
+            }
+
+            positions[vertexCount + edge] = edgeVertex;
+        }
+    }
+};
+
+struct ComputeEdgeTexCoords
+{
+    const vector<unsigned int> &indices;
+    const SubdivisionEdges &edges;
+    vector<Vector3D> &texCoords;
+    unsigned int texCoordCount;
+
+    ComputeEdgeTexCoords(const vector<unsigned int> &indices, const SubdivisionEdges &edges, vector<Vector3D> &texCoords, unsigned int texCoordCount) :
+        indices(indices), edges(edges), texCoords(texCoords), texCoordCount(texCoordCount) { }
+
+    void operator()(unsigned int begin, unsigned int end)
+    {
+        for (unsigned int edge = begin; edge < end; edge++)
+        {
+            unsigned int c0 = edges.edgeCorners[edge * 2];
+
+            Vector3D t1 = texCoords[indices[c0]];
+            Vector3D t2 = texCoords[indices[nextCorner(c0)]];
+
+            texCoords[texCoordCount + edge] = (t1 + t2) / 2.0f;
+        }
+    }
+};
+
+struct RepositionVertices
+{
+    const vector<Vector3D> &positions;
+    const vector<unsigned int> &offsets;
+    const vector<unsigned int> &neighbours;
+    vector<Vector3D> &repositioned;
+
+    RepositionVertices(const vector<Vector3D> &positions, const vector<unsigned int> &offsets,
+                       const vector<unsigned int> &neighbours, vector<Vector3D> &repositioned) :
+        positions(positions), offsets(offsets), neighbours(neighbours), repositioned(repositioned) { }
+
+    void operator()(unsigned int begin, unsigned int end)
+    {
+        for (unsigned int vertex = begin; vertex < end; vertex++)
+        {
+            unsigned int first = offsets[vertex];
+            unsigned int last = offsets[vertex + 1];
+
+            // isolated vertices stay where they are
+            if (first == last)
+            {
+                repositioned[vertex] = positions[vertex];
+                continue;
+            }
+
+            float beta, n;
+
+            n = (float)(last - first);
+            beta = 3.0f + 2.0f * cosf(FLOAT_PI * 2.0f / n);
+            beta = 5.0f / 8.0f - (beta * beta) / 64.0f;
+
+            Vector3D finalPosition = (1.0f - beta) * positions[vertex];
+
+            float bon = beta / n;
+
+            for (unsigned int i = first; i < last; i++)
+                finalPosition += positions[neighbours[i]] * bon;
+
+            repositioned[vertex] = finalPosition;
+        }
+    }
+};
+
+struct EmitSubdividedTriangles
+{
+    const vector<unsigned int> &vertexIndices;
+    const vector<unsigned int> &texCoordIndices;
+    const SubdivisionEdges &vertexEdges;
+    const SubdivisionEdges &texCoordEdges;
+    unsigned int vertexCount;
+    unsigned int texCoordCount;
+    vector<unsigned int> &subdividedVertexIndices;
+    vector<unsigned int> &subdividedTexCoordIndices;
+
+    EmitSubdividedTriangles(const vector<unsigned int> &vertexIndices, const vector<unsigned int> &texCoordIndices,
+                            const SubdivisionEdges &vertexEdges, const SubdivisionEdges &texCoordEdges,
+                            unsigned int vertexCount, unsigned int texCoordCount,
+                            vector<unsigned int> &subdividedVertexIndices, vector<unsigned int> &subdividedTexCoordIndices) :
+        vertexIndices(vertexIndices), texCoordIndices(texCoordIndices),
+        vertexEdges(vertexEdges), texCoordEdges(texCoordEdges),
+        vertexCount(vertexCount), texCoordCount(texCoordCount),
+        subdividedVertexIndices(subdividedVertexIndices), subdividedTexCoordIndices(subdividedTexCoordIndices) { }
+
+    void operator()(unsigned int begin, unsigned int end)
+    {
+        /*
+               2
+              /\
+             /  \
+          *5/____\*4
+           /\    /\
+          /  \  /  \
+         /____\/____\
+         0    *3     1
+
+         */
+
+        static const unsigned int subdivided[12] = { 0, 3, 5, 3, 1, 4, 5, 4, 2, 3, 4, 5 };
+
+        unsigned int v[6], t[6];
+
+        for (unsigned int triangle = begin; triangle < end; triangle++)
+        {
+            for (unsigned int i = 0; i < 3; i++)
+            {
+                unsigned int corner = triangle * 3 + i;
+                v[i] = vertexIndices[corner];
+                v[i + 3] = vertexCount + vertexEdges.cornerEdges[corner];
+                t[i] = texCoordIndices[corner];
+                t[i + 3] = texCoordCount + texCoordEdges.cornerEdges[corner];
+            }
+
+            for (unsigned int i = 0; i < 12; i++)
+            {
+                subdividedVertexIndices[triangle * 12 + i] = v[subdivided[i]];
+                subdividedTexCoordIndices[triangle * 12 + i] = t[subdivided[i]];
+            }
+        }
+    }
+};
+
+void Mesh2::loopSubdivision()
+{
+    FPProfileZone zone("Mesh2::loopSubdivision");
+
+    resetTriangleCache();
+
+    vector<VertexNode *> vertexNodes;
+    vector<TexCoordNode *> texCoordNodes;
+    vector<Vector3D> positions;
+    vector<Vector3D> texCoords;
+
+    vertexNodes.reserve(_vertices.count());
+    positions.reserve(_vertices.count());
+
+    for (VertexNode *node = _vertices.begin(), *end = _vertices.end(); node != end; node = node->next())
+    {
+        node->algorithmData.index = (unsigned int)vertexNodes.size();
+        vertexNodes.push_back(node);
+        positions.push_back(node->data().position);
+    }
+
+    texCoordNodes.reserve(_texCoords.count());
+    texCoords.reserve(_texCoords.count());
+
+    for (TexCoordNode *node = _texCoords.begin(), *end = _texCoords.end(); node != end; node = node->next())
+    {
+        node->algorithmData.index = (unsigned int)texCoordNodes.size();
+        texCoordNodes.push_back(node);
+        texCoords.push_back(node->data().position);
+    }
+
+    // quads are split the same way and in the same order as triangulate() does
+    vector<unsigned int> vertexIndices;
+    vector<unsigned int> texCoordIndices;
+
+    vertexIndices.reserve(_triangles.count() * 6);
+    texCoordIndices.reserve(_triangles.count() * 6);
+
+    for (unsigned int pass = 0; pass < 2; pass++)
+    {
+        for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
+        {
+            const Triangle2 &triangle = node->data();
+
+            if (triangle.isQuad() != (pass == 1))
+                continue;
+
+            unsigned int count = triangle.isQuad() ? 6 : 3;
+            for (unsigned int i = 0; i < count; i++)
+            {
+                unsigned int index = triangle.isQuad() ? Triangle2::twoTriIndices[i] : i;
+                vertexIndices.push_back((unsigned int)triangle.vertex(index)->algorithmData.index);
+                texCoordIndices.push_back((unsigned int)triangle.texCoord(index)->algorithmData.index);
+            }
+        }
+    }
+
+    unsigned int vertexCount = (unsigned int)positions.size();
+    unsigned int texCoordCount = (unsigned int)texCoords.size();
+    unsigned int triangleCount = (unsigned int)vertexIndices.size() / 3;
+
+    SubdivisionEdges vertexEdges;
+    SubdivisionEdges texCoordEdges;
+
+    buildSubdivisionEdges(vertexIndices, vertexCount, vertexEdges);
+    buildSubdivisionEdges(texCoordIndices, texCoordCount, texCoordEdges);
+
+    positions.resize(vertexCount + vertexEdges.count());
+    texCoords.resize(texCoordCount + texCoordEdges.count());
+
+    ComputeEdgeVertices edgeVertices(vertexIndices, vertexEdges, positions, vertexCount);
+    FPParallel::forRange(vertexEdges.count(), edgeVertices);
+
+    ComputeEdgeTexCoords edgeTexCoords(texCoordIndices, texCoordEdges, texCoords, texCoordCount);
+    FPParallel::forRange(texCoordEdges.count(), edgeTexCoords);
+
+    // neighbours of each vertex, in the order of its edges
+    vector<unsigned int> neighbourOffsets(vertexCount + 1, 0);
+    vector<unsigned int> neighbours(vertexEdges.count() * 2);
+
+    for (unsigned int edge = 0; edge < vertexEdges.count(); edge++)
+    {
+        unsigned int corner = vertexEdges.edgeCorners[edge * 2];
+        neighbourOffsets[vertexIndices[corner] + 1]++;
+        neighbourOffsets[vertexIndices[nextCorner(corner)] + 1]++;
+    }
+
+    for (unsigned int i = 0; i < vertexCount; i++)
+        neighbourOffsets[i + 1] += neighbourOffsets[i];
+
+    vector<unsigned int> cursors(neighbourOffsets.begin(), neighbourOffsets.end() - 1);
+
+    for (unsigned int edge = 0; edge < vertexEdges.count(); edge++)
+    {
+        unsigned int corner = vertexEdges.edgeCorners[edge * 2];
+        unsigned int v0 = vertexIndices[corner];
+        unsigned int v1 = vertexIndices[nextCorner(corner)];
+        neighbours[cursors[v0]++] = v1;
+        neighbours[cursors[v1]++] = v0;
+    }
+
+    vector<Vector3D> repositioned(vertexCount);
+
+    RepositionVertices reposition(positions, neighbourOffsets, neighbours, repositioned);
+    FPParallel::forRange(vertexCount, reposition);
+
+    vector<unsigned int> subdividedVertexIndices(triangleCount * 12);
+    vector<unsigned int> subdividedTexCoordIndices(triangleCount * 12);
+
+    EmitSubdividedTriangles emit(vertexIndices, texCoordIndices, vertexEdges, texCoordEdges, vertexCount, texCoordCount,
+                                 subdividedVertexIndices, subdividedTexCoordIndices);
+    FPParallel::forRange(triangleCount, emit);
+
+    // release the scratch arrays before the nodes get allocated
+    vector<unsigned int>().swap(vertexIndices);
+    vector<unsigned int>().swap(texCoordIndices);
+    vector<unsigned int>().swap(neighbours);
+    vector<unsigned int>().swap(vertexEdges.cornerEdges);
+    vector<unsigned int>().swap(vertexEdges.edgeCorners);
+    vector<unsigned int>().swap(texCoordEdges.cornerEdges);
+    vector<unsigned int>().swap(texCoordEdges.edgeCorners);
+
+    // existing nodes are kept together with their selection, new ones are appended
+
+    for (unsigned int i = 0; i < vertexCount; i++)
+    {
+        vertexNodes[i]->data().position = repositioned[i];
+        vertexNodes[i]->_triangles.removeAll();
+    }
+
+    for (unsigned int i = 0; i < texCoordCount; i++)
+        texCoordNodes[i]->_triangles.removeAll();
+
+    for (unsigned int i = vertexCount; i < positions.size(); i++)
+        vertexNodes.push_back(_vertices.add(positions[i]));
+
+    for (unsigned int i = texCoordCount; i < texCoords.size(); i++)
+        texCoordNodes.push_back(_texCoords.add(texCoords[i]));
+
+    _triangles.removeAll();
+
+    VertexNode *triangleVertices[3];
+    TexCoordNode *triangleTexCoords[3];
+
+    for (unsigned int i = 0; i < subdividedVertexIndices.size(); i += 3)
+    {
+        for (unsigned int j = 0; j < 3; j++)
+        {
+            triangleVertices[j] = vertexNodes[subdividedVertexIndices[i + j]];
+            triangleTexCoords[j] = texCoordNodes[subdividedTexCoordIndices[i + j]];
+        }
+
+        _triangles.add(Triangle2(triangleVertices, triangleTexCoords, false));
+    }
+
+    makeEdges();
+
+    setSelectionMode(_selectionMode);
+}
+
+// Selection limited subdivision. Selected triangles are split into four,
+// and the split spreads with red-green rules so there are no cracks. A face
+// with two or more split edges is split completely (red). A face with one
+// split edge is cut into a fan from the edge point (green). Only vertices
+// that are surrounded by red faces are moved. The mesh is changed through
+// a local edit, so untouched triangles and edges are left as they are.
+
+Triangle2 makeTriangle(VertexNode *vertices[], TexCoordNode *texCoords[],
+                       unsigned int index0, unsigned int index1, unsigned int index2);
+
+static unsigned int splitEdgeCount(const Triangle2 &triangle)
+{
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < triangle.count(); i++)
+    {
+        if (triangle.vertexEdge(i)->data().half)
+            count++;
+    }
+    return count;
+}
+
+// vertex opposite to the edge in the triangle it would be part of after triangulate()
+static VertexNode *oppositeVertex(const Triangle2 &triangle, const VertexEdgeNode *edge)
+{
+    for (unsigned int i = 0; i < triangle.count(); i++)
+    {
+        if (triangle.vertexEdge(i) == edge)
+        {
+            if (triangle.isQuad())
+                return triangle.vertex(i == 0 || i == 3 ? 2 : 0);
+            return triangle.vertex((i + 2) % 3);
+        }
+    }
+    return NULL;
+}
+
+static Vector3D loopEdgePoint(VertexEdgeNode *edgeNode)
+{
+    VertexEdge &edge = edgeNode->data();
+
+    VertexNode *v1 = edge.vertex(0);
+    VertexNode *v2 = edge.vertex(1);
+
+    Vector3D p1 = v1->data().position;
+    Vector3D p2 = v2->data().position;
+
+    if (edge.triangle(0) == NULL || edge.triangle(1) == NULL)
+        return (p1 + p2) / 2.0f;
+
+    VertexNode *v3 = oppositeVertex(edge.triangle(0)->data(), edgeNode);
+    VertexNode *v4 = oppositeVertex(edge.triangle(1)->data(), edgeNode);
+
+    // degenerated triangles
+    if (v3 == NULL || v4 == NULL || v3 == v1 || v3 == v2 || v4 == v1 || v4 == v2)
+        return (p1 + p2) / 2.0f;
+
+    Vector3D p3 = v3->data().position;
+    Vector3D p4 = v4->data().position;
+
+    return 3.0f * (p1 + p2) / 8.0f + 1.0f * (p3 + p4) / 8.0f;
+}
+
+// Returns false when some edge around the vertex is not split.
+static bool loopVertexPoint(VertexNode *vertexNode, Vector3D &position)
+{
+    unsigned int count = 0;
+
+    for (Vertex2VEdgeNode *node = vertexNode->_edges.begin(), *end = vertexNode->_edges.end(); node != end; node = node->next())
+    {
+        if (!node->data()->data().half)
+            return false;
+        count++;
+    }
+
+    // red quads are triangulated, their diagonal is another neighbour
+    for (VertexTriangleNode *node = vertexNode->_triangles.begin(), *end = vertexNode->_triangles.end(); node != end; node = node->next())
+    {
+        const Triangle2 &triangle = node->data()->data();
+        if (triangle.isQuad() && (triangle.vertex(0) == vertexNode || triangle.vertex(2) == vertexNode))
+            count++;
+    }
+
+    if (count == 0)
+        return false;
+
+    float beta, n;
+
+    n = (float)count;
+    beta = 3.0f + 2.0f * cosf(FLOAT_PI * 2.0f / n);
+    beta = 5.0f / 8.0f - (beta * beta) / 64.0f;
+
+    position = (1.0f - beta) * vertexNode->data().position;
+
+    float bon = beta / n;
+
+    for (Vertex2VEdgeNode *node = vertexNode->_edges.begin(), *end = vertexNode->_edges.end(); node != end; node = node->next())
+        position += node->data()->data().opposite(vertexNode)->data().position * bon;
+
+    for (VertexTriangleNode *node = vertexNode->_triangles.begin(), *end = vertexNode->_triangles.end(); node != end; node = node->next())
+    {
+        const Triangle2 &triangle = node->data()->data();
+        if (triangle.isQuad() && triangle.vertex(0) == vertexNode)
+            position += triangle.vertex(2)->data().position * bon;
+        else if (triangle.isQuad() && triangle.vertex(2) == vertexNode)
+            position += triangle.vertex(0)->data().position * bon;
+    }
+
+    return true;
+}
+
+bool Mesh2::isSelectedForSubdivision(const Triangle2 &triangle, float minimumEdgeLength) const
+{
+    if (_selectionMode == MeshSelectionMode::Triangles)
+    {
+        if (!triangle.selected)
+            return false;
+    }
+    else
+    {
+        for (unsigned int i = 0; i < triangle.count(); i++)
+        {
+            if (_isUnwrapped ? !triangle.texCoord(i)->data().selected : !triangle.vertex(i)->data().selected)
+                return false;
+        }
+    }
+
+    if (minimumEdgeLength <= 0.0f)
+        return true;
+
+    for (unsigned int i = 0; i < triangle.count(); i++)
+    {
+        const Vector3D &p1 = triangle.vertex(i)->data().position;
+        const Vector3D &p2 = triangle.vertex((i + 1) % triangle.count())->data().position;
+
+        if (p1.SqDistance(p2) > minimumEdgeLength * minimumEdgeLength)
+            return true;
+    }
+
+    return false;
+}
+
+void Mesh2::splitSubdivisionEdge(LocalEdit &edit, VertexEdgeNode *edgeNode, vector<TriangleNode *> &pending)
+{
+    VertexEdge &edge = edgeNode->data();
+    if (edge.half)
+        return;
+
+    edge.half = _vertices.add(loopEdgePoint(edgeNode));
+    edit.touchedVertices.push_back(edge.half);
+
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        if (edge.triangle(i))
+            pending.push_back(edge.triangle(i));
+    }
+}
+
+TexCoordNode *Mesh2::subdivisionTexCoord(LocalEdit &edit, const Triangle2 &triangle, unsigned int index)
+{
+    TexCoordEdge &edge = triangle.texCoordEdge(index)->data();
+
+    if (!edge.half)
+    {
+        edge.half = _texCoords.add((edge.texCoord(0)->data().position + edge.texCoord(1)->data().position) / 2.0f);
+        edit.touchedTexCoords.push_back(edge.half);
+    }
+
+    return edge.half;
+}
+
+void Mesh2::addChildTriangle(const Triangle2 &parent, VertexNode *vertices[], TexCoordNode *texCoords[],
+                             unsigned int index0, unsigned int index1, unsigned int index2)
+{
+    TriangleNode *node = _triangles.add(makeTriangle(vertices, texCoords, index0, index1, index2));
+    node->data().selected = parent.selected;
+    node->data().visible = parent.visible;
+}
+
+// vertices and texCoords hold three corners followed by the points on edges 0, 1 and 2
+void Mesh2::addSubdividedTriangles(const Triangle2 &parent, VertexNode *vertices[], TexCoordNode *texCoords[])
+{
+    addChildTriangle(parent, vertices, texCoords, 0, 3, 5);
+    addChildTriangle(parent, vertices, texCoords, 3, 1, 4);
+    addChildTriangle(parent, vertices, texCoords, 5, 4, 2);
+    addChildTriangle(parent, vertices, texCoords, 3, 4, 5);
+}
+
+void Mesh2::loopSubdivisionSelected(float minimumEdgeLength)
+{
+    FPProfileZone zone("Mesh2::loopSubdivisionSelected");
+
+    LocalEdit edit;
+    beginLocalEdit(edit);
+    resetTriangleCache();
+
+    for (VertexEdgeNode *node = _vertexEdges.begin(), *end = _vertexEdges.end(); node != end; node = node->next())
+        node->data().half = NULL;
+
+    for (TexCoordEdgeNode *node = _texCoordEdges.begin(), *end = _texCoordEdges.end(); node != end; node = node->next())
+        node->data().half = NULL;
+
+    vector<TriangleNode *> pending;
+    vector<TriangleNode *> faces;
+
+    for (TriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
+    {
+        const Triangle2 &triangle = node->data();
+
+        if (isSelectedForSubdivision(triangle, minimumEdgeLength))
+        {
+            for (unsigned int i = 0; i < triangle.count(); i++)
+                splitSubdivisionEdge(edit, triangle.vertexEdge(i), pending);
+        }
+    }
+
+    // red-green closure, every face next to a new split edge is checked again
+    while (!pending.empty())
+    {
+        TriangleNode *node = pending.back();
+        pending.pop_back();
+
+        const Triangle2 &triangle = node->data();
+
+        if (splitEdgeCount(triangle) >= 2)
+        {
+            for (unsigned int i = 0; i < triangle.count(); i++)
+                splitSubdivisionEdge(edit, triangle.vertexEdge(i), pending);
+        }
+    }
+
+    // faces next to split edges in list order, so new nodes do not depend on addresses
+    for (TriangleNode *node = _triangles.begin(), *end = edit.triangleEnd; node != end; node = node->next())
+    {
+        if (splitEdgeCount(node->data()) > 0)
+            faces.push_back(node);
+    }
+
+    // new positions are computed before any red face is removed,
+    // algorithmData.index marks vertices already in movedVertices
+    vector<VertexNode *> movedVertices;
+    vector<Vector3D> movedPositions;
+
+    for (unsigned int i = 0; i < faces.size(); i++)
+    {
+        const Triangle2 &triangle = faces[i]->data();
+
+        for (unsigned int j = 0; j < triangle.count(); j++)
+            triangle.vertex(j)->algorithmData.index = 0;
+    }
+
+    for (unsigned int i = 0; i < faces.size(); i++)
+    {
+        const Triangle2 &triangle = faces[i]->data();
+
+        if (splitEdgeCount(triangle) < 2)
+            continue;
+
+        for (unsigned int j = 0; j < triangle.count(); j++)
+        {
+            VertexNode *vertex = triangle.vertex(j);
+            if (vertex->algorithmData.index == 0)
+            {
+                vertex->algorithmData.index = 1;
+                movedVertices.push_back(vertex);
+            }
+        }
+    }
+
+    unsigned int movedCount = 0;
+
+    for (unsigned int i = 0; i < movedVertices.size(); i++)
+    {
+        Vector3D position;
+
+        if (loopVertexPoint(movedVertices[i], position))
+        {
+            movedVertices[movedCount++] = movedVertices[i];
+            movedPositions.push_back(position);
+        }
+    }
+
+    movedVertices.resize(movedCount);
+
+    VertexNode *v[6];
+    TexCoordNode *t[6];
+
+    for (unsigned int i = 0; i < faces.size(); i++)
+    {
+        TriangleNode *node = faces[i];
+        const Triangle2 &triangle = node->data();
+
+        unsigned int count = triangle.count();
+        unsigned int splitCount = splitEdgeCount(triangle);
+
+        if (splitCount == 0)
+            continue;
+
+        if (splitCount == 1)
+        {
+            unsigned int split = 0;
+            while (!triangle.vertexEdge(split)->data().half)
+                split++;
+
+            // corners starting after the split edge, the edge point is the last one
+            for (unsigned int j = 0; j < count; j++)
+            {
+                v[j] = triangle.vertex((split + j) % count);
+                t[j] = triangle.texCoord((split + j) % count);
+            }
+
+            v[count] = triangle.vertexEdge(split)->data().half;
+            t[count] = subdivisionTexCoord(edit, triangle, split);
+
+            for (unsigned int j = 1; j < count; j++)
+                addChildTriangle(triangle, v, t, count, j, (j + 1) % count);
+        }
+        else if (triangle.isQuad())
+        {
+            /*
+                3----(e2)----2
+                |          / |
+              (e3)    (d)   (e1)
+                |   /        |
+                0----(e0)----1
+             */
+
+            VertexNode *diagonal = _vertices.add(3.0f * (triangle.vertex(0)->data().position + triangle.vertex(2)->data().position) / 8.0f +
+                                                 1.0f * (triangle.vertex(1)->data().position + triangle.vertex(3)->data().position) / 8.0f);
+            TexCoordNode *texCoordDiagonal = _texCoords.add((triangle.texCoord(0)->data().position + triangle.texCoord(2)->data().position) / 2.0f);
+
+            edit.touchedVertices.push_back(diagonal);
+            edit.touchedTexCoords.push_back(texCoordDiagonal);
+
+            for (unsigned int j = 0; j < 3; j++)
+            {
+                v[j] = triangle.vertex(j);
+                t[j] = triangle.texCoord(j);
+            }
+
+            v[3] = triangle.vertexEdge(0)->data().half;
+            v[4] = triangle.vertexEdge(1)->data().half;
+            v[5] = diagonal;
+            t[3] = subdivisionTexCoord(edit, triangle, 0);
+            t[4] = subdivisionTexCoord(edit, triangle, 1);
+            t[5] = texCoordDiagonal;
+
+            addSubdividedTriangles(triangle, v, t);
+
+            for (unsigned int j = 0; j < 3; j++)
+            {
+                v[j] = triangle.vertex(Triangle2::twoTriIndices[j + 3]);
+                t[j] = triangle.texCoord(Triangle2::twoTriIndices[j + 3]);
+            }
+
+            v[3] = diagonal;
+            v[4] = triangle.vertexEdge(2)->data().half;
+            v[5] = triangle.vertexEdge(3)->data().half;
+            t[3] = texCoordDiagonal;
+            t[4] = subdivisionTexCoord(edit, triangle, 2);
+            t[5] = subdivisionTexCoord(edit, triangle, 3);
+
+            addSubdividedTriangles(triangle, v, t);
+        }
+        else
+        {
+            for (unsigned int j = 0; j < 3; j++)
+            {
+                v[j] = triangle.vertex(j);
+                t[j] = triangle.texCoord(j);
+                v[j + 3] = triangle.vertexEdge(j)->data().half;
+                t[j + 3] = subdivisionTexCoord(edit, triangle, j);
+            }
+
+            addSubdividedTriangles(triangle, v, t);
+        }
+
+        removeTriangle(edit, node);
+    }
+
+    for (unsigned int i = 0; i < movedVertices.size(); i++)
+    {
+        recordMovedVertex(movedVertices[i]);
+        movedVertices[i]->data().position = movedPositions[i];
+    }
+
+    endLocalEdit(edit);
+}
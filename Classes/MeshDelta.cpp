@@ -0,0 +1,455 @@
+//
+//  MeshDelta.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "MeshDelta.h"
+#include "FPMeshCodec.h"
+
+unsigned int UndoMemory::addRemovedItem(RemovedItem *item)
+{
+    _removedItems.push_back(item);
+    return (unsigned int)_removedItems.size() - 1;
+}
+
+RemovedItem *UndoMemory::removeRemovedItem(unsigned int index)
+{
+    RemovedItem *last = _removedItems.back();
+    _removedItems.pop_back();
+    
+    if (index == _removedItems.size())
+        return NULL;
+    
+    _removedItems[index] = last;
+    return last;
+}
+
+unsigned int UndoMemory::droppedStepCount() const
+{
+    unsigned int count = 0;
+    while (count < _steps.size() && _steps[count]->dropped())
+        count++;
+    return count;
+}
+
+void UndoMemory::addStep(MeshDelta *delta)
+{
+    _steps.push_back(delta);
+}
+
+void UndoMemory::removeStep(MeshDelta *delta)
+{
+    vector<MeshDelta *>::iterator it = find(_steps.begin(), _steps.end(), delta);
+    if (it != _steps.end())
+        _steps.erase(it);
+}
+
+// older steps are dropped before newer ones, so undo never reaches a
+// recorded delta behind a dropped one
+void UndoMemory::trimToBudget()
+{
+    for (unsigned int i = droppedStepCount(); i + 1 < _steps.size() && _meshDeltas > _budget; i++)
+        _steps[i]->drop();
+}
+
+MeshDelta::MeshDelta(Mesh2 *mesh, unsigned int index, bool positionsOnly, UndoMemory *memory)
+{
+    _index = index;
+    _memory = memory;
+    _memory->retain();
+    _positionsOnly = positionsOnly;
+    _finished = false;
+    _dropped = false;
+    _topologyChanged = false;
+    _patched = false;
+    _patch = NULL;
+    _selectionChanged = false;
+    _selectionCount = 0;
+    _memorySize = 0;
+    _recording = NULL;
+    
+    _selectionMode = mesh->selectionMode();
+    
+    if (_positionsOnly)
+    {
+        bool texCoords;
+        vector<unsigned int> indices;
+        vector<Vector3D> positions;
+        mesh->getMovablePositions(indices, positions, texCoords);
+        
+        if (texCoords)
+        {
+            _texCoordIndices.swap(indices);
+            _texCoordPositions.swap(positions);
+        }
+        else
+        {
+            _vertexIndices.swap(indices);
+            _vertexPositions.swap(positions);
+        }
+    }
+    else
+    {
+        // the selection is one bit per element, it is kept whole
+        mesh->getSelection(_selection);
+        _recording = new MeshRecording();
+        mesh->beginRecording(_recording);
+    }
+}
+
+MeshDelta::~MeshDelta()
+{
+    delete _recording;
+    delete _patch;
+    if (_finished)
+        _memory->removeStep(this);
+    _memory->resizeMeshDelta(_memorySize, 0);
+    _memory->release();
+}
+
+// positions past the shorter array are not compared
+static void positionDifferences(const vector<float> &before, const vector<float> &after,
+                                vector<unsigned int> &indices, vector<Vector3D> &positions)
+{
+    size_t count = min(before.size(), after.size());
+    for (unsigned int i = 0; i < count; i += 3)
+    {
+        if (memcmp(&before[i], &after[i], 3 * sizeof(float)) != 0)
+        {
+            indices.push_back(i / 3);
+            positions.push_back(Vector3D(before[i], before[i + 1], before[i + 2]));
+        }
+    }
+}
+
+// Keeps only the positions that differ from the current ones.
+static void removeUnchangedPositions(Mesh2 *mesh, vector<unsigned int> &indices, vector<Vector3D> &positions, bool texCoords)
+{
+    vector<Vector3D> current;
+    mesh->getPositions(indices, current, texCoords);
+    
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < indices.size(); i++)
+    {
+        if (memcmp(&positions[i], &current[i], sizeof(Vector3D)) != 0)
+        {
+            indices[count] = indices[i];
+            positions[count] = positions[i];
+            count++;
+        }
+    }
+    
+    indices.resize(count);
+    positions.resize(count);
+}
+
+static bool sameCorners(const vector<unsigned int> &before, size_t beforeCorner,
+                        const vector<unsigned int> &after, size_t afterCorner, unsigned int count)
+{
+    return memcmp(&before[beforeCorner], &after[afterCorner], count * sizeof(unsigned int)) == 0;
+}
+
+static bool isHidden(const vector<unsigned int> &hidden, unsigned int index)
+{
+    return binary_search(hidden.begin(), hidden.end(), index);
+}
+
+// Vertices past the shorter list are replaced, the ones below it are moved.
+static void makePatchVertices(const vector<float> &before, const vector<float> &after,
+                              const vector<unsigned int> &hidden, MeshPatchVertices &patch)
+{
+    unsigned int tail = (unsigned int)min(before.size(), after.size()) / 3;
+    
+    for (unsigned int i = tail; i < after.size() / 3; i++)
+        patch.removed.push_back(i);
+    
+    for (unsigned int i = tail; i < before.size() / 3; i++)
+    {
+        patch.added.push_back(i);
+        patch.positions.push_back(Vector3D(before[i * 3], before[i * 3 + 1], before[i * 3 + 2]));
+        patch.flags.push_back(isHidden(hidden, i) ? MeshPatch::kHidden : 0);
+    }
+    
+    positionDifferences(before, after, patch.moved, patch.movedPositions);
+}
+
+// The patch holds the faces of before that differ from after below the
+// shorter face count and everything past the shorter counts. The selection
+// is swapped whole afterwards, only hidden parts are kept in the flags.
+void MeshDelta::makePatch(const MeshSnapshot &before, const MeshSnapshot &after, MeshPatch &patch)
+{
+    unsigned int faceTail = (unsigned int)min(before.faceSizes.size(), after.faceSizes.size());
+    
+    size_t beforeCorner = 0;
+    size_t afterCorner = 0;
+    
+    for (unsigned int face = 0; face < before.faceSizes.size(); face++)
+    {
+        unsigned int count = before.faceSizes[face];
+        
+        if (face >= faceTail || count != after.faceSizes[face] ||
+            !sameCorners(before.vertexIndices, beforeCorner, after.vertexIndices, afterCorner, count) ||
+            !sameCorners(before.texCoordIndices, beforeCorner, after.texCoordIndices, afterCorner, count))
+        {
+            if (face < faceTail)
+                patch.removedFaces.push_back(face);
+            
+            patch.addedFaces.push_back(face);
+            patch.faceSizes.push_back((unsigned char)count);
+            patch.faceFlags.push_back(isHidden(before.visibility.hiddenTriangles, face) ? MeshPatch::kHidden : 0);
+            patch.vertexIndices.insert(patch.vertexIndices.end(), before.vertexIndices.begin() + beforeCorner,
+                                       before.vertexIndices.begin() + beforeCorner + count);
+            patch.texCoordIndices.insert(patch.texCoordIndices.end(), before.texCoordIndices.begin() + beforeCorner,
+                                         before.texCoordIndices.begin() + beforeCorner + count);
+        }
+        
+        beforeCorner += count;
+        if (face < faceTail)
+            afterCorner += after.faceSizes[face];
+    }
+    
+    for (unsigned int face = faceTail; face < after.faceSizes.size(); face++)
+        patch.removedFaces.push_back(face);
+    
+    makePatchVertices(before.positions, after.positions, before.visibility.hiddenVertices, patch.vertices);
+    makePatchVertices(before.texCoords, after.texCoords, before.visibility.hiddenTexCoords, patch.texCoords);
+}
+
+// Compares the snapshot taken before the first change with the mesh.
+void MeshDelta::finishSnapshot(Mesh2 *mesh)
+{
+    MeshSnapshot after;
+    mesh->toIndexArrays(after.positions, after.texCoords, after.faceSizes, after.vertexIndices, after.texCoordIndices);
+    MeshSnapshot &before = _recording->snapshot;
+    
+    _topologyChanged = before.positions.size() != after.positions.size() ||
+                       before.texCoords.size() != after.texCoords.size() ||
+                       before.faceSizes != after.faceSizes ||
+                       before.vertexIndices != after.vertexIndices ||
+                       before.texCoordIndices != after.texCoordIndices;
+    
+    if (!_topologyChanged)
+    {
+        positionDifferences(before.positions, after.positions, _vertexIndices, _vertexPositions);
+        positionDifferences(before.texCoords, after.texCoords, _texCoordIndices, _texCoordPositions);
+        return;
+    }
+    
+    size_t fullSize = (before.positions.size() + before.texCoords.size()) * sizeof(float) + before.faceSizes.size() +
+                      (before.vertexIndices.size() + before.texCoordIndices.size()) * sizeof(unsigned int);
+    
+    MeshPatch *patch = new MeshPatch();
+    makePatch(before, after, *patch);
+    
+    if (patch->memorySize() <= fullSize / 8)
+    {
+        _patch = patch;
+        _patched = true;
+        return;
+    }
+    
+    delete patch;
+    _positionsSplice.make(before.positions, after.positions);
+    _texCoordsSplice.make(before.texCoords, after.texCoords);
+    _faceSizesSplice.make(before.faceSizes, after.faceSizes);
+    _vertexIndicesSplice.make(before.vertexIndices, after.vertexIndices);
+    _texCoordIndicesSplice.make(before.texCoordIndices, after.texCoordIndices);
+    
+    size_t spliceSize = _positionsSplice.memorySize() + _texCoordsSplice.memorySize() + _faceSizesSplice.memorySize() +
+                        _vertexIndicesSplice.memorySize() + _texCoordIndicesSplice.memorySize();
+    
+    // removing vertices renumbers the rest, then the whole mesh compresses better
+    if (spliceSize > fullSize / 8)
+    {
+        _positionsSplice = MeshArraySplice<float>();
+        _texCoordsSplice = MeshArraySplice<float>();
+        _faceSizesSplice = MeshArraySplice<unsigned char>();
+        _vertexIndicesSplice = MeshArraySplice<unsigned int>();
+        _texCoordIndicesSplice = MeshArraySplice<unsigned int>();
+        
+        FPMeshCodec::encode(before.positions, before.texCoords, before.faceSizes,
+                            before.vertexIndices, before.texCoordIndices, 0.0f, _geometry);
+    }
+}
+
+static bool isEmpty(const MeshPatchVertices &patch)
+{
+    return patch.removed.empty() && patch.added.empty() && patch.moved.empty();
+}
+
+void MeshDelta::finish(Mesh2 *mesh)
+{
+    if (_finished)
+        return;
+    
+    _finished = true;
+    
+    if (_positionsOnly)
+    {
+        removeUnchangedPositions(mesh, _vertexIndices, _vertexPositions, false);
+        removeUnchangedPositions(mesh, _texCoordIndices, _texCoordPositions, true);
+        updateMemorySize();
+        _memory->addStep(this);
+        _memory->trimToBudget();
+        return;
+    }
+    
+    mesh->endRecording(_recording);
+    
+    if (_recording->state == MeshRecording::State::Snapshot)
+    {
+        finishSnapshot(mesh);
+    }
+    else if (_recording->state == MeshRecording::State::Local)
+    {
+        // local edits recorded the patch back as they went
+        const MeshPatch &patch = _recording->patch;
+        _patched = !patch.removedFaces.empty() || !patch.addedFaces.empty() ||
+                   !isEmpty(patch.vertices) || !isEmpty(patch.texCoords);
+        _topologyChanged = _patched;
+        if (_patched)
+            _patch = new MeshPatch(patch);
+    }
+    
+    delete _recording;
+    _recording = NULL;
+    
+    vector<bool> selection;
+    mesh->getSelection(selection);
+    
+    _selectionChanged = _topologyChanged || _selectionMode != mesh->selectionMode() ||
+                        _selection.size() != selection.size();
+    
+    if (!_selectionChanged)
+    {
+        for (unsigned int i = 0; i < selection.size(); i++)
+        {
+            if (_selection[i] != selection[i])
+            {
+                _selectionIndices.push_back(i);
+                _selectionValues.push_back(_selection[i]);
+            }
+        }
+        
+        _selectionCount = (unsigned int)selection.size();
+        vector<bool>().swap(_selection);
+    }
+    
+    updateMemorySize();
+    _memory->addStep(this);
+    _memory->trimToBudget();
+}
+
+void MeshDelta::swap(Mesh2 *mesh)
+{
+    if (_dropped)
+        return;
+    
+    vector<bool> selection;
+    MeshSelectionMode selectionMode = mesh->selectionMode();
+    
+    if (_selectionChanged)
+        mesh->getSelection(selection);
+    
+    if (_patched)
+    {
+        mesh->swapPatch(*_patch);
+    }
+    else if (_topologyChanged)
+    {
+        MeshSnapshot current;
+        mesh->toIndexArrays(current.positions, current.texCoords, current.faceSizes,
+                            current.vertexIndices, current.texCoordIndices);
+        
+        if (!_geometry.empty())
+        {
+            vector<unsigned char> geometry;
+            FPMeshCodec::encode(current.positions, current.texCoords, current.faceSizes,
+                                current.vertexIndices, current.texCoordIndices, 0.0f, geometry);
+            
+            if (!FPMeshCodec::decode(_geometry.data(), _geometry.size(), current.positions, current.texCoords,
+                                     current.faceSizes, current.vertexIndices, current.texCoordIndices))
+            {
+                throw MeshMaker::IndexOutOfRangeException();
+            }
+            
+            _geometry.swap(geometry);
+        }
+        else
+        {
+            _positionsSplice.apply(current.positions);
+            _texCoordsSplice.apply(current.texCoords);
+            _faceSizesSplice.apply(current.faceSizes);
+            _vertexIndicesSplice.apply(current.vertexIndices);
+            _texCoordIndicesSplice.apply(current.texCoordIndices);
+        }
+        
+        mesh->fromIndexArrays(current.positions.data(), (unsigned int)current.positions.size() / 3,
+                              current.texCoords.data(), (unsigned int)current.texCoords.size() / 3,
+                              current.faceSizes.data(), (unsigned int)current.faceSizes.size(),
+                              current.vertexIndices.data(), current.texCoordIndices.data());
+    }
+    else
+    {
+        mesh->swapPositions(_vertexIndices, _vertexPositions, false);
+        mesh->swapPositions(_texCoordIndices, _texCoordPositions, true);
+    }
+    
+    if (_selectionChanged)
+    {
+        mesh->setSelectionMode(_selectionMode);
+        mesh->setSelection(_selection);
+        _selection.swap(selection);
+        _selectionMode = selectionMode;
+    }
+    else if (mesh->selectionMode() == _selectionMode && mesh->selectedCount() == _selectionCount)
+    {
+        // the selection is not part of undo elsewhere, it can be in another mode by now
+        mesh->swapSelection(_selectionIndices, _selectionValues);
+    }
+    
+    updateMemorySize();
+}
+
+void MeshDelta::drop()
+{
+    _dropped = true;
+    _topologyChanged = false;
+    _patched = false;
+    _selectionChanged = false;
+    
+    vector<unsigned int>().swap(_vertexIndices);
+    vector<Vector3D>().swap(_vertexPositions);
+    vector<unsigned int>().swap(_texCoordIndices);
+    vector<Vector3D>().swap(_texCoordPositions);
+    vector<unsigned int>().swap(_selectionIndices);
+    vector<bool>().swap(_selectionValues);
+    vector<bool>().swap(_selection);
+    vector<unsigned char>().swap(_geometry);
+    delete _patch;
+    _patch = NULL;
+    _positionsSplice = MeshArraySplice<float>();
+    _texCoordsSplice = MeshArraySplice<float>();
+    _faceSizesSplice = MeshArraySplice<unsigned char>();
+    _vertexIndicesSplice = MeshArraySplice<unsigned int>();
+    _texCoordIndicesSplice = MeshArraySplice<unsigned int>();
+    
+    updateMemorySize();
+}
+
+void MeshDelta::updateMemorySize()
+{
+    size_t size = sizeof(MeshDelta);
+    size += (_vertexIndices.capacity() + _texCoordIndices.capacity() + _selectionIndices.capacity()) * sizeof(unsigned int);
+    size += (_vertexPositions.capacity() + _texCoordPositions.capacity()) * sizeof(Vector3D);
+    size += _positionsSplice.memorySize() + _texCoordsSplice.memorySize() + _faceSizesSplice.memorySize();
+    size += _vertexIndicesSplice.memorySize() + _texCoordIndicesSplice.memorySize();
+    size += _geometry.capacity() + (_selection.capacity() + _selectionValues.capacity()) / 8;
+    if (_patch)
+        size += sizeof(MeshPatch) + _patch->memorySize();
+    
+    _memory->resizeMeshDelta(_memorySize, size);
+    _memorySize = size;
+}
@@ -0,0 +1,157 @@
+//
+//  MeshDelta.h
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#pragma once
+
+#include "Mesh2.h"
+#include <cstring>
+
+class RemovedItem;
+class MeshDelta;
+
+// Memory held by the undo steps of one document. Undo steps retain it,
+// the undo manager can release them after the collection is gone.
+class UndoMemory
+{
+private:
+    unsigned int _referenceCount;
+    size_t _meshDeltas;
+    size_t _budget;
+    vector<MeshDelta *> _steps;
+    vector<RemovedItem *> _removedItems;
+public:
+    UndoMemory() : _referenceCount(1), _meshDeltas(0), _budget(256 * 1024 * 1024) { }
+
+    void retain() { _referenceCount++; }
+    void release() { if (--_referenceCount == 0) delete this; }
+
+    // memory held by finished mesh deltas, undo steps are dropped above the budget
+    size_t meshDeltas() const { return _meshDeltas; }
+    void resizeMeshDelta(size_t oldSize, size_t newSize) { _meshDeltas = _meshDeltas - oldSize + newSize; }
+    size_t budget() const { return _budget; }
+    void setBudget(size_t value) { _budget = value; }
+
+    // Finished mesh deltas from the oldest. Trimming drops the oldest ones
+    // until the rest fits the budget, the newest one is always kept.
+    // Dropped steps stay in the list until the undo manager deletes them.
+    unsigned int stepCount() const { return (unsigned int)_steps.size(); }
+    unsigned int droppedStepCount() const;
+    void addStep(MeshDelta *delta);
+    void removeStep(MeshDelta *delta);
+    void trimToBudget();
+
+    // Removed items alive in undo steps. Removing moves the last one into
+    // the freed slot and returns it, NULL when the removed one was last.
+    const vector<RemovedItem *> &removedItems() const { return _removedItems; }
+    unsigned int addRemovedItem(RemovedItem *item);
+    RemovedItem *removeRemovedItem(unsigned int index);
+};
+
+// Replaces the range [start, start + length) of an array with values and
+// keeps the replaced part in values, so applying it twice restores the array.
+template <class T>
+struct MeshArraySplice
+{
+    unsigned int start;
+    unsigned int length;
+    vector<T> values;
+
+    MeshArraySplice() : start(0), length(0) { }
+
+    void make(const vector<T> &before, const vector<T> &after);
+    void apply(vector<T> &array);
+    size_t memorySize() const { return values.capacity() * sizeof(T); }
+};
+
+// Difference between two states of one mesh. Swapping puts the other state
+// into the mesh and keeps the replaced one, so one delta serves both undo
+// and redo. Moved vertices and changed selection are swapped in place.
+// Edits made of local edits are recorded as they go into a patch of the
+// faces and vertices they touched. Other edits compare snapshots and keep
+// a patch when few faces changed, splices of the index arrays, or the
+// compressed geometry when the splices would be too large.
+class MeshDelta
+{
+private:
+    unsigned int _index;
+    UndoMemory *_memory;
+    MeshRecording *_recording;
+    bool _positionsOnly;
+    bool _finished;
+    bool _dropped;
+
+    vector<unsigned int> _vertexIndices;
+    vector<Vector3D> _vertexPositions;
+    vector<unsigned int> _texCoordIndices;
+    vector<Vector3D> _texCoordPositions;
+    vector<unsigned int> _selectionIndices;
+    vector<bool> _selectionValues;
+    unsigned int _selectionCount;
+
+    bool _topologyChanged;
+    bool _patched;
+    MeshPatch *_patch;
+    MeshArraySplice<float> _positionsSplice;
+    MeshArraySplice<float> _texCoordsSplice;
+    MeshArraySplice<unsigned char> _faceSizesSplice;
+    MeshArraySplice<unsigned int> _vertexIndicesSplice;
+    MeshArraySplice<unsigned int> _texCoordIndicesSplice;
+    vector<unsigned char> _geometry;
+
+    bool _selectionChanged;
+    vector<bool> _selection;
+    MeshSelectionMode _selectionMode;
+
+    size_t _memorySize;
+
+    void makePatch(const MeshSnapshot &before, const MeshSnapshot &after, MeshPatch &patch);
+    void finishSnapshot(Mesh2 *mesh);
+    void updateMemorySize();
+public:
+    // With positionsOnly only the movable positions are captured, enough
+    // for manipulations. The index is the item of the mesh, finish and swap
+    // get the mesh of that item, it can be a copy of this one by then.
+    MeshDelta(Mesh2 *mesh, unsigned int index, bool positionsOnly, UndoMemory *memory);
+    ~MeshDelta();
+
+    unsigned int index() { return _index; }
+    void finish(Mesh2 *mesh);
+    void swap(Mesh2 *mesh);
+    // frees the recorded changes, a dropped delta swaps nothing
+    void drop();
+    bool dropped() { return _dropped; }
+    // capacity of the arrays, without the recording held until finish
+    size_t memorySize() { return _memorySize; }
+};
+
+template <class T>
+void MeshArraySplice<T>::make(const vector<T> &before, const vector<T> &after)
+{
+    size_t prefix = 0;
+    size_t common = min(before.size(), after.size());
+    while (prefix < common && memcmp(&before[prefix], &after[prefix], sizeof(T)) == 0)
+        prefix++;
+
+    size_t suffix = 0;
+    while (suffix < common - prefix &&
+           memcmp(&before[before.size() - 1 - suffix], &after[after.size() - 1 - suffix], sizeof(T)) == 0)
+        suffix++;
+
+    start = (unsigned int)prefix;
+    length = (unsigned int)(after.size() - prefix - suffix);
+    values.assign(before.begin() + prefix, before.end() - suffix);
+}
+
+template <class T>
+void MeshArraySplice<T>::apply(vector<T> &array)
+{
+    vector<T> replaced(array.begin() + start, array.begin() + start + length);
+    array.erase(array.begin() + start, array.begin() + start + length);
+    array.insert(array.begin() + start, values.begin(), values.end());
+    length = (unsigned int)values.size();
+    values.swap(replaced);
+}
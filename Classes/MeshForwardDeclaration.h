@@ -12,7 +12,11 @@
 #include "Exceptions.h"
 #include "MathDeclaration.h"
 #include "FPArrayCache.h"
+#include "FPEdgeMap.h"
+#include "FPSpatialGrid.h"
+#include "FPWeldGrid.h"
 #include "SimpleNodeAndList.h"
+#include <climits>
 #include <vector>
 using namespace std;
 
@@ -34,6 +38,107 @@ struct Edge
 	unsigned int vertexIndices[2];
 };
 
+// Hidden parts of a mesh by list index, edges by the indices of their two
+// vertices (or texture coordinates), so they survive a rebuild from indices.
+struct MeshVisibility
+{
+    vector<unsigned int> hiddenVertices;
+    vector<unsigned int> hiddenTexCoords;
+    vector<unsigned int> hiddenTriangles;
+    vector<Edge> hiddenVertexEdges;
+    vector<Edge> hiddenTexCoordEdges;
+};
+
+// Nodes of one vertex (or texture coordinate) list in a MeshPatch.
+// Removed and moved nodes are indexed in the list before the patch, added
+// nodes and the ends of edges in the list after it.
+struct MeshPatchVertices
+{
+    vector<unsigned int> removed;
+    vector<unsigned int> added;
+    vector<Vector3D> positions;
+    vector<unsigned char> flags;
+    vector<unsigned int> moved;
+    vector<Vector3D> movedPositions;
+    vector<Edge> edges;
+    vector<unsigned char> edgeFlags;
+    
+    size_t memorySize() const
+    {
+        return (removed.capacity() + added.capacity() + moved.capacity()) * sizeof(unsigned int) +
+               (positions.capacity() + movedPositions.capacity()) * sizeof(Vector3D) +
+               flags.capacity() + edges.capacity() * sizeof(Edge) + edgeFlags.capacity();
+    }
+};
+
+// Change of a mesh in the form of Mesh2::toIndexArrays. Mesh2::swapPatch
+// takes out the removed nodes, puts the added ones at their sorted indices,
+// moves kept vertices, sets the flags of the listed edges and leaves the
+// reverse change in the patch. Corners of added faces index the lists
+// after the patch.
+struct MeshPatch
+{
+    static const unsigned char kSelected = 1;
+    static const unsigned char kHidden = 2;
+    
+    MeshPatchVertices vertices;
+    MeshPatchVertices texCoords;
+    vector<unsigned int> removedFaces;
+    vector<unsigned int> addedFaces;
+    vector<unsigned char> faceSizes;
+    vector<unsigned char> faceFlags;
+    vector<unsigned int> vertexIndices;
+    vector<unsigned int> texCoordIndices;
+    
+    size_t memorySize() const
+    {
+        return vertices.memorySize() + texCoords.memorySize() + faceSizes.capacity() + faceFlags.capacity() +
+               (removedFaces.capacity() + addedFaces.capacity() +
+                vertexIndices.capacity() + texCoordIndices.capacity()) * sizeof(unsigned int);
+    }
+};
+
+// Whole mesh in the form of Mesh2::toIndexArrays with its selection and
+// hidden parts.
+struct MeshSnapshot
+{
+    vector<float> positions;
+    vector<float> texCoords;
+    vector<unsigned char> faceSizes;
+    vector<unsigned int> vertexIndices;
+    vector<unsigned int> texCoordIndices;
+    vector<bool> selection;
+    MeshSelectionMode selectionMode;
+    MeshVisibility visibility;
+};
+
+// What a mesh changed since Mesh2::beginRecording. Local edits keep the
+// faces, vertices and edges they touch in patch, numbered as they were when
+// the first local edit began, endRecording turns it into the patch back.
+// Any other edit takes a snapshot of the whole mesh first.
+struct MeshRecording
+{
+    enum class State
+    {
+        Unchanged,
+        Local,
+        Snapshot
+    };
+    
+    State state;
+    bool inLocalEdit;
+    unsigned int vertexCount;
+    unsigned int texCoordCount;
+    unsigned int faceCount;
+    vector<bool> touchedFaces;
+    vector<bool> movedVertices;
+    vector<unsigned int> removedFaces;
+    MeshPatch patch;
+    MeshSnapshot snapshot;
+    
+    MeshRecording() : state(State::Unchanged), inLocalEdit(false), vertexCount(0), texCoordCount(0), faceCount(0) { }
+};
+
 class Vertex2
 {
 public:
@@ -81,18 +186,9 @@ class TriangleNode;
 class VertexTriangleNode : public FPNode<VertexTriangleNode, TriangleNode *>
 {
 public:
-    int cacheIndices[2];
-    
-    VertexTriangleNode() : FPNode<VertexTriangleNode, TriangleNode *>()
-    {
-        cacheIndices[0] = -1;
-        cacheIndices[1] = -1;
-    }
-    VertexTriangleNode(TriangleNode* const &data) : FPNode<VertexTriangleNode, TriangleNode *>(data)
-    {
-        cacheIndices[0] = -1;
-        cacheIndices[1] = -1;
-    }
+    VertexTriangleNode() : FPNode<VertexTriangleNode, TriangleNode *>() { }
+    VertexTriangleNode(FPNodeAllocator *) : FPNode<VertexTriangleNode, TriangleNode *>() { }
+    VertexTriangleNode(TriangleNode* const &data) : FPNode<VertexTriangleNode, TriangleNode *>(data) { }
     virtual ~VertexTriangleNode() { }
 };
 
@@ -103,6 +199,7 @@ public:
     int cacheIndex;
     
     VertexVEdgeNode() : FPNode<VertexVEdgeNode<T>, VEdgeNode<T> *>(), cacheIndex(-1) { }
+    VertexVEdgeNode(FPNodeAllocator *) : FPNode<VertexVEdgeNode<T>, VEdgeNode<T> *>(), cacheIndex(-1) { }
     VertexVEdgeNode(VEdgeNode<T> * const &data) : FPNode<VertexVEdgeNode<T>, VEdgeNode<T> *>(data), cacheIndex(-1) { }
     virtual ~VertexVEdgeNode() { }
 };
@@ -7,6 +7,8 @@
 //
 
 #include "MyDocument.h"
+#include "WavefrontObjectReader.h"
+#include "WavefrontObjectWriter.h"
 #include <sstream>
 
 #include "rapidxml.hpp"
@@ -29,6 +31,21 @@ vector<T> *ReadValues(string s)
     return values;
 }
 
+// Items share their meshes with the writer, which applies the transforms.
+static void addItemsToWriter(ItemCollection *items, WavefrontObjectWriter &writer)
+{
+    NSString *version = [[[NSBundle mainBundle] infoDictionary] valueForKey:@"CFBundleVersion"];
+    writer.setComment(string("Exported from MeshMaker ") + [version UTF8String]);
+    
+    for (unsigned int i = 0; i < items->count(); i++)
+    {
+        Item *item = items->itemAtIndex(i);
+        char name[32];
+        snprintf(name, sizeof(name), "Item_%u", i);
+        writer.addGroup(name, item->sharedMesh(), item->transform());
+    }
+}
+
 @implementation MyDocument (Archiving)
 
 - (BOOL)readFromFileWrapper:(NSFileWrapper *)dirWrapper ofType:(NSString *)typeName error:(NSError *__autoreleasing *)outError
@@ -101,7 +118,9 @@ vector<T> *ReadValues(string s)
 
 - (BOOL)readFromModel3D:(NSData *)data
 {
-    MemoryReadStream *stream = new MemoryReadStream(data);
+    FPProfileZone zone("MyDocument::readFromModel3D");
+    
+    MemoryReadStream *stream = new MemoryReadStream([data bytes], [data length]);
     
     ModelVersion version = (ModelVersion)stream->read<unsigned int>();
     
@@ -135,8 +154,9 @@ vector<T> *ReadValues(string s)
 
 - (NSData *)dataOfModel3D
 {
-    NSMutableData *data = [[NSMutableData alloc] init];
-    MemoryWriteStream *stream = new MemoryWriteStream(data);
+    FPProfileZone zone("MyDocument::dataOfModel3D");
+    
+    MemoryWriteStream *stream = new MemoryWriteStream();
     
     unsigned int version = (unsigned int)ModelVersion::Latest;
     stream->setVersion(version);
@@ -144,6 +164,8 @@ vector<T> *ReadValues(string s)
     textures->encode(stream);
     items->encode(stream, *textures);
 
+    NSUInteger length = stream->length();
+    NSData *data = [NSData dataWithBytesNoCopy:stream->detachBytes() length:length freeWhenDone:YES];
     delete stream;
     
     return data;
@@ -151,135 +173,28 @@ vector<T> *ReadValues(string s)
 
 + (ItemCollection *)readItemsFromWavefrontObject:(NSData *)data
 {
-    NSString *fileContents = [NSString stringWithUTF8String:(const char *)[data bytes]];
-    string str = [fileContents UTF8String];
-    stringstream ssfile;
-    ssfile << str;
+    FPProfileZone zone("MyDocument::readItemsFromWavefrontObject");
+    
+    WavefrontObjectReader reader;
+    reader.read((const char *)[data bytes], [data length]);
     
     vector<Vector3D> vertices;
     vector<Vector3D> texCoords;
     vector<TriQuad> triangles;
-    vector<unsigned int> groups;
-    
-    bool hasTexCoords = false;
-    bool hasNormals = false;
-    
-    while (!ssfile.eof())
-    {
-        string line;
-        getline(ssfile, line);
-        stringstream ssline;
-        ssline << line;
-        
-        string prefix;
-        ssline >> prefix;
-        
-        if (prefix == "#")
-        {
-            // # This is a comment
-            continue;
-        }
-        else if (prefix == "g")
-        {
-            // g group_name
-            groups.push_back(static_cast<unsigned int>(triangles.size()));
-        }
-        else if (prefix == "v")
-        {
-            // v -5.79346 -1.38018 42.63113
-            Vector3D v;
-            ssline >> v.x >> v.y >> v.z;
-            
-            swap(v.y, v.z);
-            v.z = -v.z;
-            
-            vertices.push_back(v);
-        }
-        else if (prefix == "vt")
-        {
-            // vt 0.12528 -0.64560
-            Vector3D vt;
-            ssline >> vt.x >> vt.y >> vt.z;
-            
-            vt.z = 0.0f;
-            
-            texCoords.push_back(vt);
-            hasTexCoords = true;
-        }
-        else if (prefix == "vn")
-        {
-            // vn -0.78298 -0.13881 -0.60637
-            hasNormals = true;
-        }
-        else if (prefix == "f")
-        {
-            // f  v1 v2 v3 v4 ...
-            // f  v1/vt1 v2/vt2 v3/vt3 ...
-            // f  v1/vt1/vn1 v2/vt2/vn2 v3/vt3/vn3 ...
-            // f  v1//vn1 v2//vn2 v3//vn3 ...
-            
-            // f  187/1/1 204/2/2 185/3/3
-            
-            TriQuad triQuad;
-            for (unsigned int i = 0; i < 4; i++)
-            {
-                unsigned int vi = 0, ti = 0, ni = 0;
-                char c;
-                
-                if (!hasTexCoords && !hasNormals)
-                    ssline >> vi;
-                else if (hasTexCoords && !hasNormals)
-                    ssline >> vi >> c >> ti;
-                else if (!hasTexCoords && hasNormals)
-                    ssline >> vi >> c >> c >> ni;
-                else if (hasTexCoords && hasNormals)
-                    ssline >> vi >> c >> ti >> c >> ni;
-                
-                triQuad.vertexIndices[i] = vi == 0 ? 0 : vi - 1;
-                triQuad.texCoordIndices[i] = ti == 0 ? 0 : ti - 1;
-            }
-            triQuad.isQuad = ssline.good();
-            triangles.push_back(triQuad);
-        }
-    }
-    
-    Mesh2 *mesh = new Mesh2();
-    if (!hasTexCoords)
-        mesh->fromIndexRepresentation(vertices, vertices, triangles);
-    else
-        mesh->fromIndexRepresentation(vertices, texCoords, triangles);
-    
-    mesh->flipAllTriangles();
-    
-    mesh->setSelectionMode(MeshSelectionMode::Triangles);
     
     ItemCollection *newItems = new ItemCollection();
     
-    for (unsigned int i = 0; i < groups.size(); i++)
+    for (unsigned int i = 0; i < reader.groupCount(); i++)
     {
-        for (unsigned int j = 0; j < mesh->triangleCount(); j++)
-            mesh->setSelectedAtIndex(false, j);
-        
-        for (unsigned int j = groups.at(i), end = i + 1 < groups.size() ? groups.at(i + 1) : mesh->triangleCount(); j < end; j++)
-            mesh->setSelectedAtIndex(true, j);
+        reader.groupIndexRepresentation(i, vertices, texCoords, triangles);
         
         Item *item = new Item(new Mesh2());
-        mesh->fillMeshFromSelectedTriangles(*item->mesh);
+        item->mesh()->fromIndexRepresentation(vertices, texCoords, triangles);
+        item->mesh()->flipAllTriangles();
         item->setPositionToGeometricCenter();
         newItems->addItem(item);
     }
     
-    if (groups.empty())
-    {
-        Item *item = new Item(mesh);
-        item->setPositionToGeometricCenter();
-        newItems->addItem(item);
-    }
-    else
-    {
-        delete mesh;
-    }
-    
     return newItems;
 }
 
@@ -300,71 +215,39 @@ vector<T> *ReadValues(string s)
 
 - (NSData *)dataOfWavefrontObject
 {
+    FPProfileZone zone("MyDocument::dataOfWavefrontObject");
+    
     if (items->count() == 0)
         return [@"# Nothing to export" dataUsingEncoding:NSUTF8StringEncoding];
     
-    stringstream ssfile;
+    WavefrontObjectWriter writer;
+    addItemsToWriter(items, writer);
     
-    NSString *version = [[[NSBundle mainBundle] infoDictionary] valueForKey:@"CFBundleVersion"];
-    ssfile << "# Exported from MeshMaker " << [version UTF8String] << endl;
+    MemoryWriteStream *stream = new MemoryWriteStream();
+    writer.write(stream);
     
-    // face indices in Wavefront Object starts from 1
-    unsigned int vertexIndexOffset = 1;
-    unsigned int texCoordIndexOffset = 1;
+    NSUInteger length = stream->length();
+    NSData *data = [NSData dataWithBytesNoCopy:stream->detachBytes() length:length freeWhenDone:YES];
+    delete stream;
     
-    for (unsigned int itemIndex = 0; itemIndex < items->count(); itemIndex++)
-    {
-        Item *item = items->itemAtIndex(itemIndex);
-        
-        vector<Vector3D> vertices;
-        vector<Vector3D> texCoords;
-        vector<TriQuad> triangles;
-        
-        Item *duplicate = item->duplicate();
-        Mesh2 *mesh = duplicate->mesh;
-        mesh->transformAll(duplicate->transform());
-        mesh->flipAllTriangles();
-        mesh->toIndexRepresentation(vertices, texCoords, triangles);
-        
-        ssfile << "g Item_" << itemIndex << endl;
-        ssfile << "# Number of vertices = " << vertices.size() << endl;
-        for (unsigned int i = 0; i < vertices.size(); i++)
-        {
-            // v -5.79346 -1.38018 42.63113
-            Vector3D v = vertices[i];
-            v.z = -v.z;
-            swap(v.y, v.z);
-            ssfile << "v " << v.x << " " << v.y << " " << v.z << endl;
-        }
-        
-        ssfile << "# Number of texture coordinates = " << texCoords.size() << endl;
-        for (unsigned int i = 0; i < texCoords.size(); i++)
-        {
-            // vt 0.12528 -0.64560
-            ssfile << "vt " << texCoords[i].x << " " << texCoords[i].y << " " << endl;
-        }
-        
-        ssfile << "# Number of triangles and quads = " << triangles.size() << endl;
-        for (unsigned int i = 0; i < triangles.size(); i++)
-        {
-            // f  v1/vt1 v2/vt2 v3/vt3 ...
-            ssfile << "f ";
-            const TriQuad &triQuad = triangles[i];
-            unsigned int count =  triQuad.isQuad ? 4 : 3;
-            for (unsigned int i = 0; i < count; i++)
-            {
-                ssfile << triQuad.vertexIndices[i] + vertexIndexOffset << "/";
-                ssfile << triQuad.texCoordIndices[i] + texCoordIndexOffset << " ";
-            }
-            ssfile << endl;
-        }
-        
-        vertexIndexOffset += vertices.size();
-        texCoordIndexOffset += texCoords.size();
-    }
+    return data;
+}
+
+// Wavefront Object goes straight to the file instead of through NSData.
+- (BOOL)writeToURL:(NSURL *)url ofType:(NSString *)typeName error:(NSError *__autoreleasing *)outError
+{
+    if (![typeName isEqualToString:@"Wavefront Object"] || items->count() == 0)
+        return [super writeToURL:url ofType:typeName error:outError];
+    
+    WavefrontObjectWriter writer;
+    addItemsToWriter(items, writer);
+    
+    if (writer.writeFile([url fileSystemRepresentation]))
+        return YES;
     
-    string str = ssfile.str();
-    return [[NSString stringWithUTF8String:str.c_str()] dataUsingEncoding:NSUTF8StringEncoding];
+    if (outError)
+        *outError = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+    return NO;
 }
 
 - (void)readMesh:(Mesh2 *)itemMesh fromXml:(xml_node< > *)meshXml
@@ -476,7 +359,7 @@ vector<T> *ReadValues(string s)
             {
                 if (strcmp(urlValue, geometry->first_attribute("id")->value()) == 0)
                 {
-                    [self readMesh:item->mesh fromXml:geometry->first_node("mesh")];
+                    [self readMesh:item->mesh() fromXml:geometry->first_node("mesh")];
                     break;
                 }
             }
@@ -606,7 +489,7 @@ vector<T> *ReadValues(string s)
                 vector<TriQuad> triangles;
                 
                 Item *duplicate = item->duplicate();
-                Mesh2 *mesh = duplicate->mesh;
+                Mesh2 *mesh = duplicate->mesh();
                 mesh->transformAll(duplicate->transform());
                 
                 mesh->triangulate();
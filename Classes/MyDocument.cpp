@@ -55,7 +55,7 @@
 		
 		manipulationFinished = YES;
 		oldManipulations = nil;
-		oldMeshState = nil;
+		meshDelta = nil;
 		
 		views = [[NSMutableArray alloc] init];
 		oneView = nil;
@@ -64,6 +64,10 @@
         
         NSUndoManager *undo = [self undoManager];
         [undo setLevelsOfUndo:100];
+        
+        NSInteger budget = [[NSUserDefaults standardUserDefaults] integerForKey:@"UndoMemoryBudget"];
+        if (budget > 0)
+            items->undoMemory().setBudget((size_t)budget * 1024 * 1024);
     }
     return self;
 }
@@ -158,7 +162,7 @@
 	}
 	else if (manipulated == meshController)
 	{
-		int meshTag = (int)[self currentMesh]->selectionMode() + 1;
+		int meshTag = (int)[self currentSharedMesh]->selectionMode() + 1;
 		[editModePopUp selectItemWithTag:meshTag];
 	}
 }
@@ -168,19 +172,30 @@
     manipulated->updateSelection();
 }
 
-- (Mesh2 *)currentMesh
+- (Item *)currentItem
 {
 	if (manipulated == meshController)
-    {
-        Item *item = (Item *)meshController->model();
-        return item->mesh;
-    }
+        return (Item *)meshController->model();
     if (manipulated == itemsController)
     {
         ItemCollection *itemCollection = (ItemCollection *)itemsController->model();
-        return itemCollection->currentMesh();
+        return itemCollection->firstSelectedItem();
     }
-	return nil;
+	return NULL;
+}
+
+// Copies a mesh shared with duplicates or undo steps, so it is only called
+// right before the mesh is changed. Everything else reads currentSharedMesh.
+- (Mesh2 *)currentMesh
+{
+    Item *item = [self currentItem];
+    return item ? item->mesh() : nil;
+}
+
+- (Mesh2 *)currentSharedMesh
+{
+    Item *item = [self currentItem];
+    return item ? item->sharedMesh() : nil;
 }
 
 - (MyDocument *)prepareUndoWithName:(NSString *)actionName
@@ -195,10 +210,10 @@
 - (void)addItemWithType:(enum MeshType)type steps:(unsigned int)steps;
 {
 	Item *item = new Item(new Mesh2());
-	Mesh2 *mesh = item->mesh;
+	Mesh2 *mesh = item->mesh();
     mesh->make(type, steps);
 	
-	NSString *name = Mesh2::descriptionOfMeshType(type);
+	NSString *name = [NSString stringWithUTF8String:Mesh2::descriptionOfMeshType(type)];
 	
 	MyDocument *document = [self prepareUndoWithName:[NSString stringWithFormat:@"Add %@", name]];
 	[document removeItemWithType:type steps:steps];
@@ -215,7 +230,7 @@
 
 - (void)removeItemWithType:(enum MeshType)type steps:(unsigned int)steps
 {
-	NSString *name = Mesh2::descriptionOfMeshType(type);
+	NSString *name = [NSString stringWithUTF8String:Mesh2::descriptionOfMeshType(type)];
 	
 	MyDocument *document = [self prepareUndoWithName:[NSString stringWithFormat:@"Remove %@", name]];
 	[document addItemWithType:type steps:steps];
@@ -327,25 +342,23 @@
 	[self setManipulated:itemsController];
 }
 
-- (void)swapMeshStateWithOld:(UndoStatePointer *)old
-					 current:(UndoStatePointer *)current
-				  actionName:(NSString *)actionName
+- (void)swapMeshDelta:(UndoStatePointer *)delta
+			actionName:(NSString *)actionName
 {
-    if (old.undoState == NULL)
+    if (delta.undoState == NULL)
         return;
     
-    items->setCurrentMeshState(old.undoState);
+    items->swapMeshDelta(delta.undoState);
     
-    MeshState *meshState = dynamic_cast<UndoState<MeshState> *>(old.undoState)->state();
-	Item *item = items->itemAtIndex(meshState->index());
+    MeshDelta *state = dynamic_cast<UndoState<MeshDelta> *>(delta.undoState)->state();
+	Item *item = items->itemAtIndex(state->index());
 	
     meshController->setModel(item);
     meshController->setPositionRotationScale(item->position, item->rotation, item->scale);
     
 	MyDocument *document = [self prepareUndoWithName:actionName];
-	[document swapMeshStateWithOld:current
-						   current:old
-						actionName:actionName];
+	[document swapMeshDelta:delta
+				 actionName:actionName];
 	
 	itemsController->updateSelection();
 	meshController->updateSelection();
@@ -371,15 +384,38 @@
 
 - (void)meshActionWithName:(NSString *)actionName block:(void (^)())action
 {
+	FPProfileZone zone("MyDocument::meshAction");
 	MyDocument *document = [self prepareUndoWithName:actionName];
-	UndoStatePointer *oldState = [[UndoStatePointer alloc] initWithUndoState:items->currentMeshState()];
+	UndoStatePointer *delta = [[UndoStatePointer alloc] initWithUndoState:items->beginMeshDelta(false)];
 	
 	action();
 	
-	UndoStatePointer *currentState = [[UndoStatePointer alloc] initWithUndoState:items->currentMeshState()];
-	[document swapMeshStateWithOld:oldState 
-						   current:currentState
-						actionName:actionName];
+	items->finishMeshDelta(delta.undoState);
+	[document swapMeshDelta:delta
+				 actionName:actionName];
+	[self trimUndoToMemoryBudget];
+}
+
+// Finishing a mesh delta drops the recorded changes of the oldest ones
+// above the memory budget. Lowering the undo limit then removes their
+// steps, oldest first. The removed steps can be autoreleased, their
+// deltas leave the step list when the pool drains.
+- (void)trimUndoToMemoryBudget
+{
+	NSUndoManager *undo = [self undoManager];
+	NSUInteger levels = [undo levelsOfUndo];
+	UndoMemory &memory = items->undoMemory();
+	NSUInteger limit = levels > 0 ? levels : memory.stepCount();
+	
+	for (; limit > 1 && memory.droppedStepCount() > 0; limit--)
+	{
+		@autoreleasepool
+		{
+			[undo setLevelsOfUndo:limit - 1];
+		}
+	}
+	
+	[undo setLevelsOfUndo:levels];
 }
 
 - (void)manipulationStartedInView:(OpenGLSceneView *)view
@@ -392,7 +428,7 @@
 	}
 	else if (manipulated == meshController)
 	{
-		oldMeshState = [[UndoStatePointer alloc] initWithUndoState:items->currentMeshState()];
+		meshDelta = [[UndoStatePointer alloc] initWithUndoState:items->beginMeshDelta(true)];
 	}
 }
 
@@ -413,10 +449,11 @@
 	else if (manipulated == meshController)
 	{
 		MyDocument *document = [self prepareUndoWithName:@"Mesh Manipulation"];
-		[document swapMeshStateWithOld:oldMeshState
-                               current:[[UndoStatePointer alloc] initWithUndoState:items->currentMeshState()]
-                            actionName:@"Mesh Manipulation"];
-		oldMeshState = nil;
+		items->finishMeshDelta(meshDelta.undoState);
+		[document swapMeshDelta:meshDelta
+					 actionName:@"Mesh Manipulation"];
+		meshDelta = nil;
+		[self trimUndoToMemoryBudget];
         
         meshController->willChangeSelection();
         meshController->didChangeSelection();
@@ -478,7 +515,8 @@
 	if (index > -1)
 	{
         Item *item = items->itemAtIndex(static_cast<unsigned int>(index));
-        item->mesh->setSelectionMode(mode);
+        // the selection mode is not part of what the shared mesh copies protect
+        item->sharedMesh()->setSelectionMode(mode);
         
 		meshController->setModel(item);
 		meshController->setPositionRotationScale(item->position, item->rotation, item->scale);
@@ -489,7 +527,7 @@
 
 - (void)editItems
 {
-    Mesh2 *currentMesh = [self currentMesh];
+    Mesh2 *currentMesh = [self currentSharedMesh];
     if (currentMesh)
         currentMesh->setSelectionMode(MeshSelectionMode::Vertices);
     
@@ -503,7 +541,7 @@
 - (IBAction)changeEditMode:(id)sender
 {
 	EditMode mode = (EditMode)[[editModePopUp selectedItem] tag];
-    Mesh2 *currentMesh = [self currentMesh];
+    Mesh2 *currentMesh = [self currentSharedMesh];
     
     if (!currentMesh)
         [editModePopUp selectItemWithTag:(int)EditMode::Items];
@@ -554,9 +592,21 @@
 	[self setNeedsDisplayOnAllViews];
 }
 
+- (IBAction)weldSelected:(id)sender
+{
+	if (manipulated != meshController || manipulated->selectedCount() <= 0)
+		return;
+	
+	// same tolerance as welding of imported triangle soups
+	[self meshActionWithName:@"Weld" block:^ { [self currentMesh]->weldSelected(sqrtf(FLOAT_EPS)); }];
+	
+	manipulated->updateSelection();
+	[self setNeedsDisplayOnAllViews];
+}
+
 - (void)meshOnlyActionWithName:(NSString *)actionName block:(void (^)())action
 {    
-    if ([self currentMesh] == nil)
+    if ([self currentSharedMesh] == nil)
         return;
 	
 	BOOL startManipulation = NO;
@@ -706,6 +756,11 @@
     [self meshOnlyActionWithName:@"Subdivision" block:^ { [self currentMesh]->loopSubdivision(); }];
 }
 
+- (IBAction)subdivisionSelected:(id)sender
+{
+    [self meshOnlyActionWithName:@"Subdivide Selected" block:^ { [self currentMesh]->loopSubdivisionSelected(); }];
+}
+
 - (BOOL)useSoftSelection
 {
     return Mesh2::useSoftSelection();
@@ -716,6 +771,28 @@
     Mesh2::setUseSoftSelection(value);
 }
 
+- (NSInteger)softSelectionFalloff
+{
+    return (NSInteger)Mesh2::softSelectionFalloff();
+}
+
+- (void)setSoftSelectionFalloff:(NSInteger)value
+{
+    Mesh2::setSoftSelectionFalloff((SoftSelectionFalloff)value);
+    [self weightsChanged];
+}
+
+- (float)softSelectionRadius
+{
+    return Mesh2::softSelectionRadius();
+}
+
+- (void)setSoftSelectionRadius:(float)value
+{
+    Mesh2::setSoftSelectionRadius(value);
+    [self weightsChanged];
+}
+
 - (BOOL)selectThrough
 {
     return OpenGLSceneViewCore::_alwaysSelectThrough;
@@ -807,7 +884,7 @@
         [self allItemsActionWithName:@"Triangulate" block:^
         {
             for (unsigned int i = 0; i < items->count(); i++)
-                items->itemAtIndex(i)->mesh->triangulate();
+                items->itemAtIndex(i)->mesh()->triangulate();
         }];
     }
 }
@@ -836,13 +913,46 @@
         if (result == NSFileHandlingPanelOKButton)
         {
             NSURL *url = panel.URL;
-            ItemCollection *pointCloud = [MyDocument readItemsFromWavefrontObject:[NSData dataWithContentsOfURL:url]];
+            ItemCollection *pointCloud = [MyDocument readItemsFromWavefrontObject:[NSData dataWithContentsOfURL:url options:NSDataReadingMappedIfSafe error:nil]];
             self->items->addItem(pointCloud->itemAtIndex(0)->duplicate());
             delete pointCloud;
         }
     }];
 }
 
+- (IBAction)showMemoryFootprint:(id)sender
+{
+    unsigned int vertexCount, triangleCount;
+    items->getVertexAndTriangleCount(vertexCount, triangleCount);
+    
+    FPMemoryFootprint footprint = items->memoryFootprint();
+    footprint.add(items->undoFootprint());
+    
+    NSString *text = [NSString stringWithFormat:@"%s\n%u vertices, %u faces, %.0f bytes per face",
+                      footprint.description().c_str(), vertexCount, triangleCount,
+                      triangleCount > 0 ? (double)footprint.total() / triangleCount : 0.0];
+    
+    NSAlert *alert = [[NSAlert alloc] init];
+    [alert setMessageText:@"Memory Footprint"];
+    [alert setInformativeText:text];
+    [alert beginSheetModalForWindow:[self windowForSheet] modalDelegate:nil didEndSelector:NULL contextInfo:NULL];
+}
+
+- (IBAction)saveProfilerTrace:(id)sender
+{
+    NSSavePanel *panel = [NSSavePanel savePanel];
+    [panel setNameFieldStringValue:@"trace.json"];
+    
+    [panel beginWithCompletionHandler:^(NSInteger result)
+    {
+        if (result == NSFileHandlingPanelOKButton)
+        {
+            if (!FPProfiler::writeChromeTrace([[panel.URL path] fileSystemRepresentation]))
+                NSBeep();
+        }
+    }];
+}
+
 - (void)viewSelectionTool:(id)sender
 {
     [selectionWindowController showWindow:nil];
@@ -877,19 +987,26 @@
 {
     if (vertexWindowController.isWindowLoaded && vertexWindowController.window.isVisible)
     {
-        Mesh2 *mesh = [self currentMesh];
+        if ([self currentSharedMesh] == nil)
+            return;
+        
+        Vector3D eyeVector = camera->GetAxisZ();
         switch (vertexWindowController.vertexMode)
         {
             case VertexWindowMode::Add:
-                mesh->addVertex(position);
+                [self meshActionWithName:@"Add Vertex" block:^ { [self currentMesh]->addVertex(position); }];
                 break;
             case VertexWindowMode::TriangleConnect:
-                mesh->triangleConnectVerticesNearPosition(position, camera->GetAxisZ());
-                mesh->resetTriangleCache();
+                [self meshActionWithName:@"Connect Triangle" block:^
+                { 
+                    [self currentMesh]->triangleConnectVerticesNearPosition(position, eyeVector);
+                }];
                 break;
             case VertexWindowMode::QuadConnect:
-                mesh->quadConnectVerticesNearPosition(position, camera->GetAxisZ());
-                mesh->resetTriangleCache();
+                [self meshActionWithName:@"Connect Quad" block:^
+                { 
+                    [self currentMesh]->quadConnectVerticesNearPosition(position, eyeVector);
+                }];
                 break;
             default:
                 break;
@@ -901,7 +1018,7 @@
 {
     if (vertexWindowController.isWindowLoaded && vertexWindowController.window.isVisible)
     {
-        Mesh2 *mesh = [self currentMesh];
+        Mesh2 *mesh = [self currentSharedMesh];
         switch (vertexWindowController.vertexMode)
         {
             case VertexWindowMode::Add:
@@ -53,7 +53,7 @@
 	
 	NSMutableArray *views;
 	UndoStatePointer *oldManipulations;
-	UndoStatePointer *oldMeshState;
+	UndoStatePointer *meshDelta;
     
     enum ManipulatorType currentManipulator;
 	
@@ -76,6 +76,7 @@
 - (void)setNeedsDisplayExceptView:(OpenGLSceneView *)view;
 - (void)setNeedsDisplayOnAllViews;
 - (Mesh2 *)currentMesh;
+- (Mesh2 *)currentSharedMesh;
 - (MyDocument *)prepareUndoWithName:(NSString *)actionName;
 - (void)swapManipulationsWithOld:(UndoStatePointer *)old
                          current:(UndoStatePointer *)current;
@@ -84,9 +85,10 @@
 					current:(UndoStatePointer *)current
 				 actionName:(NSString *)actionName;
 
-- (void)swapMeshStateWithOld:(UndoStatePointer *)old
-					 current:(UndoStatePointer *)current
-				  actionName:(NSString *)actionName;
+- (void)swapMeshDelta:(UndoStatePointer *)delta
+			actionName:(NSString *)actionName;
+
+- (void)trimUndoToMemoryBudget;
 
 - (void)allItemsActionWithName:(NSString *)actionName block:(void (^)())action;
 - (void)meshActionWithName:(NSString *)actionName block:(void (^)())action;
@@ -102,6 +104,7 @@
 - (IBAction)changeEditMode:(id)sender;
 - (IBAction)changeManipulator:(id)sender;
 - (IBAction)mergeSelected:(id)sender;
+- (IBAction)weldSelected:(id)sender;
 - (IBAction)splitSelected:(id)sender;
 - (IBAction)duplicateSelected:(id)sender;
 - (void)redoDuplicateSelected:(UndoStatePointer *)selection;
@@ -117,6 +120,7 @@
 - (IBAction)extrudeSelected:(id)sender;
 - (IBAction)detachSelected:(id)sender;
 - (IBAction)subdivision:(id)sender;
+- (IBAction)subdivisionSelected:(id)sender;
 - (IBAction)cleanTexture:(id)sender;
 - (IBAction)resetTexCoords:(id)sender;
 - (IBAction)triangulate:(id)sender;
@@ -125,6 +129,8 @@
 - (IBAction)viewSelectionTool:(id)sender;
 - (IBAction)viewVertexTool:(id)sender;
 - (IBAction)importPointCloud:(id)sender;
+- (IBAction)saveProfilerTrace:(id)sender;
+- (IBAction)showMemoryFootprint:(id)sender;
 
 @end
 
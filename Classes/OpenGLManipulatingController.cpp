@@ -7,6 +7,7 @@
 //
 
 #include "OpenGLManipulatingController.h"
+#include "FPSoftwarePicker.h"
 
 @implementation OpenGLManipulatingControllerKVC
 
@@ -145,22 +146,37 @@ void OpenGLManipulatingController::drawAllForSelection()
     }
 }
 
+void OpenGLManipulatingController::pickAll(FPSoftwarePicker &picker)
+{
+    picker.setModelTransform(_modelTransform);
+    
+    if (_modelMesh != NULL)
+    {
+        _modelMesh->pickAllForSelection(picker);
+    }
+    else
+    {
+        for (unsigned int i = 0; i < _modelItem->count(); i++)
+            _modelItem->pickAtIndex(i, i + 1, picker);
+    }
+}
+
 bool OpenGLManipulatingController::needsCullFace()
 {
     return _model->needsCullFace();
 }
 
-bool OpenGLManipulatingController::useGLProject()
+bool OpenGLManipulatingController::useProjectSelect()
 {
     if (_modelMesh != NULL)
-        return _modelMesh->useGLProject();
+        return _modelMesh->useProjectSelect();
     return false;
 }
 
-void OpenGLManipulatingController::glProjectSelect(int x, int y, int width, int height, OpenGLSelectionMode selectionMode)
+void OpenGLManipulatingController::projectSelect(const FPSelectionRegion &region, OpenGLSelectionMode selectionMode)
 {
     if (_modelMesh != NULL)
-        _modelMesh->glProjectSelect(x, y, width, height, _modelTransform, selectionMode);
+        _modelMesh->projectSelect(region, _modelTransform, selectionMode);
 }
 
 float OpenGLManipulatingController::selectionX()
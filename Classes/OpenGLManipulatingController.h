@@ -63,9 +63,10 @@ public:
     virtual void didSelect();
     virtual bool isObjectSelectedAtIndex(unsigned int index);
     virtual void drawAllForSelection();
+    virtual void pickAll(FPSoftwarePicker &picker);
     virtual bool needsCullFace();
-    virtual bool useGLProject();
-    virtual void glProjectSelect(int x, int y, int width, int height, OpenGLSelectionMode selectionMode);
+    virtual bool useProjectSelect();
+    virtual void projectSelect(const FPSelectionRegion &region, OpenGLSelectionMode selectionMode);
     
     // IOpenGLTransforming
     
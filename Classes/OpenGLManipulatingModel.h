@@ -44,8 +44,9 @@ public:
     virtual void getSelectionCenterRotationScale(Vector3D &center, Quaternion &rotation, Vector3D &scale) = 0;
     virtual void transformSelectedByMatrix(Matrix4x4 &matrix) = 0;
     virtual void drawAllForSelection(bool forSelection) = 0;
-    virtual bool useGLProject() = 0;
-    virtual void glProjectSelect(int x, int y, int width, int height, Matrix4x4 &matrix, OpenGLSelectionMode selectionMode) = 0;
+    virtual void pickAllForSelection(FPSoftwarePicker &picker) = 0;
+    virtual bool useProjectSelect() = 0;
+    virtual void projectSelect(const FPSelectionRegion &region, const Matrix4x4 &matrix, OpenGLSelectionMode selectionMode) = 0;
 };
 
 class IOpenGLManipulatingModelItem : public IOpenGLManipulatingModel
@@ -63,4 +64,5 @@ public:
     virtual void rotateByOffset(unsigned int index, Quaternion offset) = 0;
     virtual void scaleByOffset(unsigned int index, Vector3D offset) = 0;
     virtual void drawAtIndex(unsigned int index, bool forSelection) = 0;
+    virtual void pickAtIndex(unsigned int index, unsigned int id, FPSoftwarePicker &picker) = 0;
 };
@@ -7,6 +7,8 @@
 //
 
 #include "OpenGLSceneViewCore.h"
+#include "FPVertexBuffer.h"
+#include "FPProfiler.h"
 
 const float perspectiveAngle = 45.0f;
 const float minDistance = 1.0f;
@@ -171,11 +173,13 @@ void OpenGLSceneViewCore::endOrtho()
 	glDepthMask(GL_TRUE);
 }
 
-void OpenGLSceneViewCore::applyProjection()
+Matrix4x4 OpenGLSceneViewCore::projection()
 {
     NSRect bounds = _delegate->bounds();
     float w_h = bounds.size.width / bounds.size.height;
     
+    Matrix4x4 matrix;
+    
 	if (_cameraMode != CameraMode::Perspective)
 	{
 		float x = _camera->GetZoom() * w_h;
@@ -184,12 +188,19 @@ void OpenGLSceneViewCore::applyProjection()
 		x /= 2.0f;
 		y /= 2.0f;
 		
-		glOrtho(-x, x, -y, y, -maxDistance, maxDistance);
+		matrix.Ortho(-x, x, -y, y, -maxDistance, maxDistance);
 	}
 	else
 	{
-		gluPerspective(perspectiveAngle, w_h, minDistance, maxDistance);
+		matrix.Perspective(perspectiveAngle, w_h, minDistance, maxDistance);
 	}
+    
+    return matrix;
+}
+
+void OpenGLSceneViewCore::applyProjection()
+{
+    glMultMatrixf(projection());
 }
 
 const unsigned int kMaxSelectedIndicesCount = 2000 * 2000;  // max width * max height resolution
@@ -201,6 +212,24 @@ bool *OpenGLSceneViewCore::select(int x, int y, int width, int height, IOpenGLSe
     IOpenGLSelectingOptional *optional = dynamic_cast<IOpenGLSelectingOptional *>(selecting);
     unsigned int count = selecting->selectableCount();
     
+    if (optional != NULL)
+    {
+        NSRect bounds = _delegate->bounds();
+        
+        _picker.begin(projection(), _camera->GetViewMatrix(), bounds.size.width, bounds.size.height,
+                      x, y, width, height, count);
+        optional->pickAll(_picker);
+        
+        vector<bool> hits;
+        _picker.end(hits);
+        
+        bool *selected = new bool[count];
+        for (unsigned int i = 0; i < count; i++)
+            selected[i] = hits[i];
+        
+        return selected;
+    }
+    
 	glClearColor(0, 0, 0, 0);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
@@ -259,6 +288,8 @@ bool *OpenGLSceneViewCore::select(int x, int y, int width, int height, IOpenGLSe
 
 void OpenGLSceneViewCore::select(NSPoint point, IOpenGLSelecting *selecting, OpenGLSelectionMode selectionMode)
 {
+    FPProfileZone zone("OpenGLSceneViewCore::selectPoint");
+
     if (selecting == NULL || selecting->selectableCount() <= 0)
 		return;
 
@@ -292,6 +323,8 @@ void OpenGLSceneViewCore::select(NSPoint point, IOpenGLSelecting *selecting, Ope
 
 void OpenGLSceneViewCore::select(NSRect rect, IOpenGLSelecting *selecting, OpenGLSelectionMode selectionMode, bool selectThrough)
 {
+    FPProfileZone zone("OpenGLSceneViewCore::selectRect");
+
     if (selecting == NULL || selecting->selectableCount() <= 0)
 		return;
     
@@ -306,51 +339,22 @@ void OpenGLSceneViewCore::select(NSRect rect, IOpenGLSelecting *selecting, OpenG
     
     if (optional != NULL)
     {
-        if (optional->useGLProject())
+        if (optional->useProjectSelect())
         {
-            optional->glProjectSelect(rect.origin.x, rect.origin.y, rect.size.width, rect.size.height, selectionMode);
+            NSRect bounds = _delegate->bounds();
+
+            FPSelectionRegion region;
+            region.setMatrices(projection(), _camera->GetViewMatrix(), bounds.size.width, bounds.size.height);
+            region.setRectangle(rect.origin.x, rect.origin.y, rect.size.width, rect.size.height);
+
+            optional->projectSelect(region, selectionMode);
             optional->didSelect();
             return;
         }
     }
     
-    bool *selected = NULL;
-    
-    if (optional != NULL && optional->needsCullFace())
-    {
-        glCullFace(GL_CCW);
-        glEnable(GL_CULL_FACE);
-        
-        bool *selected1 = select(rect.origin.x, rect.origin.y, rect.size.width, rect.size.height, selecting);
-        
-        glDisable(GL_CULL_FACE);
-        
-        bool *selected2 = select(rect.origin.x, rect.origin.y, rect.size.width, rect.size.height, selecting);
-        
-        if (selected1 != NULL)
-        {
-            selected = selected1;
-        }
-        if (selected2 != NULL)
-        {
-            if (selected1 != NULL)
-            {
-                for (unsigned int i = 0; i < count; i++)
-                {
-					selected[i] = selected[i] || selected2[i];
-                }
-                delete [] selected2;
-            }
-            else
-            {
-                selected = selected2;
-            }
-        }
-    }
-    else
-    {
-        selected = select(rect.origin.x, rect.origin.y, rect.size.width, rect.size.height, selecting);
-    }
+    // the software picker selects through without depth test, no culled pass is needed
+    bool *selected = select(rect.origin.x, rect.origin.y, rect.size.width, rect.size.height, selecting);
     
     if (selected != NULL)
     {
@@ -703,7 +707,10 @@ void OpenGLSceneViewCore::drawSelectionRect()
 
 void OpenGLSceneViewCore::draw()
 {
+    FPProfileZone zone("OpenGLSceneViewCore::draw");
+
     ShaderProgram::resetProgram();
+    FPVertexBufferStats::beginFrame();
 
     float clearColor = 0.6f;
 	glClearColor(clearColor, clearColor, clearColor, 1.0f);
@@ -61,6 +61,7 @@ public:
 	Manipulator *_currentManipulator;
 	CameraMode _cameraMode;
     vector<Vector3D> _vertexHints;
+    FPSoftwarePicker _picker;
     
     static bool _alwaysSelectThrough;    
 public:
@@ -77,6 +78,7 @@ public:
     NSRect currentRect();
     void beginOrtho();
     void endOrtho();
+    Matrix4x4 projection();
     void applyProjection();
     bool *select(int x, int y, int width, int height, IOpenGLSelecting *selecting);
     void select(NSPoint point, IOpenGLSelecting *selecting, OpenGLSelectionMode selectionMode);
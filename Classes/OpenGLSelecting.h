@@ -10,6 +10,9 @@
 
 #include "Enums.h"
 
+class FPSoftwarePicker;
+class FPSelectionRegion;
+
 class IOpenGLSelecting
 {
 public:
@@ -29,7 +32,8 @@ public:
     virtual void didSelect() = 0;
     virtual bool isObjectSelectedAtIndex(unsigned int index) = 0;
     virtual void drawAllForSelection() = 0;
+    virtual void pickAll(FPSoftwarePicker &picker) = 0;
     virtual bool needsCullFace() = 0;
-    virtual bool useGLProject() = 0;
-    virtual void glProjectSelect(int x, int y, int width, int height, OpenGLSelectionMode selectionMode) = 0;
+    virtual bool useProjectSelect() = 0;
+    virtual void projectSelect(const FPSelectionRegion &region, OpenGLSelectionMode selectionMode) = 0;
 };
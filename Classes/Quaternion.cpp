@@ -24,14 +24,6 @@ Quaternion::Quaternion(const float * q)
 	z = q[3];
 }
 
-Quaternion::Quaternion(const Quaternion & q)
-{
-	x = q.x;
-	y = q.y;
-	z = q.z;
-	w = q.w;
-}
-
 Quaternion::Quaternion(float x, float y, float z, float w)
 {
 	this->x = x;
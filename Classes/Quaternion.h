@@ -18,7 +18,6 @@ public:
 
 	Quaternion();
 	Quaternion(const float *q);
-	Quaternion(const Quaternion &q);
     Quaternion(float x, float y, float z, float w);
     Quaternion(const Vector3D &eulerAngles);
     Quaternion(float radians, const Vector3D &axis);
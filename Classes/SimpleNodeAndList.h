@@ -15,6 +15,7 @@ class SimpleNode : public FPNode<SimpleNode<TData>, TData>
 {
 public:
     SimpleNode() : FPNode<SimpleNode<TData>, TData>() { }
+    SimpleNode(FPNodeAllocator *) : FPNode<SimpleNode<TData>, TData>() { }
     SimpleNode(const TData &data) : FPNode<SimpleNode<TData>, TData>(data) { }
     virtual ~SimpleNode() { }
 };
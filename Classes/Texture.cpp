@@ -158,7 +158,8 @@ void Texture::removeFromItems(ItemCollection &items)
     for (uint i = 0; i < items.count(); i++)
     {
         Item *item = items.itemAtIndex(i);
-        if (item->mesh->texture() == this)
-            item->mesh->setTexture(NULL);
+        // undo states sharing the mesh lose the texture too
+        if (item->sharedMesh()->texture() == this)
+            item->sharedMesh()->setTexture(NULL);
     }
 }
\ No newline at end of file
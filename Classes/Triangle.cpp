@@ -307,6 +307,16 @@ void Triangle2::flip()
 {
     swap(_nodes[0].vertex, _nodes[2].vertex);
     swap(_nodes[0].texCoord, _nodes[2].texCoord);
+    
+    // edge i goes from vertex i to i + 1, reversing the order swaps the edge pairs
+    swap(_nodes[0].vertexEdge, _nodes[1].vertexEdge);
+    swap(_nodes[0].texCoordEdge, _nodes[1].texCoordEdge);
+    
+    if (isQuad())
+    {
+        swap(_nodes[2].vertexEdge, _nodes[3].vertexEdge);
+        swap(_nodes[2].texCoordEdge, _nodes[3].texCoordEdge);
+    }
 }
 
 unsigned int Triangle2::indexOfVertex(const VertexNode *vertex) const
@@ -465,40 +475,3 @@ void Triangle2::convertBarycentricToUVs(float &u, float &v)
     u = final.x;
     v = final.y;
 }
-
-void TriangleNode::softSelect(const vector<float> &weights)
-{
-    selectionWeight = weights[0];
-    
-    vector<TriangleNode *> currentStepNodes;
-    currentStepNodes.push_back(this);
-    
-    vector<TriangleNode *> nextStepNodes;
-    
-    for (unsigned int w = 1; w < weights.size(); w++)
-    {
-        float weight = weights[w];
-        
-        nextStepNodes.clear();
-        
-        for (unsigned int i = 0; i < currentStepNodes.size(); i++)
-        {
-            TriangleNode *currentNode = currentStepNodes[i];
-            Triangle2 &triangle = currentNode->data();
-            
-            for (unsigned int j = 0; j < triangle.count(); j++)
-            {
-                TriangleNode *oppositeNode = triangle.vertexEdge(j)->data().opposite(currentNode);
-                
-                if (oppositeNode != NULL)
-                {
-                    nextStepNodes.push_back(oppositeNode);
-                    if (oppositeNode->selectionWeight < weight)
-                        oppositeNode->selectionWeight = weight;
-                }
-            }
-        }
-        
-        currentStepNodes = nextStepNodes;
-    }
-}
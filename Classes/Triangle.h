@@ -91,9 +91,12 @@ class TriangleNode : public FPNode<TriangleNode, Triangle2>
 {
 public:
     float selectionWeight;
+    unsigned int cacheIndex; // position in the triangle cache arrays, set by Mesh2::fillTriangleCache
+    unsigned int recordedIndex; // index when a Mesh2 recording numbered it, UINT_MAX for later nodes
     
-    TriangleNode() : FPNode<TriangleNode, Triangle2>() { }
-    TriangleNode(const Triangle2 &triangle) : FPNode<TriangleNode, Triangle2>(triangle)
+    TriangleNode() : FPNode<TriangleNode, Triangle2>(), cacheIndex(0), recordedIndex(UINT_MAX) { }
+    TriangleNode(FPNodeAllocator *) : FPNode<TriangleNode, Triangle2>(), cacheIndex(0), recordedIndex(UINT_MAX) { }
+    TriangleNode(const Triangle2 &triangle) : FPNode<TriangleNode, Triangle2>(triangle), cacheIndex(0), recordedIndex(UINT_MAX)
     {
         addToVertices();
         addToTexCoords();
@@ -120,7 +123,5 @@ public:
     
     void replaceVertex(VertexNode *currentVertex, VertexNode *newVertex);
     void replaceTexCoord(TexCoordNode *currentTexCoord, TexCoordNode *newTexCoord);
-    
-    void softSelect(const vector<float> &weights);
 };
 
@@ -0,0 +1,489 @@
+//
+//  TriangleBVH.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "TriangleBVH.h"
+#include "MeshHelpers.h"
+#include "FPParallel.h"
+#include <cfloat>
+
+static const unsigned int kBinCount = 12;
+static const unsigned int kMaximumLeafSize = 4;
+static const unsigned int kStackSize = 64;
+// traversal keeps at most one deferred child per level on its stack
+static const unsigned int kMaximumDepth = kStackSize - 2;
+
+// same bin computation as in buildNode, so the partition matches the binned cost
+struct CenterInLeftBins
+{
+    const vector<float> &boxes;
+    unsigned int axis;
+    float minimum;
+    float scale;
+    unsigned int split;
+
+    CenterInLeftBins(const vector<float> &boxes, unsigned int axis, float minimum, float scale, unsigned int split) :
+        boxes(boxes), axis(axis), minimum(minimum), scale(scale), split(split) { }
+
+    bool operator()(unsigned int primitive) const
+    {
+        float center = boxes[primitive * 6 + axis] + boxes[primitive * 6 + axis + 3];
+        return (unsigned int)((center - minimum) * scale) < split;
+    }
+};
+
+struct Bounds
+{
+    float minimum[3];
+    float maximum[3];
+
+    Bounds()
+    {
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            minimum[i] = FLT_MAX;
+            maximum[i] = -FLT_MAX;
+        }
+    }
+
+    void add(const float point[3])
+    {
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            minimum[i] = min(minimum[i], point[i]);
+            maximum[i] = max(maximum[i], point[i]);
+        }
+    }
+
+    void add(const Bounds &bounds)
+    {
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            minimum[i] = min(minimum[i], bounds.minimum[i]);
+            maximum[i] = max(maximum[i], bounds.maximum[i]);
+        }
+    }
+
+    float area() const
+    {
+        if (minimum[0] > maximum[0])
+            return 0.0f;
+
+        float x = maximum[0] - minimum[0];
+        float y = maximum[1] - minimum[1];
+        float z = maximum[2] - minimum[2];
+        return x * y + y * z + z * x;
+    }
+};
+
+static bool intersectBounds(const float minimum[3], const float maximum[3], const float origin[3],
+                            const float inverse[3], float maxDistance, float &entry)
+{
+    float near = 0.0f;
+    float far = maxDistance;
+
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        float t1 = (minimum[i] - origin[i]) * inverse[i];
+        float t2 = (maximum[i] - origin[i]) * inverse[i];
+        if (t1 > t2)
+            swap(t1, t2);
+        near = max(near, t1);
+        far = min(far, t2);
+    }
+
+    entry = near;
+    return near <= far;
+}
+
+TriangleBVH::TriangleBVH() : _valid(false), _needsRefit(false)
+{
+
+}
+
+void TriangleBVH::invalidate()
+{
+    _valid = false;
+    _needsRefit = false;
+    _nodes.clear();
+    _primitives.clear();
+}
+
+void TriangleBVH::fetchPrimitive(Primitive &primitive) const
+{
+    const Triangle2 &triangle = primitive.triangle->data();
+
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        unsigned int index = Triangle2::twoTriIndices[primitive.part * 3 + i];
+        const Vector3D &position = triangle.vertex(index)->data().position;
+        primitive.vertices[i][0] = position.x;
+        primitive.vertices[i][1] = position.y;
+        primitive.vertices[i][2] = position.z;
+    }
+}
+
+void TriangleBVH::build(TriangleNode *begin, TriangleNode *end)
+{
+    invalidate();
+
+    for (TriangleNode *node = begin; node != end; node = node->next())
+    {
+        unsigned int parts = node->data().isQuad() ? 2 : 1;
+        for (unsigned int part = 0; part < parts; part++)
+        {
+            Primitive primitive;
+            primitive.triangle = node;
+            primitive.part = part;
+            fetchPrimitive(primitive);
+            _primitives.push_back(primitive);
+        }
+    }
+
+    unsigned int count = (unsigned int)_primitives.size();
+
+    vector<unsigned int> order(count);
+    vector<float> boxes(count * 6);
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        order[i] = i;
+
+        Bounds bounds;
+        for (unsigned int j = 0; j < 3; j++)
+            bounds.add(_primitives[i].vertices[j]);
+
+        for (unsigned int j = 0; j < 3; j++)
+        {
+            boxes[i * 6 + j] = bounds.minimum[j];
+            boxes[i * 6 + j + 3] = bounds.maximum[j];
+        }
+    }
+
+    _nodes.reserve(count > 0 ? count * 2 / kMaximumLeafSize + 1 : 1);
+
+    buildNode(order, boxes, 0, count, 0);
+
+    // leaves address primitives directly, so store them in leaf order
+    vector<Primitive> primitives(count);
+    for (unsigned int i = 0; i < count; i++)
+        primitives[i] = _primitives[order[i]];
+    _primitives.swap(primitives);
+
+    _valid = true;
+}
+
+// boxes hold minimum and maximum of every primitive, split positions use the box centers
+unsigned int TriangleBVH::buildNode(vector<unsigned int> &order, const vector<float> &boxes, unsigned int first, unsigned int count, unsigned int depth)
+{
+    unsigned int nodeIndex = (unsigned int)_nodes.size();
+    _nodes.push_back(Node());
+
+    Bounds bounds, centerBounds;
+
+    for (unsigned int i = first; i < first + count; i++)
+    {
+        const float *box = &boxes[order[i] * 6];
+        float center[3] = { box[0] + box[3], box[1] + box[4], box[2] + box[5] };
+        bounds.add(box);
+        bounds.add(box + 3);
+        centerBounds.add(center);
+    }
+
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        _nodes[nodeIndex].minimum[i] = bounds.minimum[i];
+        _nodes[nodeIndex].maximum[i] = bounds.maximum[i];
+    }
+
+    _nodes[nodeIndex].index = first;
+    _nodes[nodeIndex].count = count;
+
+    if (count <= kMaximumLeafSize || depth >= kMaximumDepth)
+        return nodeIndex;
+
+    Bounds binBounds[3][kBinCount];
+    unsigned int binCounts[3][kBinCount] = { { 0 } };
+    float scales[3];
+
+    for (unsigned int axis = 0; axis < 3; axis++)
+    {
+        float extent = centerBounds.maximum[axis] - centerBounds.minimum[axis];
+        scales[axis] = extent > 0.0f ? (float)kBinCount / extent : 0.0f;
+    }
+
+    for (unsigned int i = first; i < first + count; i++)
+    {
+        const float *box = &boxes[order[i] * 6];
+
+        for (unsigned int axis = 0; axis < 3; axis++)
+        {
+            float center = box[axis] + box[axis + 3];
+            unsigned int bin = min((unsigned int)((center - centerBounds.minimum[axis]) * scales[axis]), kBinCount - 1);
+            binBounds[axis][bin].add(box);
+            binBounds[axis][bin].add(box + 3);
+            binCounts[axis][bin]++;
+        }
+    }
+
+    unsigned int bestAxis = 0;
+    unsigned int bestSplit = 0;
+    float bestCost = FLT_MAX;
+
+    for (unsigned int axis = 0; axis < 3; axis++)
+    {
+        if (scales[axis] == 0.0f)
+            continue;
+
+        // cost of splitting after bin i, swept from the right first
+        float rightAreas[kBinCount];
+        unsigned int rightCounts[kBinCount];
+        Bounds right;
+        unsigned int rightCount = 0;
+
+        for (unsigned int i = kBinCount - 1; i > 0; i--)
+        {
+            right.add(binBounds[axis][i]);
+            rightCount += binCounts[axis][i];
+            rightAreas[i - 1] = right.area();
+            rightCounts[i - 1] = rightCount;
+        }
+
+        Bounds left;
+        unsigned int leftCount = 0;
+
+        for (unsigned int i = 0; i < kBinCount - 1; i++)
+        {
+            left.add(binBounds[axis][i]);
+            leftCount += binCounts[axis][i];
+
+            if (leftCount == 0 || rightCounts[i] == 0)
+                continue;
+
+            float cost = left.area() * leftCount + rightAreas[i] * rightCounts[i];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i + 1;
+            }
+        }
+    }
+
+    unsigned int leftCount = 0;
+
+    if (bestCost < FLT_MAX)
+    {
+        unsigned int *begin = &order[first];
+        unsigned int *middle = partition(begin, begin + count, CenterInLeftBins(boxes, bestAxis, centerBounds.minimum[bestAxis], scales[bestAxis], bestSplit));
+        leftCount = (unsigned int)(middle - begin);
+    }
+
+    // all centers in one point, split in half
+    if (leftCount == 0 || leftCount == count)
+        leftCount = count / 2;
+
+    _nodes[nodeIndex].count = 0;
+
+    buildNode(order, boxes, first, leftCount, depth + 1);
+    unsigned int second = buildNode(order, boxes, first + leftCount, count - leftCount, depth + 1);
+    _nodes[nodeIndex].index = second;
+
+    return nodeIndex;
+}
+
+void TriangleBVH::refit()
+{
+    if (!_needsRefit)
+        return;
+
+    for (unsigned int i = 0; i < _primitives.size(); i++)
+        fetchPrimitive(_primitives[i]);
+
+    refitNodes();
+    _needsRefit = false;
+}
+
+void TriangleBVH::refitNodes()
+{
+    // children are always stored after their parent
+    for (unsigned int i = (unsigned int)_nodes.size(); i-- > 0; )
+    {
+        Node &node = _nodes[i];
+        Bounds bounds;
+
+        if (node.count > 0)
+        {
+            for (unsigned int j = node.index; j < node.index + node.count; j++)
+            {
+                for (unsigned int k = 0; k < 3; k++)
+                    bounds.add(_primitives[j].vertices[k]);
+            }
+        }
+        else
+        {
+            for (unsigned int k = 0; k < 3; k++)
+            {
+                bounds.minimum[k] = min(_nodes[i + 1].minimum[k], _nodes[node.index].minimum[k]);
+                bounds.maximum[k] = max(_nodes[i + 1].maximum[k], _nodes[node.index].maximum[k]);
+            }
+        }
+
+        for (unsigned int k = 0; k < 3; k++)
+        {
+            node.minimum[k] = bounds.minimum[k];
+            node.maximum[k] = bounds.maximum[k];
+        }
+    }
+}
+
+// Same test as Triangle2::rayIntersect.
+bool TriangleBVH::intersect(const Primitive &primitive, const float origin[3], const float direction[3],
+                            float maxDistance, float &t, float &u, float &v) const
+{
+    const float *v0 = primitive.vertices[0];
+    const float *v1 = primitive.vertices[1];
+    const float *v2 = primitive.vertices[2];
+
+    float e1[3] = { v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2] };
+    float e2[3] = { v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2] };
+
+    float p[3] = { direction[1] * e2[2] - direction[2] * e2[1],
+                   direction[2] * e2[0] - direction[0] * e2[2],
+                   direction[0] * e2[1] - direction[1] * e2[0] };
+
+    float a = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+    if (fabsf(a) < FLOAT_EPS)
+        return false;
+
+    float f = 1.0f / a;
+
+    float s[3] = { origin[0] - v0[0], origin[1] - v0[1], origin[2] - v0[2] };
+    u = f * (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]);
+    if (u < 0.0f || u > 1.0f)
+        return false;
+
+    float q[3] = { s[1] * e1[2] - s[2] * e1[1],
+                   s[2] * e1[0] - s[0] * e1[2],
+                   s[0] * e1[1] - s[1] * e1[0] };
+
+    v = f * (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]);
+    if (v < 0.0f || u + v > 1.0f)
+        return false;
+
+    t = f * (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]);
+    return t >= 0.0f && t < maxDistance;
+}
+
+bool TriangleBVH::traverse(const Vector3D &rayOrigin, const Vector3D &rayDirection, float maxDistance, bool anyHit, TriangleHit &hit) const
+{
+    hit.triangle = NULL;
+    hit.part = 0;
+    hit.distance = maxDistance;
+    hit.u = 0.0f;
+    hit.v = 0.0f;
+
+    if (_nodes.empty())
+        return false;
+
+    float origin[3] = { rayOrigin.x, rayOrigin.y, rayOrigin.z };
+    float direction[3] = { rayDirection.x, rayDirection.y, rayDirection.z };
+    float inverse[3];
+
+    for (unsigned int i = 0; i < 3; i++)
+        inverse[i] = direction[i] != 0.0f ? 1.0f / direction[i] : (direction[i] < 0.0f ? -FLT_MAX : FLT_MAX);
+
+    unsigned int stack[kStackSize];
+    unsigned int stackSize = 0;
+    float entry;
+
+    if (!intersectBounds(_nodes[0].minimum, _nodes[0].maximum, origin, inverse, hit.distance, entry))
+        return false;
+
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const Node &node = _nodes[stack[--stackSize]];
+
+        if (node.count > 0)
+        {
+            for (unsigned int i = node.index; i < node.index + node.count; i++)
+            {
+                float t, u, v;
+                if (intersect(_primitives[i], origin, direction, hit.distance, t, u, v))
+                {
+                    hit.triangle = _primitives[i].triangle;
+                    hit.part = _primitives[i].part;
+                    hit.distance = t;
+                    hit.u = u;
+                    hit.v = v;
+
+                    if (anyHit)
+                        return true;
+                }
+            }
+            continue;
+        }
+
+        unsigned int first = (unsigned int)(&node - &_nodes[0]) + 1;
+        unsigned int second = node.index;
+
+        float firstEntry, secondEntry;
+        bool firstHit = intersectBounds(_nodes[first].minimum, _nodes[first].maximum, origin, inverse, hit.distance, firstEntry);
+        bool secondHit = intersectBounds(_nodes[second].minimum, _nodes[second].maximum, origin, inverse, hit.distance, secondEntry);
+
+        // the nearer child is popped first
+        if (firstHit && secondHit && firstEntry > secondEntry)
+        {
+            swap(first, second);
+            swap(firstHit, secondHit);
+        }
+
+        if (secondHit)
+            stack[stackSize++] = second;
+        if (firstHit)
+            stack[stackSize++] = first;
+    }
+
+    return hit.triangle != NULL;
+}
+
+bool TriangleBVH::closestHit(const Vector3D &origin, const Vector3D &direction, TriangleHit &hit) const
+{
+    return traverse(origin, direction, FLT_MAX, false, hit);
+}
+
+bool TriangleBVH::anyHit(const Vector3D &origin, const Vector3D &direction, float maxDistance) const
+{
+    TriangleHit hit;
+    return traverse(origin, direction, maxDistance, true, hit);
+}
+
+struct CastRays
+{
+    const TriangleBVH &bvh;
+    const vector<Vector3D> &origins;
+    const vector<Vector3D> &directions;
+    vector<TriangleHit> &hits;
+
+    CastRays(const TriangleBVH &bvh, const vector<Vector3D> &origins, const vector<Vector3D> &directions, vector<TriangleHit> &hits) :
+        bvh(bvh), origins(origins), directions(directions), hits(hits) { }
+
+    void operator()(unsigned int begin, unsigned int end)
+    {
+        for (unsigned int i = begin; i < end; i++)
+            bvh.closestHit(origins[i], directions[i], hits[i]);
+    }
+};
+
+void TriangleBVH::closestHits(const vector<Vector3D> &origins, const vector<Vector3D> &directions, vector<TriangleHit> &hits) const
+{
+    hits.resize(origins.size());
+
+    CastRays castRays(*this, origins, directions, hits);
+    FPParallel::forRange((unsigned int)origins.size(), castRays);
+}
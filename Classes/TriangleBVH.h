@@ -0,0 +1,79 @@
+//
+//  TriangleBVH.h
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#pragma once
+
+#include "MeshForwardDeclaration.h"
+
+struct TriangleHit
+{
+    TriangleNode *triangle;
+    // second half of a quad, split the same way as triangulate()
+    unsigned int part;
+    float distance;
+    // barycentric coordinates in the hit triangle or half of quad
+    float u;
+    float v;
+};
+
+// Bounding volume hierarchy over mesh triangles, quads are stored as two
+// triangles. Built with the binned surface area heuristic, vertex positions
+// are copied into the hierarchy, so refit() has to be called after they move.
+class TriangleBVH
+{
+private:
+    struct Node
+    {
+        float minimum[3];
+        float maximum[3];
+        // leaf: first primitive, inner node: index of the second child
+        unsigned int index;
+        // zero for inner nodes, the first child follows its parent
+        unsigned int count;
+    };
+
+    struct Primitive
+    {
+        float vertices[3][3];
+        TriangleNode *triangle;
+        unsigned int part;
+    };
+
+    vector<Node> _nodes;
+    vector<Primitive> _primitives;
+    bool _valid;
+    bool _needsRefit;
+
+    void fetchPrimitive(Primitive &primitive) const;
+    unsigned int buildNode(vector<unsigned int> &order, const vector<float> &boxes, unsigned int first, unsigned int count, unsigned int depth);
+    void refitNodes();
+    bool intersect(const Primitive &primitive, const float origin[3], const float direction[3], float maxDistance, float &t, float &u, float &v) const;
+    bool traverse(const Vector3D &origin, const Vector3D &direction, float maxDistance, bool anyHit, TriangleHit &hit) const;
+
+    TriangleBVH(const TriangleBVH &other);
+    TriangleBVH &operator=(const TriangleBVH &other);
+
+public:
+    TriangleBVH();
+
+    bool isValid() const { return _valid; }
+    bool needsRefit() const { return _needsRefit; }
+    void invalidate();
+    void setNeedsRefit() { _needsRefit = _valid; }
+
+    void build(TriangleNode *begin, TriangleNode *end);
+    void refit();
+
+    unsigned int nodeCount() const { return (unsigned int)_nodes.size(); }
+    unsigned int primitiveCount() const { return (unsigned int)_primitives.size(); }
+    size_t memorySize() const { return _nodes.capacity() * sizeof(Node) + _primitives.capacity() * sizeof(Primitive); }
+
+    bool closestHit(const Vector3D &origin, const Vector3D &direction, TriangleHit &hit) const;
+    bool anyHit(const Vector3D &origin, const Vector3D &direction, float maxDistance) const;
+    // hits[i].triangle is NULL when ray i missed
+    void closestHits(const vector<Vector3D> &origins, const vector<Vector3D> &directions, vector<TriangleHit> &hits) const;
+};
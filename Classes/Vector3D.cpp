@@ -22,13 +22,6 @@ Vector3D::Vector3D(const float * v)
 	z = v[2];
 }
 
-Vector3D::Vector3D(const Vector3D & v)
-{
-	x = v.x;
-	y = v.y;
-	z = v.z;
-}
-
 Vector3D::Vector3D(float x, float y, float z)
 {
 	this->x = x;
@@ -18,7 +18,6 @@ public:
 
 	Vector3D();
 	Vector3D(const float * v);
-	Vector3D(const Vector3D & v);
 	Vector3D(float x, float y, float z);
 
 	operator float * ();
@@ -32,14 +32,6 @@ Vector4D::Vector4D(const Vector3D & v)
     w = 1.0f;
 }
 
-Vector4D::Vector4D(const Vector4D & v)
-{
-	x = v.x;
-	y = v.y;
-	z = v.z;
-    w = v.w;
-}
-
 Vector4D::Vector4D(float x, float y, float z, float w)
 {
 	this->x = x;
@@ -18,7 +18,6 @@ public:
 	Vector4D();
 	Vector4D(const float * v);
     Vector4D(const Vector3D & v);
-	Vector4D(const Vector4D & v);
 	Vector4D(float x, float y, float z, float w);
     
 	operator float * ();
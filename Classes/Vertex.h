@@ -39,10 +39,12 @@ public:
     FPList<VertexVEdgeNode<T>, VEdgeNode<T> *> _edges;
 public:
     float selectionWeight;
+    unsigned int recordedIndex; // index when a Mesh2 recording numbered it, UINT_MAX for later nodes
     AlgorithmData algorithmData;
     
-    VNode() : FPNode<VNode<T>, T>() { }
-    VNode(const T &vertex) : FPNode<VNode<T>, T>(vertex) { } 
+    VNode() : FPNode<VNode<T>, T>(), recordedIndex(UINT_MAX) { }
+    VNode(FPNodeAllocator *allocator) : FPNode<VNode<T>, T>(), _triangles(allocator), _edges(allocator), recordedIndex(UINT_MAX) { }
+    VNode(const T &vertex) : FPNode<VNode<T>, T>(vertex), recordedIndex(UINT_MAX) { } 
     virtual ~VNode() 
     { 
         removeFromTriangles();
@@ -162,27 +164,6 @@ public:
 		algorithmData.normal = normal;
     }
     
-    void resetCacheIndices()
-    {
-        for (VertexTriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
-        {
-            node->cacheIndices[0] = -1;
-            node->cacheIndices[1] = -1;
-        }
-    }
-    
-    void setCacheIndexForTriangleNode(TriangleNode *triangleNode, unsigned int cacheIndex, unsigned int cacheIndexPosition)
-    {
-        for (VertexTriangleNode *node = _triangles.begin(), *end = _triangles.end(); node != end; node = node->next())
-        {
-            if (node->data() == triangleNode)
-            {
-                node->cacheIndices[cacheIndexPosition] = cacheIndex;
-                break;
-            }
-        }
-    }
-    
     void setCacheIndexForEdgeNode(VEdgeNode<T> *edgeNode, unsigned int cacheIndex)
     {
         for (VertexVEdgeNode<T> *node = _edges.begin(), *end = _edges.end(); node != end; node = node->next())
@@ -241,38 +222,4 @@ public:
         
         return NULL;
     }
-    
-    void softSelect(const vector<float> &weights)
-    {
-        selectionWeight = weights[0];
-
-        vector<VertexNode *> currentStepNodes;
-        currentStepNodes.push_back(this);
-        
-        vector<VertexNode *> nextStepNodes;
-        
-        for (unsigned int w = 1; w < weights.size(); w++)
-        {
-            float weight = weights[w];
-            
-            nextStepNodes.clear();
-            
-            for (unsigned int i = 0; i < currentStepNodes.size(); i++)
-            {
-                VertexNode *currentNode = currentStepNodes[i];
-                for (VertexVEdgeNode<T> *node = currentNode->_edges.begin(), *end = currentNode->_edges.end(); node != end; node = node->next())
-                {
-                    VertexNode *vertexNode = node->data()->data().opposite(currentNode);
-                    if (!vertexNode->data().selected)
-                    {
-                        nextStepNodes.push_back(vertexNode);
-                        if (vertexNode->selectionWeight < weight)
-                            vertexNode->selectionWeight = weight;
-                    }
-                }
-            }
-            
-            currentStepNodes = nextStepNodes;
-        }
-    }
 };
@@ -226,6 +226,7 @@ public:
     float selectionWeight;
     
     VEdgeNode() : FPNode<VEdgeNode<T>, VEdge<T> >() { }
+    VEdgeNode(FPNodeAllocator *) : FPNode<VEdgeNode<T>, VEdge<T> >() { }
     
     VEdgeNode(const VEdge<T> &edge) : FPNode<VEdgeNode<T>, VEdge<T> >(edge)
     {
@@ -289,45 +290,4 @@ public:
             }
         }
     }
-    
-    void softSelect(const vector<float> &weights)
-    {
-        selectionWeight = weights[0];
-        
-        vector<VertexEdgeNode *> currentStepNodes;
-        currentStepNodes.push_back(this);
-        
-        vector<VertexEdgeNode *> nextStepNodes;
-        
-        for (unsigned int w = 1; w < weights.size(); w++)
-        {
-            float weight = weights[w];
-            
-            nextStepNodes.clear();
-            
-            for (unsigned int i = 0; i < currentStepNodes.size(); i++)
-            {
-                VertexEdgeNode *currentNode = currentStepNodes[i];
-                VertexEdge &edge = currentNode->data();
-                
-                for (unsigned int j = 0; j < 2; j++)
-                {
-                    TriangleNode *quad = edge.triangle(j);
-                    
-                    if (quad != NULL && quad->data().isQuad())
-                    {
-                        VertexEdgeNode *edgeNode = quad->data().nextEdgeInQuadLoop(edge);
-                        if (edgeNode != NULL)
-                        {
-                            nextStepNodes.push_back(edgeNode);
-                            if (edgeNode->selectionWeight < weight)
-                                edgeNode->selectionWeight = weight;
-                        }
-                    }
-                }
-            }
-            
-            currentStepNodes = nextStepNodes;
-        }
-    }
 };
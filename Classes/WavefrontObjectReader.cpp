@@ -0,0 +1,506 @@
+//
+//  WavefrontObjectReader.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "WavefrontObjectReader.h"
+#include "FPProfiler.h"
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const double powersOfTen[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline const char *skipSpaces(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    return p;
+}
+
+static inline const char *skipLine(const char *p, const char *end)
+{
+    const char *newLine = (const char *)memchr(p, '\n', end - p);
+    return newLine ? newLine + 1 : end;
+}
+
+// Decimal mantissa times a power of ten is exact in double when both fit,
+// anything else goes through strtod on a copy of the token.
+static const char *parseFloat(const char *p, const char *end, float &value)
+{
+    const char *start = p;
+    bool negative = false;
+
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    unsigned long long mantissa = 0;
+    int significantDigits = 0;
+    int exponent = 0;
+    bool hasDigits = false;
+    bool exact = true;
+
+    for (; p < end && isDigit(*p); p++)
+    {
+        hasDigits = true;
+        if (significantDigits < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa > 0)
+                significantDigits++;
+        }
+        else
+        {
+            exponent++;
+            exact = false;
+        }
+    }
+
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && isDigit(*p); p++)
+        {
+            hasDigits = true;
+            if (significantDigits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa > 0)
+                    significantDigits++;
+                exponent--;
+            }
+            else
+            {
+                exact = false;
+            }
+        }
+    }
+
+    if (!hasDigits)
+        return NULL;
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char *e = p + 1;
+        bool negativeExponent = false;
+
+        if (e < end && (*e == '-' || *e == '+'))
+            negativeExponent = *e++ == '-';
+
+        if (e < end && isDigit(*e))
+        {
+            int explicitExponent = 0;
+            for (; e < end && isDigit(*e); e++)
+            {
+                if (explicitExponent < 10000)
+                    explicitExponent = explicitExponent * 10 + (*e - '0');
+            }
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+            p = e;
+        }
+    }
+
+    if (exact && mantissa < (1ULL << 53) && exponent >= -22 && exponent <= 22)
+    {
+        double result = (double)mantissa;
+        result = exponent < 0 ? result / powersOfTen[-exponent] : result * powersOfTen[exponent];
+        value = (float)(negative ? -result : result);
+        return p;
+    }
+
+    char buffer[128];
+    size_t length = min((size_t)(p - start), sizeof(buffer) - 1);
+    memcpy(buffer, start, length);
+    buffer[length] = '\0';
+    value = (float)strtod(buffer, NULL);
+    return p;
+}
+
+static inline const char *parseIndex(const char *p, const char *end, int &value)
+{
+    bool negative = false;
+
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    if (p >= end || !isDigit(*p))
+        return NULL;
+
+    long long index = 0;
+    for (; p < end && isDigit(*p); p++)
+    {
+        if (index < INT_MAX)
+            index = index * 10 + (*p - '0');
+    }
+
+    index = min(index, (long long)INT_MAX);
+    value = (int)(negative ? -index : index);
+    return p;
+}
+
+// One based indices count from the start, negative ones from the last element read so far.
+static inline int resolveIndex(int index, size_t count)
+{
+    if (index > 0 && (size_t)index <= count)
+        return index - 1;
+    if (index < 0 && (size_t)-(long long)index <= count)
+        return (int)count + index;
+    return -1;
+}
+
+static const char *parseVector(const char *p, const char *end, unsigned int count, float values[3])
+{
+    for (unsigned int i = 0; i < count; i++)
+    {
+        p = skipSpaces(p, end);
+        const char *next = parseFloat(p, end, values[i]);
+        if (next == NULL)
+            return p;
+        p = next;
+    }
+    return p;
+}
+
+WavefrontObjectReader::WavefrontObjectReader()
+{
+    clear();
+}
+
+void WavefrontObjectReader::clear()
+{
+    _vertices.clear();
+    _texCoords.clear();
+    _normals.clear();
+    _groups.clear();
+    _groups.push_back(Group());
+    _groups.back().hasTexCoords = false;
+    _skippedFaces = 0;
+}
+
+void WavefrontObjectReader::addFace()
+{
+    unsigned int count = (unsigned int)_corners.size();
+
+    if (count < 3)
+    {
+        _skippedFaces++;
+        return;
+    }
+
+    Group &group = _groups.back();
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        Corner &corner = _corners[i];
+        corner.vertex = resolveIndex(corner.vertex, _vertices.size());
+        if (corner.vertex < 0)
+        {
+            _skippedFaces++;
+            return;
+        }
+
+        if (corner.texCoord == 0)
+        {
+            corner.texCoord = -1;
+        }
+        else
+        {
+            corner.texCoord = resolveIndex(corner.texCoord, _texCoords.size());
+            if (corner.texCoord < 0)
+            {
+                _skippedFaces++;
+                return;
+            }
+            group.hasTexCoords = true;
+        }
+    }
+
+    TriQuad triQuad;
+
+    if (count == 4)
+    {
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            triQuad.vertexIndices[i] = _corners[i].vertex;
+            triQuad.texCoordIndices[i] = _corners[i].texCoord;
+        }
+        triQuad.isQuad = true;
+        group.triangles.push_back(triQuad);
+        return;
+    }
+
+    triQuad.isQuad = false;
+    triQuad.vertexIndices[3] = triQuad.texCoordIndices[3] = 0;
+
+    for (unsigned int i = 1; i + 1 < count; i++)
+    {
+        unsigned int fan[3] = { 0, i, i + 1 };
+        for (unsigned int j = 0; j < 3; j++)
+        {
+            triQuad.vertexIndices[j] = _corners[fan[j]].vertex;
+            triQuad.texCoordIndices[j] = _corners[fan[j]].texCoord;
+        }
+        group.triangles.push_back(triQuad);
+    }
+}
+
+// f v1 v2 v3 ...
+// f v1/vt1 v2/vt2 v3/vt3 ...
+// f v1/vt1/vn1 v2/vt2/vn2 v3/vt3/vn3 ...
+// f v1//vn1 v2//vn2 v3//vn3 ...
+const char *WavefrontObjectReader::readFace(const char *p, const char *end)
+{
+    _corners.clear();
+
+    while (true)
+    {
+        p = skipSpaces(p, end);
+
+        Corner corner = { 0, 0, 0 };
+        const char *next = parseIndex(p, end, corner.vertex);
+        if (next == NULL)
+            break;
+        p = next;
+
+        if (p < end && *p == '/')
+        {
+            p++;
+            next = parseIndex(p, end, corner.texCoord);
+            if (next != NULL)
+                p = next;
+
+            if (p < end && *p == '/')
+            {
+                p++;
+                next = parseIndex(p, end, corner.normal);
+                if (next != NULL)
+                    p = next;
+            }
+        }
+
+        _corners.push_back(corner);
+    }
+
+    addFace();
+    return p;
+}
+
+// g group_name
+const char *WavefrontObjectReader::readGroup(const char *p, const char *end)
+{
+    p = skipSpaces(p, end);
+
+    const char *nameEnd = p;
+    while (nameEnd < end && *nameEnd != '\n' && *nameEnd != '\r')
+        nameEnd++;
+    while (nameEnd > p && (nameEnd[-1] == ' ' || nameEnd[-1] == '\t'))
+        nameEnd--;
+
+    // consecutive "o" and "g" lines without faces name the same group
+    if (!_groups.back().triangles.empty())
+    {
+        _groups.push_back(Group());
+        _groups.back().hasTexCoords = false;
+    }
+
+    _groups.back().name.assign(p, nameEnd);
+    return nameEnd;
+}
+
+void WavefrontObjectReader::read(const char *data, size_t length)
+{
+    FPProfileZone zone("WavefrontObjectReader::read");
+
+    clear();
+
+    const char *p = data;
+    const char *end = data + length;
+    float values[3];
+
+    while (p < end)
+    {
+        p = skipSpaces(p, end);
+
+        if (p + 1 < end && (p[1] == ' ' || p[1] == '\t'))
+        {
+            switch (p[0])
+            {
+                case 'v':
+                {
+                    // v -5.79346 -1.38018 42.63113
+                    values[0] = values[1] = values[2] = 0.0f;
+                    p = parseVector(p + 2, end, 3, values);
+                    _vertices.push_back(Vector3D(values[0], values[2], -values[1]));
+                } break;
+                case 'f':
+                    p = readFace(p + 2, end);
+                    break;
+                case 'g':
+                case 'o':
+                    p = readGroup(p + 2, end);
+                    break;
+                default:
+                    break;
+            }
+        }
+        else if (p + 2 < end && p[0] == 'v' && (p[2] == ' ' || p[2] == '\t'))
+        {
+            values[0] = values[1] = values[2] = 0.0f;
+
+            if (p[1] == 't')
+            {
+                // vt 0.12528 -0.64560
+                p = parseVector(p + 3, end, 2, values);
+                _texCoords.push_back(Vector3D(values[0], values[1], 0.0f));
+            }
+            else if (p[1] == 'n')
+            {
+                // vn -0.78298 -0.13881 -0.60637
+                p = parseVector(p + 3, end, 3, values);
+                _normals.push_back(Vector3D(values[0], values[2], -values[1]));
+            }
+        }
+
+        p = skipLine(p, end);
+    }
+
+    for (int i = (int)_groups.size() - 1; i >= 0 && _groups.size() > 1; i--)
+    {
+        if (_groups[i].triangles.empty())
+            _groups.erase(_groups.begin() + i);
+    }
+}
+
+bool WavefrontObjectReader::readFile(const char *path)
+{
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat status;
+    if (fstat(file, &status) != 0)
+    {
+        close(file);
+        return false;
+    }
+
+    size_t length = (size_t)status.st_size;
+
+    if (length == 0)
+    {
+        close(file);
+        clear();
+        return true;
+    }
+
+    void *data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+
+    if (data == MAP_FAILED)
+        return false;
+
+    madvise(data, length, MADV_SEQUENTIAL);
+    read((const char *)data, length);
+    munmap(data, length);
+
+    return true;
+}
+
+void WavefrontObjectReader::groupIndexRepresentation(unsigned int index, vector<Vector3D> &vertices, vector<Vector3D> &texCoords, vector<TriQuad> &triangles)
+{
+    const Group &group = _groups[index];
+
+    vertices.clear();
+    texCoords.clear();
+    triangles.clear();
+
+    if (group.triangles.empty())
+    {
+        vertices = _vertices;
+        texCoords = _texCoords.empty() ? _vertices : _texCoords;
+        return;
+    }
+
+    if (_vertexRemap.size() < _vertices.size())
+        _vertexRemap.resize(_vertices.size(), UINT_MAX);
+    if (_texCoordRemap.size() < _texCoords.size())
+        _texCoordRemap.resize(_texCoords.size(), UINT_MAX);
+
+    triangles = group.triangles;
+
+    unsigned int missingTexCoord = UINT_MAX;
+
+    for (unsigned int i = 0; i < triangles.size(); i++)
+    {
+        TriQuad &triQuad = triangles[i];
+        unsigned int count = triQuad.isQuad ? 4 : 3;
+
+        for (unsigned int j = 0; j < count; j++)
+        {
+            unsigned int &vertex = triQuad.vertexIndices[j];
+            unsigned int &texCoord = triQuad.texCoordIndices[j];
+
+            if (_vertexRemap[vertex] == UINT_MAX)
+            {
+                _vertexRemap[vertex] = (unsigned int)vertices.size();
+                vertices.push_back(_vertices[vertex]);
+            }
+
+            if (!group.hasTexCoords)
+            {
+                texCoord = _vertexRemap[vertex];
+            }
+            else if (texCoord == UINT_MAX)
+            {
+                if (missingTexCoord == UINT_MAX)
+                {
+                    missingTexCoord = (unsigned int)texCoords.size();
+                    texCoords.push_back(Vector3D());
+                }
+                texCoord = missingTexCoord;
+            }
+            else
+            {
+                if (_texCoordRemap[texCoord] == UINT_MAX)
+                {
+                    _texCoordRemap[texCoord] = (unsigned int)texCoords.size();
+                    texCoords.push_back(_texCoords[texCoord]);
+                }
+                texCoord = _texCoordRemap[texCoord];
+            }
+
+            vertex = _vertexRemap[vertex];
+        }
+    }
+
+    if (!group.hasTexCoords)
+        texCoords = vertices;
+
+    // reset only the entries this group touched
+    for (unsigned int i = 0; i < group.triangles.size(); i++)
+    {
+        const TriQuad &triQuad = group.triangles[i];
+        unsigned int count = triQuad.isQuad ? 4 : 3;
+
+        for (unsigned int j = 0; j < count; j++)
+        {
+            _vertexRemap[triQuad.vertexIndices[j]] = UINT_MAX;
+            if (triQuad.texCoordIndices[j] != UINT_MAX)
+                _texCoordRemap[triQuad.texCoordIndices[j]] = UINT_MAX;
+        }
+    }
+}
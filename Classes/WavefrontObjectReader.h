@@ -0,0 +1,74 @@
+//
+//  WavefrontObjectReader.h
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#pragma once
+
+#include "MeshForwardDeclaration.h"
+#include <string>
+
+// Single pass Wavefront OBJ parser working directly on the file bytes.
+// Faces are collected per group ("g" or "o") with indices into the shared
+// vertex arrays, n-gons with more than four corners are split into a fan.
+// Positions and normals are rotated to the editor axes, inverse of what
+// the exporter in MyDocument+archiving does.
+class WavefrontObjectReader
+{
+public:
+    struct Group
+    {
+        string name;
+        vector<TriQuad> triangles;
+        // without any "vt" in the group, vertices are used as texture coordinates
+        bool hasTexCoords;
+    };
+
+private:
+    struct Corner
+    {
+        int vertex;
+        int texCoord;
+        int normal;
+    };
+
+    vector<Vector3D> _vertices;
+    vector<Vector3D> _texCoords;
+    vector<Vector3D> _normals;
+    vector<Group> _groups;
+    vector<Corner> _corners;
+    vector<unsigned int> _vertexRemap;
+    vector<unsigned int> _texCoordRemap;
+    unsigned int _skippedFaces;
+
+    const char *readFace(const char *p, const char *end);
+    const char *readGroup(const char *p, const char *end);
+    void addFace();
+    void clear();
+
+    WavefrontObjectReader(const WavefrontObjectReader &other);
+    WavefrontObjectReader &operator=(const WavefrontObjectReader &other);
+
+public:
+    WavefrontObjectReader();
+
+    void read(const char *data, size_t length);
+    // maps the file into memory, returns false when it cannot be opened
+    bool readFile(const char *path);
+
+    const vector<Vector3D> &vertices() const { return _vertices; }
+    const vector<Vector3D> &texCoords() const { return _texCoords; }
+    const vector<Vector3D> &normals() const { return _normals; }
+
+    // faces with indices out of range are skipped
+    unsigned int skippedFaces() const { return _skippedFaces; }
+
+    // There is always at least one group, a file without faces keeps all vertices in it.
+    unsigned int groupCount() const { return (unsigned int)_groups.size(); }
+    const Group &group(unsigned int index) const { return _groups[index]; }
+
+    // Copies only vertices and texture coordinates used by the group, suitable for Mesh2::fromIndexRepresentation.
+    void groupIndexRepresentation(unsigned int index, vector<Vector3D> &vertices, vector<Vector3D> &texCoords, vector<TriQuad> &triangles);
+};
@@ -0,0 +1,535 @@
+//
+//  WavefrontObjectWriter.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "WavefrontObjectWriter.h"
+#include "FPParallel.h"
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const double powersOfTen[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Exact for exponents up to 22 like the fast path of the reader.
+static double scaleByPowerOfTen(double value, int exponent)
+{
+    while (exponent > 22)
+    {
+        value *= 1e22;
+        exponent -= 22;
+    }
+
+    while (exponent < -22)
+    {
+        value /= 1e22;
+        exponent += 22;
+    }
+
+    return exponent >= 0 ? value * powersOfTen[exponent] : value / powersOfTen[-exponent];
+}
+
+// Floats between lower and upper read back as value, the halfway points
+// to the neighbouring floats are exact in double.
+struct RoundingInterval
+{
+    float value;
+    double lower;
+    double upper;
+
+    // value is positive and finite, its neighbours differ by one in the bits
+    RoundingInterval(float value) : value(value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        float below, above;
+        uint32_t belowBits = bits - 1, aboveBits = bits + 1;
+        memcpy(&below, &belowBits, sizeof(below));
+        memcpy(&above, &aboveBits, sizeof(above));
+
+        lower = 0.5 * ((double)value + (double)below);
+        upper = value < FLT_MAX ? 0.5 * ((double)value + (double)above) : 2.0 * value - lower;
+    }
+};
+
+static bool readsBack(float value, unsigned long long mantissa, int scale)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%llue%d", mantissa, scale);
+    return strtof(text, NULL) == value;
+}
+
+// Rounds positive value with decimal exponent to digits significant digits,
+// value is about mantissa * 10^(exponent - digits + 1) then.
+static unsigned long long roundToDigits(float value, int exponent, int digits)
+{
+    return (unsigned long long)(scaleByPowerOfTen(value, digits - 1 - exponent) + 0.5);
+}
+
+static bool roundsTrip(const RoundingInterval &interval, int exponent, int digits, unsigned long long &mantissa)
+{
+    mantissa = roundToDigits(interval.value, exponent, digits);
+    double scaled = scaleByPowerOfTen((double)mantissa, exponent - digits + 1);
+
+    // scaling rounds a few times, too close to a halfway point strtof decides
+    double distance = min(fabs(scaled - interval.lower), fabs(scaled - interval.upper));
+    if (distance > scaled * 1e-14)
+        return (float)scaled == interval.value;
+
+    return readsBack(interval.value, mantissa, exponent - digits + 1);
+}
+
+char *WavefrontObjectWriter::formatUnsigned(unsigned int value, char *text)
+{
+    char digits[10];
+    unsigned int count = 0;
+
+    do
+    {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    while (count > 0)
+        *text++ = digits[--count];
+
+    return text;
+}
+
+char *WavefrontObjectWriter::formatFloat(float value, char *text)
+{
+    if (value != value)
+    {
+        memcpy(text, "nan", 3);
+        return text + 3;
+    }
+
+    // negative zero keeps its sign
+    if (signbit(value))
+    {
+        *text++ = '-';
+        value = -value;
+    }
+
+    if (value == 0.0f)
+    {
+        *text++ = '0';
+        return text;
+    }
+
+    if (value > FLT_MAX)
+    {
+        memcpy(text, "inf", 3);
+        return text + 3;
+    }
+
+    // log10(2) times the binary exponent is the decimal one or one less
+    int binaryExponent;
+    frexp(value, &binaryExponent);
+    int exponent = (int)floor((binaryExponent - 1) * 0.30102999566398114);
+    if (scaleByPowerOfTen(value, -exponent - 1) >= 1.0)
+        exponent++;
+
+    // nine digits always round trip, more digits never break a round trip
+    int digits = 9;
+    unsigned long long mantissa = roundToDigits(value, exponent, digits);
+    RoundingInterval interval(value);
+
+    for (int low = 1, high = 8; low <= high; )
+    {
+        int middle = (low + high) / 2;
+        unsigned long long candidate;
+
+        if (roundsTrip(interval, exponent, middle, candidate))
+        {
+            digits = middle;
+            mantissa = candidate;
+            high = middle - 1;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+
+    int scale = exponent - digits + 1;
+    while (mantissa % 10 == 0)
+    {
+        mantissa /= 10;
+        scale++;
+    }
+
+    char mantissaText[20];
+    char *mantissaEnd = formatUnsigned((unsigned int)mantissa, mantissaText);
+    int count = (int)(mantissaEnd - mantissaText);
+
+    // digits in front of the decimal point, negative for leading zeros after it
+    int integerDigits = scale + count;
+
+    if (integerDigits > 9 || integerDigits < -4)
+    {
+        *text++ = mantissaText[0];
+        if (count > 1)
+        {
+            *text++ = '.';
+            memcpy(text, mantissaText + 1, count - 1);
+            text += count - 1;
+        }
+
+        *text++ = 'e';
+        int decimalExponent = integerDigits - 1;
+        if (decimalExponent < 0)
+        {
+            *text++ = '-';
+            decimalExponent = -decimalExponent;
+        }
+        return formatUnsigned((unsigned int)decimalExponent, text);
+    }
+
+    if (integerDigits <= 0)
+    {
+        *text++ = '0';
+        *text++ = '.';
+        for (int i = integerDigits; i < 0; i++)
+            *text++ = '0';
+        memcpy(text, mantissaText, count);
+        return text + count;
+    }
+
+    if (integerDigits >= count)
+    {
+        memcpy(text, mantissaText, count);
+        text += count;
+        for (int i = count; i < integerDigits; i++)
+            *text++ = '0';
+        return text;
+    }
+
+    memcpy(text, mantissaText, integerDigits);
+    text += integerDigits;
+    *text++ = '.';
+    memcpy(text, mantissaText + integerDigits, count - integerDigits);
+    return text + count - integerDigits;
+}
+
+// File axes have y up, the editor has z up, see WavefrontObjectReader.
+struct VertexLines
+{
+    const vector<VertexNode *> &nodes;
+    const Matrix4x4 &transform;
+
+    VertexLines(const vector<VertexNode *> &nodes, const Matrix4x4 &transform) : nodes(nodes), transform(transform) { }
+
+    void operator()(unsigned int begin, unsigned int end, string &text) const
+    {
+        char line[64];
+
+        for (unsigned int i = begin; i < end; i++)
+        {
+            Vector3D v = transform.Transform(nodes[i]->data().position);
+
+            char *p = line;
+            *p++ = 'v';
+            *p++ = ' ';
+            p = WavefrontObjectWriter::formatFloat(v.x, p);
+            *p++ = ' ';
+            p = WavefrontObjectWriter::formatFloat(-v.z, p);
+            *p++ = ' ';
+            p = WavefrontObjectWriter::formatFloat(v.y, p);
+            *p++ = '\n';
+            text.append(line, p - line);
+        }
+    }
+};
+
+struct TexCoordLines
+{
+    const vector<TexCoordNode *> &nodes;
+
+    TexCoordLines(const vector<TexCoordNode *> &nodes) : nodes(nodes) { }
+
+    void operator()(unsigned int begin, unsigned int end, string &text) const
+    {
+        char line[48];
+
+        for (unsigned int i = begin; i < end; i++)
+        {
+            const Vector3D &v = nodes[i]->data().position;
+
+            char *p = line;
+            *p++ = 'v';
+            *p++ = 't';
+            *p++ = ' ';
+            p = WavefrontObjectWriter::formatFloat(v.x, p);
+            *p++ = ' ';
+            p = WavefrontObjectWriter::formatFloat(v.y, p);
+            *p++ = '\n';
+            text.append(line, p - line);
+        }
+    }
+};
+
+// Corners go in reverse like after Mesh2::flipAllTriangles.
+struct FaceLines
+{
+    const vector<TriangleNode *> &nodes;
+    unsigned int vertexOffset;
+    unsigned int texCoordOffset;
+
+    FaceLines(const vector<TriangleNode *> &nodes, unsigned int vertexOffset, unsigned int texCoordOffset) :
+        nodes(nodes), vertexOffset(vertexOffset), texCoordOffset(texCoordOffset) { }
+
+    void operator()(unsigned int begin, unsigned int end, string &text) const
+    {
+        static const unsigned int flippedCorners[] = { 2, 1, 0, 3 };
+        char line[128];
+
+        for (unsigned int i = begin; i < end; i++)
+        {
+            const Triangle2 &triangle = nodes[i]->data();
+
+            char *p = line;
+            *p++ = 'f';
+            for (unsigned int j = 0; j < triangle.count(); j++)
+            {
+                unsigned int corner = flippedCorners[j];
+                *p++ = ' ';
+                p = WavefrontObjectWriter::formatUnsigned(triangle.vertex(corner)->algorithmData.index + vertexOffset, p);
+                *p++ = '/';
+                p = WavefrontObjectWriter::formatUnsigned(triangle.texCoord(corner)->algorithmData.index + texCoordOffset, p);
+            }
+            *p++ = '\n';
+            text.append(line, p - line);
+        }
+    }
+};
+
+template <class TLines>
+struct FormatBlocks
+{
+    const TLines &lines;
+    unsigned int firstLine;
+    unsigned int lineCount;
+    vector<string> &buffers;
+
+    FormatBlocks(const TLines &lines, unsigned int firstLine, unsigned int lineCount, vector<string> &buffers) :
+        lines(lines), firstLine(firstLine), lineCount(lineCount), buffers(buffers) { }
+
+    void operator()(unsigned int begin, unsigned int end)
+    {
+        for (unsigned int block = begin; block < end; block++)
+        {
+            unsigned int first = firstLine + block * WavefrontObjectWriter::kBlockLines;
+            unsigned int last = min(first + WavefrontObjectWriter::kBlockLines, lineCount);
+
+            buffers[block].clear();
+            lines(first, last, buffers[block]);
+        }
+    }
+};
+
+// A window of a few blocks per thread is formatted, then written in order.
+template <class TLines, class TSink>
+static bool writeLines(const TLines &lines, unsigned int count, vector<string> &buffers, TSink &sink)
+{
+    const unsigned int blockLines = WavefrontObjectWriter::kBlockLines;
+    unsigned int windowBlocks = FPParallel::threadCount() * 4;
+    if (buffers.size() < windowBlocks)
+        buffers.resize(windowBlocks);
+
+    for (unsigned int first = 0; first < count; first += windowBlocks * blockLines)
+    {
+        unsigned int blocks = min(windowBlocks, (count - first + blockLines - 1) / blockLines);
+
+        FormatBlocks<TLines> format(lines, first, count, buffers);
+        FPParallel::forRange(blocks, format, 1);
+
+        for (unsigned int i = 0; i < blocks; i++)
+        {
+            if (!sink(buffers[i]))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+struct FileSink
+{
+    int fd;
+
+    FileSink(int fd) : fd(fd) { }
+
+    bool operator()(const string &text) const
+    {
+        const char *p = text.data();
+        size_t length = text.size();
+
+        while (length > 0)
+        {
+            ssize_t written = ::write(fd, p, length);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            p += written;
+            length -= written;
+        }
+
+        return true;
+    }
+};
+
+struct StreamSink
+{
+    MemoryWriteStream *stream;
+
+    StreamSink(MemoryWriteStream *stream) : stream(stream) { }
+
+    bool operator()(const string &text) const
+    {
+        stream->writeBytes(text.data(), (unsigned int)text.size());
+        return true;
+    }
+};
+
+static void appendCountLine(string &text, const char *label, unsigned int count)
+{
+    char number[16];
+    text += label;
+    text.append(number, WavefrontObjectWriter::formatUnsigned(count, number) - number);
+    text += '\n';
+}
+
+WavefrontObjectWriter::WavefrontObjectWriter()
+{
+}
+
+void WavefrontObjectWriter::addGroup(const string &name, Mesh2 *mesh, const Matrix4x4 &transform)
+{
+    Group group;
+    group.name = name;
+    group.mesh = mesh;
+    group.transform = transform;
+    _groups.push_back(group);
+}
+
+template <class TSink>
+bool WavefrontObjectWriter::writeGroups(TSink &sink)
+{
+    FPProfileZone zone("WavefrontObjectWriter::write");
+
+    string text;
+    if (!_comment.empty())
+        text = "# " + _comment + "\n";
+
+    vector<VertexNode *> vertices;
+    vector<TexCoordNode *> texCoords;
+    vector<TriangleNode *> triangles;
+
+    // face indices in Wavefront Object starts from 1
+    unsigned int vertexOffset = 1;
+    unsigned int texCoordOffset = 1;
+
+    for (unsigned int i = 0; i < _groups.size(); i++)
+    {
+        const Group &group = _groups[i];
+        const Mesh2 *mesh = group.mesh;
+
+        vertices.clear();
+        texCoords.clear();
+        triangles.clear();
+
+        for (VertexNode *node = mesh->vertices().begin(), *end = mesh->vertices().end(); node != end; node = node->next())
+        {
+            node->algorithmData.index = (unsigned int)vertices.size();
+            vertices.push_back(node);
+        }
+
+        for (TexCoordNode *node = mesh->texCoords().begin(), *end = mesh->texCoords().end(); node != end; node = node->next())
+        {
+            node->algorithmData.index = (unsigned int)texCoords.size();
+            texCoords.push_back(node);
+        }
+
+        for (TriangleNode *node = mesh->triangles().begin(), *end = mesh->triangles().end(); node != end; node = node->next())
+            triangles.push_back(node);
+
+        text += "g " + group.name + "\n";
+        appendCountLine(text, "# Number of vertices = ", (unsigned int)vertices.size());
+        if (!sink(text))
+            return false;
+
+        VertexLines vertexLines(vertices, group.transform);
+        if (!writeLines(vertexLines, (unsigned int)vertices.size(), _buffers, sink))
+            return false;
+
+        text.clear();
+        appendCountLine(text, "# Number of texture coordinates = ", (unsigned int)texCoords.size());
+        if (!sink(text))
+            return false;
+
+        TexCoordLines texCoordLines(texCoords);
+        if (!writeLines(texCoordLines, (unsigned int)texCoords.size(), _buffers, sink))
+            return false;
+
+        text.clear();
+        appendCountLine(text, "# Number of triangles and quads = ", (unsigned int)triangles.size());
+        if (!sink(text))
+            return false;
+
+        FaceLines faceLines(triangles, vertexOffset, texCoordOffset);
+        if (!writeLines(faceLines, (unsigned int)triangles.size(), _buffers, sink))
+            return false;
+
+        vertexOffset += (unsigned int)vertices.size();
+        texCoordOffset += (unsigned int)texCoords.size();
+        text.clear();
+    }
+
+    return text.empty() || sink(text);
+}
+
+bool WavefrontObjectWriter::write(int fd)
+{
+    FileSink sink(fd);
+    return writeGroups(sink);
+}
+
+bool WavefrontObjectWriter::writeFile(const char *path)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+
+    bool written = write(fd);
+    int error = errno;
+
+    if (close(fd) != 0 && written)
+        return false;
+
+    errno = error;
+    return written;
+}
+
+void WavefrontObjectWriter::write(MemoryWriteStream *stream)
+{
+    StreamSink sink(stream);
+    writeGroups(sink);
+}
@@ -0,0 +1,59 @@
+//
+//  WavefrontObjectWriter.h
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#pragma once
+
+#include "Mesh2.h"
+#include <string>
+
+// Wavefront OBJ exporter writing one group per mesh. Meshes are not copied,
+// the group transform, the rotation to the file axes and the flipped
+// winding are applied while the lines are formatted. Lines are formatted
+// in blocks on worker threads and written in file order, so only a few
+// blocks are in memory at a time. Floats get the shortest text that reads
+// back as the same float.
+class WavefrontObjectWriter
+{
+private:
+    struct Group
+    {
+        string name;
+        Mesh2 *mesh;
+        Matrix4x4 transform;
+    };
+
+    string _comment;
+    vector<Group> _groups;
+    vector<string> _buffers;
+
+    template <class TSink>
+    bool writeGroups(TSink &sink);
+
+    WavefrontObjectWriter(const WavefrontObjectWriter &other);
+    WavefrontObjectWriter &operator=(const WavefrontObjectWriter &other);
+
+public:
+    static const unsigned int kBlockLines = 16384;
+
+    WavefrontObjectWriter();
+
+    // written as the first line
+    void setComment(const string &comment) { _comment = comment; }
+
+    // Writing renumbers algorithmData of the mesh, it must not change
+    // until the write returns.
+    void addGroup(const string &name, Mesh2 *mesh, const Matrix4x4 &transform);
+
+    // returns false with errno set when the file cannot be written
+    bool write(int fd);
+    bool writeFile(const char *path);
+    void write(MemoryWriteStream *stream);
+
+    // Writes the shortest decimal that reads back as value, returns the end.
+    static char *formatFloat(float value, char *text);
+    static char *formatUnsigned(unsigned int value, char *text);
+};
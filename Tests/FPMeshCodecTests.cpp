@@ -0,0 +1,164 @@
+//
+//  FPMeshCodecTests.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "FPMeshCodec.h"
+#include "Mesh2.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+struct IndexArrays
+{
+    vector<float> positions;
+    vector<float> texCoords;
+    vector<unsigned char> faceSizes;
+    vector<unsigned int> vertexIndices;
+    vector<unsigned int> texCoordIndices;
+
+    void encode(float tolerance, vector<unsigned char> &output) const
+    {
+        FPMeshCodec::encode(positions, texCoords, faceSizes, vertexIndices, texCoordIndices, tolerance, output);
+    }
+
+    bool decode(const unsigned char *data, size_t length)
+    {
+        return FPMeshCodec::decode(data, length, positions, texCoords, faceSizes, vertexIndices, texCoordIndices);
+    }
+};
+
+class FPMeshCodecTest : public ::testing::Test
+{
+protected:
+    IndexArrays arrays;
+
+    virtual void SetUp()
+    {
+        Mesh2 *mesh = new Mesh2();
+        mesh->make(MeshType::Sphere, 24);
+
+        // positions off the quantization grid
+        Matrix4x4 matrix;
+        matrix.TranslateRotateScale(Vector3D(0.1f, -3.7f, 12.3f), Quaternion(), Vector3D(1.3f, 0.7f, 2.9f));
+        mesh->transformAll(matrix);
+
+        mesh->toIndexArrays(arrays.positions, arrays.texCoords, arrays.faceSizes, arrays.vertexIndices, arrays.texCoordIndices);
+        mesh->release();
+    }
+};
+
+TEST_F(FPMeshCodecTest, ZeroToleranceIsExact)
+{
+    vector<unsigned char> encoded;
+    arrays.encode(0.0f, encoded);
+
+    IndexArrays decoded;
+    ASSERT_TRUE(decoded.decode(encoded.data(), encoded.size()));
+
+    ASSERT_EQ(arrays.positions.size(), decoded.positions.size());
+    EXPECT_EQ(0, memcmp(arrays.positions.data(), decoded.positions.data(), arrays.positions.size() * sizeof(float)));
+    ASSERT_EQ(arrays.texCoords.size(), decoded.texCoords.size());
+    EXPECT_EQ(0, memcmp(arrays.texCoords.data(), decoded.texCoords.data(), arrays.texCoords.size() * sizeof(float)));
+    EXPECT_EQ(arrays.faceSizes, decoded.faceSizes);
+    EXPECT_EQ(arrays.vertexIndices, decoded.vertexIndices);
+    EXPECT_EQ(arrays.texCoordIndices, decoded.texCoordIndices);
+}
+
+TEST_F(FPMeshCodecTest, ToleranceBoundsError)
+{
+    const float tolerances[] = { 0.1f, 0.001f, 0.00001f };
+    size_t previousSize = 0;
+
+    for (unsigned int t = 0; t < 3; t++)
+    {
+        float tolerance = tolerances[t];
+
+        vector<unsigned char> encoded;
+        arrays.encode(tolerance, encoded);
+
+        // a finer grid takes more bytes
+        EXPECT_LT(previousSize, encoded.size());
+        previousSize = encoded.size();
+
+        IndexArrays decoded;
+        ASSERT_TRUE(decoded.decode(encoded.data(), encoded.size()));
+        ASSERT_EQ(arrays.positions.size(), decoded.positions.size());
+
+        for (unsigned int i = 0; i < arrays.positions.size(); i++)
+        {
+            float value = arrays.positions[i];
+            float rounding = 4.0f * FLT_EPSILON * max(fabsf(value), 16.0f);
+            ASSERT_LE(fabsf(value - decoded.positions[i]), tolerance + rounding) << "tolerance " << tolerance << " coordinate " << i;
+        }
+
+        // only positions are quantized
+        EXPECT_EQ(arrays.texCoords, decoded.texCoords);
+        EXPECT_EQ(arrays.faceSizes, decoded.faceSizes);
+        EXPECT_EQ(arrays.vertexIndices, decoded.vertexIndices);
+        EXPECT_EQ(arrays.texCoordIndices, decoded.texCoordIndices);
+    }
+}
+
+TEST_F(FPMeshCodecTest, TruncatedInputFails)
+{
+    for (unsigned int t = 0; t < 2; t++)
+    {
+        vector<unsigned char> encoded;
+        arrays.encode(t == 0 ? 0.0f : 0.001f, encoded);
+
+        IndexArrays decoded;
+        ASSERT_TRUE(decoded.decode(encoded.data(), encoded.size()));
+
+        // a copy of exactly the remaining bytes, so reading past them is caught by sanitizers
+        for (size_t length = 0; length < encoded.size(); length++)
+        {
+            vector<unsigned char> truncated(encoded.begin(), encoded.begin() + length);
+            ASSERT_FALSE(decoded.decode(truncated.data(), truncated.size())) << "length " << length;
+        }
+    }
+}
+
+TEST_F(FPMeshCodecTest, DamagedInputFails)
+{
+    vector<unsigned char> encoded;
+    arrays.encode(0.001f, encoded);
+
+    IndexArrays decoded;
+
+    // unknown codec version
+    vector<unsigned char> damaged = encoded;
+    damaged[0]++;
+    EXPECT_FALSE(decoded.decode(damaged.data(), damaged.size()));
+
+    // counts larger than the streams behind them, the vertex count follows version and flags
+    for (unsigned int i = 2; i < 2 + 4 * sizeof(unsigned int); i++)
+    {
+        if (encoded[i] == 0xFF)
+            continue;
+        damaged = encoded;
+        damaged[i] = 0xFF;
+        EXPECT_FALSE(decoded.decode(damaged.data(), damaged.size())) << "byte " << i;
+    }
+
+    // any other flipped byte either fails or decodes to consistent arrays
+    for (size_t i = 0; i < encoded.size(); i += 7)
+    {
+        damaged = encoded;
+        damaged[i] ^= 0x5A;
+
+        if (decoded.decode(damaged.data(), damaged.size()))
+        {
+            unsigned int indexCount = 0;
+            for (unsigned int j = 0; j < decoded.faceSizes.size(); j++)
+                indexCount += decoded.faceSizes[j];
+            EXPECT_LE(indexCount, decoded.vertexIndices.size()) << "byte " << i;
+            EXPECT_EQ(decoded.vertexIndices.size(), decoded.texCoordIndices.size()) << "byte " << i;
+            EXPECT_EQ(0U, decoded.positions.size() % 3) << "byte " << i;
+        }
+    }
+}
@@ -0,0 +1,118 @@
+//
+//  FPParallelTests.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "FPParallel.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <mutex>
+#include <set>
+
+// Each chunk writes its indices and waits a moment for another thread to
+// join, so even on one core the workers take some of the chunks.
+struct RecordThreads
+{
+    vector<unsigned int> &values;
+    set<thread::id> threads;
+    mutex threadsMutex;
+    atomic<unsigned int> entered;
+
+    RecordThreads(vector<unsigned int> &values) : values(values), entered(0) { }
+
+    void operator()(unsigned int begin, unsigned int end)
+    {
+        {
+            lock_guard<mutex> lock(threadsMutex);
+            threads.insert(this_thread::get_id());
+        }
+
+        entered++;
+        chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::seconds(5);
+        while (entered < 2 && chrono::steady_clock::now() < deadline)
+            this_thread::yield();
+
+        for (unsigned int i = begin; i < end; i++)
+            values[i] = i * 2;
+    }
+};
+
+struct NestedRange
+{
+    vector<unsigned int> &values;
+
+    NestedRange(vector<unsigned int> &values) : values(values) { }
+
+    void operator()(unsigned int begin, unsigned int end)
+    {
+        for (unsigned int i = begin; i < end; i++)
+            values[i] = i + 1;
+    }
+};
+
+// Starts a range on the busy workers from inside another range.
+struct OuterRange
+{
+    vector<unsigned int> &inner;
+    vector<unsigned int> &values;
+
+    OuterRange(vector<unsigned int> &inner, vector<unsigned int> &values) : inner(inner), values(values) { }
+
+    void operator()(unsigned int begin, unsigned int end)
+    {
+        if (begin == 0)
+        {
+            NestedRange nested(inner);
+            FPParallel::forRange((unsigned int)inner.size(), nested);
+        }
+
+        for (unsigned int i = begin; i < end; i++)
+            values[i] = i;
+    }
+};
+
+TEST(FPParallelTest, WorkersTakeChunks)
+{
+    FPParallel::setThreadCount(4);
+    ASSERT_EQ(4U, FPParallel::threadCount());
+
+    unsigned int count = FPParallel::kMinimumRangeSize * 8;
+
+    // the second run finds the workers asleep from the first one
+    for (unsigned int run = 0; run < 2; run++)
+    {
+        vector<unsigned int> values(count, UINT_MAX);
+        RecordThreads record(values);
+        FPParallel::forRange(count, record);
+
+        EXPECT_LT(1U, record.threads.size());
+        for (unsigned int i = 0; i < count; i++)
+            ASSERT_EQ(i * 2, values[i]);
+    }
+
+    FPParallel::setThreadCount(0);
+}
+
+TEST(FPParallelTest, NestedRangeRunsOnItsOwnThreads)
+{
+    FPParallel::setThreadCount(3);
+
+    unsigned int count = FPParallel::kMinimumRangeSize * 3;
+    vector<unsigned int> inner(count, 0);
+    vector<unsigned int> values(count, UINT_MAX);
+
+    OuterRange outer(inner, values);
+    FPParallel::forRange(count, outer);
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        ASSERT_EQ(i + 1, inner[i]);
+        ASSERT_EQ(i, values[i]);
+    }
+
+    FPParallel::setThreadCount(0);
+}
@@ -0,0 +1,265 @@
+//
+//  FPSelectionRegionTests.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "FPSelectionRegion.h"
+#include "Mesh2.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+
+// With identity matrices a 100 pixel viewport maps world x and y in
+// [-1, 1] to window pixels, window = (world + 1) * 50.
+static const int kViewportSize = 100;
+
+static Vector3D fromWindow(float x, float y, float z = 0.0f)
+{
+    return Vector3D(x / 50.0f - 1.0f, y / 50.0f - 1.0f, z);
+}
+
+static void setIdentity(FPSelectionRegion &region)
+{
+    Matrix4x4 identity;
+    region.setMatrices(identity, identity, kViewportSize, kViewportSize);
+}
+
+// U shaped lasso, the notch between its arms is outside
+static void setLasso(FPSelectionRegion &region)
+{
+    const float points[8][2] = { { 10, 10 }, { 90, 10 }, { 90, 90 }, { 70, 90 }, { 70, 30 }, { 30, 30 }, { 30, 90 }, { 10, 90 } };
+
+    vector<Vector2D> polygon;
+    for (unsigned int i = 0; i < 8; i++)
+        polygon.push_back(Vector2D(points[i][0], points[i][1]));
+
+    region.setPolygon(polygon);
+}
+
+static bool insideLasso(float x, float y)
+{
+    if (x <= 10.0f || x >= 90.0f || y <= 10.0f || y >= 90.0f)
+        return false;
+    return y < 30.0f || x < 30.0f || x > 70.0f;
+}
+
+static vector<bool> contains(const FPSelectionRegion &region, const vector<Vector3D> &points)
+{
+    bool *inside = new bool[points.size()];
+    region.containsPoints(Matrix4x4(), &points[0], (unsigned int)points.size(), inside);
+
+    vector<bool> result(inside, inside + points.size());
+    delete [] inside;
+    return result;
+}
+
+// a triangle or an edge is inside when all its corners are
+static bool containsAll(const FPSelectionRegion &region, const vector<Vector3D> &corners)
+{
+    vector<bool> inside = contains(region, corners);
+    return find(inside.begin(), inside.end(), false) == inside.end();
+}
+
+TEST(FPSelectionRegionTest, RectangleContainsPoints)
+{
+    FPSelectionRegion region;
+    setIdentity(region);
+    region.setRectangle(25, 25, 50, 50);
+
+    vector<Vector3D> points;
+    points.push_back(fromWindow(50, 50));
+    points.push_back(fromWindow(26, 74, 0.9f));
+    points.push_back(fromWindow(25, 50));       // on the left edge
+    points.push_back(fromWindow(50, 75));       // on the top edge
+    points.push_back(fromWindow(20, 50));
+    points.push_back(fromWindow(50, 80));
+    points.push_back(fromWindow(50, 50, 1.5f)); // beyond the far plane
+    points.push_back(fromWindow(50, 50, -1.0f)); // on the near plane
+
+    // more than one batch with a short tail
+    for (unsigned int i = 0; i < FPSelectionRegion::kBatchSize + 3; i++)
+        points.push_back(fromWindow(30.0f + (float)i * 4.0f, 40.0f));
+
+    vector<bool> inside = contains(region, points);
+
+    EXPECT_TRUE(inside[0]);
+    EXPECT_TRUE(inside[1]);
+    for (unsigned int i = 2; i < 8; i++)
+        EXPECT_FALSE(inside[i]) << "point " << i;
+    for (unsigned int i = 8; i < points.size(); i++)
+        EXPECT_EQ(30.0f + (float)(i - 8) * 4.0f < 75.0f, inside[i]) << "point " << i;
+}
+
+TEST(FPSelectionRegionTest, LassoContainsPoints)
+{
+    FPSelectionRegion region;
+    setIdentity(region);
+    setLasso(region);
+
+    vector<Vector3D> points;
+    vector<bool> expected;
+
+    for (float y = 5.0f; y < 100.0f; y += 10.0f)
+    {
+        for (float x = 5.0f; x < 100.0f; x += 10.0f)
+        {
+            points.push_back(fromWindow(x, y));
+            expected.push_back(insideLasso(x, y));
+        }
+    }
+
+    // inside the polygon but outside the depth range
+    points.push_back(fromWindow(20, 20, 1.5f));
+    expected.push_back(false);
+
+    vector<bool> inside = contains(region, points);
+
+    for (unsigned int i = 0; i < points.size(); i++)
+        EXPECT_EQ(expected[i], inside[i]) << "point " << i;
+}
+
+// A point behind a perspective camera is never inside, even where its
+// projection would land in the region.
+TEST(FPSelectionRegionTest, PerspectiveSkipsPointsBehindCamera)
+{
+    Matrix4x4 projection, view;
+    projection.Perspective(90.0f, 1.0f, 0.1f, 10.0f);
+
+    vector<Vector3D> points;
+    points.push_back(Vector3D(0.0f, 0.0f, -1.0f));
+    points.push_back(Vector3D(0.0f, 0.0f, 1.0f));
+    points.push_back(Vector3D(0.5f, 0.5f, 1.0f));
+    points.push_back(Vector3D(0.0f, 0.0f, -20.0f));
+
+    FPSelectionRegion region;
+    region.setMatrices(projection, view, kViewportSize, kViewportSize);
+
+    for (unsigned int lasso = 0; lasso < 2; lasso++)
+    {
+        if (lasso == 0)
+        {
+            region.setRectangle(0, 0, kViewportSize, kViewportSize);
+        }
+        else
+        {
+            vector<Vector2D> polygon;
+            polygon.push_back(Vector2D(0, 0));
+            polygon.push_back(Vector2D(kViewportSize, 0));
+            polygon.push_back(Vector2D(kViewportSize, kViewportSize));
+            polygon.push_back(Vector2D(0, kViewportSize));
+            region.setPolygon(polygon);
+        }
+
+        vector<bool> inside = contains(region, points);
+        EXPECT_TRUE(inside[0]);
+        EXPECT_FALSE(inside[1]);
+        EXPECT_FALSE(inside[2]);
+        EXPECT_FALSE(inside[3]);
+    }
+}
+
+TEST(FPSelectionRegionTest, TrianglesAndEdgesInside)
+{
+    FPSelectionRegion region;
+    setIdentity(region);
+
+    vector<Vector3D> inRectangle, crossingRectangle, inLasso, inNotch, edgeInside, edgeIntoNotch;
+
+    inRectangle.push_back(fromWindow(30, 30));
+    inRectangle.push_back(fromWindow(70, 30));
+    inRectangle.push_back(fromWindow(50, 70));
+
+    crossingRectangle.push_back(fromWindow(30, 30));
+    crossingRectangle.push_back(fromWindow(70, 30));
+    crossingRectangle.push_back(fromWindow(50, 80));
+
+    inLasso.push_back(fromWindow(15, 15));
+    inLasso.push_back(fromWindow(85, 15));
+    inLasso.push_back(fromWindow(20, 80));
+
+    inNotch.push_back(fromWindow(15, 15));
+    inNotch.push_back(fromWindow(85, 15));
+    inNotch.push_back(fromWindow(50, 50));
+
+    edgeInside.push_back(fromWindow(40, 40));
+    edgeInside.push_back(fromWindow(60, 60));
+
+    edgeIntoNotch.push_back(fromWindow(20, 20));
+    edgeIntoNotch.push_back(fromWindow(40, 40));
+
+    region.setRectangle(25, 25, 50, 50);
+    EXPECT_TRUE(containsAll(region, inRectangle));
+    EXPECT_FALSE(containsAll(region, crossingRectangle));
+    EXPECT_TRUE(containsAll(region, edgeInside));
+    EXPECT_FALSE(containsAll(region, edgeIntoNotch));
+
+    setLasso(region);
+    EXPECT_TRUE(containsAll(region, inLasso));
+    EXPECT_FALSE(containsAll(region, inNotch));
+    EXPECT_FALSE(containsAll(region, edgeInside));
+    EXPECT_FALSE(containsAll(region, edgeIntoNotch));
+
+    region.setPolygon(vector<Vector2D>());
+    EXPECT_FALSE(containsAll(region, edgeInside));
+}
+
+// 10 x 10 grid of quads, vertex window coordinates are 2.5 + 10 * i so
+// none lies on a region border.
+static Mesh2 *makeGrid()
+{
+    vector<float> positions;
+    for (unsigned int y = 0; y < 10; y++)
+    {
+        for (unsigned int x = 0; x < 10; x++)
+        {
+            Vector3D position = fromWindow(2.5f + 10.0f * (float)x, 2.5f + 10.0f * (float)y);
+            positions.push_back(position.x);
+            positions.push_back(position.y);
+            positions.push_back(position.z);
+        }
+    }
+
+    vector<unsigned char> faceSizes;
+    vector<unsigned int> indices;
+    for (unsigned int y = 0; y < 9; y++)
+    {
+        for (unsigned int x = 0; x < 9; x++)
+        {
+            faceSizes.push_back(4);
+            indices.push_back(y * 10 + x);
+            indices.push_back(y * 10 + x + 1);
+            indices.push_back((y + 1) * 10 + x + 1);
+            indices.push_back((y + 1) * 10 + x);
+        }
+    }
+
+    Mesh2 *mesh = new Mesh2();
+    mesh->fromIndexArrays(&positions[0], 100, &positions[0], 100, &faceSizes[0], (unsigned int)faceSizes.size(), &indices[0], &indices[0]);
+    mesh->setSelectionMode(MeshSelectionMode::Vertices);
+    return mesh;
+}
+
+TEST(FPSelectionRegionTest, MeshProjectSelect)
+{
+    Mesh2 *mesh = makeGrid();
+    FPSelectionRegion region;
+    setIdentity(region);
+
+    region.setRectangle(25, 25, 50, 50);
+    mesh->projectSelect(region, Matrix4x4(), OpenGLSelectionMode::Add);
+
+    setLasso(region);
+    mesh->projectSelect(region, Matrix4x4(), OpenGLSelectionMode::Invert);
+
+    unsigned int index = 0;
+    for (VertexNode *node = mesh->vertices().begin(); node != mesh->vertices().end(); node = node->next(), index++)
+    {
+        float x = (node->data().position.x + 1.0f) * 50.0f;
+        float y = (node->data().position.y + 1.0f) * 50.0f;
+        bool inRectangle = x > 25.0f && x < 75.0f && y > 25.0f && y < 75.0f;
+        EXPECT_EQ(inRectangle != insideLasso(x, y), mesh->isSelectedAtIndex(index)) << "vertex " << index;
+    }
+
+    mesh->release();
+}
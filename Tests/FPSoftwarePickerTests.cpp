@@ -0,0 +1,214 @@
+//
+//  FPSoftwarePickerTests.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "FPSoftwarePicker.h"
+#include "Mesh2.h"
+#include <gtest/gtest.h>
+
+// With identity matrices clip space is world space, a 64 pixel viewport
+// maps x and y in [-1, 1] to pixels and z to depth z * 0.5 + 0.5.
+static const int kViewportSize = 64;
+
+static void beginPick(FPSoftwarePicker &picker, int x, int y, int width, int height, unsigned int count)
+{
+    Matrix4x4 identity;
+    picker.begin(identity, identity, kViewportSize, kViewportSize, x, y, width, height, count);
+}
+
+static void addQuad(FPSoftwarePicker &picker, float minX, float minY, float maxX, float maxY, float z, unsigned int id)
+{
+    picker.addTriangle(Vector3D(minX, minY, z), Vector3D(maxX, minY, z), Vector3D(maxX, maxY, z), id);
+    picker.addTriangle(Vector3D(minX, minY, z), Vector3D(maxX, maxY, z), Vector3D(minX, maxY, z), id);
+}
+
+TEST(FPSoftwarePickerTest, PointLineAndTriangleHits)
+{
+    FPSoftwarePicker picker;
+
+    // point at pixel (48, 48), line along row 16, triangle around the center
+    beginPick(picker, 0, 0, kViewportSize, kViewportSize, 3);
+    picker.addPoint(Vector3D(0.5f, 0.5f, 0.0f), 1);
+    picker.addLine(Vector3D(-0.8f, -0.49f, 0.0f), Vector3D(-0.2f, -0.49f, 0.0f), 2);
+    picker.addTriangle(Vector3D(-0.1f, -0.1f, 0.0f), Vector3D(0.1f, -0.1f, 0.0f), Vector3D(0.0f, 0.1f, 0.0f), 3);
+
+    vector<bool> hits;
+    picker.end(hits);
+    ASSERT_EQ(3U, hits.size());
+    EXPECT_TRUE(hits[0]);
+    EXPECT_TRUE(hits[1]);
+    EXPECT_TRUE(hits[2]);
+
+    // a small rectangle sees only what is inside it
+    const int rectangles[3][2] = { { 46, 46 }, { 14, 14 }, { 30, 30 } };
+
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        beginPick(picker, rectangles[i][0], rectangles[i][1], 4, 4, 3);
+        picker.addPoint(Vector3D(0.5f, 0.5f, 0.0f), 1);
+        picker.addLine(Vector3D(-0.8f, -0.49f, 0.0f), Vector3D(-0.2f, -0.49f, 0.0f), 2);
+        picker.addTriangle(Vector3D(-0.1f, -0.1f, 0.0f), Vector3D(0.1f, -0.1f, 0.0f), Vector3D(0.0f, 0.1f, 0.0f), 3);
+        picker.end(hits);
+
+        for (unsigned int j = 0; j < 3; j++)
+            EXPECT_EQ(i == j, hits[j]) << "rectangle " << i << " id " << j + 1;
+    }
+
+    // nothing outside the view frustum
+    beginPick(picker, 0, 0, kViewportSize, kViewportSize, 3);
+    picker.addPoint(Vector3D(0.0f, 0.0f, 2.0f), 1);
+    picker.addLine(Vector3D(-0.5f, 0.0f, -1.5f), Vector3D(0.5f, 0.0f, -1.5f), 2);
+    picker.addTriangle(Vector3D(1.5f, 0.0f, 0.0f), Vector3D(2.0f, 0.0f, 0.0f), Vector3D(2.0f, 0.5f, 0.0f), 3);
+    picker.end(hits);
+    EXPECT_FALSE(hits[0]);
+    EXPECT_FALSE(hits[1]);
+    EXPECT_FALSE(hits[2]);
+}
+
+TEST(FPSoftwarePickerTest, NearestDepthWins)
+{
+    FPSoftwarePicker picker;
+    vector<bool> hits;
+
+    // the same overlap in both submission orders
+    for (unsigned int order = 0; order < 2; order++)
+    {
+        beginPick(picker, 24, 24, 16, 16, 2);
+
+        if (order == 0)
+        {
+            addQuad(picker, -0.5f, -0.5f, 0.5f, 0.5f, -0.5f, 1);
+            addQuad(picker, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f, 2);
+        }
+        else
+        {
+            addQuad(picker, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f, 2);
+            addQuad(picker, -0.5f, -0.5f, 0.5f, 0.5f, -0.5f, 1);
+        }
+
+        picker.end(hits);
+        EXPECT_TRUE(hits[0]);
+        EXPECT_FALSE(hits[1]);
+    }
+
+    // a tilted triangle crossing a flat one wins on the side where it is nearer
+    beginPick(picker, 0, 0, kViewportSize, kViewportSize, 2);
+    picker.addTriangle(Vector3D(-0.9f, -0.9f, 0.0f), Vector3D(0.9f, -0.9f, 0.0f), Vector3D(0.0f, 0.9f, 0.0f), 1);
+    picker.addTriangle(Vector3D(-0.9f, -0.9f, -0.5f), Vector3D(0.9f, -0.9f, -0.5f), Vector3D(0.0f, 0.9f, 0.5f), 2);
+    picker.end(hits);
+    EXPECT_TRUE(hits[0]);
+    EXPECT_TRUE(hits[1]);
+
+    beginPick(picker, 30, 8, 4, 4, 2);
+    picker.addTriangle(Vector3D(-0.9f, -0.9f, 0.0f), Vector3D(0.9f, -0.9f, 0.0f), Vector3D(0.0f, 0.9f, 0.0f), 1);
+    picker.addTriangle(Vector3D(-0.9f, -0.9f, -0.5f), Vector3D(0.9f, -0.9f, -0.5f), Vector3D(0.0f, 0.9f, 0.5f), 2);
+    picker.end(hits);
+    EXPECT_FALSE(hits[0]);
+    EXPECT_TRUE(hits[1]);
+}
+
+TEST(FPSoftwarePickerTest, OccluderHidesWhatIsBehind)
+{
+    FPSoftwarePicker picker;
+    vector<bool> hits;
+
+    for (unsigned int selectThrough = 0; selectThrough < 2; selectThrough++)
+    {
+        beginPick(picker, 0, 0, kViewportSize, kViewportSize, 4);
+        picker.setDepthTest(selectThrough == 0);
+
+        picker.addOccluder(Vector3D(-0.5f, -0.5f, 0.0f), Vector3D(0.5f, -0.5f, 0.0f), Vector3D(0.5f, 0.5f, 0.0f));
+        picker.addOccluder(Vector3D(-0.5f, -0.5f, 0.0f), Vector3D(0.5f, 0.5f, 0.0f), Vector3D(-0.5f, 0.5f, 0.0f));
+
+        // behind the occluder
+        picker.addPoint(Vector3D(0.0f, 0.0f, 0.5f), 1);
+        picker.addLine(Vector3D(-0.3f, 0.2f, 0.5f), Vector3D(0.3f, 0.2f, 0.5f), 2);
+        // on the occluder, the polygon offset keeps them in front
+        picker.addPoint(Vector3D(0.25f, -0.25f, 0.0f), 3);
+        picker.addLine(Vector3D(-0.3f, -0.2f, 0.0f), Vector3D(0.3f, -0.2f, 0.0f), 4);
+
+        picker.end(hits);
+        ASSERT_EQ(4U, hits.size());
+        EXPECT_EQ(selectThrough == 1, hits[0]);
+        EXPECT_EQ(selectThrough == 1, hits[1]);
+        EXPECT_TRUE(hits[2]);
+        EXPECT_TRUE(hits[3]);
+    }
+}
+
+// Front quad at z -0.5 hides a smaller back quad at z 0.5 completely.
+static Mesh2 *makeTwoQuads()
+{
+    const float positions[] =
+    {
+        -0.5f, -0.5f, -0.5f,    0.5f, -0.5f, -0.5f,    0.5f, 0.5f, -0.5f,    -0.5f, 0.5f, -0.5f,
+        -0.25f, -0.25f, 0.5f,   0.25f, -0.25f, 0.5f,   0.25f, 0.25f, 0.5f,   -0.25f, 0.25f, 0.5f,
+    };
+    const unsigned char faceSizes[] = { 4, 4 };
+    const unsigned int indices[] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+
+    Mesh2 *mesh = new Mesh2();
+    mesh->fromIndexArrays(positions, 8, positions, 8, faceSizes, 2, indices, indices);
+    return mesh;
+}
+
+struct IsFront
+{
+    bool operator()(const Vertex2 &vertex) const { return vertex.position.z < 0.0f; }
+    bool operator()(const VertexEdge &edge) const { return edge.vertex(0)->data().position.z < 0.0f; }
+    bool operator()(const Triangle2 &triangle) const { return triangle.vertex(0)->data().position.z < 0.0f; }
+};
+
+template <class Node>
+static void expectFrontHits(Node *begin, Node *end, const vector<bool> &hits, bool selectThrough)
+{
+    IsFront isFront;
+    unsigned int index = 0;
+
+    for (Node *node = begin; node != end; node = node->next(), index++)
+    {
+        ASSERT_LT(index, hits.size());
+        EXPECT_EQ(selectThrough || isFront(node->data()), hits[index]) << "index " << index;
+    }
+
+    EXPECT_EQ(hits.size(), index);
+}
+
+// Mesh2::pickAll hides what is behind the mesh unless it selects through.
+TEST(FPSoftwarePickerTest, MeshSelectThrough)
+{
+    Mesh2 *mesh = makeTwoQuads();
+    FPSoftwarePicker picker;
+    vector<bool> hits;
+
+    bool oldSelectThrough = Mesh2::selectThrough();
+
+    for (unsigned int selectThrough = 0; selectThrough < 2; selectThrough++)
+    {
+        Mesh2::setSelectThrough(selectThrough == 1);
+
+        mesh->setSelectionMode(MeshSelectionMode::Vertices);
+        beginPick(picker, 0, 0, kViewportSize, kViewportSize, mesh->vertexCount());
+        mesh->pickAll(picker);
+        picker.end(hits);
+        expectFrontHits(mesh->vertices().begin(), mesh->vertices().end(), hits, selectThrough == 1);
+
+        mesh->setSelectionMode(MeshSelectionMode::Edges);
+        beginPick(picker, 0, 0, kViewportSize, kViewportSize, mesh->vertexEdges().count());
+        mesh->pickAll(picker);
+        picker.end(hits);
+        expectFrontHits(mesh->vertexEdges().begin(), mesh->vertexEdges().end(), hits, selectThrough == 1);
+
+        mesh->setSelectionMode(MeshSelectionMode::Triangles);
+        beginPick(picker, 0, 0, kViewportSize, kViewportSize, mesh->triangleCount());
+        mesh->pickAll(picker);
+        picker.end(hits);
+        expectFrontHits(mesh->triangles().begin(), mesh->triangles().end(), hits, selectThrough == 1);
+    }
+
+    Mesh2::setSelectThrough(oldSelectThrough);
+    mesh->release();
+}
@@ -0,0 +1,354 @@
+//
+//  HalfEdgeMeshTests.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+// HalfEdgeMesh against Mesh2 after the same operation on the same input.
+// List order differs between the two, so faces are compared as sorted
+// lists of corner positions, each rotated to start at its smallest corner.
+
+#include "Mesh2.h"
+#include "HalfEdgeMesh.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <map>
+
+typedef vector<long long> FaceKey;
+
+static long long quantize(float value)
+{
+    return llround(value * 10000.0);
+}
+
+static void faceKeys(const vector<Vector3D> &positions, const vector<TriQuad> &triangles, bool texCoords, vector<FaceKey> &keys)
+{
+    keys.clear();
+
+    for (unsigned int i = 0; i < triangles.size(); i++)
+    {
+        const TriQuad &triQuad = triangles[i];
+        unsigned int count = triQuad.isQuad ? 4 : 3;
+        vector<FaceKey> corners(count);
+
+        for (unsigned int j = 0; j < count; j++)
+        {
+            const Vector3D &position = positions[texCoords ? triQuad.texCoordIndices[j] : triQuad.vertexIndices[j]];
+            corners[j].push_back(quantize(position.x));
+            corners[j].push_back(quantize(position.y));
+            corners[j].push_back(quantize(position.z));
+        }
+
+        unsigned int first = (unsigned int)(min_element(corners.begin(), corners.end()) - corners.begin());
+        FaceKey key;
+        for (unsigned int j = 0; j < count; j++)
+            key.insert(key.end(), corners[(first + j) % count].begin(), corners[(first + j) % count].end());
+
+        keys.push_back(key);
+    }
+
+    sort(keys.begin(), keys.end());
+}
+
+static void toHalfEdgeMesh(const Mesh2 *mesh, HalfEdgeMesh &halfEdgeMesh)
+{
+    vector<Vector3D> vertices;
+    vector<Vector3D> texCoords;
+    vector<TriQuad> triangles;
+
+    mesh->toIndexRepresentation(vertices, texCoords, triangles);
+    halfEdgeMesh.fromIndexRepresentation(vertices, texCoords, triangles);
+}
+
+static void expectSameMesh(Mesh2 *mesh, const HalfEdgeMesh &halfEdgeMesh, bool compareTexCoords)
+{
+    EXPECT_EQ(mesh->vertexCount(), halfEdgeMesh.vertexCount());
+    EXPECT_EQ(mesh->triangleCount(), halfEdgeMesh.faceCount());
+    EXPECT_EQ(mesh->vertexEdgeCount(), halfEdgeMesh.edgeCount());
+
+    vector<Vector3D> vertices, halfEdgeVertices;
+    vector<Vector3D> texCoords, halfEdgeTexCoords;
+    vector<TriQuad> triangles, halfEdgeTriangles;
+
+    mesh->toIndexRepresentation(vertices, texCoords, triangles);
+    halfEdgeMesh.toIndexRepresentation(halfEdgeVertices, halfEdgeTexCoords, halfEdgeTriangles);
+
+    vector<FaceKey> keys, halfEdgeKeys;
+    faceKeys(vertices, triangles, false, keys);
+    faceKeys(halfEdgeVertices, halfEdgeTriangles, false, halfEdgeKeys);
+    EXPECT_TRUE(keys == halfEdgeKeys);
+
+    if (compareTexCoords)
+    {
+        EXPECT_EQ(texCoords.size(), halfEdgeTexCoords.size());
+        faceKeys(texCoords, triangles, true, keys);
+        faceKeys(halfEdgeTexCoords, halfEdgeTriangles, true, halfEdgeKeys);
+        EXPECT_TRUE(keys == halfEdgeKeys);
+    }
+}
+
+static Mesh2 *makeMesh(MeshType meshType, unsigned int steps)
+{
+    Mesh2 *mesh = new Mesh2();
+    mesh->make(meshType, steps);
+    return mesh;
+}
+
+// same faces selected in both, faces keep their index order after conversion
+static void selectEveryNthFace(Mesh2 *mesh, HalfEdgeMesh &halfEdgeMesh, unsigned int n)
+{
+    mesh->setSelectionMode(MeshSelectionMode::Triangles);
+    for (unsigned int i = 0; i < mesh->triangleCount(); i += n)
+    {
+        mesh->setSelectedAtIndex(true, i);
+        halfEdgeMesh.setFaceSelected(i, true);
+    }
+}
+
+class HalfEdgeMeshTest : public ::testing::TestWithParam<MeshType>
+{
+protected:
+    Mesh2 *mesh;
+    HalfEdgeMesh halfEdgeMesh;
+
+    virtual void SetUp()
+    {
+        mesh = makeMesh(GetParam(), 12);
+        toHalfEdgeMesh(mesh, halfEdgeMesh);
+    }
+
+    virtual void TearDown()
+    {
+        mesh->release();
+    }
+};
+
+TEST_P(HalfEdgeMeshTest, RoundTrip)
+{
+    expectSameMesh(mesh, halfEdgeMesh, true);
+}
+
+TEST_P(HalfEdgeMeshTest, LoopSubdivision)
+{
+    mesh->loopSubdivision();
+    halfEdgeMesh.loopSubdivision();
+    expectSameMesh(mesh, halfEdgeMesh, true);
+
+    mesh->loopSubdivision();
+    halfEdgeMesh.loopSubdivision();
+    expectSameMesh(mesh, halfEdgeMesh, true);
+}
+
+TEST_P(HalfEdgeMeshTest, FlipSelectedFaces)
+{
+    selectEveryNthFace(mesh, halfEdgeMesh, 3);
+    mesh->flipSelectedTriangles();
+    halfEdgeMesh.flipSelectedFaces();
+    expectSameMesh(mesh, halfEdgeMesh, true);
+}
+
+TEST_P(HalfEdgeMeshTest, TurnSelectedEdges)
+{
+    map<const VertexNode *, unsigned int> vertexIndices;
+    unsigned int index = 0;
+    for (VertexNode *node = mesh->vertices().begin(); node != mesh->vertices().end(); node = node->next())
+        vertexIndices[node] = index++;
+
+    // edges that share no triangle, so the order of turning does not matter
+    mesh->setSelectionMode(MeshSelectionMode::Edges);
+    vector<const TriangleNode *> usedTriangles;
+    vector<pair<unsigned int, unsigned int> > selectedEdges;
+    index = 0;
+
+    for (VertexEdgeNode *node = mesh->vertexEdges().begin(); node != mesh->vertexEdges().end(); node = node->next(), index++)
+    {
+        VertexEdge &edge = node->data();
+        const TriangleNode *t0 = edge.triangle(0);
+        const TriangleNode *t1 = edge.triangle(1);
+
+        if (index % 3 != 0 || t0 == NULL || t1 == NULL)
+            continue;
+        if (find(usedTriangles.begin(), usedTriangles.end(), t0) != usedTriangles.end() ||
+            find(usedTriangles.begin(), usedTriangles.end(), t1) != usedTriangles.end())
+            continue;
+
+        usedTriangles.push_back(t0);
+        usedTriangles.push_back(t1);
+        mesh->setSelectedAtIndex(true, index);
+        selectedEdges.push_back(make_pair(vertexIndices[edge.vertex(0)], vertexIndices[edge.vertex(1)]));
+    }
+
+    ASSERT_FALSE(selectedEdges.empty());
+
+    for (unsigned int face = 0; face < halfEdgeMesh.faceCapacity(); face++)
+    {
+        for (unsigned int i = 0; i < halfEdgeMesh.faceSize(face); i++)
+        {
+            unsigned int halfEdge = halfEdgeMesh.faceHalfEdge(face, i);
+            pair<unsigned int, unsigned int> edge(halfEdgeMesh.origin(halfEdge), halfEdgeMesh.destination(halfEdge));
+            pair<unsigned int, unsigned int> reversed(edge.second, edge.first);
+
+            if (find(selectedEdges.begin(), selectedEdges.end(), edge) != selectedEdges.end() ||
+                find(selectedEdges.begin(), selectedEdges.end(), reversed) != selectedEdges.end())
+                halfEdgeMesh.setEdgeSelected(halfEdge, true);
+        }
+    }
+
+    // Mesh2 turns only the vertices and leaves the texture coordinates in place
+    mesh->turnSelectedEdges();
+    halfEdgeMesh.turnSelectedEdges();
+    expectSameMesh(mesh, halfEdgeMesh, false);
+}
+
+TEST_P(HalfEdgeMeshTest, ExtrudeSelectedFaces)
+{
+    selectEveryNthFace(mesh, halfEdgeMesh, 5);
+    mesh->extrudeSelectedTriangles();
+    halfEdgeMesh.extrudeSelectedFaces();
+    expectSameMesh(mesh, halfEdgeMesh, false);
+}
+
+// same vertices selected in both, vertices keep their index order after conversion
+static void selectEveryNthVertex(Mesh2 *mesh, HalfEdgeMesh &halfEdgeMesh, unsigned int n)
+{
+    mesh->setSelectionMode(MeshSelectionMode::Vertices);
+    for (unsigned int i = 0; i < mesh->vertexCount(); i += n)
+    {
+        mesh->setSelectedAtIndex(true, i);
+        halfEdgeMesh.setVertexSelected(i, true);
+    }
+}
+
+TEST_P(HalfEdgeMeshTest, MergeSelectedVertices)
+{
+    vector<Vector3D> vertices;
+    vector<Vector3D> texCoords;
+    vector<TriQuad> triangles;
+    mesh->toIndexRepresentation(vertices, texCoords, triangles);
+
+    // the corners of the first face collapse it and its neighbours
+    mesh->setSelectionMode(MeshSelectionMode::Vertices);
+    unsigned int count = triangles[0].isQuad ? 4 : 3;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        mesh->setSelectedAtIndex(true, triangles[0].vertexIndices[i]);
+        halfEdgeMesh.setVertexSelected(triangles[0].vertexIndices[i], true);
+    }
+
+    unsigned int vertexCount = mesh->vertexCount();
+    mesh->mergeSelected();
+    halfEdgeMesh.mergeSelectedVertices();
+    EXPECT_EQ(vertexCount - count + 1, mesh->vertexCount());
+    expectSameMesh(mesh, halfEdgeMesh, false);
+}
+
+TEST_P(HalfEdgeMeshTest, SplitSelectedFaces)
+{
+    selectEveryNthFace(mesh, halfEdgeMesh, 4);
+    unsigned int triangleCount = mesh->triangleCount();
+    mesh->splitSelected();
+    EXPECT_LT(triangleCount, mesh->triangleCount());
+    halfEdgeMesh.splitSelectedFaces();
+    expectSameMesh(mesh, halfEdgeMesh, true);
+}
+
+TEST_P(HalfEdgeMeshTest, DetachSelectedVertices)
+{
+    selectEveryNthVertex(mesh, halfEdgeMesh, 7);
+    unsigned int vertexCount = mesh->vertexCount();
+    mesh->detachSelected();
+    EXPECT_LT(vertexCount, mesh->vertexCount());
+    halfEdgeMesh.detachSelectedVertices();
+    expectSameMesh(mesh, halfEdgeMesh, true);
+}
+
+TEST_P(HalfEdgeMeshTest, DetachSelectedFaces)
+{
+    selectEveryNthFace(mesh, halfEdgeMesh, 6);
+    unsigned int vertexCount = mesh->vertexCount();
+    mesh->detachSelected();
+    EXPECT_LT(vertexCount, mesh->vertexCount());
+    halfEdgeMesh.detachSelectedFaces();
+    expectSameMesh(mesh, halfEdgeMesh, true);
+}
+
+// with falloff some vertices have to be reached by it, not only selected
+static void expectSameWeights(const Mesh2 *mesh, const HalfEdgeMesh &halfEdgeMesh, bool falloff)
+{
+    unsigned int index = 0;
+    unsigned int softlySelected = 0;
+    for (VertexNode *node = mesh->vertices().begin(); node != mesh->vertices().end(); node = node->next(), index++)
+    {
+        EXPECT_FLOAT_EQ(halfEdgeMesh.selectionWeight(index), node->selectionWeight) << "vertex " << index;
+        if (node->selectionWeight > 0.0f && node->selectionWeight < 1.0f)
+            softlySelected++;
+    }
+    EXPECT_EQ(falloff, softlySelected > 0);
+}
+
+TEST_P(HalfEdgeMeshTest, SoftSelectionFromVertices)
+{
+    Mesh2::setUseSoftSelection(true);
+    selectEveryNthVertex(mesh, halfEdgeMesh, 17);
+    mesh->computeSoftSelection();
+    halfEdgeMesh.computeSoftSelection(MeshSelectionMode::Vertices, Mesh2::selectionWeights());
+    Mesh2::setUseSoftSelection(false);
+    expectSameWeights(mesh, halfEdgeMesh, true);
+}
+
+TEST_P(HalfEdgeMeshTest, SoftSelectionFromFaces)
+{
+    Mesh2::setUseSoftSelection(true);
+    selectEveryNthFace(mesh, halfEdgeMesh, 11);
+    mesh->computeSoftSelection();
+    halfEdgeMesh.computeSoftSelection(MeshSelectionMode::Triangles, Mesh2::selectionWeights());
+    Mesh2::setUseSoftSelection(false);
+    expectSameWeights(mesh, halfEdgeMesh, true);
+}
+
+TEST_P(HalfEdgeMeshTest, SoftSelectionFromEdges)
+{
+    map<const VertexNode *, unsigned int> vertexIndices;
+    unsigned int index = 0;
+    for (VertexNode *node = mesh->vertices().begin(); node != mesh->vertices().end(); node = node->next())
+        vertexIndices[node] = index++;
+
+    mesh->setSelectionMode(MeshSelectionMode::Edges);
+    vector<pair<unsigned int, unsigned int> > selectedEdges;
+    index = 0;
+
+    for (VertexEdgeNode *node = mesh->vertexEdges().begin(); node != mesh->vertexEdges().end(); node = node->next(), index++)
+    {
+        if (index % 13 != 0)
+            continue;
+
+        mesh->setSelectedAtIndex(true, index);
+        unsigned int v0 = vertexIndices[node->data().vertex(0)];
+        unsigned int v1 = vertexIndices[node->data().vertex(1)];
+        selectedEdges.push_back(make_pair(min(v0, v1), max(v0, v1)));
+    }
+
+    for (unsigned int face = 0; face < halfEdgeMesh.faceCapacity(); face++)
+    {
+        for (unsigned int i = 0; i < halfEdgeMesh.faceSize(face); i++)
+        {
+            unsigned int halfEdge = halfEdgeMesh.faceHalfEdge(face, i);
+            unsigned int v0 = halfEdgeMesh.origin(halfEdge);
+            unsigned int v1 = halfEdgeMesh.destination(halfEdge);
+
+            if (find(selectedEdges.begin(), selectedEdges.end(), make_pair(min(v0, v1), max(v0, v1))) != selectedEdges.end())
+                halfEdgeMesh.setEdgeSelected(halfEdge, true);
+        }
+    }
+
+    Mesh2::setUseSoftSelection(true);
+    mesh->computeSoftSelection();
+    halfEdgeMesh.computeSoftSelection(MeshSelectionMode::Edges, Mesh2::selectionWeights());
+    Mesh2::setUseSoftSelection(false);
+    // edges spread along quad loops only
+    expectSameWeights(mesh, halfEdgeMesh, GetParam() != MeshType::Icosahedron);
+}
+
+INSTANTIATE_TEST_CASE_P(Primitives, HalfEdgeMeshTest,
+                        ::testing::Values(MeshType::Cube, MeshType::Icosahedron, MeshType::Sphere));
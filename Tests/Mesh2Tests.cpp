@@ -0,0 +1,710 @@
+//
+//  Mesh2Tests.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "Mesh2.h"
+#include <gtest/gtest.h>
+#include <map>
+
+// A triangle connected through a local edit is hit by rays from both sides
+// without a full triangle cache reset in between.
+TEST(Mesh2Test, ConnectedTriangleIsPicked)
+{
+    Mesh2 *mesh = new Mesh2();
+    mesh->make(MeshType::Cube, 0);
+
+    mesh->addVertex(Vector3D(10.0f, 0.0f, 0.0f));
+    mesh->addVertex(Vector3D(11.0f, 0.0f, 0.0f));
+    mesh->addVertex(Vector3D(10.0f, 1.0f, 0.0f));
+
+    TriangleHit hit;
+    EXPECT_TRUE(mesh->rayIntersect(Vector3D(0.0f, 0.0f, 5.0f), Vector3D(0.0f, 0.0f, -1.0f), hit));
+    EXPECT_FALSE(mesh->rayIntersect(Vector3D(10.25f, 0.25f, 5.0f), Vector3D(0.0f, 0.0f, -1.0f), hit));
+
+    TriangleNode *triangle = mesh->triangleConnectVerticesNearPosition(Vector3D(10.3f, 0.3f, 0.0f), Vector3D(0.0f, 0.0f, 1.0f));
+
+    ASSERT_TRUE(mesh->rayIntersect(Vector3D(10.25f, 0.25f, 5.0f), Vector3D(0.0f, 0.0f, -1.0f), hit));
+    EXPECT_EQ(triangle, hit.triangle);
+    ASSERT_TRUE(mesh->rayIntersect(Vector3D(10.25f, 0.25f, -5.0f), Vector3D(0.0f, 0.0f, 1.0f), hit));
+    EXPECT_EQ(triangle, hit.triangle);
+
+    mesh->release();
+}
+
+// Added vertices go into the vertex grid and the selection cache once.
+TEST(Mesh2Test, AddedVerticesAreFoundOnce)
+{
+    Mesh2 *mesh = new Mesh2();
+    mesh->make(MeshType::Cube, 0);
+    mesh->setSelectionMode(MeshSelectionMode::Vertices);
+
+    vector<VertexNode *> skipVertices;
+    ASSERT_TRUE(mesh->findNearestVertex(Vector3D(), skipVertices) != NULL);
+
+    VertexNode *first = mesh->addVertex(Vector3D(10.0f, 0.0f, 0.0f));
+    VertexNode *second = mesh->addVertex(Vector3D(12.0f, 0.0f, 0.0f));
+    EXPECT_EQ(mesh->vertexCount(), mesh->selectedCount());
+
+    vector<VertexNode *> nearest;
+    mesh->findNearestVertices(Vector3D(10.5f, 0.0f, 0.0f), 2, skipVertices, nearest);
+    ASSERT_EQ(2U, nearest.size());
+    EXPECT_EQ(first, nearest[0]);
+    EXPECT_EQ(second, nearest[1]);
+
+    mesh->release();
+}
+
+// Dragging after a selection change moves the newly selected vertices only.
+TEST(Mesh2Test, TransformSelectedFollowsSelection)
+{
+    Mesh2 *mesh = new Mesh2();
+    mesh->make(MeshType::Cube, 0);
+    mesh->setSelectionMode(MeshSelectionMode::Vertices);
+
+    vector<Vector3D> positions;
+    for (VertexNode *node = mesh->vertices().begin(); node != mesh->vertices().end(); node = node->next())
+        positions.push_back(node->data().position);
+
+    Matrix4x4 matrix;
+    matrix.Translate(0.0f, 1.0f, 0.0f);
+
+    mesh->setSelectedAtIndex(true, 0);
+    mesh->transformSelected(matrix);
+    mesh->transformSelected(matrix);
+
+    mesh->setSelectedAtIndex(false, 0);
+    mesh->setSelectedAtIndex(true, 1);
+    mesh->transformSelected(matrix);
+
+    unsigned int index = 0;
+    for (VertexNode *node = mesh->vertices().begin(); node != mesh->vertices().end(); node = node->next(), index++)
+    {
+        float moved = index == 0 ? 2.0f : (index == 1 ? 1.0f : 0.0f);
+        EXPECT_FLOAT_EQ(positions[index].y + moved, node->data().position.y);
+    }
+
+    mesh->release();
+}
+
+static void countHidden(const Mesh2 *mesh, unsigned int &triangles, unsigned int &edges, unsigned int &vertices)
+{
+    triangles = edges = vertices = 0;
+
+    for (TriangleNode *node = mesh->triangles().begin(); node != mesh->triangles().end(); node = node->next())
+        triangles += node->data().visible ? 0 : 1;
+    for (VertexEdgeNode *node = mesh->vertexEdges().begin(); node != mesh->vertexEdges().end(); node = node->next())
+        edges += node->data().visible ? 0 : 1;
+    for (VertexNode *node = mesh->vertices().begin(); node != mesh->vertices().end(); node = node->next())
+        vertices += node->data().visible ? 0 : 1;
+}
+
+// A duplicated item shares its mesh until the first edit copies it,
+// the copy keeps what was hidden and the original stays as it was.
+TEST(Mesh2Test, CopyKeepsHiddenParts)
+{
+    Mesh2 *mesh = new Mesh2();
+    mesh->make(MeshType::Sphere, 8);
+
+    mesh->setSelectionMode(MeshSelectionMode::Vertices);
+    mesh->setSelectedAtIndex(true, 0);
+    mesh->hideSelected();
+
+    mesh->setSelectionMode(MeshSelectionMode::Edges);
+    mesh->setSelectedAtIndex(true, 5);
+    mesh->hideSelected();
+
+    mesh->setSelectionMode(MeshSelectionMode::Triangles);
+    for (unsigned int i = 0; i < 10; i++)
+        mesh->setSelectedAtIndex(true, i * 7);
+    mesh->hideSelected();
+
+    unsigned int triangles, edges, vertices;
+    countHidden(mesh, triangles, edges, vertices);
+    ASSERT_EQ(10U, triangles);
+    ASSERT_LT(1U, edges);
+    ASSERT_EQ(1U, vertices);
+
+    MeshVisibility visibility;
+    mesh->getVisibility(visibility);
+
+    mesh->retain();
+    Mesh2 *copy = mesh->copy();
+    mesh->release();
+
+    copy->setSelectedAtIndex(true, 1);
+    copy->flipSelectedTriangles();
+
+    MeshVisibility copyVisibility;
+    copy->getVisibility(copyVisibility);
+    EXPECT_EQ(visibility.hiddenVertices, copyVisibility.hiddenVertices);
+    EXPECT_EQ(visibility.hiddenTriangles, copyVisibility.hiddenTriangles);
+    EXPECT_EQ(visibility.hiddenVertexEdges.size(), copyVisibility.hiddenVertexEdges.size());
+
+    unsigned int copyTriangles, copyEdges, copyVertices;
+    countHidden(copy, copyTriangles, copyEdges, copyVertices);
+    EXPECT_EQ(triangles, copyTriangles);
+    EXPECT_EQ(edges, copyEdges);
+    EXPECT_EQ(vertices, copyVertices);
+
+    countHidden(mesh, copyTriangles, copyEdges, copyVertices);
+    EXPECT_EQ(triangles, copyTriangles);
+    EXPECT_EQ(edges, copyEdges);
+    EXPECT_EQ(vertices, copyVertices);
+
+    copy->release();
+    mesh->release();
+}
+
+static void expectSameArrays(const Mesh2 *mesh, const Mesh2 *loaded, float tolerance)
+{
+    vector<float> positions, texCoords, loadedPositions, loadedTexCoords;
+    vector<unsigned char> faceSizes, loadedFaceSizes;
+    vector<unsigned int> vertexIndices, texCoordIndices, loadedVertexIndices, loadedTexCoordIndices;
+
+    mesh->toIndexArrays(positions, texCoords, faceSizes, vertexIndices, texCoordIndices);
+    loaded->toIndexArrays(loadedPositions, loadedTexCoords, loadedFaceSizes, loadedVertexIndices, loadedTexCoordIndices);
+
+    ASSERT_EQ(positions.size(), loadedPositions.size());
+    for (unsigned int i = 0; i < positions.size(); i++)
+    {
+        if (tolerance == 0.0f)
+            ASSERT_EQ(positions[i], loadedPositions[i]) << "coordinate " << i;
+        else
+            ASSERT_NEAR(positions[i], loadedPositions[i], tolerance * 1.001f) << "coordinate " << i;
+    }
+
+    EXPECT_EQ(texCoords, loadedTexCoords);
+    EXPECT_EQ(faceSizes, loadedFaceSizes);
+    EXPECT_EQ(vertexIndices, loadedVertexIndices);
+    EXPECT_EQ(texCoordIndices, loadedTexCoordIndices);
+}
+
+static Mesh2 *load(const MemoryWriteStream &stream, ModelVersion version)
+{
+    MemoryReadStream readStream(stream.bytes(), stream.length());
+    readStream.setVersion((unsigned int)version);
+    return new Mesh2(&readStream);
+}
+
+// Sections are written raw below zero tolerance and through FPMeshCodec
+// from zero up, every version before still loads.
+TEST(Mesh2Test, SaveAndLoadVersions)
+{
+    Mesh2 *mesh = new Mesh2();
+    mesh->make(MeshType::Sphere, 12);
+
+    float oldTolerance = Mesh2::compressionTolerance();
+    const float tolerances[] = { -1.0f, 0.0f, 0.001f };
+    size_t rawLength = 0;
+
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        Mesh2::setCompressionTolerance(tolerances[i]);
+
+        MemoryWriteStream stream;
+        stream.setVersion((unsigned int)ModelVersion::BulkArrays);
+        mesh->encode(&stream);
+
+        if (i == 0)
+            rawLength = stream.length();
+        else
+            EXPECT_GT(rawLength, stream.length());
+
+        Mesh2 *loaded = load(stream, ModelVersion::BulkArrays);
+        expectSameArrays(mesh, loaded, max(tolerances[i], 0.0f));
+        EXPECT_EQ(mesh->color(), loaded->color());
+        loaded->release();
+    }
+
+    Mesh2::setCompressionTolerance(oldTolerance);
+
+    const ModelVersion versions[] = { ModelVersion::TextureNames, ModelVersion::CrossPlatform };
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        MemoryWriteStream stream;
+        stream.setVersion((unsigned int)versions[i]);
+        mesh->encode(&stream);
+
+        Mesh2 *loaded = load(stream, versions[i]);
+        expectSameArrays(mesh, loaded, 0.0f);
+        loaded->release();
+    }
+
+    vector<Vector3D> vertices, texCoords;
+    vector<TriQuad> triangles;
+    mesh->toIndexRepresentation(vertices, texCoords, triangles);
+
+    // older versions wrote the structures as they were in memory
+    MemoryWriteStream triQuads;
+    triQuads.write<Vector4D>(mesh->color());
+    triQuads.write<unsigned int>((unsigned int)vertices.size());
+    triQuads.write<unsigned int>((unsigned int)texCoords.size());
+    triQuads.write<unsigned int>((unsigned int)triangles.size());
+    for (unsigned int i = 0; i < vertices.size(); i++)
+        triQuads.write<Vector3D>(vertices[i]);
+    for (unsigned int i = 0; i < texCoords.size(); i++)
+        triQuads.write<Vector3D>(texCoords[i]);
+    for (unsigned int i = 0; i < triangles.size(); i++)
+        triQuads.write<TriQuad>(triangles[i]);
+
+    Mesh2 *loaded = load(triQuads, ModelVersion::TriQuads);
+    expectSameArrays(mesh, loaded, 0.0f);
+    EXPECT_EQ(mesh->color(), loaded->color());
+    loaded->release();
+
+    // the first version had only triangles and no color
+    const float tetrahedron[] = { 0.0f, 0.0f, 0.0f,  1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f, 1.0f };
+    const unsigned char faceSizes[] = { 3, 3, 3, 3 };
+    const unsigned int indices[] = { 0, 2, 1,  0, 1, 3,  0, 3, 2,  1, 2, 3 };
+
+    Mesh2 *triangleMesh = new Mesh2();
+    triangleMesh->fromIndexArrays(tetrahedron, 4, tetrahedron, 4, faceSizes, 4, indices, indices);
+    vertices.clear();
+    texCoords.clear();
+    triangles.clear();
+    triangleMesh->toIndexRepresentation(vertices, texCoords, triangles);
+
+    MemoryWriteStream first;
+    first.write<unsigned int>((unsigned int)vertices.size());
+    first.write<unsigned int>((unsigned int)texCoords.size());
+    first.write<unsigned int>((unsigned int)triangles.size());
+    for (unsigned int i = 0; i < vertices.size(); i++)
+        first.write<Vector3D>(vertices[i]);
+    for (unsigned int i = 0; i < texCoords.size(); i++)
+        first.write<Vector3D>(texCoords[i]);
+    for (unsigned int i = 0; i < triangles.size(); i++)
+    {
+        ASSERT_FALSE(triangles[i].isQuad);
+        Triangle triangle;
+        for (unsigned int j = 0; j < 3; j++)
+        {
+            triangle.vertexIndices[j] = triangles[i].vertexIndices[j];
+            triangle.texCoordIndices[j] = triangles[i].texCoordIndices[j];
+        }
+        first.write<Triangle>(triangle);
+    }
+
+    loaded = load(first, ModelVersion::First);
+    expectSameArrays(triangleMesh, loaded, 0.0f);
+    loaded->release();
+
+    triangleMesh->release();
+    mesh->release();
+}
+
+TEST(Mesh2Test, TruncatedFileThrows)
+{
+    Mesh2 *mesh = new Mesh2();
+    mesh->make(MeshType::Cube, 0);
+
+    float oldTolerance = Mesh2::compressionTolerance();
+
+    for (unsigned int compressed = 0; compressed < 2; compressed++)
+    {
+        Mesh2::setCompressionTolerance(compressed ? 0.0f : -1.0f);
+
+        MemoryWriteStream stream;
+        stream.setVersion((unsigned int)ModelVersion::BulkArrays);
+        mesh->encode(&stream);
+
+        for (size_t length = 0; length < stream.length(); length++)
+        {
+            vector<unsigned char> truncated(stream.bytes(), stream.bytes() + length);
+            MemoryReadStream readStream(truncated.data(), truncated.size());
+            readStream.setVersion((unsigned int)ModelVersion::BulkArrays);
+
+            EXPECT_THROW(new Mesh2(&readStream), MeshMaker::IndexOutOfRangeException) << "length " << length;
+        }
+    }
+
+    Mesh2::setCompressionTolerance(oldTolerance);
+    mesh->release();
+}
+
+// Flat grid of cells with two triangles each, corners at whole numbers.
+static Mesh2 *makeTriangleGrid(unsigned int cells)
+{
+    unsigned int side = cells + 1;
+
+    vector<float> positions;
+    for (unsigned int y = 0; y < side; y++)
+    {
+        for (unsigned int x = 0; x < side; x++)
+        {
+            positions.push_back((float)x);
+            positions.push_back((float)y);
+            positions.push_back(0.0f);
+        }
+    }
+
+    vector<unsigned char> faceSizes;
+    vector<unsigned int> indices;
+    for (unsigned int y = 0; y < cells; y++)
+    {
+        for (unsigned int x = 0; x < cells; x++)
+        {
+            unsigned int corner = y * side + x;
+            const unsigned int cell[] = { corner, corner + 1, corner + side + 1, corner, corner + side + 1, corner + side };
+            indices.insert(indices.end(), cell, cell + 6);
+            faceSizes.push_back(3);
+            faceSizes.push_back(3);
+        }
+    }
+
+    Mesh2 *mesh = new Mesh2();
+    mesh->fromIndexArrays(&positions[0], side * side, &positions[0], side * side, &faceSizes[0], (unsigned int)faceSizes.size(), &indices[0], &indices[0]);
+    mesh->setSelectionMode(MeshSelectionMode::Triangles);
+    return mesh;
+}
+
+static void triangleCorners(const Mesh2 *mesh, vector<vector<Vector3D> > &corners)
+{
+    corners.clear();
+    for (TriangleNode *node = mesh->triangles().begin(); node != mesh->triangles().end(); node = node->next())
+    {
+        vector<Vector3D> triangle;
+        for (unsigned int i = 0; i < node->data().count(); i++)
+            triangle.push_back(node->data().vertex(i)->data().position);
+        corners.push_back(triangle);
+    }
+}
+
+static float meshArea(const Mesh2 *mesh)
+{
+    float area = 0.0f;
+    for (TriangleNode *node = mesh->triangles().begin(); node != mesh->triangles().end(); node = node->next())
+    {
+        const Triangle2 &triangle = node->data();
+        Vector3D a = triangle.vertex(0)->data().position;
+        Vector3D b = triangle.vertex(1)->data().position;
+        Vector3D c = triangle.vertex(2)->data().position;
+        area += 0.5f * (b - a).Cross(c - a).z;
+    }
+    return area;
+}
+
+static unsigned int boundaryEdgeCount(const Mesh2 *mesh)
+{
+    unsigned int count = 0;
+    for (VertexEdgeNode *node = mesh->vertexEdges().begin(); node != mesh->vertexEdges().end(); node = node->next())
+        count += node->data().triangle(1) == NULL ? 1 : 0;
+    return count;
+}
+
+// Selected faces split in four, faces on the border of the selection are
+// split in two so no edge ends in the middle of another one, and faces
+// away from the selection keep their corners.
+TEST(Mesh2Test, LoopSubdivisionSelected)
+{
+    const unsigned int cells = 6;
+
+    // one triangle, then both triangles of a cell, in the middle of the grid
+    for (unsigned int selected = 1; selected <= 2; selected++)
+    {
+        Mesh2 *mesh = makeTriangleGrid(cells);
+
+        unsigned int first = (3 * cells + 3) * 2;
+        for (unsigned int i = 0; i < selected; i++)
+            mesh->setSelectedAtIndex(true, first + i);
+
+        Vector3D center(3.5f, 3.5f, 0.0f);
+
+        vector<vector<Vector3D> > before, after;
+        triangleCorners(mesh, before);
+        unsigned int triangleCount = mesh->triangleCount();
+        unsigned int boundaryEdges = boundaryEdgeCount(mesh);
+
+        mesh->loopSubdivisionSelected();
+
+        // three selected edges have three neighbours, the cell has four
+        unsigned int splitNeighbours = selected == 1 ? 3 : 4;
+        EXPECT_EQ(triangleCount + selected * 3 + splitNeighbours, mesh->triangleCount());
+
+        unsigned int selectedTriangles = 0;
+        for (TriangleNode *node = mesh->triangles().begin(); node != mesh->triangles().end(); node = node->next())
+            selectedTriangles += node->data().selected ? 1 : 0;
+        EXPECT_EQ(selected * 4, selectedTriangles);
+
+        EXPECT_NEAR((float)(cells * cells), meshArea(mesh), 0.001f);
+        EXPECT_EQ(boundaryEdges, boundaryEdgeCount(mesh));
+
+        triangleCorners(mesh, after);
+
+        unsigned int far = 0;
+        for (unsigned int i = 0; i < before.size(); i++)
+        {
+            bool isFar = true;
+            for (unsigned int j = 0; j < 3; j++)
+                isFar = isFar && before[i][j].Distance(center) > 2.5f;
+
+            if (!isFar)
+                continue;
+
+            far++;
+            EXPECT_TRUE(find(after.begin(), after.end(), before[i]) != after.end()) << "triangle " << i;
+        }
+        EXPECT_LT(0U, far);
+
+        for (unsigned int i = 0; i < after.size(); i++)
+        {
+            for (unsigned int j = 0; j < 3; j++)
+                ASSERT_EQ(0.0f, after[i][j].z);
+        }
+
+        mesh->release();
+    }
+}
+
+static Mesh2 *makeQuadGrid(unsigned int cells)
+{
+    unsigned int side = cells + 1;
+
+    vector<float> positions;
+    for (unsigned int y = 0; y < side; y++)
+    {
+        for (unsigned int x = 0; x < side; x++)
+        {
+            positions.push_back((float)x);
+            positions.push_back((float)y);
+            positions.push_back(0.0f);
+        }
+    }
+
+    vector<unsigned char> faceSizes(cells * cells, 4);
+    vector<unsigned int> indices;
+    for (unsigned int y = 0; y < cells; y++)
+    {
+        for (unsigned int x = 0; x < cells; x++)
+        {
+            unsigned int corner = y * side + x;
+            const unsigned int cell[] = { corner, corner + 1, corner + side + 1, corner + side };
+            indices.insert(indices.end(), cell, cell + 4);
+        }
+    }
+
+    Mesh2 *mesh = new Mesh2();
+    mesh->fromIndexArrays(&positions[0], side * side, &positions[0], side * side, &faceSizes[0], (unsigned int)faceSizes.size(), &indices[0], &indices[0]);
+    return mesh;
+}
+
+// Soft selection as it was before the single pass, a search from every
+// selected node on its own keeping the highest weight each node gets.
+typedef map<const void *, float> ReferenceWeights;
+
+static void raiseWeight(ReferenceWeights &result, const void *node, float weight)
+{
+    if (result[node] < weight)
+        result[node] = weight;
+}
+
+static void referenceVertexSoftSelect(VertexNode *source, const vector<float> &weights, ReferenceWeights &result)
+{
+    result[source] = weights[0];
+
+    vector<VertexNode *> currentStepNodes(1, source);
+    vector<VertexNode *> nextStepNodes;
+
+    for (unsigned int w = 1; w < weights.size(); w++)
+    {
+        nextStepNodes.clear();
+
+        for (unsigned int i = 0; i < currentStepNodes.size(); i++)
+        {
+            VertexNode *currentNode = currentStepNodes[i];
+            for (Vertex2VEdgeNode *node = currentNode->_edges.begin(), *end = currentNode->_edges.end(); node != end; node = node->next())
+            {
+                VertexNode *vertexNode = node->data()->data().opposite(currentNode);
+                if (!vertexNode->data().selected)
+                {
+                    nextStepNodes.push_back(vertexNode);
+                    raiseWeight(result, vertexNode, weights[w]);
+                }
+            }
+        }
+
+        currentStepNodes = nextStepNodes;
+    }
+}
+
+static void referenceTriangleSoftSelect(TriangleNode *source, const vector<float> &weights, ReferenceWeights &result)
+{
+    result[source] = weights[0];
+
+    vector<TriangleNode *> currentStepNodes(1, source);
+    vector<TriangleNode *> nextStepNodes;
+
+    for (unsigned int w = 1; w < weights.size(); w++)
+    {
+        nextStepNodes.clear();
+
+        for (unsigned int i = 0; i < currentStepNodes.size(); i++)
+        {
+            TriangleNode *currentNode = currentStepNodes[i];
+            Triangle2 &triangle = currentNode->data();
+
+            for (unsigned int j = 0; j < triangle.count(); j++)
+            {
+                TriangleNode *oppositeNode = triangle.vertexEdge(j)->data().opposite(currentNode);
+                if (oppositeNode != NULL)
+                {
+                    nextStepNodes.push_back(oppositeNode);
+                    raiseWeight(result, oppositeNode, weights[w]);
+                }
+            }
+        }
+
+        currentStepNodes = nextStepNodes;
+    }
+}
+
+static void referenceEdgeSoftSelect(VertexEdgeNode *source, const vector<float> &weights, ReferenceWeights &result)
+{
+    result[source] = weights[0];
+
+    vector<VertexEdgeNode *> currentStepNodes(1, source);
+    vector<VertexEdgeNode *> nextStepNodes;
+
+    for (unsigned int w = 1; w < weights.size(); w++)
+    {
+        nextStepNodes.clear();
+
+        for (unsigned int i = 0; i < currentStepNodes.size(); i++)
+        {
+            VertexEdge &edge = currentStepNodes[i]->data();
+
+            for (unsigned int j = 0; j < 2; j++)
+            {
+                TriangleNode *quad = edge.triangle(j);
+                if (quad != NULL && quad->data().isQuad())
+                {
+                    VertexEdgeNode *edgeNode = quad->data().nextEdgeInQuadLoop(edge);
+                    if (edgeNode != NULL)
+                    {
+                        nextStepNodes.push_back(edgeNode);
+                        raiseWeight(result, edgeNode, weights[w]);
+                    }
+                }
+            }
+        }
+
+        currentStepNodes = nextStepNodes;
+    }
+}
+
+static void referenceSoftSelection(Mesh2 *mesh, ReferenceWeights &result)
+{
+    const vector<float> &weights = Mesh2::selectionWeights();
+    result.clear();
+
+    switch (mesh->selectionMode())
+    {
+        case MeshSelectionMode::Vertices:
+            for (VertexNode *node = mesh->vertices().begin(); node != mesh->vertices().end(); node = node->next())
+            {
+                if (node->data().selected)
+                    referenceVertexSoftSelect(node, weights, result);
+            }
+            break;
+        case MeshSelectionMode::Triangles:
+            for (TriangleNode *node = mesh->triangles().begin(); node != mesh->triangles().end(); node = node->next())
+            {
+                if (node->data().selected)
+                    referenceTriangleSoftSelect(node, weights, result);
+            }
+            for (TriangleNode *node = mesh->triangles().begin(); node != mesh->triangles().end(); node = node->next())
+            {
+                for (unsigned int i = 0; i < node->data().count(); i++)
+                    raiseWeight(result, node->data().vertex(i), result[node]);
+            }
+            break;
+        case MeshSelectionMode::Edges:
+            for (VertexEdgeNode *node = mesh->vertexEdges().begin(); node != mesh->vertexEdges().end(); node = node->next())
+            {
+                if (node->data().selected)
+                    referenceEdgeSoftSelect(node, weights, result);
+            }
+            for (VertexEdgeNode *node = mesh->vertexEdges().begin(); node != mesh->vertexEdges().end(); node = node->next())
+            {
+                for (unsigned int i = 0; i < 2; i++)
+                    raiseWeight(result, node->data().vertex(i), result[node]);
+            }
+            break;
+    }
+}
+
+template <class TNode>
+static unsigned int expectReferenceWeights(TNode *begin, TNode *end, ReferenceWeights &reference)
+{
+    unsigned int softlySelected = 0;
+    unsigned int index = 0;
+
+    for (TNode *node = begin; node != end; node = node->next(), index++)
+    {
+        EXPECT_EQ(reference[node], node->selectionWeight) << "node " << index;
+        if (node->selectionWeight > 0.0f && node->selectionWeight < 1.0f)
+            softlySelected++;
+    }
+
+    return softlySelected;
+}
+
+// The single pass from all selected nodes gives every node the same weight
+// as the searches from each selected node did, overlapping fronts included.
+TEST(Mesh2Test, SoftSelectionMatchesPerNodeSearch)
+{
+    const vector<float> defaultWeights = Mesh2::selectionWeights();
+    const float longWeights[] = { 1.0f, 0.9f, 0.8f, 0.6f, 0.4f, 0.3f, 0.2f, 0.1f };
+
+    bool oldUseSoftSelection = Mesh2::useSoftSelection();
+    SoftSelectionFalloff oldFalloff = Mesh2::softSelectionFalloff();
+    Mesh2::setUseSoftSelection(true);
+    Mesh2::setSoftSelectionFalloff(SoftSelectionFalloff::Steps);
+
+    const MeshSelectionMode modes[] = { MeshSelectionMode::Vertices, MeshSelectionMode::Triangles, MeshSelectionMode::Edges };
+
+    for (unsigned int table = 0; table < 2; table++)
+    {
+        if (table == 1)
+            Mesh2::selectionWeights().assign(longWeights, longWeights + 8);
+
+        for (unsigned int quads = 0; quads < 2; quads++)
+        {
+            for (unsigned int m = 0; m < 3; m++)
+            {
+                // edges spread along quad loops only
+                if (!quads && modes[m] == MeshSelectionMode::Edges)
+                    continue;
+
+                Mesh2 *mesh = quads ? makeQuadGrid(10) : makeTriangleGrid(8);
+                mesh->setSelectionMode(modes[m]);
+
+                for (unsigned int i = 3; i < mesh->selectedCount(); i += 29)
+                    mesh->setSelectedAtIndex(true, i);
+
+                mesh->computeSoftSelection();
+
+                ReferenceWeights reference;
+                referenceSoftSelection(mesh, reference);
+
+                SCOPED_TRACE(testing::Message() << "table " << table << " quads " << quads << " mode " << m);
+
+                unsigned int softlySelected = expectReferenceWeights(mesh->vertices().begin(), mesh->vertices().end(), reference);
+                EXPECT_LT(0U, softlySelected);
+
+                if (modes[m] == MeshSelectionMode::Triangles)
+                    expectReferenceWeights(mesh->triangles().begin(), mesh->triangles().end(), reference);
+                else if (modes[m] == MeshSelectionMode::Edges)
+                    expectReferenceWeights(mesh->vertexEdges().begin(), mesh->vertexEdges().end(), reference);
+
+                mesh->release();
+            }
+        }
+    }
+
+    Mesh2::selectionWeights() = defaultWeights;
+    Mesh2::setSoftSelectionFalloff(oldFalloff);
+    Mesh2::setUseSoftSelection(oldUseSoftSelection);
+}
@@ -0,0 +1,405 @@
+//
+//  MeshDeltaTests.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "MeshDelta.h"
+#include <gtest/gtest.h>
+
+struct IndexArrays
+{
+    vector<float> positions;
+    vector<float> texCoords;
+    vector<unsigned char> faceSizes;
+    vector<unsigned int> vertexIndices;
+    vector<unsigned int> texCoordIndices;
+
+    IndexArrays(const Mesh2 *mesh)
+    {
+        mesh->toIndexArrays(positions, texCoords, faceSizes, vertexIndices, texCoordIndices);
+    }
+
+    bool operator==(const IndexArrays &other) const
+    {
+        return positions == other.positions && texCoords == other.texCoords && faceSizes == other.faceSizes &&
+               vertexIndices == other.vertexIndices && texCoordIndices == other.texCoordIndices;
+    }
+};
+
+static void selectTriangle(Mesh2 *mesh, unsigned int index)
+{
+    mesh->setSelectionMode(MeshSelectionMode::Triangles);
+    mesh->setSelection(vector<bool>(mesh->selectedCount(), false));
+    mesh->setSelectedAtIndex(true, index);
+}
+
+class MeshDeltaTest : public ::testing::Test
+{
+protected:
+    Mesh2 *mesh;
+    UndoMemory *memory;
+    vector<MeshDelta *> deltas;
+    vector<IndexArrays> states;
+
+    virtual void SetUp()
+    {
+        mesh = new Mesh2();
+        mesh->make(MeshType::Sphere, 12);
+        memory = new UndoMemory();
+        states.push_back(IndexArrays(mesh));
+    }
+
+    virtual void TearDown()
+    {
+        for (unsigned int i = 0; i < deltas.size(); i++)
+            delete deltas[i];
+        EXPECT_EQ(0U, memory->meshDeltas());
+        memory->release();
+        mesh->release();
+    }
+
+    void extrude(unsigned int triangle)
+    {
+        MeshDelta *delta = new MeshDelta(mesh, 0, false, memory);
+        selectTriangle(mesh, triangle);
+        mesh->extrudeSelectedTriangles();
+        delta->finish(mesh);
+        deltas.push_back(delta);
+        states.push_back(IndexArrays(mesh));
+    }
+
+    void move(float offset)
+    {
+        MeshDelta *delta = new MeshDelta(mesh, 0, true, memory);
+        Matrix4x4 matrix;
+        matrix.Translate(0.0f, offset, 0.0f);
+        mesh->transformSelected(matrix);
+        delta->finish(mesh);
+        deltas.push_back(delta);
+        states.push_back(IndexArrays(mesh));
+    }
+
+    void removeTriangle(unsigned int triangle)
+    {
+        MeshDelta *delta = new MeshDelta(mesh, 0, false, memory);
+        selectTriangle(mesh, triangle);
+        mesh->removeSelected();
+        delta->finish(mesh);
+        deltas.push_back(delta);
+        states.push_back(IndexArrays(mesh));
+    }
+
+    void subdivide(unsigned int triangle)
+    {
+        MeshDelta *delta = new MeshDelta(mesh, 0, false, memory);
+        selectTriangle(mesh, triangle);
+        mesh->loopSubdivisionSelected();
+        delta->finish(mesh);
+        deltas.push_back(delta);
+        states.push_back(IndexArrays(mesh));
+    }
+
+    void turnEdge(unsigned int edge)
+    {
+        MeshDelta *delta = new MeshDelta(mesh, 0, false, memory);
+        mesh->setSelectionMode(MeshSelectionMode::Edges);
+        mesh->setSelection(vector<bool>(mesh->selectedCount(), false));
+        mesh->setSelectedAtIndex(true, edge);
+        mesh->turnSelectedEdges();
+        delta->finish(mesh);
+        deltas.push_back(delta);
+        states.push_back(IndexArrays(mesh));
+    }
+
+    // a new vertex in front of the sphere and a face to it
+    void connect(unsigned int corners)
+    {
+        MeshDelta *delta = new MeshDelta(mesh, 0, false, memory);
+        mesh->setSelectionMode(MeshSelectionMode::Vertices);
+        mesh->addVertex(Vector3D(0.0f, 0.0f, 1.5f));
+        if (corners == 4)
+            mesh->quadConnectVerticesNearPosition(Vector3D(0.0f, 0.0f, 1.2f), Vector3D(0.0f, 0.0f, -1.0f));
+        else
+            mesh->triangleConnectVerticesNearPosition(Vector3D(0.0f, 0.0f, 1.2f), Vector3D(0.0f, 0.0f, -1.0f));
+        delta->finish(mesh);
+        deltas.push_back(delta);
+        states.push_back(IndexArrays(mesh));
+    }
+
+    void expectUndoAndRedo()
+    {
+        for (unsigned int i = (unsigned int)deltas.size(); i-- > 0;)
+        {
+            deltas[i]->swap(mesh);
+            EXPECT_TRUE(IndexArrays(mesh) == states[i]) << "undo of step " << i;
+        }
+
+        for (unsigned int i = 0; i < deltas.size(); i++)
+        {
+            deltas[i]->swap(mesh);
+            EXPECT_TRUE(IndexArrays(mesh) == states[i + 1]) << "redo of step " << i;
+        }
+    }
+};
+
+TEST_F(MeshDeltaTest, ExtrudeAndMove)
+{
+    for (unsigned int i = 0; i < 5; i++)
+    {
+        extrude(i * 31);
+        move(0.1f);
+        move(0.1f);
+    }
+
+    expectUndoAndRedo();
+    EXPECT_LT(0U, memory->meshDeltas());
+}
+
+// removing a face shifts the faces after it, those steps are not patches
+TEST_F(MeshDeltaTest, RemoveAndExtrude)
+{
+    removeTriangle(3);
+    extrude(10);
+    removeTriangle(0);
+    extrude(20);
+
+    expectUndoAndRedo();
+}
+
+// the patch keeps the nodes outside it, so it keeps their hidden state too
+TEST_F(MeshDeltaTest, ExtrudeUndoKeepsHiddenFaces)
+{
+    selectTriangle(mesh, 50);
+    mesh->hideSelected();
+
+    extrude(7);
+    deltas[0]->swap(mesh);
+
+    unsigned int index = 0;
+    for (TriangleNode *node = mesh->triangles().begin(); node != mesh->triangles().end(); node = node->next(), index++)
+        EXPECT_EQ(index != 50, node->data().visible);
+}
+
+// Above the budget the oldest steps are dropped, the newer ones still undo.
+TEST_F(MeshDeltaTest, OldStepsTrimmedToBudget)
+{
+    mesh->setSelectionMode(MeshSelectionMode::Vertices);
+    mesh->setSelection(vector<bool>(mesh->selectedCount(), true));
+
+    move(0.1f);
+    memory->setBudget(memory->meshDeltas() * 4);
+
+    for (unsigned int i = 1; i < 10; i++)
+        move(0.1f);
+
+    EXPECT_EQ(10U, memory->stepCount());
+    EXPECT_LE(memory->meshDeltas(), memory->budget());
+
+    unsigned int dropped = memory->droppedStepCount();
+    EXPECT_LT(0U, dropped);
+    EXPECT_GT(10U, dropped);
+    for (unsigned int i = 0; i < deltas.size(); i++)
+        EXPECT_EQ(i < dropped, deltas[i]->dropped()) << "step " << i;
+
+    for (unsigned int i = (unsigned int)deltas.size(); i-- > dropped;)
+    {
+        deltas[i]->swap(mesh);
+        EXPECT_TRUE(IndexArrays(mesh) == states[i]) << "undo of step " << i;
+    }
+
+    // a dropped step swaps nothing
+    deltas[dropped - 1]->swap(mesh);
+    EXPECT_TRUE(IndexArrays(mesh) == states[dropped]);
+
+    // the undo manager deletes the dropped steps
+    for (unsigned int i = 0; i < dropped; i++)
+        delete deltas[i];
+    deltas.erase(deltas.begin(), deltas.begin() + dropped);
+    EXPECT_EQ(0U, memory->droppedStepCount());
+    EXPECT_EQ(10U - dropped, memory->stepCount());
+
+    // the newest step is kept even when it alone is over the budget
+    memory->setBudget(0);
+    move(0.1f);
+    EXPECT_EQ(memory->stepCount() - 1, memory->droppedStepCount());
+    EXPECT_FALSE(deltas.back()->dropped());
+}
+
+// edge ends and selection in list order
+static void edgeStates(Mesh2 *mesh, vector<float> &states)
+{
+    states.clear();
+    for (VertexEdgeNode *node = mesh->vertexEdges().begin(); node != mesh->vertexEdges().end(); node = node->next())
+    {
+        VertexEdge &edge = node->data();
+        for (unsigned int i = 0; i < 2; i++)
+        {
+            const Vector3D &position = edge.vertex(i)->data().position;
+            states.push_back(position.x);
+            states.push_back(position.y);
+            states.push_back(position.z);
+        }
+        states.push_back(edge.selected ? 1.0f : 0.0f);
+    }
+}
+
+// Local subdivision appends edges out of face order, a copy of the shared
+// mesh has to keep them in place for the edge selection delta.
+TEST_F(MeshDeltaTest, EdgeUndoOnSharedCopy)
+{
+    selectTriangle(mesh, 20);
+    mesh->loopSubdivisionSelected();
+    mesh->setSelectionMode(MeshSelectionMode::Edges);
+
+    vector<float> before, after, copied;
+    edgeStates(mesh, before);
+
+    MeshDelta *delta = new MeshDelta(mesh, 0, false, memory);
+    for (unsigned int i = 0; i < mesh->vertexEdgeCount(); i += 5)
+        mesh->setSelectedAtIndex(true, i);
+    delta->finish(mesh);
+    deltas.push_back(delta);
+    edgeStates(mesh, after);
+
+    // the item copies the mesh before changing it
+    mesh->retain();
+    Mesh2 *copy = mesh->copy();
+    mesh->release();
+
+    edgeStates(copy, copied);
+    EXPECT_EQ(after, copied);
+
+    delta->swap(copy);
+    edgeStates(copy, copied);
+    EXPECT_EQ(before, copied);
+
+    delta->swap(copy);
+    edgeStates(copy, copied);
+    EXPECT_EQ(after, copied);
+
+    edgeStates(mesh, copied);
+    EXPECT_EQ(after, copied);
+
+    copy->release();
+}
+
+// Steps made of local edits record only what they touch.
+TEST_F(MeshDeltaTest, LocalEditsUndo)
+{
+    selectTriangle(mesh, 5);
+    mesh->hideSelected();
+    selectTriangle(mesh, 7);
+    vector<bool> selection;
+    mesh->getSelection(selection);
+
+    removeTriangle(3);
+    subdivide(40);
+    removeTriangle(60);
+    connect(4);
+    connect(3);
+    subdivide(states.back().faceSizes.size() - 1);
+
+    size_t fullSize = states.back().vertexIndices.size() * sizeof(unsigned int);
+    for (unsigned int i = 0; i < deltas.size(); i++)
+        EXPECT_GT(fullSize, deltas[i]->memorySize()) << "step " << i;
+
+    expectUndoAndRedo();
+
+    // hidden faces and the selection come back with the removed ones
+    for (unsigned int i = (unsigned int)deltas.size(); i-- > 0;)
+        deltas[i]->swap(mesh);
+
+    vector<bool> after;
+    mesh->getSelection(after);
+    EXPECT_EQ(selection, after);
+
+    unsigned int index = 0;
+    for (TriangleNode *node = mesh->triangles().begin(); node != mesh->triangles().end(); node = node->next(), index++)
+        EXPECT_EQ(index != 5, node->data().visible) << "triangle " << index;
+}
+
+TEST_F(MeshDeltaTest, TurnedEdgesUndo)
+{
+    mesh->triangulate();
+    states[0] = IndexArrays(mesh);
+
+    for (unsigned int i = 0; i < 4; i++)
+        turnEdge(i * 17 + 3);
+
+    expectUndoAndRedo();
+}
+
+// A local edit and then one on the whole mesh in one step, the snapshot
+// is taken from the mesh put back by the recorded patch.
+TEST_F(MeshDeltaTest, LocalThenWholeMeshEdit)
+{
+    MeshDelta *delta = new MeshDelta(mesh, 0, false, memory);
+    selectTriangle(mesh, 8);
+    mesh->removeSelected();
+    selectTriangle(mesh, 30);
+    mesh->loopSubdivisionSelected();
+    selectTriangle(mesh, 12);
+    mesh->extrudeSelectedTriangles();
+    delta->finish(mesh);
+    deltas.push_back(delta);
+    states.push_back(IndexArrays(mesh));
+
+    extrude(2);
+    removeTriangle(0);
+
+    expectUndoAndRedo();
+}
+
+// The item copies a shared mesh before changing it, the copy records the
+// rest of the step.
+TEST_F(MeshDeltaTest, CopyTakesRecordingOver)
+{
+    MeshDelta *delta = new MeshDelta(mesh, 0, false, memory);
+    selectTriangle(mesh, 8);
+    mesh->removeSelected();
+
+    mesh->retain();
+    Mesh2 *copy = mesh->copy();
+    mesh->release();
+
+    selectTriangle(copy, 30);
+    copy->loopSubdivisionSelected();
+    delta->finish(copy);
+    deltas.push_back(delta);
+
+    IndexArrays after(copy);
+    delta->swap(copy);
+    EXPECT_TRUE(IndexArrays(copy) == states[0]);
+    delta->swap(copy);
+    EXPECT_TRUE(IndexArrays(copy) == after);
+
+    // the first mesh keeps what it had when it was copied
+    selectTriangle(mesh, 1);
+    mesh->removeSelected();
+    EXPECT_TRUE(IndexArrays(copy) == after);
+
+    copy->release();
+}
+
+// Removing from the middle moves the last item into the freed slot.
+TEST(UndoMemoryTest, RemovedItemsSwapWithLast)
+{
+    UndoMemory *memory = new UndoMemory();
+    RemovedItem *items[3];
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        items[i] = reinterpret_cast<RemovedItem *>(&items[i]);
+        EXPECT_EQ(i, memory->addRemovedItem(items[i]));
+    }
+
+    EXPECT_EQ(items[2], memory->removeRemovedItem(0));
+    ASSERT_EQ(2U, memory->removedItems().size());
+    EXPECT_EQ(items[2], memory->removedItems()[0]);
+    EXPECT_EQ(NULL, memory->removeRemovedItem(1));
+    EXPECT_EQ(NULL, memory->removeRemovedItem(0));
+    EXPECT_TRUE(memory->removedItems().empty());
+
+    memory->release();
+}
@@ -0,0 +1,266 @@
+//
+//  WavefrontObjectTests.cpp
+//  OpenGLEditor
+//
+//  For license see LICENSE.TXT
+//
+
+#include "WavefrontObjectReader.h"
+#include "WavefrontObjectWriter.h"
+#include "MemoryStream.h"
+#include <gtest/gtest.h>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+static void read(WavefrontObjectReader &reader, const string &text)
+{
+    reader.read(text.data(), text.size());
+}
+
+static uint32_t floatBits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// the reader turns file (x, y, z) into editor (x, z, -y)
+static void expectVertex(const Vector3D &vertex, float x, float y, float z)
+{
+    EXPECT_EQ(x, vertex.x);
+    EXPECT_EQ(z, vertex.y);
+    EXPECT_EQ(-y, vertex.z);
+}
+
+static void expectTriangle(const TriQuad &triQuad, unsigned int a, unsigned int b, unsigned int c)
+{
+    EXPECT_FALSE(triQuad.isQuad);
+    EXPECT_EQ(a, triQuad.vertexIndices[0]);
+    EXPECT_EQ(b, triQuad.vertexIndices[1]);
+    EXPECT_EQ(c, triQuad.vertexIndices[2]);
+}
+
+TEST(WavefrontObjectTest, ReaderFacesAndGroups)
+{
+    const char *text =
+        "# two groups\n"
+        "o first\n"
+        "v 0 0 0\n"
+        "v 1 0 0\n"
+        "v 1 1 0\n"
+        "v 0 1 0\n"
+        "v 0.5 1.5 0\n"
+        "vt 0 0\n"
+        "vt 1 0\n"
+        "vt 1 1\n"
+        "vt 0 1\n"
+        "vt 0.5 1.5\n"
+        "vn 0 0 1\n"
+        "f 1/1/1 2/2/1 3/3/1 5/5/1 4/4/1\n"
+        "o second\n"
+        "g renamed\n"
+        "v 2 0 0\n"
+        "v 3 0 0\r\n"
+        "v 3 1 0\n"
+        "f -3//-1 -2//-1 -1//-1\n"
+        "f 6 7 8 1\n"
+        "f 1 2 99\n"
+        "f 1 2\n";
+
+    WavefrontObjectReader reader;
+    read(reader, text);
+
+    ASSERT_EQ(8U, reader.vertices().size());
+    ASSERT_EQ(5U, reader.texCoords().size());
+    ASSERT_EQ(1U, reader.normals().size());
+    expectVertex(reader.vertices()[4], 0.5f, 1.5f, 0.0f);
+    expectVertex(reader.vertices()[6], 3.0f, 0.0f, 0.0f);
+    EXPECT_EQ(1.5f, reader.texCoords()[4].y);
+    expectVertex(reader.normals()[0], 0.0f, 0.0f, 1.0f);
+    EXPECT_EQ(2U, reader.skippedFaces());
+
+    // an "o" and a "g" line without faces in between name one group
+    ASSERT_EQ(2U, reader.groupCount());
+    EXPECT_EQ("first", reader.group(0).name);
+    EXPECT_EQ("renamed", reader.group(1).name);
+
+    // the pentagon becomes a fan around its first corner
+    const WavefrontObjectReader::Group &first = reader.group(0);
+    EXPECT_TRUE(first.hasTexCoords);
+    ASSERT_EQ(3U, first.triangles.size());
+    expectTriangle(first.triangles[0], 0, 1, 2);
+    expectTriangle(first.triangles[1], 0, 2, 4);
+    expectTriangle(first.triangles[2], 0, 4, 3);
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        for (unsigned int j = 0; j < 3; j++)
+            EXPECT_EQ(first.triangles[i].vertexIndices[j], first.triangles[i].texCoordIndices[j]);
+    }
+
+    // negative indices count back from the last vertex read so far
+    const WavefrontObjectReader::Group &second = reader.group(1);
+    EXPECT_FALSE(second.hasTexCoords);
+    ASSERT_EQ(2U, second.triangles.size());
+    expectTriangle(second.triangles[0], 5, 6, 7);
+    EXPECT_EQ(UINT_MAX, second.triangles[0].texCoordIndices[0]);
+    EXPECT_TRUE(second.triangles[1].isQuad);
+    EXPECT_EQ(5U, second.triangles[1].vertexIndices[0]);
+    EXPECT_EQ(0U, second.triangles[1].vertexIndices[3]);
+
+    // a group without "vt" uses its own vertices as texture coordinates
+    vector<Vector3D> vertices, texCoords;
+    vector<TriQuad> triangles;
+    reader.groupIndexRepresentation(1, vertices, texCoords, triangles);
+    ASSERT_EQ(4U, vertices.size());
+    ASSERT_EQ(4U, texCoords.size());
+    expectVertex(vertices[0], 2.0f, 0.0f, 0.0f);
+    expectVertex(vertices[3], 0.0f, 0.0f, 0.0f);
+    expectTriangle(triangles[0], 0, 1, 2);
+    EXPECT_EQ(0U, triangles[1].vertexIndices[0]);
+    EXPECT_EQ(3U, triangles[1].vertexIndices[3]);
+    EXPECT_EQ(3U, triangles[1].texCoordIndices[3]);
+
+    reader.groupIndexRepresentation(0, vertices, texCoords, triangles);
+    EXPECT_EQ(5U, vertices.size());
+    EXPECT_EQ(5U, texCoords.size());
+}
+
+TEST(WavefrontObjectTest, ReaderParsesFloats)
+{
+    const char *tokens[] =
+    {
+        "0", "-0", "7.", ".5", "+3e+1", "1.5e3", "-2.5E-2", "1e22", "1e23", "9007199254740993",
+        "0.12345678901234567890123", "123456789012345678901234", "12345678901234567890.5",
+        "0.000000000000000000000000000001", "1e-40", "1.4e-45", "3.4028234663852886e38", "1e39",
+        "0.1000000000000000055511151231257827", "2.00000011920928955078125", "1e-99999"
+    };
+    unsigned int count = sizeof(tokens) / sizeof(tokens[0]);
+
+    string text;
+    for (unsigned int i = 0; i < count; i++)
+        text += string("v ") + tokens[i] + " 0 0\n";
+
+    WavefrontObjectReader reader;
+    read(reader, text);
+    ASSERT_EQ(count, reader.vertices().size());
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        float expected = (float)strtod(tokens[i], NULL);
+        EXPECT_EQ(floatBits(expected), floatBits(reader.vertices()[i].x)) << tokens[i];
+    }
+}
+
+TEST(WavefrontObjectTest, WriterFloatsReadBack)
+{
+    const float values[] = { 0.1f, 1.0f, -2.5f, 100.0f, 1e10f, 0.0001f, 123456792.0f };
+    const char *texts[] = { "0.1", "1", "-2.5", "100", "1e10", "0.0001", "123456790" };
+
+    char buffer[32];
+    for (unsigned int i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        char *end = WavefrontObjectWriter::formatFloat(values[i], buffer);
+        EXPECT_EQ(string(texts[i]), string(buffer, end));
+    }
+
+    // every exponent, denormals and the largest float
+    vector<float> floats;
+    uint32_t seed = 12345;
+    for (unsigned int i = 0; i < 20000; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        uint32_t bits = seed & 0xFFFFFFFF;
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        if (value == value && value - value == 0.0f)
+            floats.push_back(value);
+    }
+    floats.push_back(1.4e-45f);
+    floats.push_back(1.17549435e-38f);
+    floats.push_back(3.40282347e38f);
+
+    string text;
+    for (unsigned int i = 0; i < floats.size(); i++)
+    {
+        char *end = WavefrontObjectWriter::formatFloat(floats[i], buffer);
+        *end = '\0';
+        EXPECT_EQ(floatBits(floats[i]), floatBits(strtof(buffer, NULL))) << buffer;
+        text += string("v ") + buffer + " 0 0\n";
+    }
+
+    WavefrontObjectReader reader;
+    read(reader, text);
+    ASSERT_EQ(floats.size(), reader.vertices().size());
+    for (unsigned int i = 0; i < floats.size(); i++)
+        ASSERT_EQ(floatBits(floats[i]), floatBits(reader.vertices()[i].x)) << i;
+}
+
+// Written groups read back with the same positions and texture coordinates,
+// corners in reverse order like the writer flips them.
+TEST(WavefrontObjectTest, WriterRoundTrip)
+{
+    Mesh2 *cube = new Mesh2();
+    cube->make(MeshType::Cube, 0);
+    Mesh2 *sphere = new Mesh2();
+    sphere->make(MeshType::Sphere, 8);
+
+    Matrix4x4 identity, transform;
+    transform.Translate(3.0f, -1.0f, 0.25f);
+
+    WavefrontObjectWriter writer;
+    writer.setComment("round trip");
+    writer.addGroup("cube", cube, identity);
+    writer.addGroup("sphere", sphere, transform);
+
+    MemoryWriteStream stream;
+    writer.write(&stream);
+
+    WavefrontObjectReader reader;
+    reader.read((const char *)stream.bytes(), stream.length());
+    EXPECT_EQ(0U, reader.skippedFaces());
+    ASSERT_EQ(2U, reader.groupCount());
+    EXPECT_EQ("cube", reader.group(0).name);
+    EXPECT_EQ("sphere", reader.group(1).name);
+
+    Mesh2 *meshes[] = { cube, sphere };
+    const Matrix4x4 *transforms[] = { &identity, &transform };
+    const unsigned int flippedCorners[] = { 2, 1, 0, 3 };
+
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        vector<Vector3D> vertices, texCoords, readVertices, readTexCoords;
+        vector<TriQuad> triangles, readTriangles;
+        meshes[i]->toIndexRepresentation(vertices, texCoords, triangles);
+        reader.groupIndexRepresentation(i, readVertices, readTexCoords, readTriangles);
+
+        ASSERT_EQ(triangles.size(), readTriangles.size());
+        EXPECT_EQ(vertices.size(), readVertices.size());
+
+        for (unsigned int j = 0; j < triangles.size(); j++)
+        {
+            const TriQuad &triQuad = triangles[j];
+            const TriQuad &readTriQuad = readTriangles[j];
+            ASSERT_EQ(triQuad.isQuad, readTriQuad.isQuad);
+
+            for (unsigned int k = 0; k < (triQuad.isQuad ? 4U : 3U); k++)
+            {
+                unsigned int corner = flippedCorners[k];
+                Vector3D position = transforms[i]->Transform(vertices[triQuad.vertexIndices[corner]]);
+                const Vector3D &readPosition = readVertices[readTriQuad.vertexIndices[k]];
+                EXPECT_EQ(floatBits(position.x), floatBits(readPosition.x));
+                EXPECT_EQ(floatBits(position.y), floatBits(readPosition.y));
+                EXPECT_EQ(floatBits(position.z), floatBits(readPosition.z));
+
+                const Vector3D &texCoord = texCoords[triQuad.texCoordIndices[corner]];
+                const Vector3D &readTexCoord = readTexCoords[readTriQuad.texCoordIndices[k]];
+                EXPECT_EQ(floatBits(texCoord.x), floatBits(readTexCoord.x));
+                EXPECT_EQ(floatBits(texCoord.y), floatBits(readTexCoord.y));
+            }
+        }
+    }
+
+    cube->release();
+    sphere->release();
+}